@@ -33,8 +33,126 @@
 #define MIN_TEMP 26
 #define MAX_TEMP 33
 
+/* Scheduled fires (rise, spike, spreading fire) for the Simulator to play out */
+/* Edit the file and re-run the Sim, no need to recompile - see src-simulator/thermal.h */
+#define SCENARIO_FILE "scenario.txt"
 
-/* Slows down all timings by multiplying milliseconds by this no. */
-/* Does not affect DURATION or DISPLAYING STATUS */
-/* Must be at least 1 (1 = no change) */
-#define SLOW_MOTION 1
\ No newline at end of file
+/* Seed for the simulated temperatures, the same seed gives the same temperatures */
+/* 0 = different every run */
+#define TEMP_SEED 0
+
+/* Seed for the cars (plates, entrances, exits & parking times), the same seed gives the same cars */
+/* 0 = different every run */
+#define SEED 0
+
+/* Fire detection algorithm used by the Fire Alarm System */
+/* "rise+spike" (default - both algorithms above), "rise", "spike", "ewma", "cusum", "regression" */
+/* Compare them with ./DETECTOR-BENCH before switching */
+#define DETECTOR "rise+spike"
+
+/* Adaptive sampling - 1 = monitors sample less often while temps are low & steady */
+/* 0 = always sample every 2ms */
+#define ADAPTIVE_SAMPLING 1
+
+/* Longest time (ms) a monitor may wait between samples when adaptive sampling is on */
+/* Worst-case detection delay is the 2ms delay plus at most this - must be at least 2 */
+#define MAX_SAMPLE_INTERVAL 50
+
+/* Real-time profile for the Fire Alarm System - 1 = on, 0 = off */
+/* Fire detecting & acting threads run SCHED_FIFO, memory is locked & prefaulted */
+/* Needs root (or CAP_SYS_NICE & CAP_IPC_LOCK), otherwise warns and runs as normal */
+#define RT_PROFILE 0
+
+/* CPUs reserved for the fire detecting & acting threads when RT_PROFILE is on */
+/* -1 = do not pin, must be below the no. of CPUs */
+#define RT_DETECT_CPU -1
+#define RT_ACTUATE_CPU -1
+
+/* Fire Alarm System liveness - each of its threads beats at least every HEARTBEAT_PERIOD ms */
+/* (the monitors too, however long their adaptive sample interval) */
+/* If any beat stops for WATCHDOG_TIMEOUT ms, or no thread has started WATCHDOG_GRACE + WATCHDOG_TIMEOUT ms */
+/* after the Manager did, the Manager fails safe (raises gates, signs show 'F') */
+/* HEARTBEAT_PERIOD must be at least 1, WATCHDOG_TIMEOUT must be above it, WATCHDOG_GRACE at least 0 */
+#define HEARTBEAT_PERIOD 20
+#define WATCHDOG_TIMEOUT 250
+#define WATCHDOG_GRACE 5000
+
+/* Metrics for Prometheus (or curl) at http://127.0.0.1:<port>/metrics, this machine only */
+/* Simulator on METRICS_PORT, Manager on METRICS_PORT + 1, Fire Alarm System on METRICS_PORT + 2 */
+/* 0 = off, otherwise 1024..65533 */
+#define METRICS_PORT 9310
+
+/* Span tracing of cars across all 3 programs - 1 = on, 0 = off (compiled out, costs nothing) */
+/* Each program writes trace-<program>.txt when it ends, ./TRACE-MERGE joins them into trace.json */
+/* Open trace.json in chrome://tracing or https://ui.perfetto.dev */
+#define TRACE 0
+
+/* Lock contention profiling of the device & program locks - 1 = on, 0 = off (plain pthread calls) */
+/* Each program prints its locks ranked by time waited when it ends, */
+/* and live with curl http://127.0.0.1:<metrics port>/locks (needs METRICS_PORT) */
+#define LOCK_PROFILE 0
+
+/* Lossless log of every LPR plate, gate, sign & alarm change, car spawned and bill - 1 = on, 0 = off */
+/* Each program appends events-<program>.bin while it runs, ./EVENT-DECODE prints them as 1 timeline */
+/* (./MICRO-BENCH builds its copy with -DEVENT_LOG=1 to measure it) */
+#ifndef EVENT_LOG
+#define EVENT_LOG 0
+#endif
+
+/* Live status feed - the Manager publishes every change on this Unix socket, "" = off */
+/* Watch from any no. of terminals with ./STATUS-VIEWER, attaching & detaching at any time */
+#define STATUS_SOCKET "/tmp/carpark-status.sock"
+
+/* Cars arriving per second, the Sim spawns them at random (Poisson) gaps on a fixed schedule */
+/* whether or not the car park keeps up - 0 = a car every 1..100ms at random (the original) */
+#define ARRIVAL_RATE 0
+
+/* Traffic profile - Poisson, bursty & rush hour arrivals, entrance weights & parking times */
+/* Edit the file and re-run the Sim, no need to recompile - see src-simulator/traffic.h */
+/* Any arrival phase in the file replaces ARRIVAL_RATE */
+#define TRAFFIC_FILE "traffic.txt"
+
+/* Threads generating the traffic profile's cars, 1..8, add more if the Sim reports generator lag */
+#define GENERATORS 1
+
+/* Threads moving the cars inside (parking, leaving, driving to an exit), 1..64 - each parked car */
+/* is a few dozen bytes in a timer wheel rather than a thread, add more if the Sim reports late moves */
+#define LIFECYCLE_WORKERS 2
+
+/* Balancing cars between the entrance queues & between the exit queues */
+/* 0 = off, cars keep the entrance/exit they were sent to (the original) */
+/* 1 = shortest queue, cars join the shortest line when they arrive */
+/* 2 = work stealing, an idle entrance/exit takes the car at the back of the longest line */
+#define BALANCE_MODE 0
+
+/* Headless - 1 = the Manager shows no status display & the Sim does not clear the terminal */
+/* for running under ./LOAD-TEST or with output to a file, 0 = off */
+#define HEADLESS 0
+
+/* Folder the Sim & Manager write their results to as JSON when they end, "" = off */
+/* (simulator.json & manager.json, throughput, queue waits & decision latency percentiles) */
+#define RESULTS_DIR ""
+
+/* File the Sim captures every LPR reading to (entrance, exit & level, timestamped) */
+/* for ./LPR-REPLAY to replay to the Manager without the Sim, "" = off */
+#define LPR_CAPTURE ""
+
+/* File the Sim & Manager save the car park to when they end (queued & parked cars, bills, */
+/* capacity & revenue), "" = off. Both may name the same file, each keeps its own part */
+#define CHECKPOINT_FILE ""
+
+/* File the Sim & Manager carry on from when they start, rather than an empty car park, "" = off */
+/* (a checkpoint of the same ENTRANCES, EXITS, LEVELS & CAPACITY, start the Sim first) */
+#define RESTORE_FILE ""
+
+/* ENTRANCES, EXITS, LEVELS, CAPACITY, CHANCE, SEED, DURATION, METRICS_PORT, ARRIVAL_RATE, TRAFFIC_FILE, GENERATORS, */
+/* LIFECYCLE_WORKERS, BALANCE_MODE, HEADLESS, RESULTS_DIR, LPR_CAPTURE, STATUS_SOCKET, CHECKPOINT_FILE, RESTORE_FILE */
+/* & SPEED may be overridden without re-building, */
+/* CARPARK_<NAME>=value, see ./LOAD-TEST & ./SWEEP */
+
+
+/* Speed of simulated time - every timing in all 3 programs (parking, gates, LPRs, temperatures, */
+/* heartbeats, traffic.txt and billing) runs on the Sim's clock, this many times as fast as real time */
+/* 0.5 = slow motion at half speed, 60 = fast-forward (an hour in a minute), 1 = real time */
+/* Does not affect DURATION (real seconds) or how often the status display refreshes - 0.001..1000 */
+#define SPEED 1.0
\ No newline at end of file
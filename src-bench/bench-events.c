@@ -0,0 +1,88 @@
+/************************************************
+ * @file    bench-events.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Benchmarks of the event log (event-log.h) shared
+ *          by the 3 programs: threads logging into their own
+ *          rings, and threads beyond EVENT_RINGS sharing the
+ *          overflow ring. The drainer writes every event to
+ *          events-micro-bench.bin as it would in a program
+ *          (removed afterwards), so a thread waiting on a full
+ *          ring is part of the time taken. The log must take
+ *          1M+ events a second, under 1000 ns/op.
+ *
+ *          Built with EVENT_LOG 1 whatever config.h says (see
+ *          the Makefile), as the programs' logging compiles
+ *          out otherwise.
+ ***********************************************/
+#include <stdio.h>      /* for IO operations */
+#include <string.h>     /* for string operations */
+
+#include "micro-bench.h"                /* for running benchmarks */
+#include "../src-common/event-log.h"    /* for the event log */
+
+#define EVENT_OPS 100000    /* events per repetition, of all threads together */
+#define EVENT_BENCH_FILE "events-micro-bench.bin"
+
+/* How many threads log & whether they have rings of their own */
+typedef struct event_bench_t {
+    int threads;
+    int overflow;       /* 1 = every thread logs into the overflow ring */
+} event_bench_t;
+
+/* function prototypes */
+static double log_events(void *ctx);
+static void log_events_work(void *ctx, int thread);
+
+void bench_events(void) {
+    event_init("micro-bench", 5, 5, 5);
+
+    /* -----------------------------------------------
+     *   EACH THREAD IN ITS OWN RING (NO LOCK, NO
+     *   LOCKED INSTRUCTION) & ALL IN THE OVERFLOW RING
+     * -------------------------------------------- */
+    int threads[3] = {1, 2, 4};
+    for (int i = 0; i < 3; i++) {
+        event_bench_t eb = {.threads = threads[i], .overflow = 0};
+        bench_run("event_log", "ns/op", EVENT_OPS, threads[i], log_events, &eb);
+    }
+    for (int i = 0; i < 3; i++) {
+        event_bench_t eb = {.threads = threads[i], .overflow = 1};
+        bench_run("event_log_overflow", "ns/op", EVENT_OPS, threads[i], log_events, &eb);
+    }
+
+    event_stop();
+    remove(EVENT_BENCH_FILE);
+}
+
+/**
+ * @brief Threads log plate events as fast as they can.
+ *
+ * @param ctx - the event_bench_t
+ * @return double - ns per event of all threads together
+ */
+static double log_events(void *ctx) {
+    event_bench_t *eb = (event_bench_t *)ctx;
+    uint64_t taken = bench_parallel(eb->threads, log_events_work, eb);
+
+    return (double)taken / ((EVENT_OPS / eb->threads) * eb->threads);
+}
+
+/**
+ * @brief 1 thread of log_events. A thread of the overflow case looks
+ * attached without a ring, as a thread beyond EVENT_RINGS would.
+ *
+ * @param ctx - the event_bench_t
+ * @param thread - thread no.
+ */
+static void log_events_work(void *ctx, int thread) {
+    event_bench_t *eb = (event_bench_t *)ctx;
+    char plate[8];
+
+    if (eb->overflow) {
+        event_mine = NULL;
+        event_tid = (uint16_t)(thread + 1);
+    }
+    bench_plate(thread, plate);
+    for (int i = 0; i < EVENT_OPS / eb->threads; i++) event_log(EV_PLATE, (uint16_t)(i & 0xff), 0, plate, 0);
+}
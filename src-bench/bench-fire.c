@@ -0,0 +1,63 @@
+/************************************************
+ * @file    bench-fire.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Benchmarks of the Fire Alarm System's median
+ *          filter (bubble_sort), at the 5 temps it smooths
+ *          with and at larger windows.
+ ***********************************************/
+#include <stdio.h>      /* for IO operations */
+#include <string.h>     /* for string operations */
+
+#include "micro-bench.h"                        /* for running benchmarks */
+#include "../src-fire-alarm-system/detectors.h" /* for the median filter */
+
+#define MAX_WINDOW 100      /* temps per median at most */
+#define WINDOWS 64          /* different windows sorted in turn */
+#define MEDIAN_OPS 20000    /* medians per repetition */
+
+/* Unsorted windows of raw temps and how many temps each median takes */
+typedef struct median_bench_t {
+    int size;
+    int temps[WINDOWS][MAX_WINDOW];
+} median_bench_t;
+
+static median_bench_t mb;
+
+/* function prototypes */
+static double medians(void *ctx);
+
+void bench_fire(void) {
+    uint32_t seed = 1;
+
+    /* raw temps around a quiet carpark's 20-30 degrees */
+    for (int w = 0; w < WINDOWS; w++) {
+        for (int t = 0; t < MAX_WINDOW; t++) mb.temps[w][t] = 20 + (int)(bench_rand(&seed) % 11);
+    }
+
+    int sizes[3] = {MEDIAN_WINDOW, 30, MAX_WINDOW};
+    for (int i = 0; i < 3; i++) {
+        mb.size = sizes[i];
+        bench_run("bubble_sort_median", "ns/op", sizes[i], 1, medians, &mb);
+    }
+}
+
+/**
+ * @brief Takes the median of unsorted windows in turn, each copied
+ * first (as smoother_push does) so every sort starts unsorted.
+ *
+ * @param ctx - the median_bench_t
+ * @return double - ns per median, including the copy
+ */
+static double medians(void *ctx) {
+    median_bench_t *m = (median_bench_t *)ctx;
+    int sorted[MAX_WINDOW];
+    volatile int median = 0; /* kept so the calls are not optimised away */
+    uint64_t start = mono_ns();
+
+    for (int i = 0; i < MEDIAN_OPS; i++) {
+        memcpy(sorted, m->temps[i % WINDOWS], sizeof(int) * (size_t)m->size);
+        median += bubble_sort(sorted, m->size);
+    }
+    return (double)(mono_ns() - start) / MEDIAN_OPS;
+}
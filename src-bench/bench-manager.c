@@ -0,0 +1,202 @@
+/************************************************
+ * @file    bench-manager.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Benchmarks of the Manager's code: hashing plates,
+ *          adding, finding & deleting them in its # tables
+ *          (alone and shared by threads under 1 lock, like
+ *          the entrances & exits share them) and validating
+ *          plates.txt lines.
+ ***********************************************/
+#include <stdio.h>      /* for IO operations */
+#include <string.h>     /* for string operations */
+#include <pthread.h>    /* for thread operations */
+
+#include "micro-bench.h"                        /* for running benchmarks */
+#include "../src-manager/plates-hash-table.h"   /* for # tables */
+
+#define TABLE_SIZE 100      /* buckets, as the Manager's tables have */
+#define MAX_PLATES 10000    /* plates per table at most */
+#define FIND_OPS 100000     /* finds per repetition when threaded */
+
+/* A # table of 'count' plates and what a benchmark does with it */
+typedef struct table_bench_t {
+    htab_t *h;
+    pthread_mutex_t lock;
+    int count;          /* plates in the table */
+    int threads;
+    char (*plates)[8];  /* plates to add/find/delete, writable as the table uppercases them */
+} table_bench_t;
+
+static char plates[MAX_PLATES][8];
+static char checked[MAX_PLATES][8];
+
+/* function prototypes */
+static double hash_plates(void *ctx);
+static double add_plates(void *ctx);
+static double find_plates(void *ctx);
+static double delete_plates(void *ctx);
+static double find_locked(void *ctx);
+static void find_locked_work(void *ctx, int thread);
+static double validate_plates(void *ctx);
+
+void bench_manager(void) {
+    /* every plate different, so deleting them all empties a table */
+    for (int i = 0; i < MAX_PLATES; i++) {
+        bench_plate(i * 1279, plates[i]);
+        strcpy(checked[i], plates[i]);
+        if (i % 4 == 3) checked[i][i % 6] = (i % 8 == 3) ? '#' : '\0'; /* wrong character or too short */
+    }
+
+    /* -----------------------------------------------
+     *   HASHING - ONCE PER ADD, FIND & DELETE BELOW
+     * -------------------------------------------- */
+    table_bench_t all = {.count = MAX_PLATES, .plates = plates};
+    bench_run("hash", "ns/op", MAX_PLATES, 1, hash_plates, &all);
+
+    /* -----------------------------------------------
+     *   ADD, FIND & DELETE - TABLES FILLED FROM THE
+     *   MANAGER'S 100 BUCKETS TO 100 PLATES EACH,
+     *   1 TABLE PER SIZE, EMPTIED BY EACH REPETITION
+     * -------------------------------------------- */
+    int counts[3] = {100, 1000, 10000};
+    for (int i = 0; i < 3; i++) {
+        table_bench_t tb = {.count = counts[i], .threads = 1, .plates = plates};
+        tb.h = new_hashtable(TABLE_SIZE, MEM_OTHER);
+        bench_run("hashtable_add", "ns/op", tb.count, 1, add_plates, &tb);
+
+        for (int p = 0; p < tb.count; p++) hashtable_add(tb.h, plates[p], 1);
+        bench_run("hashtable_find", "ns/op", tb.count, 1, find_plates, &tb);
+        for (int p = 0; p < tb.count; p++) hashtable_delete(tb.h, plates[p]);
+
+        bench_run("hashtable_delete", "ns/op", tb.count, 1, delete_plates, &tb);
+        hashtable_destroy(tb.h);
+    }
+
+    int threads[3] = {1, 2, 4};
+    for (int i = 0; i < 3; i++) {
+        table_bench_t tb = {.count = 1000, .threads = threads[i], .plates = plates};
+        tb.h = new_hashtable(TABLE_SIZE, MEM_OTHER);
+        pthread_mutex_init(&tb.lock, NULL);
+        for (int p = 0; p < tb.count; p++) hashtable_add(tb.h, plates[p], 1);
+        bench_run("hashtable_find_locked", "ns/op", tb.count, threads[i], find_locked, &tb);
+        pthread_mutex_destroy(&tb.lock);
+        hashtable_destroy(tb.h);
+    }
+
+    /* -----------------------------------------------
+     *            VALIDATING plates.txt LINES
+     * -------------------------------------------- */
+    bench_run("validate_plate_manager", "ns/op", MAX_PLATES, 1, validate_plates, checked);
+}
+
+/**
+ * @brief Hashes every plate into the Manager's no. of buckets.
+ *
+ * @param ctx - the table_bench_t
+ * @return double - ns per plate
+ */
+static double hash_plates(void *ctx) {
+    table_bench_t *tb = (table_bench_t *)ctx;
+    volatile size_t keys = 0; /* kept so the calls are not optimised away */
+    uint64_t start = mono_ns();
+
+    for (int i = 0; i < tb->count; i++) keys += hash(tb->plates[i], TABLE_SIZE);
+    return (double)(mono_ns() - start) / tb->count;
+}
+
+/**
+ * @brief Adds every plate to an empty table, then empties it again
+ * outside the time taken.
+ *
+ * @param ctx - the table_bench_t, its table empty
+ * @return double - ns per plate
+ */
+static double add_plates(void *ctx) {
+    table_bench_t *tb = (table_bench_t *)ctx;
+    uint64_t start = mono_ns();
+
+    for (int i = 0; i < tb->count; i++) hashtable_add(tb->h, tb->plates[i], 1);
+    uint64_t taken = mono_ns() - start;
+
+    for (int i = 0; i < tb->count; i++) hashtable_delete(tb->h, tb->plates[i]);
+    return (double)taken / tb->count;
+}
+
+/**
+ * @brief Finds every plate in a full table.
+ *
+ * @param ctx - the table_bench_t, its table holding every plate
+ * @return double - ns per plate
+ */
+static double find_plates(void *ctx) {
+    table_bench_t *tb = (table_bench_t *)ctx;
+    volatile int found = 0; /* kept so the calls are not optimised away */
+    uint64_t start = mono_ns();
+
+    for (int i = 0; i < tb->count; i++) found += (hashtable_find(tb->h, tb->plates[i]) != NULL);
+    return (double)(mono_ns() - start) / tb->count;
+}
+
+/**
+ * @brief Deletes every plate from a full table, filled outside the
+ * time taken.
+ *
+ * @param ctx - the table_bench_t, its table empty
+ * @return double - ns per plate
+ */
+static double delete_plates(void *ctx) {
+    table_bench_t *tb = (table_bench_t *)ctx;
+
+    for (int i = 0; i < tb->count; i++) hashtable_add(tb->h, tb->plates[i], 1);
+    uint64_t start = mono_ns();
+    for (int i = 0; i < tb->count; i++) hashtable_delete(tb->h, tb->plates[i]);
+    return (double)(mono_ns() - start) / tb->count;
+}
+
+/**
+ * @brief Threads find plates in a shared table, taking its lock for each.
+ *
+ * @param ctx - the table_bench_t, its table holding every plate
+ * @return double - ns per find of all threads together
+ */
+static double find_locked(void *ctx) {
+    table_bench_t *tb = (table_bench_t *)ctx;
+    uint64_t taken = bench_parallel(tb->threads, find_locked_work, tb);
+
+    return (double)taken / ((FIND_OPS / tb->threads) * tb->threads);
+}
+
+/**
+ * @brief 1 thread of find_locked, each starting at a different plate.
+ *
+ * @param ctx - the table_bench_t
+ * @param thread - thread no.
+ */
+static void find_locked_work(void *ctx, int thread) {
+    table_bench_t *tb = (table_bench_t *)ctx;
+    char plate[8];
+
+    for (int i = 0; i < FIND_OPS / tb->threads; i++) {
+        /* own copy, as finding uppercases the plate in place */
+        strcpy(plate, tb->plates[(i + (thread * 97)) % tb->count]);
+        pthread_mutex_lock(&tb->lock);
+        hashtable_find(tb->h, plate);
+        pthread_mutex_unlock(&tb->lock);
+    }
+}
+
+/**
+ * @brief Validates every plate with the Manager's validate_plate.
+ *
+ * @param ctx - MAX_PLATES plates, 3 in 4 valid
+ * @return double - ns per plate
+ */
+static double validate_plates(void *ctx) {
+    char (*p)[8] = (char (*)[8])ctx;
+    volatile int valid = 0; /* kept so the calls are not optimised away */
+    uint64_t start = mono_ns();
+
+    for (int i = 0; i < MAX_PLATES; i++) valid += validate_plate(p[i]);
+    return (double)(mono_ns() - start) / MAX_PLATES;
+}
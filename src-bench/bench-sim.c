@@ -0,0 +1,277 @@
+/************************************************
+ * @file    bench-sim.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Benchmarks of the Simulator's code: its queues,
+ *          random plates, validating plates.txt, how late
+ *          its millisecond sleeps wake and its timer wheel.
+ ***********************************************/
+#include <stdio.h>      /* for IO operations */
+#include <string.h>     /* for string operations */
+#include <pthread.h>    /* for thread operations */
+
+#include "micro-bench.h"                /* for running benchmarks */
+#include "../src-simulator/queue.h"     /* for queues */
+#include "../src-simulator/sleep.h"     /* for sleeping */
+#include "../src-simulator/spawn-cars.h" /* for random plates */
+#include "../src-simulator/sim-common.h" /* for the Sim's globals */
+#include "../src-simulator/timer-wheel.h" /* for parking cars */
+
+#define QUEUE_OPS 100000    /* pushes & pops per repetition */
+#define PLATE_OPS 100000    /* plates per repetition */
+#define PLATES 10000        /* plates validated per repetition */
+#define WHEEL_SLOTS 4096    /* as the Sim's car lifecycles */
+#define MAX_PARKED 100000   /* most cars in the wheel */
+
+/* -----------------------------------------------
+ *   THE SIM'S GLOBALS ITS CODE NEEDS, AS DEFINED
+ *   IN simulator.c FOR THE SIM ITSELF
+ * -------------------------------------------- */
+volatile _Atomic int end_simulation = 0;
+volatile void *shm;
+pthread_mutex_t rand_lock = PTHREAD_MUTEX_INITIALIZER;
+queue_t **en_queues;
+queue_t **ex_queues;
+pthread_mutex_t en_queues_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_mutex_t ex_queues_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t en_queues_cond = PTHREAD_COND_INITIALIZER;
+pthread_cond_t ex_queues_cond = PTHREAD_COND_INITIALIZER;
+
+/* the Sim's validate_plate, renamed when built for the bench (see Makefile) */
+bool sim_validate_plate(char *p);
+
+/* A queue and what a benchmark does with it */
+typedef struct queue_bench_t {
+    queue_t q;
+    pthread_mutex_t lock;
+    int depth;          /* cars in the queue throughout */
+    int threads;
+    car_t *cars;        /* cars to push, 'depth' + 1 */
+} queue_bench_t;
+
+/* Plates to validate, 3 in 4 valid */
+typedef struct plates_bench_t {
+    char plates[PLATES][8];
+} plates_bench_t;
+
+/* A sleep and how many to time per repetition */
+typedef struct sleep_bench_t {
+    int ms;
+    int count;
+} sleep_bench_t;
+
+/* Cars parked in a timer wheel, each due 100..10000ms after the start */
+typedef struct wheel_bench_t {
+    int parked;
+    wheel_entry_t *entries; /* 'parked' of them */
+} wheel_bench_t;
+
+static car_t cars[10001];
+static plates_bench_t plates;
+static wheel_entry_t entries[MAX_PARKED];
+
+/* function prototypes */
+static double queue_push_pop(void *ctx);
+static double queue_locked(void *ctx);
+static void queue_locked_work(void *ctx, int thread);
+static double random_plates(void *ctx);
+static void random_plates_work(void *ctx, int thread);
+static double validate_plates(void *ctx);
+static double sleep_late(void *ctx);
+static double wheel_park(void *ctx);
+
+void bench_sim(void) {
+    uint32_t seed = 42;
+
+    /* -----------------------------------------------
+     *  QUEUES - FILL TO A DEPTH THEN EMPTY, ALONE AND
+     *  SHARED BY THREADS UNDER 1 LOCK LIKE THE SIM'S
+     * -------------------------------------------- */
+    int depths[3] = {1, 100, 10000};
+    for (int i = 0; i < 3; i++) {
+        queue_bench_t qb = {.depth = depths[i], .threads = 1, .cars = cars};
+        init_queue(&qb.q);
+        bench_run("queue_push_pop", "ns/op", depths[i], 1, queue_push_pop, &qb);
+    }
+
+    int threads[3] = {1, 2, 4};
+    for (int i = 0; i < 3; i++) {
+        queue_bench_t qb = {.depth = 100, .threads = threads[i], .cars = cars};
+        init_queue(&qb.q);
+        pthread_mutex_init(&qb.lock, NULL);
+        for (int c = 0; c < qb.depth; c++) push_queue(&qb.q, &cars[c]);
+        bench_run("queue_push_pop_locked", "ns/op", qb.depth, threads[i], queue_locked, &qb);
+        while (pop_queue(&qb.q) != NULL); /* not empty_queue, the cars are not on the heap */
+        pthread_mutex_destroy(&qb.lock);
+    }
+
+    /* -----------------------------------------------
+     *   RANDOM PLATES - EACH CALL TAKES THE RAND LOCK
+     *   6 TIMES, SO THREADS CONTEND LIKE THE SIM'S
+     * -------------------------------------------- */
+    for (int i = 0; i < 3; i++) {
+        bench_run("random_plate", "ns/op", PLATE_OPS, threads[i], random_plates, &threads[i]);
+    }
+
+    /* -----------------------------------------------
+     *            VALIDATING plates.txt LINES
+     * -------------------------------------------- */
+    for (int i = 0; i < PLATES; i++) {
+        bench_plate((int)(bench_rand(&seed) % 12812904), plates.plates[i]);
+        if (i % 4 == 3) plates.plates[i][i % 6] = (i % 8 == 3) ? '#' : '\0'; /* wrong character or too short */
+    }
+    bench_run("validate_plate_sim", "ns/op", PLATES, 1, validate_plates, &plates);
+
+    /* -----------------------------------------------
+     *     SLEEPS - HOW LATE sleep_for_millis WAKES
+     * -------------------------------------------- */
+    sleep_bench_t sleeps[3] = {{1, 20}, {2, 20}, {10, 5}};
+    for (int i = 0; i < 3; i++) {
+        bench_run("sleep_for_millis", "us late", sleeps[i].ms, 1, sleep_late, &sleeps[i]);
+    }
+
+    /* -----------------------------------------------
+     *   TIMER WHEEL - PARK CARS, THEN TICK EVERY MS
+     *   UNTIL ALL OF THEM HAVE LEFT, LIKE THE SIM'S
+     * -------------------------------------------- */
+    for (int i = 0; i < MAX_PARKED; i++) entries[i].due = 100 + (bench_rand(&seed) % 9901);
+    int parked[3] = {100, 10000, MAX_PARKED};
+    for (int i = 0; i < 3; i++) {
+        wheel_bench_t wb = {.parked = parked[i], .entries = entries};
+        bench_run("timer_wheel_park", "ns/car", parked[i], 1, wheel_park, &wb);
+    }
+}
+
+/**
+ * @brief Fills a queue to its depth then empties it, until QUEUE_OPS
+ * cars have been pushed & popped.
+ *
+ * @param ctx - the queue_bench_t
+ * @return double - ns per push & pop
+ */
+static double queue_push_pop(void *ctx) {
+    queue_bench_t *qb = (queue_bench_t *)ctx;
+    int rounds = QUEUE_OPS / qb->depth;
+    uint64_t start = mono_ns();
+
+    for (int r = 0; r < rounds; r++) {
+        for (int c = 0; c < qb->depth; c++) push_queue(&qb->q, &qb->cars[c]);
+        for (int c = 0; c < qb->depth; c++) pop_queue(&qb->q);
+    }
+    return (double)(mono_ns() - start) / (rounds * qb->depth);
+}
+
+/**
+ * @brief Threads push & pop a shared queue, taking its lock for each.
+ *
+ * @param ctx - the queue_bench_t, already 'depth' deep
+ * @return double - ns per push & pop of all threads together
+ */
+static double queue_locked(void *ctx) {
+    queue_bench_t *qb = (queue_bench_t *)ctx;
+    uint64_t taken = bench_parallel(qb->threads, queue_locked_work, qb);
+
+    return (double)taken / ((QUEUE_OPS / qb->threads) * qb->threads);
+}
+
+/**
+ * @brief 1 thread of queue_locked.
+ *
+ * @param ctx - the queue_bench_t
+ * @param thread - thread no.
+ */
+static void queue_locked_work(void *ctx, int thread) {
+    queue_bench_t *qb = (queue_bench_t *)ctx;
+
+    (void)thread;
+    for (int i = 0; i < QUEUE_OPS / qb->threads; i++) {
+        pthread_mutex_lock(&qb->lock);
+        push_queue(&qb->q, &qb->cars[qb->depth]);
+        pthread_mutex_unlock(&qb->lock);
+        pthread_mutex_lock(&qb->lock);
+        pop_queue(&qb->q);
+        pthread_mutex_unlock(&qb->lock);
+    }
+}
+
+/**
+ * @brief Threads each give cars random plates.
+ *
+ * @param ctx - no. of threads
+ * @return double - ns per plate of all threads together
+ */
+static double random_plates(void *ctx) {
+    int threads = *(int *)ctx;
+    uint64_t taken = bench_parallel(threads, random_plates_work, &threads);
+
+    return (double)taken / ((PLATE_OPS / threads) * threads);
+}
+
+/**
+ * @brief 1 thread of random_plates.
+ *
+ * @param ctx - no. of threads
+ * @param thread - thread no.
+ */
+static void random_plates_work(void *ctx, int thread) {
+    int threads = *(int *)ctx;
+    car_t c;
+
+    (void)thread;
+    for (int i = 0; i < PLATE_OPS / threads; i++) random_plate(&c);
+}
+
+/**
+ * @brief Validates every plate with the Sim's validate_plate.
+ *
+ * @param ctx - the plates_bench_t
+ * @return double - ns per plate
+ */
+static double validate_plates(void *ctx) {
+    plates_bench_t *pb = (plates_bench_t *)ctx;
+    volatile int valid = 0; /* kept so the calls are not optimised away */
+    uint64_t start = mono_ns();
+
+    for (int i = 0; i < PLATES; i++) valid += sim_validate_plate(pb->plates[i]);
+    return (double)(mono_ns() - start) / PLATES;
+}
+
+/**
+ * @brief Sleeps several times, measuring how late each wakes.
+ *
+ * @param ctx - the sleep_bench_t
+ * @return double - average us woken after the time asked for
+ */
+static double sleep_late(void *ctx) {
+    sleep_bench_t *sb = (sleep_bench_t *)ctx;
+    double late = 0;
+
+    for (int i = 0; i < sb->count; i++) {
+        uint64_t start = mono_ns();
+        sleep_for_millis(sb->ms);
+        late += (double)(mono_ns() - start) / 1000 - (sb->ms * 1000);
+    }
+    return late / sb->count;
+}
+
+/**
+ * @brief Parks every car in a new wheel, then moves it on 1ms at a
+ * time until every car is due, as the Sim's ticker does.
+ *
+ * @param ctx - the wheel_bench_t
+ * @return double - ns per car parked & taken out, ticks included
+ */
+static double wheel_park(void *ctx) {
+    wheel_bench_t *wb = (wheel_bench_t *)ctx;
+    wheel_t w;
+    int left = 0;
+    uint64_t start = mono_ns();
+
+    if (wheel_init(&w, WHEEL_SLOTS, 0) != 0) return 0;
+    for (int i = 0; i < wb->parked; i++) wheel_add(&w, &wb->entries[i]);
+    for (int ms = 1; w.count > 0; ms++) {
+        for (wheel_entry_t *e = wheel_advance(&w, ms); e != NULL; e = e->next) left++;
+    }
+    wheel_destroy(&w);
+    return (left == wb->parked) ? (double)(mono_ns() - start) / wb->parked : 0;
+}
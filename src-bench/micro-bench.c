@@ -0,0 +1,248 @@
+/************************************************
+ * @file    micro-bench.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Main file for ./MICRO-BENCH, runs every benchmark
+ *          and reports them (see micro-bench.h).
+ *
+ *          ./MICRO-BENCH [-r REPS] [-w REPS] [-b NAME] [-o FILE]
+ *
+ *          -r REPS   repetitions kept per benchmark (default 10)
+ *          -w REPS   warm up repetitions thrown away (default 2)
+ *          -b NAME   only benchmarks whose name contains NAME
+ *          -o FILE   results as JSON (default micro-bench.json)
+ ***********************************************/
+#include <stdio.h>      /* for IO operations */
+#include <stdlib.h>     /* for atoi & qsort */
+#include <string.h>     /* for string operations */
+#include <math.h>       /* for sqrt */
+#include <unistd.h>     /* for no. of CPUs */
+#include <pthread.h>    /* for threads */
+
+#include "micro-bench.h" /* corresponding header */
+
+#define MAX_SERIES 128
+
+/* Results of 1 benchmark */
+typedef struct series_t {
+    const char *name;
+    const char *unit;
+    int size;
+    int threads;
+    int reps;
+    double samples[BENCH_MAX_REPS];
+} series_t;
+
+/* Summary of a series' repetitions */
+typedef struct stats_t {
+    double min;
+    double median;
+    double mean;
+    double stddev;
+    double max;
+} stats_t;
+
+/* 1 thread of bench_parallel */
+typedef struct worker_t {
+    void (*work)(void *ctx, int thread);
+    void *ctx;
+    int thread;
+    pthread_barrier_t *start;
+} worker_t;
+
+static series_t series[MAX_SERIES];
+static int series_count = 0;
+static int reps = 10;
+static int warmup = 2;
+static const char *filter = NULL;
+
+/* function prototypes */
+static stats_t summarise(series_t *s);
+static int compare(const void *a, const void *b);
+static void write_json(const char *path);
+static void *worker(void *arg);
+
+/**
+ * @brief Entry point for MICRO-BENCH.
+ *
+ * @param argc - argument count
+ * @param argv - see the file's brief
+ * @return int - 0 once every benchmark is written, 1 if the arguments are wrong
+ */
+int main(int argc, char **argv) {
+    const char *out = "micro-bench.json";
+
+    for (int i = 1; i < argc; i++) {
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if (value != NULL && strcmp(argv[i], "-r") == 0) {
+            reps = atoi(value);
+        } else if (value != NULL && strcmp(argv[i], "-w") == 0) {
+            warmup = atoi(value);
+        } else if (value != NULL && strcmp(argv[i], "-b") == 0) {
+            filter = value;
+        } else if (value != NULL && strcmp(argv[i], "-o") == 0) {
+            out = value;
+        } else {
+            puts("usage: ./MICRO-BENCH [-r REPS] [-w REPS] [-b NAME] [-o FILE]");
+            return 1;
+        }
+        i++;
+    }
+    if (reps < 1 || reps > BENCH_MAX_REPS || warmup < 0) {
+        printf("~REPS must be 1..%d and the warm up at least 0\n", BENCH_MAX_REPS);
+        return 1;
+    }
+
+    printf("~%d repetitions (after %d to warm up) on %ld CPUs\n", reps, warmup, sysconf(_SC_NPROCESSORS_ONLN));
+    printf("%-26s %7s %7s %12s %12s %12s %10s %12s\n", "benchmark", "size", "threads", "min", "median", "mean", "stddev", "max");
+    bench_sim();
+    bench_manager();
+    bench_fire();
+    bench_events();
+
+    write_json(out);
+    printf("~Results written to %s\n", out);
+    return 0;
+}
+
+void bench_run(const char *name, const char *unit, int size, int threads, double (*rep)(void *ctx), void *ctx) {
+    if ((filter != NULL && strstr(name, filter) == NULL) || series_count >= MAX_SERIES) return;
+
+    series_t *s = &series[series_count++];
+    s->name = name;
+    s->unit = unit;
+    s->size = size;
+    s->threads = threads;
+    s->reps = reps;
+
+    for (int i = 0; i < warmup; i++) rep(ctx);
+    for (int i = 0; i < reps; i++) s->samples[i] = rep(ctx);
+
+    stats_t st = summarise(s);
+    printf("%-26s %7d %7d %12.1f %12.1f %12.1f %10.1f %12.1f %s\n", name, size, threads,
+        st.min, st.median, st.mean, st.stddev, st.max, unit);
+    fflush(stdout);
+}
+
+uint64_t bench_parallel(int threads, void (*work)(void *ctx, int thread), void *ctx) {
+    pthread_t ids[BENCH_MAX_THREADS];
+    worker_t workers[BENCH_MAX_THREADS];
+    pthread_barrier_t start;
+
+    if (threads < 1) threads = 1;
+    if (threads > BENCH_MAX_THREADS) threads = BENCH_MAX_THREADS;
+
+    /* every thread is created and waiting before the clock starts */
+    pthread_barrier_init(&start, NULL, (unsigned)threads + 1);
+    for (int i = 0; i < threads; i++) {
+        workers[i] = (worker_t){work, ctx, i, &start};
+        pthread_create(&ids[i], NULL, worker, &workers[i]);
+    }
+    pthread_barrier_wait(&start);
+    uint64_t began = mono_ns();
+    for (int i = 0; i < threads; i++) pthread_join(ids[i], NULL);
+    uint64_t taken = mono_ns() - began;
+
+    pthread_barrier_destroy(&start);
+    return taken;
+}
+
+void bench_plate(int n, char *out) {
+    out[0] = "123456789"[n % 9];
+    out[1] = "123456789"[(n / 9) % 9];
+    out[2] = "123456789"[(n / 81) % 9];
+    out[3] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"[(n / 729) % 26];
+    out[4] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"[(n / 18954) % 26];
+    out[5] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"[(n / 492804) % 26];
+    out[6] = '\0';
+}
+
+uint32_t bench_rand(uint32_t *seed) {
+    /* xorshift32 */
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 17;
+    *seed ^= *seed << 5;
+    return *seed;
+}
+
+/**
+ * @brief Summarises a series' repetitions.
+ *
+ * @param s - series with at least 1 repetition
+ * @return stats_t - min, median, mean, standard deviation & max
+ */
+static stats_t summarise(series_t *s) {
+    double sorted[BENCH_MAX_REPS];
+    double sum = 0;
+    double squares = 0;
+    stats_t st;
+
+    memcpy(sorted, s->samples, sizeof(double) * (size_t)s->reps);
+    qsort(sorted, (size_t)s->reps, sizeof(double), compare);
+    for (int i = 0; i < s->reps; i++) sum += sorted[i];
+    st.mean = sum / s->reps;
+    for (int i = 0; i < s->reps; i++) squares += (sorted[i] - st.mean) * (sorted[i] - st.mean);
+
+    st.min = sorted[0];
+    st.max = sorted[s->reps - 1];
+    st.median = (s->reps % 2) ? sorted[s->reps / 2] : (sorted[(s->reps / 2) - 1] + sorted[s->reps / 2]) / 2;
+    st.stddev = (s->reps > 1) ? sqrt(squares / (s->reps - 1)) : 0;
+    return st;
+}
+
+/**
+ * @brief Orders doubles ascending, for qsort.
+ *
+ * @param a - 1st double
+ * @param b - 2nd double
+ * @return int - below, at or above 0 as a is below, equal to or above b
+ */
+static int compare(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Writes every benchmark's summary and repetitions as JSON.
+ *
+ * @param path - file to write
+ */
+static void write_json(const char *path) {
+    FILE *fp = fopen(path, "w");
+
+    if (fp == NULL) {
+        perror(path);
+        return;
+    }
+    fprintf(fp, "{\n\"cpus\": %ld,\n\"reps\": %d,\n\"warmup\": %d,\n\"benchmarks\": [", sysconf(_SC_NPROCESSORS_ONLN), reps, warmup);
+    for (int i = 0; i < series_count; i++) {
+        series_t *s = &series[i];
+        stats_t st = summarise(s);
+
+        fprintf(fp, "%s\n{\"name\": \"%s\", \"unit\": \"%s\", \"size\": %d, \"threads\": %d, ", (i > 0) ? "," : "",
+            s->name, s->unit, s->size, s->threads);
+        fprintf(fp, "\"min\": %.3f, \"median\": %.3f, \"mean\": %.3f, \"stddev\": %.3f, \"max\": %.3f, \"samples\": [",
+            st.min, st.median, st.mean, st.stddev, st.max);
+        for (int r = 0; r < s->reps; r++) fprintf(fp, "%s%.3f", (r > 0) ? ", " : "", s->samples[r]);
+        fprintf(fp, "]}");
+    }
+    fprintf(fp, "\n]\n}\n");
+    fclose(fp);
+}
+
+/**
+ * @brief Runs 1 thread of bench_parallel once all have started.
+ *
+ * @param arg - the thread's worker_t
+ * @return void* - NULL
+ */
+static void *worker(void *arg) {
+    worker_t *w = (worker_t *)arg;
+
+    pthread_barrier_wait(w->start);
+    w->work(w->ctx, w->thread);
+    return NULL;
+}
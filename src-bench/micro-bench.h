@@ -0,0 +1,90 @@
+/************************************************
+ * @file    micro-bench.h
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   API for the microbenchmarks of the data structures
+ *          & kernels on the hot path (./MICRO-BENCH), so any
+ *          replacement can be justified with numbers against
+ *          the current code.
+ *
+ *          A benchmark is a function measuring 1 repetition
+ *          (such as ns per push & pop of a queue 100 deep).
+ *          bench_run calls it for the warm up, whose results
+ *          are thrown away, then for each repetition, and
+ *          keeps every result for the report: min, median,
+ *          mean, standard deviation & max, printed and written
+ *          as JSON.
+ *
+ *          The benchmarks of each program's code are in their
+ *          own file (bench-sim.c, bench-manager.c and
+ *          bench-fire.c, plus bench-events.c for the event
+ *          log they share), as the programs' headers clash.
+ ***********************************************/
+#pragma once
+
+#include <stdint.h>     /* for int types */
+
+#include "../src-common/sim-clock.h" /* for timing (mono_ns) */
+
+#define BENCH_MAX_REPS 100  /* repetitions kept per benchmark */
+#define BENCH_MAX_THREADS 8 /* threads bench_parallel runs at most */
+
+/**
+ * @brief Runs 1 benchmark (unless filtered out): the warm up, then
+ * every repetition, keeping the results for the report.
+ *
+ * @param name - what is measured, such as "queue_push_pop"
+ * @param unit - what 'rep' returns, such as "ns/op"
+ * @param size - items, depth, window... (what it means is in the name's doc)
+ * @param threads - threads the benchmark runs on
+ * @param rep - measures 1 repetition, returning the result in 'unit'
+ * @param ctx - passed to 'rep'
+ */
+void bench_run(const char *name, const char *unit, int size, int threads, double (*rep)(void *ctx), void *ctx);
+
+/**
+ * @brief Runs a function on several threads at once and times them
+ * from when they all start to when the last one ends.
+ *
+ * @param threads - no. of threads, 1..BENCH_MAX_THREADS
+ * @param work - run by each thread, given 'ctx' & its thread no. 0..threads-1
+ * @param ctx - passed to 'work'
+ * @return uint64_t - ns taken
+ */
+uint64_t bench_parallel(int threads, void (*work)(void *ctx, int thread), void *ctx);
+
+/**
+ * @brief Writes a valid plate (111AAA) that is different for each no.
+ *
+ * @param n - which plate, 0..12812903
+ * @param out - 7 chars, '\0' terminated
+ */
+void bench_plate(int n, char *out);
+
+/**
+ * @brief A cheap random no. for filling inputs, not timed.
+ *
+ * @param seed - state, updated
+ * @return uint32_t - next no.
+ */
+uint32_t bench_rand(uint32_t *seed);
+
+/**
+ * @brief Runs the benchmarks of the Sim's queues, plates & sleeps.
+ */
+void bench_sim(void);
+
+/**
+ * @brief Runs the benchmarks of the Manager's # tables & plates.
+ */
+void bench_manager(void);
+
+/**
+ * @brief Runs the benchmarks of the Fire Alarm System's median filter.
+ */
+void bench_fire(void);
+
+/**
+ * @brief Runs the benchmarks of the event log, in own & overflow rings.
+ */
+void bench_events(void);
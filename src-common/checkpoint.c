@@ -0,0 +1,143 @@
+/************************************************
+ * @file    checkpoint.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Source code for checkpoint.h
+ ***********************************************/
+#include <stdio.h>      /* for IO operations */
+#include <string.h>     /* for string operations */
+#include <fcntl.h>      /* for opening the file */
+#include <unistd.h>     /* for reading & writing */
+#include <sys/file.h>   /* for locking the file */
+#include <sys/stat.h>   /* for the file's size */
+
+#include "checkpoint.h" /* corresponding header */
+#include "mem-account.h" /* for accounting memory */
+
+/* function prototypes */
+static char *load(int fd, size_t *size);
+static const checkpoint_header_t *next_part(const char *file, size_t size, size_t *at);
+
+int checkpoint_write(const char *path, checkpoint_part_t part, uint64_t run, const void *data, size_t size) {
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+    flock(fd, LOCK_EX);
+
+    /* -----------------------------------------------
+     *  KEEP THE OTHER PROGRAM'S PART FROM THIS RUN,
+     *  THEN ADD (OR REPLACE) THIS PROGRAM'S
+     * -------------------------------------------- */
+    size_t old_size = 0;
+    char *old = load(fd, &old_size);
+    char *file = mem_malloc(old_size + sizeof(checkpoint_header_t) + size, MEM_CHECKPOINT);
+    size_t used = 0;
+    int written = -1;
+
+    if (file != NULL) {
+        const checkpoint_header_t *h;
+        size_t at = 0;
+        while ((h = next_part(old, old_size, &at)) != NULL) {
+            if (h->part == (uint32_t)part || h->run != run) continue;
+            memcpy(file + used, h, sizeof(*h) + h->size);
+            used += sizeof(*h) + h->size;
+        }
+
+        checkpoint_header_t mine = {CHECKPOINT_MAGIC, CHECKPOINT_VERSION, (uint32_t)part, run, size};
+        memcpy(file + used, &mine, sizeof(mine));
+        memcpy(file + used + sizeof(mine), data, size);
+        used += sizeof(mine) + size;
+
+        if (pwrite(fd, file, used, 0) == (ssize_t)used && ftruncate(fd, (off_t)used) == 0 && fsync(fd) == 0) written = 0;
+        else perror(path);
+        mem_free(file);
+    }
+    if (old != NULL) mem_free(old);
+
+    flock(fd, LOCK_UN);
+    close(fd);
+    return written;
+}
+
+void *checkpoint_read(const char *path, checkpoint_part_t part, uint64_t *run, size_t *size) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    flock(fd, LOCK_SH);
+
+    size_t file_size = 0;
+    char *file = load(fd, &file_size);
+    flock(fd, LOCK_UN);
+    close(fd);
+    if (file == NULL) return NULL;
+
+    const checkpoint_header_t *h;
+    size_t at = 0;
+    char *found = NULL;
+    while ((h = next_part(file, file_size, &at)) != NULL) {
+        if (h->part != (uint32_t)part) continue;
+        found = mem_malloc(h->size, MEM_CHECKPOINT);
+        if (found != NULL) {
+            memcpy(found, (const char *)(h + 1), h->size);
+            *run = h->run;
+            *size = h->size;
+        }
+        break;
+    }
+    mem_free(file);
+    return found;
+}
+
+double checkpoint_rebase(double when, double at) {
+    if (when == 0) return 0;
+
+    /* a stage reached just as the checkpoint was taken is still reached */
+    double rebased = when - at;
+    return (rebased == 0) ? -0.001 : rebased;
+}
+
+/**
+ * @brief Reads a whole checkpoint file.
+ *
+ * @param fd - the file, locked
+ * @param size - set to its bytes
+ * @return char* - its bytes (free with mem_free), NULL if empty or unreadable
+ */
+static char *load(int fd, size_t *size) {
+    struct stat st;
+
+    *size = 0;
+    if (fstat(fd, &st) < 0 || st.st_size <= 0) return NULL;
+
+    char *file = mem_malloc((size_t)st.st_size, MEM_CHECKPOINT);
+    if (file == NULL) return NULL;
+    if (pread(fd, file, (size_t)st.st_size, 0) != st.st_size) {
+        mem_free(file);
+        return NULL;
+    }
+    *size = (size_t)st.st_size;
+    return file;
+}
+
+/**
+ * @brief Steps to the next whole part of a checkpoint file, stopping
+ * at the first header that is not one (an older version, or a file
+ * cut short).
+ *
+ * @param file - the file's bytes
+ * @param size - bytes of the file
+ * @param at - offset of the part, moved past it
+ * @return const checkpoint_header_t* - the part's header, NULL at the end
+ */
+static const checkpoint_header_t *next_part(const char *file, size_t size, size_t *at) {
+    if (file == NULL || *at + sizeof(checkpoint_header_t) > size) return NULL;
+
+    const checkpoint_header_t *h = (const checkpoint_header_t *)(file + *at);
+    if (memcmp(h->magic, CHECKPOINT_MAGIC, sizeof(h->magic)) != 0 || h->version != CHECKPOINT_VERSION
+        || h->part >= CHECKPOINT_PARTS || h->size > size - *at - sizeof(*h)) {
+        return NULL;
+    }
+    *at += sizeof(*h) + h->size;
+    return h;
+}
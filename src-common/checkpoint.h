@@ -0,0 +1,147 @@
+/************************************************
+ * @file    checkpoint.h
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   API for the checkpoint file the Simulator & Manager
+ *          save the car park's state to when they end, and
+ *          resume from when they start, so a long soak test can
+ *          be stopped & carried on, and a benchmark can start
+ *          from a warm car park rather than an empty one.
+ *
+ *          A checkpoint is taken at the end of a run, once
+ *          every thread has returned, so no car is moving and
+ *          no lock is held. The file holds 1 part per program,
+ *          each a header then the program's state:
+ *
+ *          Simulator - the PARKING devices, every car waiting
+ *          at an entrance or exit & every car inside (where it
+ *          is up to and when its next move is due)
+ *
+ *          Manager - the billing table (each car's level and
+ *          when it entered), the capacity of each level, the
+ *          revenue & no. of cars entered
+ *
+ *          Each program replaces only its own part, so they can
+ *          end in any order. Both parts are stamped with the
+ *          run (the Sim's clock), and every time in them is on
+ *          that 1 clock, so they agree on when the checkpoint
+ *          was taken. On restore, the Manager keeps only the
+ *          bills of cars the Sim's part has inside, so a car
+ *          caught at a gate as the run ended is not billed
+ *          forever.
+ *
+ *          Saving is off unless CHECKPOINT_FILE in config.h (or
+ *          CARPARK_CHECKPOINT_FILE) names a file, restoring is
+ *          off unless RESTORE_FILE (or CARPARK_RESTORE_FILE) does.
+ ***********************************************/
+#pragma once
+
+#include <stddef.h>     /* for size_t */
+#include <stdint.h>     /* for int types */
+
+#define CHECKPOINT_MAGIC "CARPARK" /* first 8 bytes of every part (with the '\0') */
+#define CHECKPOINT_VERSION 1
+#define CHECKPOINT_STAMPS 16        /* journey stamps kept per car, at least CAR_STAMPS */
+#define CHECKPOINT_LEVELS 5
+#define CHECKPOINT_ENTERED 4        /* stamp of driving through the entrance gate (STAMP_ENTERED) */
+
+/* Which program a part belongs to */
+typedef enum checkpoint_part_t {
+    CHECKPOINT_SIMULATOR,
+    CHECKPOINT_MANAGER,
+    CHECKPOINT_PARTS    /* no. of parts */
+} checkpoint_part_t;
+
+/* Where a car in the Sim's part is */
+typedef enum checkpoint_place_t {
+    CHECKPOINT_EN_QUEUE,    /* waiting at an entrance */
+    CHECKPOINT_INSIDE,      /* driving in, parked or driving out */
+    CHECKPOINT_EX_QUEUE     /* waiting at an exit */
+} checkpoint_place_t;
+
+/* Before each part */
+typedef struct checkpoint_header_t {
+    char magic[8];      /* CHECKPOINT_MAGIC */
+    uint32_t version;   /* CHECKPOINT_VERSION */
+    uint32_t part;      /* checkpoint_part_t */
+    uint64_t run;       /* the Sim's clock origin, the same in both parts of 1 run */
+    uint64_t size;      /* bytes of the part after this header */
+} checkpoint_header_t;
+
+/* The Sim's part, followed by 'devices' bytes of PARKING then 'cars' checkpoint_car_t */
+typedef struct checkpoint_sim_t {
+    double at;          /* sim_now_ms when taken */
+    int32_t ens;
+    int32_t exs;
+    int32_t lvls;
+    int32_t cap;
+    uint32_t devices;   /* bytes of the PARKING devices, PARKING_STATUS_OFFSET */
+    uint32_t cars;
+} checkpoint_sim_t;
+
+/* 1 car in the Sim's part, every time on the Sim's clock */
+typedef struct checkpoint_car_t {
+    char plate[8];
+    int32_t place;      /* checkpoint_place_t */
+    int32_t index;      /* entrance or exit it waits at, or the exit it will leave by */
+    int32_t floor;      /* level it was assigned, -1 before */
+    int32_t state;      /* its lifecycle state when inside (car_state_t) */
+    int32_t seq;        /* spawned n-th */
+    int32_t exit;       /* exit it will leave by, once parked */
+    double duration;    /* ms it parks for */
+    double due;         /* its next move when inside */
+    double stamps[CHECKPOINT_STAMPS]; /* when it reached each stage, 0 = not yet */
+} checkpoint_car_t;
+
+/* The Manager's part, followed by 'bills' checkpoint_bill_t */
+typedef struct checkpoint_man_t {
+    int32_t lvls;
+    int32_t revenue;    /* cents */
+    int32_t cars_entered;
+    uint32_t bills;
+    int32_t capacity[CHECKPOINT_LEVELS];
+    int32_t padding;
+} checkpoint_man_t;
+
+/* 1 car in the billing table */
+typedef struct checkpoint_bill_t {
+    char plate[8];
+    int32_t level;
+    int32_t padding;
+    double start;       /* sim_now_ms it entered */
+} checkpoint_bill_t;
+
+/**
+ * @brief Saves a program's part, keeping the other program's part only
+ * if it was taken in the same run. The file is locked while it is
+ * rewritten, so the Sim & Manager may save at the same time.
+ *
+ * @param path - checkpoint file, created if missing
+ * @param part - the program saving
+ * @param run - the Sim's clock origin (see parking-status.h)
+ * @param data - the part
+ * @param size - bytes of the part
+ * @return int - 0 on success, -1 if the file could not be written
+ */
+int checkpoint_write(const char *path, checkpoint_part_t part, uint64_t run, const void *data, size_t size);
+
+/**
+ * @brief Loads a program's part.
+ *
+ * @param path - checkpoint file
+ * @param part - the part to load
+ * @param run - set to the run it was taken in
+ * @param size - set to its bytes
+ * @return void* - the part (free with mem_free), NULL if the file or part is missing or damaged
+ */
+void *checkpoint_read(const char *path, checkpoint_part_t part, uint64_t *run, size_t *size);
+
+/**
+ * @brief Moves a time from the checkpoint's clock to this run's, as
+ * if the checkpoint was taken at simulated 0, keeping 0 as 'not yet'.
+ *
+ * @param when - sim_now_ms when saved, 0 = not yet
+ * @param at - sim_now_ms the checkpoint was taken
+ * @return double - the same moment on this run's clock, 0 = not yet
+ */
+double checkpoint_rebase(double when, double at);
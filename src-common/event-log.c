@@ -0,0 +1,276 @@
+/************************************************
+ * @file    event-log.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Source code for event-log.h
+ ***********************************************/
+#include <stdio.h>      /* for IO operations */
+#include <string.h>     /* for string operations */
+#include <unistd.h>     /* for getpid */
+#include <pthread.h>    /* for the drainer thread & thread keys */
+#include <sched.h>      /* for yielding while a ring is full */
+
+#include "event-log.h"  /* corresponding header */
+
+#if EVENT_LOG
+
+#define DRAIN_BATCH 1024    /* events written per fwrite */
+#define DRAIN_IDLE_MS 1     /* drainer's nap when every ring is empty */
+
+_Thread_local event_ring_t *event_mine = NULL;
+_Thread_local uint64_t event_room = 0;
+_Thread_local uint16_t event_tid = 0;
+
+/* -----------------------------------------------
+ *                      RINGS
+ * -----------------------------------------------
+ * Owned rings have 1 producer (the owner) & 1
+ * consumer (the drainer). The overflow ring has
+ * many producers, each claims a slot by bumping
+ * enqueue, then publishes it by setting the
+ * slot's seq (Vyukov's bounded queue).
+ */
+typedef struct overflow_slot_t {
+    volatile _Atomic uint64_t seq;  /* = position once written, position + 1 once read */
+    event_t event;
+} overflow_slot_t;
+
+static event_ring_t rings[EVENT_RINGS];
+static overflow_slot_t overflow[EVENT_OVERFLOW];
+static volatile _Atomic uint64_t enqueue = 0;
+static uint64_t dequeue = 0;                    /* drainer only */
+
+static volatile _Atomic uint32_t threads_seen = 0;
+static volatile _Atomic uint64_t stalls = 0;    /* times a producer waited for room */
+static volatile _Atomic uint64_t dropped = 0;   /* logged after event_stop */
+static volatile _Atomic int draining = 0;       /* 1 = drainer running */
+static volatile _Atomic int stopping = 0;
+
+static pthread_key_t ring_key;
+static pthread_once_t ring_key_once = PTHREAD_ONCE_INIT;
+static pthread_t drainer;
+static FILE *log_fp = NULL;
+static char log_name[64];
+static uint64_t written = 0;                    /* drainer only */
+static event_t batch[DRAIN_BATCH];              /* drainer only */
+
+/* function prototypes */
+static void make_key(void);
+static void detach(void *ring);
+static void *drain(void *args);
+static int drain_once(void);
+static void write_event(const event_t *e, size_t *n);
+
+event_ring_t *event_attach(void) {
+    event_ring_t *r = NULL;
+
+    pthread_once(&ring_key_once, make_key);
+    for (int i = 0; i < EVENT_RINGS && r == NULL; i++) {
+        int free_ring = EVENT_RING_FREE;
+        if (atomic_compare_exchange_strong(&rings[i].state, &free_ring, EVENT_RING_OWNED)) r = &rings[i];
+    }
+    event_tid = (uint16_t)(atomic_fetch_add(&threads_seen, 1) + 1);
+
+    if (r != NULL) {
+        event_room = atomic_load_explicit(&r->tail, memory_order_acquire) + EVENT_RING_EVENTS;
+        pthread_setspecific(ring_key, r);
+    }
+    event_mine = r;
+    return r;
+}
+
+void event_slow(const event_t *e) {
+    event_ring_t *r = event_mine;
+    int stalled = 0;
+
+    if (r != NULL) {
+        /* the cached room ran out, see how far the drainer has got */
+        uint64_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+        event_room = atomic_load_explicit(&r->tail, memory_order_acquire) + EVENT_RING_EVENTS;
+        while (head >= event_room) {
+            if (!atomic_load(&draining) && atomic_load(&stopping)) {
+                atomic_fetch_add(&dropped, 1);
+                return;
+            }
+            stalled = 1;
+            sched_yield();
+            event_room = atomic_load_explicit(&r->tail, memory_order_acquire) + EVENT_RING_EVENTS;
+        }
+        r->events[head & (EVENT_RING_EVENTS - 1)] = *e;
+        atomic_store_explicit(&r->head, head + 1, memory_order_release);
+    } else {
+        /* no ring of its own, claim a slot of the overflow ring */
+        uint64_t pos = atomic_load_explicit(&enqueue, memory_order_relaxed);
+        for (;;) {
+            overflow_slot_t *slot = &overflow[pos & (EVENT_OVERFLOW - 1)];
+            uint64_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+
+            if (seq == pos) {
+                if (atomic_compare_exchange_weak_explicit(&enqueue, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed)) {
+                    slot->event = *e;
+                    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+                    break;
+                }
+            } else if (seq < pos) {
+                /* full, wait for the drainer */
+                if (!atomic_load(&draining) && atomic_load(&stopping)) {
+                    atomic_fetch_add(&dropped, 1);
+                    return;
+                }
+                stalled = 1;
+                sched_yield();
+                pos = atomic_load_explicit(&enqueue, memory_order_relaxed);
+            } else {
+                pos = atomic_load_explicit(&enqueue, memory_order_relaxed);
+            }
+        }
+    }
+    if (stalled) atomic_fetch_add(&stalls, 1);
+}
+
+/**
+ * @brief Creates the key whose destructor releases rings.
+ */
+static void make_key(void) {
+    pthread_key_create(&ring_key, detach);
+}
+
+/**
+ * @brief Releases an ended thread's ring, the drainer frees it once empty.
+ *
+ * @param ring - the ring
+ */
+static void detach(void *ring) {
+    atomic_store(&((event_ring_t *)ring)->state, EVENT_RING_RELEASED);
+}
+
+/**
+ * @brief Drainer thread, appends every ring to the log until stopped.
+ *
+ * @param args - unused
+ * @return void* - NULL upon completion
+ */
+static void *drain(void *args) {
+    (void)args;
+    while (!atomic_load(&stopping)) {
+        if (drain_once() == 0) {
+            struct timespec nap = {0, DRAIN_IDLE_MS * 1000000};
+            nanosleep(&nap, NULL);
+        }
+    }
+    /* the logging threads have returned, take what is left */
+    while (drain_once() > 0) {}
+    atomic_store(&draining, 0);
+    return NULL;
+}
+
+/**
+ * @brief Appends every event logged so far, in batches.
+ *
+ * @return int - no. of events appended
+ */
+static int drain_once(void) {
+    size_t n = 0;
+    int total = 0;
+
+    for (int i = 0; i < EVENT_RINGS; i++) {
+        event_ring_t *r = &rings[i];
+        int state = atomic_load(&r->state);
+        if (state == EVENT_RING_FREE) continue;
+
+        uint64_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+        uint64_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+        for (uint64_t j = tail; j < head; j++) {
+            write_event(&r->events[j & (EVENT_RING_EVENTS - 1)], &n);
+            total++;
+
+            /* hand room back every batch, so a full ring's owner waits less */
+            if (n == 0) atomic_store_explicit(&r->tail, j + 1, memory_order_release);
+        }
+        atomic_store_explicit(&r->tail, head, memory_order_release);
+
+        /* a released ring is free once drained (its owner has ended, nothing more comes) */
+        if (state == EVENT_RING_RELEASED) atomic_store(&r->state, EVENT_RING_FREE);
+    }
+
+    for (;;) {
+        overflow_slot_t *slot = &overflow[dequeue & (EVENT_OVERFLOW - 1)];
+        if (atomic_load_explicit(&slot->seq, memory_order_acquire) != dequeue + 1) break;
+        write_event(&slot->event, &n);
+        total++;
+        atomic_store_explicit(&slot->seq, dequeue + EVENT_OVERFLOW, memory_order_release);
+        dequeue++;
+    }
+
+    if (n > 0) fwrite(batch, sizeof(event_t), n, log_fp);
+    written += (uint64_t)total;
+    return total;
+}
+
+/**
+ * @brief Adds an event to the batch, writing the batch once full.
+ *
+ * @param e - event
+ * @param n - events in the batch, updated (0 once written)
+ */
+static void write_event(const event_t *e, size_t *n) {
+    batch[(*n)++] = *e;
+    if (*n == DRAIN_BATCH) {
+        fwrite(batch, sizeof(event_t), *n, log_fp);
+        *n = 0;
+    }
+}
+
+#endif
+
+void event_init(const char *program, int ens, int exs, int lvls) {
+#if EVENT_LOG
+    event_header_t header;
+
+    snprintf(log_name, sizeof(log_name), EVENT_FILE, program);
+    log_fp = fopen(log_name, "wb");
+    if (log_fp == NULL) {
+        perror("fopen event log");
+        atomic_store(&stopping, 1); /* so loggers drop rather than wait */
+        return;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, EVENT_MAGIC, sizeof(EVENT_MAGIC));
+    header.version = EVENT_VERSION;
+    header.size = (uint32_t)sizeof(event_t);
+    header.pid = (int32_t)getpid();
+    header.ens = (uint8_t)ens;
+    header.exs = (uint8_t)exs;
+    header.lvls = (uint8_t)lvls;
+    snprintf(header.program, sizeof(header.program), "%s", program);
+    fwrite(&header, sizeof(header), 1, log_fp);
+
+    for (uint64_t i = 0; i < EVENT_OVERFLOW; i++) atomic_store(&overflow[i].seq, i);
+    atomic_store(&draining, 1);
+    if (pthread_create(&drainer, NULL, drain, NULL) != 0) {
+        perror("pthread_create event drainer");
+        atomic_store(&draining, 0);
+        atomic_store(&stopping, 1);
+    }
+#else
+    (void)program;
+    (void)ens;
+    (void)exs;
+    (void)lvls;
+#endif
+}
+
+void event_stop(void) {
+#if EVENT_LOG
+    if (log_fp == NULL) return;
+    if (atomic_load(&draining)) {
+        atomic_store(&stopping, 1);
+        pthread_join(drainer, NULL);
+    }
+    fclose(log_fp);
+    log_fp = NULL;
+    printf("~Events: %lu written to %s (%u threads, %lu waits for a full ring, %lu dropped after the end)\n",
+        (unsigned long)written, log_name, (unsigned)threads_seen, (unsigned long)stalls, (unsigned long)dropped);
+#endif
+}
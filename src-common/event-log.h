@@ -0,0 +1,189 @@
+/************************************************
+ * @file    event-log.h
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   API for a lossless log of what happened to the
+ *          car park in all 3 programs: every plate written
+ *          to an LPR, every gate & sign change, every alarm
+ *          change, plus each car spawned and each bill.
+ *
+ *          Only compiled in when EVENT_LOG is 1 in config.h,
+ *          otherwise every EVENT_ macro below expands to
+ *          nothing and costs nothing.
+ *
+ *          Every thread logs into its own ring (1 producer,
+ *          1 consumer, no lock), and a drainer thread appends
+ *          the rings to events-<program>.bin as fixed size
+ *          binary records. Unlike trace.h nothing is ever
+ *          overwritten: a full ring waits for the drainer,
+ *          and threads beyond EVENT_RINGS share a lock-free
+ *          overflow ring. Then:
+ *
+ *          ./EVENT-DECODE  (prints the 3 logs merged in time)
+ *
+ *          The rings, the overflow ring and the drainer's
+ *          write batch are all static arrays, so the Fire
+ *          Alarm System (MISRA C, no heap) can log as well.
+ ***********************************************/
+#pragma once
+
+#include <stdint.h>     /* for int types */
+#include <stdatomic.h>  /* for atomic loads & stores */
+#include <time.h>       /* for the clock */
+
+#include "../config.h"  /* for EVENT_LOG */
+
+#define EVENT_RINGS 128         /* threads with their own ring at once, the rest share the overflow ring */
+#define EVENT_RING_EVENTS 4096  /* events per ring (a power of 2) */
+#define EVENT_OVERFLOW 16384    /* events in the shared overflow ring (a power of 2) */
+#define EVENT_FILE "events-%s.bin" /* %s = program, such as simulator */
+#define EVENT_MAGIC "CPEVLOG"   /* first 8 bytes of every log file (with the '\0') */
+#define EVENT_VERSION 1
+
+/* What happened, keep event_names (event-decode.c) in the same order */
+typedef enum event_type_t {
+    EV_SET,             /* a gate, sign or alarm changed, value = the new char */
+    EV_PLATE,           /* a plate was written to an LPR, "" = LPR reset */
+    EV_SPAWN,           /* Sim: car spawned, arg = its sequence no. */
+    EV_BILL,            /* Manager: car billed, arg = cents */
+    EVENT_TYPES         /* no. of types */
+} event_type_t;
+
+/* 1 event, 24 bytes */
+typedef struct event_t {
+    uint64_t ns;        /* CLOCK_MONOTONIC so all 3 programs agree */
+    uint32_t arg;       /* see event_type_t */
+    uint16_t offset;    /* byte changed within the car park hardware, 0 if none */
+    uint16_t tid;       /* thread no. within the program */
+    uint8_t type;       /* event_type_t */
+    char value;         /* new char of EV_SET */
+    char plate[6];      /* car's plate, not '\0' terminated when 6 chars long */
+} event_t;
+
+/* Start of every log file, 64 bytes */
+typedef struct event_header_t {
+    char magic[8];      /* EVENT_MAGIC */
+    uint32_t version;   /* EVENT_VERSION */
+    uint32_t size;      /* sizeof(event_t) */
+    int32_t pid;
+    uint8_t ens;        /* no. of entrances, exits & levels, to tell offsets apart */
+    uint8_t exs;
+    uint8_t lvls;
+    uint8_t padding;
+    char program[40];
+} event_header_t;
+
+/* 1 thread's events, logged into by its owner & drained by the drainer */
+typedef struct event_ring_t {
+    _Alignas(64) volatile _Atomic uint64_t head;    /* written by the owner */
+    _Alignas(64) volatile _Atomic uint64_t tail;    /* written by the drainer */
+    _Alignas(64) volatile _Atomic int state;        /* EVENT_RING_ states below */
+    event_t events[EVENT_RING_EVENTS];
+} event_ring_t;
+
+#define EVENT_RING_FREE 0       /* may be claimed */
+#define EVENT_RING_OWNED 1      /* logged into by a thread */
+#define EVENT_RING_RELEASED 2   /* owner ended, freed once drained */
+
+/**
+ * @brief Opens events-<program>.bin and starts the drainer, before the
+ * program's threads start. Does nothing when EVENT_LOG is 0.
+ *
+ * @param program - such as "simulator"
+ * @param ens - no. of entrances
+ * @param exs - no. of exits
+ * @param lvls - no. of levels
+ */
+void event_init(const char *program, int ens, int exs, int lvls);
+
+/**
+ * @brief Drains every event left & closes the log, once the logging
+ * threads have returned. Does nothing when EVENT_LOG is 0.
+ */
+void event_stop(void);
+
+#if EVENT_LOG
+
+/* The calling thread's ring, NULL until it first logs */
+extern _Thread_local event_ring_t *event_mine;
+extern _Thread_local uint64_t event_room;   /* head the ring is known to have room up to */
+extern _Thread_local uint16_t event_tid;
+
+/**
+ * @brief Claims a ring for the calling thread, only called the first
+ * time a thread logs.
+ *
+ * @return event_ring_t* - the ring, NULL if none are free (use the overflow ring)
+ */
+event_ring_t *event_attach(void);
+
+/**
+ * @brief Appends to the calling thread's full ring once the drainer
+ * makes room, or to the overflow ring for threads without a ring.
+ *
+ * @param e - event to append
+ */
+void event_slow(const event_t *e);
+
+/**
+ * @brief Logs an event into the calling thread's ring.
+ *
+ * @param type - what happened
+ * @param offset - byte changed within the car park hardware, 0 if none
+ * @param value - new char of EV_SET
+ * @param plate - car's plate, NULL if none
+ * @param arg - see event_type_t
+ */
+static inline void event_log(event_type_t type, uint16_t offset, char value, const char *plate, uint32_t arg) {
+    event_ring_t *r = (event_mine != NULL || event_tid != 0) ? event_mine : event_attach(); /* tid set = attached */
+    struct timespec ts;
+    event_t e;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    e.ns = ((uint64_t)ts.tv_sec * 1000000000) + (uint64_t)ts.tv_nsec;
+    e.arg = arg;
+    e.offset = offset;
+    e.tid = event_tid;
+    e.type = (uint8_t)type;
+    e.value = value;
+    for (int i = 0; i < 6; i++) {
+        e.plate[i] = (plate != NULL) ? plate[i] : '\0';
+        if (e.plate[i] == '\0') plate = NULL; /* pad after the end of the plate */
+    }
+
+    if (r != NULL) {
+        uint64_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+        if (head < event_room) {
+            r->events[head & (EVENT_RING_EVENTS - 1)] = e;
+            atomic_store_explicit(&r->head, head + 1, memory_order_release);
+            return;
+        }
+    }
+    event_slow(&e);
+}
+
+/**
+ * @brief Finds a field's byte within the car park hardware.
+ *
+ * @param shm - first byte of shared memory
+ * @param field - the field
+ * @return uint16_t - bytes from the start of the shared memory
+ */
+static inline uint16_t event_offset(volatile void *shm, volatile void *field) {
+    return (uint16_t)((volatile char *)field - (volatile char *)shm);
+}
+
+/* Logs a gate, sign or alarm's new char */
+#define EVENT_SET(shm, field, value) event_log(EV_SET, event_offset((shm), (field)), (value), NULL, 0)
+/* Logs a plate written to an LPR */
+#define EVENT_PLATE(shm, field, plate) event_log(EV_PLATE, event_offset((shm), (field)), 0, (plate), 0)
+/* Logs an event that is not a hardware change */
+#define EVENT(type, plate, arg) event_log((type), 0, 0, (plate), (uint32_t)(arg))
+
+#else
+
+#define EVENT_SET(shm, field, value)
+#define EVENT_PLATE(shm, field, plate)
+#define EVENT(type, plate, arg)
+
+#endif
@@ -0,0 +1,84 @@
+/************************************************
+ * @file    hdr-histogram.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Source code for hdr-histogram.h
+ ***********************************************/
+#include <stdio.h>          /* for IO operations */
+
+#include "hdr-histogram.h"  /* corresponding header */
+
+/* function prototypes */
+static uint64_t highest(int index);
+
+void hdr_reset(hdr_t *h) {
+    for (int i = 0; i < HDR_COUNTS; i++) {
+        h->counts[i] = 0;
+    }
+    h->total = 0;
+    h->max = 0;
+}
+
+void hdr_merge(hdr_t *into, hdr_t *from) {
+    uint64_t total = 0;
+
+    /* count the buckets rather than trusting 'from's total, which
+    may be a value ahead or behind while its owner records */
+    for (int i = 0; i < HDR_COUNTS; i++) {
+        uint64_t n = atomic_load_explicit(&from->counts[i], memory_order_relaxed);
+        into->counts[i] += n;
+        total += n;
+    }
+    into->total += total;
+
+    uint64_t max = atomic_load_explicit(&from->max, memory_order_relaxed);
+    if (max > into->max) into->max = max;
+}
+
+uint64_t hdr_percentile(hdr_t *h, double percent) {
+    uint64_t wanted = (uint64_t)(((percent / 100) * (double)h->total) + 0.5);
+    uint64_t seen = 0;
+    uint64_t value = 0;
+
+    if (wanted < 1) wanted = 1;
+    for (int i = 0; i < HDR_COUNTS && h->total > 0 && seen < wanted; i++) {
+        seen += h->counts[i];
+        if (seen >= wanted) value = highest(i);
+    }
+
+    /* the top of a sub-bucket may be above anything actually recorded */
+    return (value > h->max) ? h->max : value;
+}
+
+void hdr_print(FILE *fp, const char *name, hdr_t *h) {
+    if (h->total > 0) {
+        fprintf(fp, "\t%-24s %8lu  p50 %9.1fus  p90 %9.1fus  p99 %9.1fus  p99.9 %9.1fus  max %9.1fus\n",
+            name, (unsigned long)h->total,
+            hdr_percentile(h, 50) / 1000.0, hdr_percentile(h, 90) / 1000.0,
+            hdr_percentile(h, 99) / 1000.0, hdr_percentile(h, 99.9) / 1000.0, h->max / 1000.0);
+    }
+}
+
+void hdr_json(FILE *fp, hdr_t *h) {
+    fprintf(fp, "{\"count\": %lu, \"p50_ms\": %.3f, \"p90_ms\": %.3f, \"p99_ms\": %.3f, \"p999_ms\": %.3f, \"max_ms\": %.3f}",
+        (unsigned long)h->total, hdr_percentile(h, 50) / 1e6, hdr_percentile(h, 90) / 1e6,
+        hdr_percentile(h, 99) / 1e6, hdr_percentile(h, 99.9) / 1e6, h->max / 1e6);
+}
+
+/**
+ * @brief Largest value counted at an index.
+ *
+ * @param index - index into counts
+ * @return uint64_t - ns
+ */
+static uint64_t highest(int index) {
+    uint64_t value = (uint64_t)index;
+
+    if (index >= HDR_SUB) {
+        int k = index - HDR_SUB;
+        int shift = (k / HDR_HALF) + 1;
+        uint64_t sub = (uint64_t)((k % HDR_HALF) + HDR_HALF);
+        value = (sub << shift) + (((uint64_t)1 << shift) - 1);
+    }
+    return value;
+}
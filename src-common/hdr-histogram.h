@@ -0,0 +1,110 @@
+/************************************************
+ * @file    hdr-histogram.h
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   API for HDR (high dynamic range) histograms of
+ *          durations in nanoseconds, precise enough to read
+ *          p99.9 from.
+ *
+ *          Each power of 2 range of values is split into
+ *          HDR_HALF equal sub-buckets, so any value is
+ *          counted within 1/HDR_HALF (under 2%) of itself,
+ *          from 1ns up to 2^HDR_MAX_BITS ns (about 18
+ *          minutes, larger values are counted as the largest).
+ *
+ *          Only 1 thread records into a histogram, so
+ *          recording is a plain load & add & store, while
+ *          other threads may merge & read it at any time.
+ ***********************************************/
+#pragma once
+
+#include <stdio.h>      /* for FILE type */
+#include <stdint.h>     /* for int types */
+#include <stdatomic.h>  /* for atomic loads & stores */
+
+#define HDR_SUB_BITS 7                      /* 128 values counted exactly */
+#define HDR_SUB (1 << HDR_SUB_BITS)
+#define HDR_HALF (HDR_SUB / 2)              /* sub-buckets per power of 2 after that */
+#define HDR_MAX_BITS 40                     /* largest value is 2^40 - 1 ns */
+#define HDR_COUNTS (HDR_SUB + ((HDR_MAX_BITS - HDR_SUB_BITS) * HDR_HALF))
+
+typedef struct hdr_t {
+    volatile _Atomic uint64_t counts[HDR_COUNTS];
+    volatile _Atomic uint64_t total;        /* values recorded */
+    volatile _Atomic uint64_t max;          /* largest value recorded */
+} hdr_t;
+
+/**
+ * @brief Empties a histogram.
+ *
+ * @param h - histogram to empty
+ */
+void hdr_reset(hdr_t *h);
+
+/**
+ * @brief Adds every count of 1 histogram to another.
+ *
+ * @param into - histogram to add to (nobody may record into it meanwhile)
+ * @param from - histogram to add, may still be recorded into
+ */
+void hdr_merge(hdr_t *into, hdr_t *from);
+
+/**
+ * @brief Finds the value below which a percentage of values fall.
+ *
+ * @param h - histogram to read
+ * @param percent - 0..100, such as 99.9
+ * @return uint64_t - ns (the top of its sub-bucket), 0 if empty
+ */
+uint64_t hdr_percentile(hdr_t *h, double percent);
+
+/**
+ * @brief Prints 1 line with the count, p50, p90, p99, p99.9 & max
+ * in microseconds, nothing if the histogram is empty.
+ *
+ * @param fp - where to print, such as stdout
+ * @param name - what the values are
+ * @param h - histogram to print
+ */
+void hdr_print(FILE *fp, const char *name, hdr_t *h);
+
+/**
+ * @brief Writes the count, p50, p90, p99, p99.9 & max in milliseconds
+ * as 1 JSON object, such as {"count": 12, "p50_ms": 0.8, ...}.
+ *
+ * @param fp - where to write
+ * @param h - histogram to write, all 0 if empty
+ */
+void hdr_json(FILE *fp, hdr_t *h);
+
+/**
+ * @brief Finds which count a value belongs in.
+ *
+ * @param ns - value
+ * @return int - index into counts
+ */
+static inline int hdr_index(uint64_t ns) {
+    int index;
+
+    if (ns >= ((uint64_t)1 << HDR_MAX_BITS)) ns = ((uint64_t)1 << HDR_MAX_BITS) - 1;
+    index = (int)ns;
+    if (ns >= HDR_SUB) {
+        int shift = (63 - __builtin_clzll(ns)) - (HDR_SUB_BITS - 1); /* 1 for 128..255, 2 for 256..511 ... */
+        index = HDR_SUB + ((shift - 1) * HDR_HALF) + (int)((ns >> shift) - HDR_HALF);
+    }
+    return index;
+}
+
+/**
+ * @brief Records a value, only ever called by the histogram's owner.
+ *
+ * @param h - histogram to record into
+ * @param ns - value
+ */
+static inline void hdr_record(hdr_t *h, uint64_t ns) {
+    volatile _Atomic uint64_t *c = &h->counts[hdr_index(ns)];
+
+    atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) + 1, memory_order_relaxed);
+    atomic_store_explicit(&h->total, atomic_load_explicit(&h->total, memory_order_relaxed) + 1, memory_order_relaxed);
+    if (ns > atomic_load_explicit(&h->max, memory_order_relaxed)) atomic_store_explicit(&h->max, ns, memory_order_relaxed);
+}
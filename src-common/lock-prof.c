@@ -0,0 +1,113 @@
+/************************************************
+ * @file    lock-prof.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Source code for lock-prof.h
+ ***********************************************/
+#include <stdio.h>      /* for IO operations */
+#include <stdarg.h>     /* for variable arguments */
+
+#include "lock-prof.h"  /* corresponding header */
+
+#define LOCKPROF_REPORT 8192 /* bytes for the printed report */
+
+static const char *lockprof_program = "program";
+
+#if LOCK_PROFILE
+
+lock_stats_t lock_stats[LOCK_IDS];
+
+/* names of the device locks (5 ids each), then the rest */
+static const char *device_names[] = {"entrance %d LPR", "entrance %d gate", "entrance %d sign",
+    "exit %d LPR", "exit %d gate", "level %d LPR"};
+static const char *other_names[LOCK_IDS - LK_RAND] = {"rand_lock", "en_queues_lock", "ex_queues_lock", "lifecycle_lock",
+    "auth_ht_lock", "bill_ht_lock", "curr_capacity_lock", "alarm_m"};
+
+/* function prototypes */
+static void put(char *buf, size_t size, size_t *len, const char *fmt, ...);
+
+#endif
+
+void lockprof_init(const char *program) {
+    lockprof_program = program;
+#if LOCK_PROFILE
+    metrics_page("/locks", lockprof_render);
+#endif
+}
+
+size_t lockprof_render(char *buf, size_t size) {
+    size_t len = 0;
+
+    if (size > 0) buf[0] = '\0';
+#if LOCK_PROFILE
+    int order[LOCK_IDS];
+    int count = 0;
+
+    /* rank the locks taken by time waited, most first (insertion sort, few locks) */
+    for (int id = 0; id < LOCK_IDS; id++) {
+        if (atomic_load(&lock_stats[id].acquired) == 0) continue;
+        int at = count++;
+        while (at > 0 && atomic_load(&lock_stats[order[at - 1]].wait_ns) < atomic_load(&lock_stats[id].wait_ns)) {
+            order[at] = order[at - 1];
+            at--;
+        }
+        order[at] = id;
+    }
+
+    put(buf, size, &len, "%s lock contention, ranked by time waited:\n", lockprof_program);
+    put(buf, size, &len, "\t%-20s %10s %10s %6s %11s %11s %11s %11s %11s\n", "lock", "acquired", "contended", "",
+        "waited ms", "max wait us", "held ms", "mean hold", "max hold us");
+    for (int i = 0; i < count; i++) {
+        lock_stats_t *s = &lock_stats[order[i]];
+        char name[32];
+        uint64_t acquired = atomic_load(&s->acquired);
+        uint64_t contended = atomic_load(&s->contended);
+
+        if (order[i] < LK_RAND) {
+            snprintf(name, sizeof(name), device_names[order[i] / 5], (order[i] % 5) + 1);
+        } else {
+            snprintf(name, sizeof(name), "%s", other_names[order[i] - LK_RAND]);
+        }
+        put(buf, size, &len, "\t%-20s %10lu %10lu %5.1f%% %11.3f %11.1f %11.3f %9.2fus %11.1f\n", name,
+            (unsigned long)acquired, (unsigned long)contended, (double)contended * 100 / (double)acquired,
+            (double)atomic_load(&s->wait_ns) / 1e6, (double)atomic_load(&s->max_wait_ns) / 1e3,
+            (double)atomic_load(&s->hold_ns) / 1e6, (double)atomic_load(&s->hold_ns) / (double)acquired / 1e3,
+            (double)atomic_load(&s->max_hold_ns) / 1e3);
+    }
+    if (count == 0) put(buf, size, &len, "\tno locks taken yet\n");
+#endif
+    return len;
+}
+
+void lockprof_report(void) {
+#if LOCK_PROFILE
+    static char report[LOCKPROF_REPORT];
+
+    lockprof_render(report, sizeof(report));
+    printf("~%s", report);
+#endif
+}
+
+#if LOCK_PROFILE
+
+/**
+ * @brief Appends formatted text to a buffer, stopping quietly once full.
+ *
+ * @param buf - buffer to append to
+ * @param size - size of buf
+ * @param len - bytes in buf so far, updated
+ * @param fmt - printf style format
+ */
+static void put(char *buf, size_t size, size_t *len, const char *fmt, ...) {
+    va_list args;
+
+    if (*len + 1 < size) {
+        va_start(args, fmt);
+        int n = vsnprintf(buf + *len, size - *len, fmt, args);
+        va_end(args);
+
+        if (n > 0) *len += ((size_t)n < size - *len) ? (size_t)n : size - *len - 1;
+    }
+}
+
+#endif
@@ -0,0 +1,232 @@
+/************************************************
+ * @file    lock-prof.h
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   API for profiling lock contention in all 3
+ *          programs: per named lock, how often it was taken,
+ *          how often it was already held (contended), how
+ *          long threads waited for it and how long they held it.
+ *
+ *          Lock with PROF_LOCK/PROF_UNLOCK/PROF_COND_WAIT/
+ *          PROF_COND_TIMEDWAIT, naming the lock with a
+ *          lock_id_t. Only compiled in when LOCK_PROFILE is 1
+ *          in config.h, otherwise they are the plain pthread
+ *          calls (and metrics_lock for PROF_METRICS_LOCK).
+ *
+ *          The shared memory's device locks are taken by all
+ *          3 programs, each program profiles the acquisitions
+ *          of its own threads. A program prints its locks,
+ *          ranked by time waited, when it ends, and serves the
+ *          same report live next to its metrics:
+ *
+ *          curl http://127.0.0.1:<metrics port>/locks
+ *
+ *          Statistics live in 1 static slot per lock id and
+ *          the report is built in a static buffer, so the
+ *          Fire Alarm System (MISRA C, no heap) can profile
+ *          its locks as well.
+ ***********************************************/
+#pragma once
+
+#include <stdint.h>     /* for int types */
+#include <stddef.h>     /* for size_t */
+#include <stdatomic.h>  /* for atomic adds */
+#include <pthread.h>    /* for mutexes & conditions */
+#include <time.h>       /* for the clock & timespec */
+
+#include "metrics.h"    /* for PROF_METRICS_LOCK */
+#include "../config.h"  /* for LOCK_PROFILE */
+
+/* Every lock, device locks take 5 ids each (+ entrance/exit/level 0..4) */
+typedef enum lock_id_t {
+    LK_EN_LPR = 0,
+    LK_EN_GATE = 5,
+    LK_EN_SIGN = 10,
+    LK_EX_LPR = 15,
+    LK_EX_GATE = 20,
+    LK_LVL_LPR = 25,
+    LK_RAND = 30,       /* Sim: rand calls */
+    LK_EN_QUEUES,       /* Sim: all entrance queues */
+    LK_EX_QUEUES,       /* Sim: all exit queues */
+    LK_LIFECYCLE,       /* Sim: timer wheel & ready moves of the cars inside */
+    LK_AUTH,            /* Manager: authorised plates # table */
+    LK_BILL,            /* Manager: billing # table */
+    LK_CAPACITY,        /* Manager: current capacity of each level */
+    LK_ALARM,           /* Fire Alarm System: alarm_active */
+    LOCK_IDS            /* no. of ids */
+} lock_id_t;
+
+/* 1 lock's totals, aligned so locks never share a cache line */
+typedef struct lock_stats_t {
+    _Alignas(64) volatile _Atomic uint64_t acquired;
+    volatile _Atomic uint64_t contended;    /* already held when asked for */
+    volatile _Atomic uint64_t wait_ns;
+    volatile _Atomic uint64_t max_wait_ns;
+    volatile _Atomic uint64_t hold_ns;
+    volatile _Atomic uint64_t max_hold_ns;
+    uint64_t held_since;                    /* ns, only read & written by the holder */
+} lock_stats_t;
+
+/**
+ * @brief Names the program & serves the report on /locks once
+ * metrics_serve is called. Does nothing when LOCK_PROFILE is 0.
+ *
+ * @param program - such as "Manager"
+ */
+void lockprof_init(const char *program);
+
+/**
+ * @brief Writes every lock taken, ranked by time waited.
+ *
+ * @param buf - where to write
+ * @param size - size of buf
+ * @return size_t - bytes written
+ */
+size_t lockprof_render(char *buf, size_t size);
+
+/**
+ * @brief Prints the ranked report, when the program ends. Does
+ * nothing when LOCK_PROFILE is 0.
+ */
+void lockprof_report(void);
+
+#if LOCK_PROFILE
+
+extern lock_stats_t lock_stats[LOCK_IDS];
+
+/**
+ * @brief Reads the clock locks are timed with.
+ *
+ * @return uint64_t - ns
+ */
+static inline uint64_t lockprof_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000) + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Raises a maximum if a value is above it.
+ *
+ * @param max - maximum
+ * @param ns - value
+ */
+static inline void lockprof_max(volatile _Atomic uint64_t *max, uint64_t ns) {
+    uint64_t seen = atomic_load_explicit(max, memory_order_relaxed);
+    while (ns > seen && !atomic_compare_exchange_weak_explicit(max, &seen, ns, memory_order_relaxed, memory_order_relaxed)) {}
+}
+
+/**
+ * @brief Locks a mutex, counting it & timing the wait if it was held.
+ *
+ * @param m - mutex
+ * @param id - lock's name
+ * @return uint64_t - ns waited (0 if free)
+ */
+static inline uint64_t lockprof_lock(pthread_mutex_t *m, int id) {
+    lock_stats_t *s = &lock_stats[id];
+    uint64_t waited = 0;
+
+    if (pthread_mutex_trylock(m) == 0) {
+        s->held_since = lockprof_now();
+    } else {
+        uint64_t before = lockprof_now();
+        pthread_mutex_lock(m);
+        s->held_since = lockprof_now();
+        waited = s->held_since - before;
+        atomic_fetch_add_explicit(&s->contended, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&s->wait_ns, waited, memory_order_relaxed);
+        lockprof_max(&s->max_wait_ns, waited);
+    }
+    atomic_fetch_add_explicit(&s->acquired, 1, memory_order_relaxed);
+    return waited;
+}
+
+/**
+ * @brief Adds how long the calling thread held a lock, then forgets it.
+ *
+ * @param id - lock's name
+ */
+static inline void lockprof_release(int id) {
+    lock_stats_t *s = &lock_stats[id];
+    uint64_t held = lockprof_now() - s->held_since;
+
+    atomic_fetch_add_explicit(&s->hold_ns, held, memory_order_relaxed);
+    lockprof_max(&s->max_hold_ns, held);
+}
+
+/**
+ * @brief Locks a mutex for the profile & records the wait in a
+ * metrics histogram too (see metrics_lock).
+ *
+ * @param m - mutex
+ * @param id - lock's name
+ * @param metric - index of the histogram
+ */
+static inline void lockprof_metrics_lock(pthread_mutex_t *m, int id, int metric) {
+    metric_observe_us(metric, lockprof_lock(m, id) / 1000);
+}
+
+/**
+ * @brief Unlocks a mutex, adding how long it was held.
+ *
+ * @param m - mutex
+ * @param id - lock's name
+ */
+static inline void lockprof_unlock(pthread_mutex_t *m, int id) {
+    lockprof_release(id);
+    pthread_mutex_unlock(m);
+}
+
+/**
+ * @brief Waits on a condition. The mutex is not held while waiting,
+ * so the hold ends before & starts again after.
+ *
+ * @param c - condition
+ * @param m - mutex, held
+ * @param id - lock's name
+ * @return int - pthread_cond_wait's result
+ */
+static inline int lockprof_cond_wait(pthread_cond_t *c, pthread_mutex_t *m, int id) {
+    int rc;
+
+    lockprof_release(id);
+    rc = pthread_cond_wait(c, m);
+    lock_stats[id].held_since = lockprof_now();
+    return rc;
+}
+
+/**
+ * @brief Waits on a condition until a deadline, see lockprof_cond_wait.
+ *
+ * @param c - condition
+ * @param m - mutex, held
+ * @param deadline - CLOCK_REALTIME deadline
+ * @param id - lock's name
+ * @return int - pthread_cond_timedwait's result
+ */
+static inline int lockprof_cond_timedwait(pthread_cond_t *c, pthread_mutex_t *m, const struct timespec *deadline, int id) {
+    int rc;
+
+    lockprof_release(id);
+    rc = pthread_cond_timedwait(c, m, deadline);
+    lock_stats[id].held_since = lockprof_now();
+    return rc;
+}
+
+#define PROF_LOCK(m, id) ((void)lockprof_lock((m), (id)))
+#define PROF_METRICS_LOCK(m, id, metric) lockprof_metrics_lock((m), (id), (metric))
+#define PROF_UNLOCK(m, id) lockprof_unlock((m), (id))
+#define PROF_COND_WAIT(c, m, id) lockprof_cond_wait((c), (m), (id))
+#define PROF_COND_TIMEDWAIT(c, m, deadline, id) lockprof_cond_timedwait((c), (m), (deadline), (id))
+
+#else
+
+/* the id is still evaluated (for nothing) so ids kept in variables are not unused */
+#define PROF_LOCK(m, id) ((void)(id), pthread_mutex_lock(m))
+#define PROF_METRICS_LOCK(m, id, metric) ((void)(id), metrics_lock((m), (metric)))
+#define PROF_UNLOCK(m, id) ((void)(id), pthread_mutex_unlock(m))
+#define PROF_COND_WAIT(c, m, id) ((void)(id), pthread_cond_wait((c), (m)))
+#define PROF_COND_TIMEDWAIT(c, m, deadline, id) ((void)(id), pthread_cond_timedwait((c), (m), (deadline)))
+
+#endif
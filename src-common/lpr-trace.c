@@ -0,0 +1,85 @@
+/************************************************
+ * @file    lpr-trace.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Source code for lpr-trace.h
+ ***********************************************/
+#include <stdio.h>      /* for IO operations */
+#include <string.h>     /* for string operations */
+#include <pthread.h>    /* for the capture lock */
+#include <stdatomic.h>  /* for testing the capture without the lock */
+
+#include "lpr-trace.h"  /* corresponding header */
+#include "sim-clock.h"  /* for the clock */
+
+static FILE *_Atomic capture = NULL; /* NULL = capture off, only changed under capture_lock */
+static const char *capture_path;
+static pthread_mutex_t capture_lock = PTHREAD_MUTEX_INITIALIZER;
+static lpr_header_t header;
+static uint64_t began;          /* ns, CLOCK_MONOTONIC */
+
+void lpr_capture_init(const char *path, int ens, int exs, int lvls, double speed) {
+    if (path[0] == '\0') return;
+
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL) {
+        perror("LPR capture");
+        return;
+    }
+    capture_path = path;
+
+    /* records stays 0 until the end, so a capture cut short is noticed */
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, LPR_MAGIC, sizeof(header.magic));
+    header.version = LPR_VERSION;
+    header.size = sizeof(lpr_record_t);
+    header.ens = (uint8_t)ens;
+    header.exs = (uint8_t)exs;
+    header.lvls = (uint8_t)lvls;
+    header.speed = (float)speed;
+    fwrite(&header, sizeof(header), 1, fp);
+    began = mono_ns();
+    pthread_mutex_lock(&capture_lock);
+    atomic_store(&capture, fp);
+    pthread_mutex_unlock(&capture_lock);
+    printf("~Capturing LPR readings to %s\n", path);
+}
+
+void lpr_capture(lpr_where_t where, int id, const char *plate) {
+    if (atomic_load_explicit(&capture, memory_order_relaxed) == NULL) return;
+
+    lpr_record_t r;
+    r.where = (uint8_t)where;
+    r.id = (uint8_t)id;
+    for (int i = 0; i < 6; i++) {
+        r.plate[i] = (plate != NULL) ? plate[i] : '\0';
+        if (r.plate[i] == '\0') plate = NULL; /* pad after the end of the plate */
+    }
+
+    /* stdio buffers the records, so the lock is held for a copy. Timed
+    under it so the records are in time order, checking again as the
+    test above may race lpr_capture_stop */
+    pthread_mutex_lock(&capture_lock);
+    FILE *fp = atomic_load(&capture);
+    if (fp != NULL) {
+        r.ns = mono_ns() - began;
+        fwrite(&r, sizeof(r), 1, fp);
+        header.records++;
+    }
+    pthread_mutex_unlock(&capture_lock);
+}
+
+void lpr_capture_stop(void) {
+    pthread_mutex_lock(&capture_lock);
+    FILE *fp = atomic_load(&capture);
+    if (fp == NULL) {
+        pthread_mutex_unlock(&capture_lock);
+        return;
+    }
+    atomic_store(&capture, NULL);
+    rewind(fp);
+    fwrite(&header, sizeof(header), 1, fp);
+    fclose(fp);
+    pthread_mutex_unlock(&capture_lock);
+    printf("~%lu LPR readings captured to %s\n", (unsigned long)header.records, capture_path);
+}
@@ -0,0 +1,85 @@
+/************************************************
+ * @file    lpr-trace.h
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   API for capturing every LPR reading the Simulator
+ *          makes (entrance, exit & level, timestamped) into a
+ *          compact binary file, so the Manager can be load
+ *          tested without the Simulator:
+ *
+ *          ./LPR-REPLAY lpr-capture.bin  (see src-tools/lpr-replay.c)
+ *
+ *          The file is a header then 1 fixed size record per
+ *          reading, in the order the readings were made. Only
+ *          plates written to an LPR are captured, not the LPR
+ *          being reset (the Manager does that) nor the gates &
+ *          signs (the Manager's answers).
+ *
+ *          Capture is off unless LPR_CAPTURE in config.h (or
+ *          CARPARK_LPR_CAPTURE) names a file.
+ ***********************************************/
+#pragma once
+
+#include <stdint.h>     /* for int types */
+
+#define LPR_MAGIC "CPLPRTR" /* first 8 bytes of every capture (with the '\0') */
+#define LPR_VERSION 2
+
+/* Which LPR read a plate */
+typedef enum lpr_where_t {
+    LPR_ENTRANCE,
+    LPR_EXIT,
+    LPR_LEVEL,
+    LPR_WHERES          /* no. of kinds of LPR */
+} lpr_where_t;
+
+/* 1 reading, 16 bytes */
+typedef struct lpr_record_t {
+    uint64_t ns;        /* since the capture began */
+    uint8_t where;      /* lpr_where_t */
+    uint8_t id;         /* entrance, exit or level no. */
+    char plate[6];      /* not '\0' terminated when 6 chars long */
+} lpr_record_t;
+
+/* Start of every capture, 32 bytes */
+typedef struct lpr_header_t {
+    char magic[8];      /* LPR_MAGIC */
+    uint32_t version;   /* LPR_VERSION */
+    uint32_t size;      /* sizeof(lpr_record_t) */
+    uint8_t ens;        /* no. of entrances, exits & levels captured */
+    uint8_t exs;
+    uint8_t lvls;
+    uint8_t padding;
+    float speed;        /* SPEED the Sim ran at */
+    uint64_t records;   /* readings in the file, 0 if the Sim never finished writing it */
+} lpr_header_t;
+
+/**
+ * @brief Creates the capture file, before any car is spawned. Does
+ * nothing if 'path' is "".
+ *
+ * @param path - file to capture to, "" = off
+ * @param ens - no. of entrances
+ * @param exs - no. of exits
+ * @param lvls - no. of levels
+ * @param speed - SPEED
+ */
+void lpr_capture_init(const char *path, int ens, int exs, int lvls, double speed);
+
+/**
+ * @brief Captures 1 reading, called by any thread right after it writes
+ * a plate to an LPR, still holding the LPR's lock so the readings are
+ * captured in the order the Manager sees them. Does nothing when
+ * capture is off.
+ *
+ * @param where - which kind of LPR
+ * @param id - entrance, exit or level no.
+ * @param plate - plate written
+ */
+void lpr_capture(lpr_where_t where, int id, const char *plate);
+
+/**
+ * @brief Completes the header & closes the capture file, once every
+ * thread that captures has returned. Does nothing when capture is off.
+ */
+void lpr_capture_stop(void);
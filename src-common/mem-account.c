@@ -0,0 +1,192 @@
+/************************************************
+ * @file    mem-account.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Source code for mem-account.h
+ ***********************************************/
+#include <stdio.h>      /* for IO operations */
+#include <stdlib.h>     /* for dynamic memory */
+#include <string.h>     /* for zeroing memory */
+#include <stdarg.h>     /* for variable arguments */
+#include <stdatomic.h>  /* for atomic counts */
+#include <time.h>       /* for the allocation rate */
+
+#include "mem-account.h" /* corresponding header */
+#include "metrics.h"    /* for serving /memory */
+
+#define MEM_MAGIC 0x4d454d21u   /* "MEM!" in a live block's header */
+#define MEM_REPORT 4096         /* bytes for the printed report */
+
+/* Before every block, 16 bytes so the block stays 16 byte aligned */
+typedef struct mem_header_t {
+    size_t size;
+    uint32_t tag;
+    uint32_t magic;
+} mem_header_t;
+
+/* 1 tag's totals, aligned so tags never share a cache line */
+typedef struct mem_stats_t {
+    _Alignas(64) volatile _Atomic uint64_t live;
+    volatile _Atomic uint64_t peak;
+    volatile _Atomic uint64_t allocs;
+    volatile _Atomic uint64_t frees;
+} mem_stats_t;
+
+/* Names printed for each mem_tag_t, in the same order */
+static const char *mem_names[MEM_TAGS] = {"cars", "queues", "thread args", "authorised table", "billing table",
+    "plate pool", "thermal model", "screen", "car lifecycles", "checkpoints", "other"};
+
+static mem_stats_t stats[MEM_TAGS + 1]; /* + all tags together */
+static const char *mem_program = "program";
+static struct timespec started;
+
+/* function prototypes */
+static void *account(mem_header_t *h, size_t size, mem_tag_t tag);
+static void add(mem_stats_t *s, size_t size);
+static void put(char *buf, size_t size, size_t *len, const char *fmt, ...);
+
+void mem_init(const char *program) {
+    mem_program = program;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    metrics_page("/memory", mem_render);
+}
+
+void *mem_malloc(size_t size, mem_tag_t tag) {
+    return account(malloc(sizeof(mem_header_t) + size), size, tag);
+}
+
+void *mem_calloc(size_t n, size_t size, mem_tag_t tag) {
+    if (size != 0 && n > (SIZE_MAX - sizeof(mem_header_t)) / size) return NULL;
+
+    void *p = mem_malloc(n * size, tag);
+    if (p != NULL) memset(p, 0, n * size);
+    return p;
+}
+
+void *mem_realloc(void *p, size_t size, mem_tag_t tag) {
+    if (p == NULL) return mem_malloc(size, tag);
+
+    mem_header_t *old = (mem_header_t *)p - 1;
+    size_t old_size = old->size;
+    mem_tag_t old_tag = (mem_tag_t)old->tag;
+    mem_header_t *h = realloc(old, sizeof(mem_header_t) + size);
+
+    if (h == NULL) return NULL;
+
+    /* account the old size as freed & the new size as allocated */
+    atomic_fetch_sub(&stats[old_tag].live, old_size);
+    atomic_fetch_add(&stats[old_tag].frees, 1);
+    atomic_fetch_sub(&stats[MEM_TAGS].live, old_size);
+    atomic_fetch_add(&stats[MEM_TAGS].frees, 1);
+    return account(h, size, old_tag);
+}
+
+void mem_free(void *p) {
+    if (p == NULL) return;
+
+    /* a block freed twice cannot be told apart safely (its header is
+    already freed memory), ASan builds catch those */
+    mem_header_t *h = (mem_header_t *)p - 1;
+    if (h->magic != MEM_MAGIC) {
+        fprintf(stderr, "mem_free: %p was not allocated by mem_malloc\n", p);
+        abort();
+    }
+
+    atomic_fetch_sub(&stats[h->tag].live, h->size);
+    atomic_fetch_add(&stats[h->tag].frees, 1);
+    atomic_fetch_sub(&stats[MEM_TAGS].live, h->size);
+    atomic_fetch_add(&stats[MEM_TAGS].frees, 1);
+    free(h);
+}
+
+mem_usage_t mem_usage(mem_tag_t tag) {
+    mem_usage_t u;
+
+    u.live = atomic_load(&stats[tag].live);
+    u.peak = atomic_load(&stats[tag].peak);
+    u.allocs = atomic_load(&stats[tag].allocs);
+    u.frees = atomic_load(&stats[tag].frees);
+    return u;
+}
+
+size_t mem_render(char *buf, size_t size) {
+    struct timespec now;
+    size_t len = 0;
+
+    if (size > 0) buf[0] = '\0';
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double secs = (double)(now.tv_sec - started.tv_sec) + (double)(now.tv_nsec - started.tv_nsec) / 1e9;
+    if (secs <= 0) secs = 1;
+
+    put(buf, size, &len, "%s heap memory after %.1fs:\n", mem_program, secs);
+    put(buf, size, &len, "\t%-18s %12s %12s %10s %10s %10s\n", "used by", "live KB", "peak KB", "allocs", "frees", "allocs/s");
+    for (int tag = 0; tag <= MEM_TAGS; tag++) {
+        mem_usage_t u = mem_usage((mem_tag_t)tag);
+        if (u.allocs == 0 && tag != MEM_TAGS) continue;
+
+        put(buf, size, &len, "\t%-18s %12.1f %12.1f %10lu %10lu %10.1f\n", (tag < MEM_TAGS) ? mem_names[tag] : "all",
+            (double)u.live / 1024, (double)u.peak / 1024, (unsigned long)u.allocs, (unsigned long)u.frees,
+            (double)u.allocs / secs);
+    }
+    return len;
+}
+
+void mem_report(void) {
+    static char report[MEM_REPORT];
+
+    mem_render(report, sizeof(report));
+    printf("~%s", report);
+}
+
+/**
+ * @brief Fills in a new block's header and counts it.
+ *
+ * @param h - block from malloc/realloc, NULL if it failed
+ * @param size - bytes asked for
+ * @param tag - what it is for
+ * @return void* - memory after the header, NULL if h is NULL
+ */
+static void *account(mem_header_t *h, size_t size, mem_tag_t tag) {
+    if (h == NULL) return NULL;
+
+    h->size = size;
+    h->tag = (uint32_t)tag;
+    h->magic = MEM_MAGIC;
+    add(&stats[tag], size);
+    add(&stats[MEM_TAGS], size);
+    return h + 1;
+}
+
+/**
+ * @brief Counts an allocation, raising the peak if it is a new high.
+ *
+ * @param s - totals to add to
+ * @param size - bytes allocated
+ */
+static void add(mem_stats_t *s, size_t size) {
+    uint64_t live = atomic_fetch_add(&s->live, size) + size;
+    uint64_t peak = atomic_load_explicit(&s->peak, memory_order_relaxed);
+
+    atomic_fetch_add_explicit(&s->allocs, 1, memory_order_relaxed);
+    while (live > peak && !atomic_compare_exchange_weak(&s->peak, &peak, live)) {}
+}
+
+/**
+ * @brief Appends formatted text to a buffer, stopping quietly once full.
+ *
+ * @param buf - buffer to append to
+ * @param size - size of buf
+ * @param len - bytes in buf so far, updated
+ * @param fmt - printf style format
+ */
+static void put(char *buf, size_t size, size_t *len, const char *fmt, ...) {
+    va_list args;
+
+    if (*len + 1 < size) {
+        va_start(args, fmt);
+        int n = vsnprintf(buf + *len, size - *len, fmt, args);
+        va_end(args);
+
+        if (n > 0) *len += ((size_t)n < size - *len) ? (size_t)n : size - *len - 1;
+    }
+}
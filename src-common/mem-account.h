@@ -0,0 +1,119 @@
+/************************************************
+ * @file    mem-account.h
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   API for accounting every heap allocation of the
+ *          3 programs by what it is for (cars, queues, args,
+ *          the authorised & billing # tables, the plate pool
+ *          ...), so memory growth during long runs can be
+ *          pinned on 1 part of a program.
+ *
+ *          Allocate with mem_malloc/mem_calloc/mem_realloc,
+ *          naming a mem_tag_t, and free with mem_free. Each
+ *          block carries a 16 byte header holding its size &
+ *          tag, so mem_free needs neither. Per tag, the live
+ *          bytes, peak bytes & allocation counts are kept in
+ *          atomics (no lock). A program prints them when it
+ *          ends, and serves them next to its metrics:
+ *
+ *          curl http://127.0.0.1:<metrics port>/memory
+ ***********************************************/
+#pragma once
+
+#include <stdint.h>     /* for int types */
+#include <stddef.h>     /* for size_t */
+
+/* What an allocation is for, keep mem_names (mem-account.c) in the same order */
+typedef enum mem_tag_t {
+    MEM_CAR,            /* Sim: cars */
+    MEM_QUEUE,          /* Sim: entrance & exit queues and their nodes */
+    MEM_ARGS,           /* all: thread args */
+    MEM_AUTH,           /* Manager: authorised plates # table */
+    MEM_BILLING,        /* Manager: billing # table */
+    MEM_PLATES,         /* Sim: plate pool (plates.txt) */
+    MEM_THERMAL,        /* Sim: thermal model */
+    MEM_SCREEN,         /* Manager: status display's screen */
+    MEM_LIFECYCLE,      /* Sim: lifecycles of the cars inside & the timer wheel */
+    MEM_CHECKPOINT,     /* Sim & Manager: checkpoints being saved or restored */
+    MEM_OTHER,          /* anything else (set up, capacities) */
+    MEM_TAGS            /* no. of tags */
+} mem_tag_t;
+
+/* 1 tag's (or all tags') totals, copied by mem_usage */
+typedef struct mem_usage_t {
+    uint64_t live;      /* bytes allocated & not yet freed */
+    uint64_t peak;      /* most bytes live at once */
+    uint64_t allocs;    /* allocations ever */
+    uint64_t frees;     /* frees ever */
+} mem_usage_t;
+
+/**
+ * @brief Names the program, starts the allocation rate clock & serves
+ * the report on /memory once metrics_serve is called.
+ *
+ * @param program - such as "Manager"
+ */
+void mem_init(const char *program);
+
+/**
+ * @brief Allocates memory, accounted to a tag.
+ *
+ * @param size - bytes
+ * @param tag - what it is for
+ * @return void* - the memory, NULL if malloc failed
+ */
+void *mem_malloc(size_t size, mem_tag_t tag);
+
+/**
+ * @brief Allocates zeroed memory for n items, accounted to a tag.
+ *
+ * @param n - no. of items
+ * @param size - bytes per item
+ * @param tag - what it is for
+ * @return void* - the memory, NULL if calloc failed
+ */
+void *mem_calloc(size_t n, size_t size, mem_tag_t tag);
+
+/**
+ * @brief Grows (or shrinks) memory from mem_malloc/mem_calloc, keeping
+ * its tag. Like realloc, NULL may be given & the old memory is kept
+ * if it fails.
+ *
+ * @param p - memory to resize, NULL for new memory
+ * @param size - new size in bytes
+ * @param tag - what it is for (new memory only)
+ * @return void* - the memory, NULL if realloc failed
+ */
+void *mem_realloc(void *p, size_t size, mem_tag_t tag);
+
+/**
+ * @brief Frees memory from mem_malloc/mem_calloc/mem_realloc. NULL is
+ * ignored, any other memory aborts. Memory freed twice is undefined
+ * (as with free), build with -fsanitize=address to catch it.
+ *
+ * @param p - memory to free
+ */
+void mem_free(void *p);
+
+/**
+ * @brief Copies a tag's totals.
+ *
+ * @param tag - the tag, MEM_TAGS for all tags together
+ * @return mem_usage_t - the totals
+ */
+mem_usage_t mem_usage(mem_tag_t tag);
+
+/**
+ * @brief Writes every tag used: live & peak bytes, allocations, frees
+ * and allocations per second.
+ *
+ * @param buf - where to write
+ * @param size - size of buf
+ * @return size_t - bytes written
+ */
+size_t mem_render(char *buf, size_t size);
+
+/**
+ * @brief Prints the report, when the program ends.
+ */
+void mem_report(void);
@@ -0,0 +1,379 @@
+/************************************************
+ * @file    metrics.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Source code for metrics.h
+ ***********************************************/
+#include <stdio.h>      /* for IO operations */
+#include <stdarg.h>     /* for variable arguments */
+#include <string.h>     /* for string operations */
+#include <time.h>       /* for timing lock waits */
+#include <unistd.h>     /* for close */
+#include <poll.h>       /* for waiting on connections */
+#include <sys/time.h>   /* for timeval */
+#include <sys/socket.h> /* for sockets */
+#include <netinet/in.h> /* for internet addresses */
+#include <arpa/inet.h>  /* for htons/htonl */
+
+#include "metrics.h"    /* corresponding header */
+
+#define METRICS_POLL 100    /* ms between checks of whether to stop serving */
+#define METRICS_REQUEST 1024 /* bytes of a request we bother reading */
+
+/* Text being written into a fixed size buffer */
+typedef struct page_t {
+    char *buf;
+    size_t size;
+    size_t len;
+} page_t;
+
+const uint64_t metrics_bounds[METRICS_BUCKETS - 1] = {
+    10, 50, 100, 500, 1000, 5000, 10000, 50000, 100000, 500000, 1000000
+};
+_Thread_local metrics_shard_t *metrics_mine = NULL;
+
+/* -----------------------------------------------
+ *       SHARDS & THE TOTALS OF ENDED THREADS
+ * -----------------------------------------------
+ * metrics_m guards claiming, folding & adding up
+ * shards, never held while recording
+ */
+static metrics_shard_t shards[METRICS_SHARDS];
+static metrics_shard_t overflow = {.shared = 1};
+static metrics_shard_t retired;
+static pthread_mutex_t metrics_m = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t shard_key;
+static pthread_once_t shard_key_once = PTHREAD_ONCE_INIT;
+static int threads_seen = 0;
+static int threads_peak = 0;
+static int threads_now = 0;
+
+static const metric_def_t *metrics_defs = NULL;
+static int metrics_count = 0;
+
+/* serving thread */
+static pthread_t server;
+static int server_fd = -1;
+static int server_port = 0;
+static volatile _Atomic int stopping = 0;
+static volatile _Atomic unsigned long scrapes = 0;
+static char page_buf[METRICS_PAGE];
+
+/* extra pages, registered before serving */
+static const char *page_paths[METRICS_PAGES];
+static size_t (*page_renders[METRICS_PAGES])(char *buf, size_t size);
+static int pages = 0;
+
+/* function prototypes */
+static void make_key(void);
+static void detach(void *shard);
+static void fold(metric_cell_t *into, metric_cell_t *from, int clear);
+static void put(page_t *p, const char *fmt, ...);
+static void render_metric(page_t *p, const metric_def_t *d, const metric_def_t *prev, metric_cell_t *total);
+static void *serve(void *args);
+static void answer(int fd);
+
+void metrics_init(const metric_def_t *defs, int count) {
+    metrics_defs = defs;
+    metrics_count = (count > METRICS_MAX) ? METRICS_MAX : count;
+}
+
+metrics_shard_t *metrics_attach(void) {
+    metrics_shard_t *s = &overflow;
+
+    pthread_once(&shard_key_once, make_key);
+    pthread_mutex_lock(&metrics_m);
+    for (int i = 0; i < METRICS_SHARDS && s == &overflow; i++) {
+        if (!shards[i].in_use) s = &shards[i];
+    }
+    if (s != &overflow) {
+        s->in_use = 1;
+        threads_now++;
+        if (threads_now > threads_peak) threads_peak = threads_now;
+    }
+    threads_seen++;
+    pthread_mutex_unlock(&metrics_m);
+
+    /* only real shards are handed back when the thread ends */
+    if (s != &overflow) pthread_setspecific(shard_key, s);
+    metrics_mine = s;
+    return s;
+}
+
+void metrics_lock_slow(pthread_mutex_t *m, int id) {
+    struct timespec before, after;
+
+    clock_gettime(CLOCK_MONOTONIC, &before);
+    pthread_mutex_lock(m);
+    clock_gettime(CLOCK_MONOTONIC, &after);
+    metric_observe_us(id, (uint64_t)(((after.tv_sec - before.tv_sec) * 1000000) + ((after.tv_nsec - before.tv_nsec) / 1000)));
+}
+
+size_t metrics_render(char *buf, size_t size) {
+    page_t p = {buf, size, 0};
+    metric_cell_t total;
+
+    for (int i = 0; i < metrics_count; i++) {
+        const metric_def_t *d = &metrics_defs[i];
+        memset(&total, 0, sizeof(total));
+
+        if (d->collect != NULL) {
+            /* read on scrape, not recorded */
+            double v = d->collect();
+            render_metric(&p, d, (i > 0) ? &metrics_defs[i - 1] : NULL, NULL);
+            put(&p, " %.15g\n", v);
+        } else {
+            /* add up every shard (including ended threads) */
+            pthread_mutex_lock(&metrics_m);
+            fold(&total, &retired.cells[i], 0);
+            fold(&total, &overflow.cells[i], 0);
+            for (int s = 0; s < METRICS_SHARDS; s++) {
+                if (shards[s].in_use) fold(&total, &shards[s].cells[i], 0);
+            }
+            pthread_mutex_unlock(&metrics_m);
+            render_metric(&p, d, (i > 0) ? &metrics_defs[i - 1] : NULL, &total);
+        }
+    }
+    return p.len;
+}
+
+int metrics_serve(int port) {
+    struct sockaddr_in addr;
+    int on = 1;
+    int ok = -1;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK); /* this machine only */
+    addr.sin_port = htons((uint16_t)port);
+
+    server_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (server_fd < 0) {
+        perror("metrics socket");
+    } else if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) < 0 ||
+        bind(server_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(server_fd, 8) < 0) {
+        printf("\tMetrics port %d unavailable, not serving metrics\n", port);
+        close(server_fd);
+        server_fd = -1;
+    } else {
+        server_port = port;
+        stopping = 0;
+        pthread_create(&server, NULL, serve, NULL);
+        ok = 0;
+    }
+    return ok;
+}
+
+void metrics_page(const char *path, size_t (*render)(char *buf, size_t size)) {
+    if (pages < METRICS_PAGES) {
+        page_paths[pages] = path;
+        page_renders[pages] = render;
+        pages++;
+    }
+}
+
+void metrics_stop(void) {
+    if (server_fd >= 0) {
+        stopping = 1;
+        pthread_join(server, NULL);
+        close(server_fd);
+        server_fd = -1;
+    }
+}
+
+void metrics_report(const char *program) {
+    pthread_mutex_lock(&metrics_m);
+    if (server_port != 0) {
+        printf("~%s metrics: %lu scrapes served on port %d, ", program, (unsigned long)scrapes, server_port);
+    } else {
+        printf("~%s metrics: not served, ", program);
+    }
+    printf("%d threads recorded (%d at once at most)\n", threads_seen, threads_peak);
+    pthread_mutex_unlock(&metrics_m);
+}
+
+/**
+ * @brief Creates the key used to hand a shard back when its thread ends.
+ */
+static void make_key(void) {
+    pthread_key_create(&shard_key, detach);
+}
+
+/**
+ * @brief Runs as a thread ends, folding its shard into the totals
+ * of ended threads and freeing the shard for the next new thread.
+ *
+ * @param shard - the ended thread's shard
+ */
+static void detach(void *shard) {
+    metrics_shard_t *s = (metrics_shard_t *)shard;
+
+    pthread_mutex_lock(&metrics_m);
+    for (int i = 0; i < METRICS_MAX; i++) {
+        fold(&retired.cells[i], &s->cells[i], 1);
+    }
+    s->in_use = 0;
+    threads_now--;
+    pthread_mutex_unlock(&metrics_m);
+}
+
+/**
+ * @brief Adds the values of 1 metric cell to another. metrics_m must be locked.
+ *
+ * @param into - cell to add to
+ * @param from - cell to add
+ * @param clear - 1 = zero 'from' afterwards (its thread has ended)
+ */
+static void fold(metric_cell_t *into, metric_cell_t *from, int clear) {
+    into->value += from->value;
+    into->sum += from->sum;
+    for (int b = 0; b < METRICS_BUCKETS; b++) {
+        into->buckets[b] += from->buckets[b];
+    }
+
+    if (clear) {
+        from->value = 0;
+        from->sum = 0;
+        for (int b = 0; b < METRICS_BUCKETS; b++) {
+            from->buckets[b] = 0;
+        }
+    }
+}
+
+/**
+ * @brief Appends formatted text to a page, stopping quietly once full.
+ *
+ * @param p - page to append to
+ * @param fmt - printf style format
+ */
+static void put(page_t *p, const char *fmt, ...) {
+    va_list args;
+
+    if (p->len + 1 < p->size) {
+        va_start(args, fmt);
+        int n = vsnprintf(p->buf + p->len, p->size - p->len, fmt, args);
+        va_end(args);
+
+        if (n > 0) p->len += ((size_t)n < p->size - p->len) ? (size_t)n : p->size - p->len - 1;
+    }
+}
+
+/**
+ * @brief Writes 1 metric in the Prometheus text format. The HELP & TYPE
+ * lines are only written for the first of several labelled metrics.
+ *
+ * @param p - page to append to
+ * @param d - metric to write
+ * @param prev - metric written before it, NULL if first
+ * @param total - values added up from every shard, NULL to only
+ * write the name (the caller then writes the collected value)
+ */
+static void render_metric(page_t *p, const metric_def_t *d, const metric_def_t *prev, metric_cell_t *total) {
+    static const char *types[] = {"counter", "gauge", "histogram"};
+    int base = (int)strcspn(d->name, "{");
+    const char *labels = d->name + base; /* "" or {...} */
+    int label_len = (*labels == '{') ? (int)strlen(labels) - 2 : 0;
+
+    /* same name as the previous metric = more labels of the same metric */
+    if (prev == NULL || (int)strcspn(prev->name, "{") != base || strncmp(prev->name, d->name, base) != 0) {
+        put(p, "# HELP %.*s %s\n", base, d->name, d->help);
+        put(p, "# TYPE %.*s %s\n", base, d->name, types[d->type]);
+    }
+
+    if (total == NULL) {
+        put(p, "%s", d->name);
+
+    } else if (d->type == METRIC_COUNTER) {
+        put(p, "%s %llu\n", d->name, (unsigned long long)total->value);
+
+    } else if (d->type == METRIC_GAUGE) {
+        put(p, "%s %lld\n", d->name, (long long)(int64_t)total->value);
+
+    } else {
+        /* buckets are cumulative, bounds & sum served in seconds */
+        uint64_t running = 0;
+        for (int b = 0; b < METRICS_BUCKETS; b++) {
+            running += total->buckets[b];
+            put(p, "%.*s_bucket{%.*s%s", base, d->name, label_len, labels + 1, label_len ? "," : "");
+            if (b < METRICS_BUCKETS - 1) {
+                put(p, "le=\"%g\"} %llu\n", (double)metrics_bounds[b] / 1000000, (unsigned long long)running);
+            } else {
+                put(p, "le=\"+Inf\"} %llu\n", (unsigned long long)running);
+            }
+        }
+        put(p, "%.*s_sum%s %.6f\n", base, d->name, labels, (double)total->sum / 1000000);
+        put(p, "%.*s_count%s %llu\n", base, d->name, labels, (unsigned long long)total->value);
+    }
+}
+
+/**
+ * @brief Serving thread, answers each connection in turn until
+ * metrics_stop is called.
+ *
+ * @param args - unused
+ * @return void* - NULL
+ */
+static void *serve(void *args) {
+    (void)args;
+
+    while (!stopping) {
+        struct pollfd waiting = {server_fd, POLLIN, 0};
+
+        if (poll(&waiting, 1, METRICS_POLL) > 0) {
+            int fd = accept(server_fd, NULL, NULL);
+            if (fd >= 0) {
+                answer(fd);
+                close(fd);
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Reads 1 HTTP request and answers it, GET /metrics (or /)
+ * gets every metric, GET on an extra page's path gets that page and
+ * anything else gets a 404.
+ *
+ * @param fd - connection to answer
+ */
+static void answer(int fd) {
+    char request[METRICS_REQUEST];
+    char header[256];
+    struct timeval patience = {1, 0}; /* give up on slow clients after 1s */
+    const char *body = "not found\n";
+    size_t body_len = strlen(body);
+    const char *status = "404 Not Found";
+
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &patience, sizeof(patience));
+    ssize_t got = recv(fd, request, sizeof(request) - 1, 0);
+    request[(got > 0) ? got : 0] = '\0';
+
+    if (strncmp(request, "GET /metrics ", 13) == 0 || strncmp(request, "GET / ", 6) == 0) {
+        body_len = metrics_render(page_buf, sizeof(page_buf));
+        body = page_buf;
+        status = "200 OK";
+        scrapes++;
+    }
+
+    for (int i = 0; i < pages; i++) {
+        size_t len = strlen(page_paths[i]);
+        if (strncmp(request, "GET ", 4) == 0 && strncmp(request + 4, page_paths[i], len) == 0 && request[4 + len] == ' ') {
+            body_len = page_renders[i](page_buf, sizeof(page_buf));
+            body = page_buf;
+            status = "200 OK";
+        }
+    }
+
+    int header_len = snprintf(header, sizeof(header),
+        "HTTP/1.1 %s\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n",
+        status, body_len);
+    send(fd, header, (size_t)header_len, MSG_NOSIGNAL);
+
+    /* send may take the body in pieces */
+    size_t sent = 0;
+    while (sent < body_len) {
+        ssize_t n = send(fd, body + sent, body_len - sent, MSG_NOSIGNAL);
+        sent = (n > 0) ? sent + (size_t)n : body_len;
+    }
+}
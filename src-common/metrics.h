@@ -0,0 +1,223 @@
+/************************************************
+ * @file    metrics.h
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   API for runtime metrics (counters, gauges and
+ *          histograms) served over HTTP on localhost in the
+ *          Prometheus text format. Shared by all 3 programs,
+ *          each program lists its own metrics in a metric_def_t
+ *          table and records them by index.
+ *
+ *          Every thread records into its own shard (1 per
+ *          thread, found through a thread-local pointer), so
+ *          recording is a plain load & add & store with no lock
+ *          and no locked instruction. Shards are only added up
+ *          when the metrics are scraped. When a thread ends its
+ *          shard is folded into a running total and handed to
+ *          the next new thread, so short lived threads (like
+ *          the Simulator's cars) never run out of shards.
+ *
+ *          No dynamic memory is used (MISRA C), so it is also
+ *          safe to use from the Fire Alarm System.
+ *
+ *          curl http://127.0.0.1:<port>/metrics
+ ***********************************************/
+#pragma once
+
+#include <stdint.h>     /* for int types */
+#include <stddef.h>     /* for size_t */
+#include <pthread.h>    /* for mutex types */
+#include <stdatomic.h>  /* for atomic loads & stores */
+
+#define METRICS_MAX 32          /* metrics per program */
+#define METRICS_BUCKETS 12      /* histogram buckets, the last is +Inf */
+#define METRICS_SHARDS 64       /* threads recording at once, any more share 1 overflow shard */
+#define METRICS_PAGE 65536      /* bytes for a scraped page */
+#define METRICS_PAGES 4         /* extra pages served besides /metrics */
+
+typedef enum metric_type_t {
+    METRIC_COUNTER,     /* only goes up */
+    METRIC_GAUGE,       /* goes up & down, adds up across threads */
+    METRIC_HISTOGRAM    /* durations in microseconds, served in seconds */
+} metric_type_t;
+
+/* A metric, as listed in each program's table */
+typedef struct metric_def_t {
+    const char *name;           /* may end in labels, such as lock_wait_seconds{lock="billing"} */
+    const char *help;           /* one line summary */
+    metric_type_t type;
+    double (*collect)(void);    /* read on scrape instead of recorded values, NULL = recorded */
+} metric_def_t;
+
+/* 1 metric's recorded values within a shard */
+typedef struct metric_cell_t {
+    volatile _Atomic uint64_t value;    /* counter total, gauge total, histogram count */
+    volatile _Atomic uint64_t sum;      /* histogram sum of microseconds */
+    volatile _Atomic uint64_t buckets[METRICS_BUCKETS];
+} metric_cell_t;
+
+/* Everything 1 thread recorded, aligned so threads never share a cache line */
+typedef struct metrics_shard_t {
+    _Alignas(64) metric_cell_t cells[METRICS_MAX];
+    int in_use;         /* 0 = free, 1 = owned by a thread */
+    int shared;         /* 1 = the overflow shard, written with locked adds */
+} metrics_shard_t;
+
+/* Upper bounds (microseconds) of each histogram bucket but the last */
+extern const uint64_t metrics_bounds[METRICS_BUCKETS - 1];
+
+/* The calling thread's shard, NULL until it first records */
+extern _Thread_local metrics_shard_t *metrics_mine;
+
+/**
+ * @brief Sets the metrics of this program, before any thread records.
+ *
+ * @param defs - table of metrics, recorded by their index
+ * @param count - no. of metrics (METRICS_MAX at most)
+ */
+void metrics_init(const metric_def_t *defs, int count);
+
+/**
+ * @brief Starts the thread serving the metrics over HTTP on
+ * 127.0.0.1, it ends once metrics_stop is called.
+ *
+ * @param port - TCP port to listen on
+ * @return int - 0 if listening, -1 if not (reason printed)
+ */
+int metrics_serve(int port);
+
+/**
+ * @brief Serves an extra plain text page besides /metrics, such as the
+ * lock contention report on /locks. Call before metrics_serve.
+ *
+ * @param path - such as "/locks"
+ * @param render - writes the page into buf, returning the bytes written
+ */
+void metrics_page(const char *path, size_t (*render)(char *buf, size_t size));
+
+/**
+ * @brief Stops & joins the thread serving the metrics, if started.
+ */
+void metrics_stop(void);
+
+/**
+ * @brief Writes every metric in the Prometheus text format,
+ * adding up all shards.
+ *
+ * @param buf - where to write
+ * @param size - size of buf
+ * @return size_t - bytes written (cut short if buf is too small)
+ */
+size_t metrics_render(char *buf, size_t size);
+
+/**
+ * @brief Prints how many scrapes were served and threads recorded.
+ *
+ * @param program - name to print, such as "Manager"
+ */
+void metrics_report(const char *program);
+
+/**
+ * @brief Claims a shard for the calling thread, only called the
+ * first time a thread records.
+ *
+ * @return metrics_shard_t* - the shard (or the overflow shard)
+ */
+metrics_shard_t *metrics_attach(void);
+
+/**
+ * @brief Adds to a counter or gauge of the calling thread's shard.
+ * Only the owner writes a shard, so no locked instruction is needed.
+ *
+ * @param cell - counter or gauge
+ * @param n - amount to add (wraps, so gauges may add negatives)
+ * @param shared - 1 if the shard is the overflow shard
+ */
+static inline void metric_cell_add(volatile _Atomic uint64_t *cell, uint64_t n, int shared) {
+    if (shared) {
+        atomic_fetch_add_explicit(cell, n, memory_order_relaxed);
+    } else {
+        atomic_store_explicit(cell, atomic_load_explicit(cell, memory_order_relaxed) + n, memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Locates the calling thread's shard, claiming one if needed.
+ *
+ * @return metrics_shard_t* - the shard
+ */
+static inline metrics_shard_t *metrics_shard(void) {
+    metrics_shard_t *s = metrics_mine;
+    return (s != NULL) ? s : metrics_attach();
+}
+
+/**
+ * @brief Adds to a counter.
+ *
+ * @param id - index of the metric
+ * @param n - amount to add
+ */
+static inline void metric_add(int id, uint64_t n) {
+    metrics_shard_t *s = metrics_shard();
+    metric_cell_add(&s->cells[id].value, n, s->shared);
+}
+
+/**
+ * @brief Adds 1 to a counter.
+ *
+ * @param id - index of the metric
+ */
+static inline void metric_inc(int id) {
+    metric_add(id, 1);
+}
+
+/**
+ * @brief Moves a gauge up (or down if negative).
+ *
+ * @param id - index of the metric
+ * @param n - amount to move by
+ */
+static inline void metric_gauge_add(int id, int64_t n) {
+    metric_add(id, (uint64_t)n);
+}
+
+/**
+ * @brief Records a duration in a histogram.
+ *
+ * @param id - index of the metric
+ * @param us - microseconds
+ */
+static inline void metric_observe_us(int id, uint64_t us) {
+    metrics_shard_t *s = metrics_shard();
+    metric_cell_t *c = &s->cells[id];
+    int b = 0;
+
+    while (b < (METRICS_BUCKETS - 1) && us > metrics_bounds[b]) b++;
+    metric_cell_add(&c->buckets[b], 1, s->shared);
+    metric_cell_add(&c->sum, us, s->shared);
+    metric_cell_add(&c->value, 1, s->shared);
+}
+
+/**
+ * @brief Locks a mutex that is already held by another thread,
+ * recording how long the calling thread waited in a histogram.
+ *
+ * @param m - mutex to lock
+ * @param id - index of the histogram
+ */
+void metrics_lock_slow(pthread_mutex_t *m, int id);
+
+/**
+ * @brief Locks a mutex, recording how long the thread waited in a
+ * histogram. If the mutex is free it records 0 without reading the clock.
+ *
+ * @param m - mutex to lock
+ * @param id - index of the histogram
+ */
+static inline void metrics_lock(pthread_mutex_t *m, int id) {
+    if (pthread_mutex_trylock(m) == 0) {
+        metric_observe_us(id, 0);
+    } else {
+        metrics_lock_slow(m, id);
+    }
+}
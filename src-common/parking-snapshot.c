@@ -0,0 +1,100 @@
+/************************************************
+ * @file    parking-snapshot.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Source code for parking-snapshot.h
+ ***********************************************/
+#include <sched.h>      /* for sched_yield */
+#include <stdatomic.h>  /* for atomic loads */
+
+#include "parking-snapshot.h"   /* corresponding header */
+#include "parking-status.h"     /* for the write version */
+#include "parking-types.h"      /* for car park types */
+
+/* function prototypes */
+static void copy(volatile void *shm, int entrances, int exits, int levels, parking_snapshot_t *snap);
+static void copy_plate(char *dest, volatile const char *src);
+
+int parking_snapshot(volatile void *shm, int entrances, int exits, int levels, parking_snapshot_t *snap) {
+    parking_version_t *v = &parking_status(shm)->version;
+    int result = -1;
+
+    snap->entrances = entrances;
+    snap->exits = exits;
+    snap->levels = levels;
+    snap->retries = 0;
+
+    for (int tries = 0; tries < SNAPSHOT_MAX_TRIES && result != 0; tries++) {
+        /* finished first, then started: if they match, nothing
+        was mid-write when we read 'started' */
+        uint64_t ended = atomic_load_explicit(&v->ended, memory_order_acquire);
+        uint64_t begun = atomic_load_explicit(&v->begun, memory_order_acquire);
+
+        if (begun == ended) {
+            copy(shm, entrances, exits, levels, snap);
+            atomic_thread_fence(memory_order_acquire); /* copy is done before we re-check */
+
+            /* no write started while copying = consistent */
+            if (atomic_load_explicit(&v->begun, memory_order_relaxed) == begun) {
+                snap->version = ended;
+                result = 0;
+            }
+        }
+
+        if (result != 0) {
+            snap->retries++;
+            if (tries % 16 == 15) sched_yield(); /* let a writer on this CPU finish */
+        }
+    }
+
+    /* gave up, return a copy anyway */
+    if (result != 0) {
+        copy(shm, entrances, exits, levels, snap);
+        snap->version = atomic_load_explicit(&v->ended, memory_order_acquire);
+    }
+    return result;
+}
+
+/**
+ * @brief Copies every entrance, exit and level, reading each value once.
+ * 
+ * @param shm - first byte of shared memory
+ * @param entrances - no. of entrances
+ * @param exits - no. of exits
+ * @param levels - no. of levels
+ * @param snap - set to the copy
+ */
+static void copy(volatile void *shm, int entrances, int exits, int levels, parking_snapshot_t *snap) {
+    for (int i = 0; i < entrances; i++) {
+        entrance_t *en = (entrance_t *)((char *)shm + (sizeof(entrance_t) * i));
+        copy_plate(snap->en[i].plate, en->sensor.plate);
+        snap->en[i].gate = *(volatile char *)&en->gate.status;
+        snap->en[i].sign = *(volatile char *)&en->sign.display;
+    }
+
+    for (int i = 0; i < exits; i++) {
+        exit_t *ex = (exit_t *)((char *)shm + (sizeof(entrance_t) * entrances) + (sizeof(exit_t) * i));
+        copy_plate(snap->ex[i].plate, ex->sensor.plate);
+        snap->ex[i].gate = *(volatile char *)&ex->gate.status;
+    }
+
+    for (int i = 0; i < levels; i++) {
+        level_t *lvl = (level_t *)((char *)shm + (sizeof(entrance_t) * entrances) + (sizeof(exit_t) * exits) + (sizeof(level_t) * i));
+        copy_plate(snap->lvl[i].plate, lvl->sensor.plate);
+        snap->lvl[i].temp = atomic_load_explicit(&lvl->temp_sensor, memory_order_relaxed);
+        snap->lvl[i].alarm = atomic_load_explicit(&lvl->alarm, memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Copies a plate byte by byte, always ending with a null terminator.
+ * 
+ * @param dest - 7 bytes to copy into
+ * @param src - plate in shared memory
+ */
+static void copy_plate(char *dest, volatile const char *src) {
+    for (int i = 0; i < 6; i++) {
+        dest[i] = src[i];
+    }
+    dest[6] = '\0';
+}
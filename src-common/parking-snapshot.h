@@ -0,0 +1,57 @@
+/************************************************
+ * @file    parking-snapshot.h
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   API for consistent, lock-free snapshots of all
+ *          the car park hardware in the PARKING shared
+ *          memory. Works from any of the 3 programs.
+ *
+ *          The snapshot never takes a hardware mutex, so
+ *          observers (the status display, metrics, debugging)
+ *          never hold up the entrances, exits & levels. If a
+ *          write happens while copying, the copy is thrown
+ *          away and taken again, so every snapshot is a
+ *          single point in time.
+ ***********************************************/
+#pragma once
+
+#include <stdint.h>     /* for int types */
+
+#define SNAPSHOT_MAX_TRIES 1000 /* copies attempted before giving up on a consistent one */
+
+/* Copy of every entrance, exit & level (5 of each at most) */
+typedef struct parking_snapshot_t {
+    int entrances;
+    int exits;
+    int levels;
+    struct {
+        char plate[7];
+        char gate;
+        char sign;
+    } en[5];
+    struct {
+        char plate[7];
+        char gate;
+    } ex[5];
+    struct {
+        char plate[7];
+        int16_t temp;
+        char alarm;
+    } lvl[5];
+    uint64_t version;   /* hardware writes finished when taken */
+    int retries;        /* copies thrown away due to writes */
+} parking_snapshot_t;
+
+/**
+ * @brief Copies every entrance, exit and level without locking.
+ * Retries while a write is in progress or happens during the copy.
+ *
+ * @param shm - first byte of shared memory
+ * @param entrances - no. of entrances
+ * @param exits - no. of exits
+ * @param levels - no. of levels
+ * @param snap - set to the copy
+ * @return int - 0 if consistent, -1 if still being written to after
+ * SNAPSHOT_MAX_TRIES (snap holds the last, possibly mixed, copy)
+ */
+int parking_snapshot(volatile void *shm, int entrances, int exits, int levels, parking_snapshot_t *snap);
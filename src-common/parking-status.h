@@ -0,0 +1,168 @@
+/************************************************
+ * @file    parking-status.h
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Status area shared by the Simulator, Manager
+ *          and Fire Alarm System, placed after the car park
+ *          hardware in the PARKING shared memory.
+ *
+ *          The hardware (entrances, exits, levels) always
+ *          takes the first PARKING_DEVICES_SIZE bytes, laid
+ *          out exactly as before. Everything the software
+ *          pieces need to tell each other (rather than the
+ *          hardware) goes in parking_status_t, which starts
+ *          at PARKING_STATUS_OFFSET.
+ *
+ *          Shared by all 3 programs so the layout can never
+ *          disagree between them.
+ ***********************************************/
+#pragma once
+
+#include <stdint.h>     /* for int types */
+#include <string.h>     /* for string operations */
+#include <stdatomic.h>  /* for atomic loads & stores */
+
+#include "event-log.h"  /* for logging every hardware change */
+
+#define PARKING_DEVICES_SIZE 2920   /* 5 entrances, 5 exits, 5 levels */
+#define PARKING_STATUS_OFFSET 2944  /* devices rounded up to a 64 byte cache line */
+#define PARKING_SIZE (PARKING_STATUS_OFFSET + sizeof(parking_status_t))
+
+/* -----------------------------------------------
+ *            FIRE ALARM HEARTBEATS
+ * -----------------------------------------------
+ * Every Fire Alarm thread owns 1 slot and bumps its
+ * counter at least every HEARTBEAT_PERIOD ms. Only the
+ * owner writes a slot, so a beat is a plain load & store
+ * (no locked instruction), and each slot has its own
+ * cache line so beating threads never slow each other.
+ */
+#define HEARTBEAT_SLOTS 8
+#define HB_MONITOR 0    /* slots 0..4 - 1 per level */
+#define HB_EVAC 5
+#define HB_GATE 6
+#define HB_NO_FIRE 7    /* stopped by a tool running the Manager without a Fire Alarm System */
+
+#define HB_UNUSED 0     /* thread never started, not watched */
+#define HB_ALIVE 1      /* thread running, beats must keep coming */
+#define HB_STOPPED 2    /* thread ended on purpose, not watched */
+
+typedef struct heartbeat_t {
+    volatile _Atomic uint64_t beats;
+    volatile _Atomic int state;     /* HB_UNUSED, HB_ALIVE, HB_STOPPED */
+    char padding[52];               /* pad to 64 bytes */
+} heartbeat_t;
+
+/* -----------------------------------------------
+ *              HARDWARE WRITE VERSION
+ * -----------------------------------------------
+ * Every change to the hardware (plate, gate, sign,
+ * temperature, alarm) in any of the 3 programs is
+ * wrapped in parking_write_begin/end, which count the
+ * writes started & finished. Equal counts mean nothing
+ * is mid-write, so a reader can copy the whole car park
+ * without locks and know the copy is consistent if no
+ * write started while it copied (see parking-snapshot.h).
+ *
+ * Like a seqlock, but 2 counters rather than 1 so that
+ * writers in different programs holding different mutexes
+ * may write at the same time.
+ */
+typedef struct parking_version_t {
+    volatile _Atomic uint64_t begun;
+    volatile _Atomic uint64_t ended;
+    char padding[48];               /* pad to 64 bytes */
+} parking_version_t;
+
+/* -----------------------------------------------
+ *                SIMULATED CLOCK
+ * -----------------------------------------------
+ * Published once by the Sim before any of its threads
+ * start: the CLOCK_MONOTONIC moment simulated time began
+ * and how fast it runs. The Manager & Fire Alarm System
+ * read it when they start, so all 3 programs sleep and
+ * timestamp against the same time (see sim-clock.h).
+ */
+typedef struct sim_clock_t {
+    volatile _Atomic uint64_t origin;   /* ns, 0 = not published yet */
+    volatile _Atomic double speed;      /* simulated ms per real ms */
+    char padding[48];                   /* pad to 64 bytes */
+} sim_clock_t;
+
+/* -----------------------------------------------
+ *          EVERYTHING AFTER THE HARDWARE
+ * -------------------------------------------- */
+typedef struct parking_status_t {
+    heartbeat_t fire[HEARTBEAT_SLOTS];
+    parking_version_t version;
+    sim_clock_t clock;
+} parking_status_t;
+
+/**
+ * @brief Locates the status area of the PARKING shared memory.
+ *
+ * @param shm - first byte of shared memory
+ * @return parking_status_t* - the status area
+ */
+static inline parking_status_t *parking_status(volatile void *shm) {
+    return (parking_status_t *)((char *)shm + PARKING_STATUS_OFFSET);
+}
+
+/**
+ * @brief Bumps a heartbeat, only ever called by the slot's owner.
+ *
+ * @param h - slot to bump
+ */
+static inline void heartbeat_beat(heartbeat_t *h) {
+    uint64_t b = atomic_load_explicit(&h->beats, memory_order_relaxed);
+    atomic_store_explicit(&h->beats, b + 1, memory_order_relaxed);
+}
+
+/**
+ * @brief Call before changing any hardware in the shared memory.
+ *
+ * @param shm - first byte of shared memory
+ */
+static inline void parking_write_begin(volatile void *shm) {
+    atomic_fetch_add(&parking_status(shm)->version.begun, 1);
+    atomic_thread_fence(memory_order_release); /* count is seen before the change */
+}
+
+/**
+ * @brief Call after changing hardware in the shared memory.
+ *
+ * @param shm - first byte of shared memory
+ */
+static inline void parking_write_end(volatile void *shm) {
+    atomic_fetch_add_explicit(&parking_status(shm)->version.ended, 1, memory_order_release);
+}
+
+/**
+ * @brief Changes a single character of hardware (gate status or sign
+ * display), counted as a write & logged. Lock the hardware's mutex first.
+ *
+ * @param shm - first byte of shared memory
+ * @param field - gate status or sign display
+ * @param value - new value
+ */
+static inline void parking_set(volatile void *shm, char *field, char value) {
+    parking_write_begin(shm);
+    *(volatile char *)field = value;
+    parking_write_end(shm);
+    EVENT_SET(shm, field, value);
+}
+
+/**
+ * @brief Changes an LPR's plate, counted as a write & logged. Lock the
+ * LPR's mutex first.
+ *
+ * @param shm - first byte of shared memory
+ * @param plate - LPR's plate
+ * @param value - new plate, "" = empty
+ */
+static inline void parking_set_plate(volatile void *shm, char *plate, const char *value) {
+    parking_write_begin(shm);
+    strcpy(plate, value);
+    parking_write_end(shm);
+    EVENT_PLATE(shm, plate, value);
+}
@@ -0,0 +1,66 @@
+/************************************************
+ * @file    parking-types.h
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Car park hardware types in the PARKING shared
+ *          memory, shared by the Simulator, Manager and
+ *          Fire Alarm System so the layout can never
+ *          disagree between them.
+ * 
+ * Formulas for locating segments of the PARKING shared memory, 
+ * where 'i' increments from 0 to less-than the number of 
+ * ENTRANCES/EXITS/LEVELS respectively.
+ * 
+ * entrances: (sizeof(en) * i)
+ * exits:     (sizeof(en) * total en) + (sizeof(ex) * i)
+ * levels:    (sizeof(en) * total en) + (sizeof(ex) * total ex) + (sizeof(lvl) * i)
+ ***********************************************/
+#pragma once
+
+#include <pthread.h>    /* for mutexes/conditions */
+#include <stdint.h>     /* for 16 bit int type */
+
+/* -----------------------------------------------
+ *                 NESTED TYPES
+ * -------------------------------------------- */
+typedef struct LPR_t {
+    pthread_mutex_t lock;
+    pthread_cond_t condition;
+    char plate[7];      /* 6 chars +1 for string null terminator */
+    char padding[1];    /* as we +1 above, we only need to +1 for padding, not +2 */
+} LPR_t;
+
+typedef struct boom_t {
+    pthread_mutex_t lock;
+    pthread_cond_t condition;
+    char status;        /* C,R,L,O - Closed, Raising, Lowering, Opened */
+    char padding[7];
+} boom_t;
+
+typedef struct info_t {
+    pthread_mutex_t lock;
+    pthread_cond_t condition;
+    char display;       /* X,F,number - Not authorised, Full, Assigned level*/
+    char padding[7];
+} info_t;
+
+/* -----------------------------------------------
+ *                 PARENT TYPES
+ * -------------------------------------------- */
+typedef struct entrance_t {
+    LPR_t sensor;
+    boom_t gate;
+    info_t sign;
+} entrance_t;
+
+typedef struct exit_t {
+    LPR_t sensor;
+    boom_t gate;
+} exit_t;
+
+typedef struct level_t {
+    LPR_t sensor;
+    volatile _Atomic int16_t temp_sensor;    /* 2 bytes - signed 16 bit int */
+    volatile _Atomic char alarm;            /* 1 byte  - either a '0' or a '1' */
+    char padding[5];
+} level_t;
@@ -0,0 +1,64 @@
+/************************************************
+ * @file    run-config.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Source code for run-config.h
+ ***********************************************/
+#include <stdio.h>      /* for IO operations */
+#include <stdlib.h>     /* for getenv, strtol & strtod */
+
+#include "run-config.h" /* corresponding header */
+
+/* function prototypes */
+static const char *lookup(const char *name);
+
+int config_int(const char *name, int compiled) {
+    const char *text = lookup(name);
+    char *end = NULL;
+
+    if (text == NULL) return compiled;
+
+    long value = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || value < -2147483647L || value > 2147483647L) {
+        printf("\t%s%s is not a whole no., using config.h (%d)\n", CONFIG_PREFIX, name, compiled);
+        return compiled;
+    }
+    printf("\t%s set to %ld by %s%s\n", name, value, CONFIG_PREFIX, name);
+    return (int)value;
+}
+
+double config_double(const char *name, double compiled) {
+    const char *text = lookup(name);
+    char *end = NULL;
+
+    if (text == NULL) return compiled;
+
+    double value = strtod(text, &end);
+    if (end == text || *end != '\0') {
+        printf("\t%s%s is not a no., using config.h (%g)\n", CONFIG_PREFIX, name, compiled);
+        return compiled;
+    }
+    printf("\t%s set to %g by %s%s\n", name, value, CONFIG_PREFIX, name);
+    return value;
+}
+
+const char *config_str(const char *name, const char *compiled) {
+    const char *text = lookup(name);
+
+    if (text == NULL) return compiled;
+    printf("\t%s set to \"%s\" by %s%s\n", name, text, CONFIG_PREFIX, name);
+    return text;
+}
+
+/**
+ * @brief Reads a value's environment variable.
+ *
+ * @param name - name in config.h
+ * @return const char* - CARPARK_<name>, NULL if unset or the name is too long
+ */
+static const char *lookup(const char *name) {
+    char var[64];
+
+    if (snprintf(var, sizeof(var), "%s%s", CONFIG_PREFIX, name) >= (int)sizeof(var)) return NULL;
+    return getenv(var);
+}
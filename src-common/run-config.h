@@ -0,0 +1,47 @@
+/************************************************
+ * @file    run-config.h
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   API for overriding a few config.h values when a
+ *          program starts, without re-building, so a harness
+ *          (./LOAD-TEST) can run many car park sizes and
+ *          arrival rates from 1 build.
+ *
+ *          A value is overridden by the environment variable
+ *          of the same name with a CARPARK_ prefix:
+ *
+ *          CARPARK_ENTRANCES=2 CARPARK_DURATION=10 ./SIMULATOR
+ *
+ *          Overrides go through the same bounds checks as
+ *          config.h. Without the variable, config.h is used.
+ ***********************************************/
+#pragma once
+
+#define CONFIG_PREFIX "CARPARK_"
+
+/**
+ * @brief A whole no. from config.h, or its override.
+ *
+ * @param name - name in config.h, such as "ENTRANCES"
+ * @param compiled - value in config.h
+ * @return int - CARPARK_<name> if set to a whole no., otherwise 'compiled'
+ */
+int config_int(const char *name, int compiled);
+
+/**
+ * @brief A no. (not necessarily whole) from config.h, or its override.
+ *
+ * @param name - name in config.h, such as "SPEED"
+ * @param compiled - value in config.h
+ * @return double - CARPARK_<name> if set to a no., otherwise 'compiled'
+ */
+double config_double(const char *name, double compiled);
+
+/**
+ * @brief A string from config.h, or its override.
+ *
+ * @param name - name in config.h, such as "RESULTS_DIR"
+ * @param compiled - value in config.h
+ * @return const char* - CARPARK_<name> if set (even to ""), otherwise 'compiled'
+ */
+const char *config_str(const char *name, const char *compiled);
@@ -0,0 +1,141 @@
+/************************************************
+ * @file    sim-clock.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Source code for sim-clock.h
+ ***********************************************/
+#include <stdio.h>      /* for IO operations */
+#include <stdint.h>     /* for int types */
+#include <stdatomic.h>  /* for atomic loads & stores */
+#include <errno.h>      /* for telling a signal apart */
+#include <time.h>       /* for the clock & sleeping */
+
+#include "sim-clock.h"  /* corresponding header */
+#include "parking-status.h" /* for the published clock */
+
+#define ATTACH_TRIES 100    /* 10ms apart, 1 second in total */
+
+/* this program's copy, speed is set before origin & never changes after */
+static volatile _Atomic uint64_t origin = 0;    /* CLOCK_MONOTONIC ns at simulated 0, 0 = not started */
+static double speed = 1;                        /* simulated ms per real ms */
+
+/* function prototypes */
+static uint64_t started(void);
+static struct timespec to_timespec(uint64_t ns);
+
+void sim_clock_start(volatile void *shm, double new_speed) {
+    speed = new_speed;
+    atomic_store(&origin, mono_ns());
+
+    if (shm != NULL) {
+        sim_clock_t *c = &parking_status(shm)->clock;
+        atomic_store(&c->speed, speed);
+        atomic_store(&c->origin, atomic_load(&origin)); /* published last, so the speed is seen with it */
+    }
+}
+
+int sim_clock_attach(volatile void *shm) {
+    sim_clock_t *c = &parking_status(shm)->clock;
+
+    for (int i = 0; i < ATTACH_TRIES; i++) {
+        uint64_t at = atomic_load(&c->origin);
+        if (at != 0) {
+            speed = atomic_load(&c->speed);
+            atomic_store(&origin, at);
+            return 0;
+        }
+        struct timespec nap = {0, 10000000};
+        nanosleep(&nap, NULL);
+    }
+    puts("\tThe Sim has not published its clock, running in real time");
+    sim_clock_start(NULL, 1);
+    return -1;
+}
+
+double sim_speed(void) {
+    started();
+    return speed;
+}
+
+double sim_now_ms(void) {
+    uint64_t at = started();
+    return ((double)(mono_ns() - at) / 1000000) * speed;
+}
+
+void sim_sleep_ms(double ms) {
+    if (ms <= 0) return;
+    started();
+
+    /* whole ns first, then split, so no part can overflow into the next */
+    struct timespec requested = to_timespec((uint64_t)((ms / speed) * 1000000));
+    nanosleep(&requested, NULL);
+}
+
+void sim_sleep_until_ms(double when) {
+    double real = sim_mono_ms(when);
+    if (real <= 0) return;
+
+    struct timespec at = to_timespec((uint64_t)(real * 1000000));
+
+    /* only a signal wakes it early, then sleep the rest */
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &at, NULL) == EINTR);
+}
+
+double sim_real_ms(double ms) {
+    started();
+    return ms / speed;
+}
+
+double sim_mono_ms(double when) {
+    uint64_t at = started();
+    return ((double)at / 1000000) + (when / speed);
+}
+
+uint64_t mono_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000) + (uint64_t)ts.tv_nsec;
+}
+
+double now_ms(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((double)ts.tv_sec * 1000) + ((double)ts.tv_nsec / 1000000);
+}
+
+double thread_cpu_ms(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ((double)ts.tv_sec * 1000) + ((double)ts.tv_nsec / 1000000);
+}
+
+/**
+ * @brief When simulated time began, starting a real time clock the
+ * first time it is needed if nothing started or attached one.
+ *
+ * @return uint64_t - CLOCK_MONOTONIC ns at simulated 0
+ */
+static uint64_t started(void) {
+    uint64_t at = atomic_load(&origin);
+
+    if (at == 0) {
+        uint64_t now = mono_ns();
+        /* if another thread got there first, use its start */
+        at = atomic_compare_exchange_strong(&origin, &at, now) ? now : at;
+    }
+    return at;
+}
+
+/**
+ * @brief Splits nanoseconds into a timespec.
+ *
+ * @param ns - nanoseconds
+ * @return struct timespec - the same time
+ */
+static struct timespec to_timespec(uint64_t ns) {
+    struct timespec ts = {(time_t)(ns / 1000000000), (long)(ns % 1000000000)};
+    return ts;
+}
@@ -0,0 +1,123 @@
+/************************************************
+ * @file    sim-clock.h
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   API for the simulated clock every timing in
+ *          the car park runs on: how long cars park, gate
+ *          and LPR delays, temperature ticks, heartbeats,
+ *          the traffic profile and billing.
+ *
+ *          Simulated time runs SPEED times as fast as real
+ *          time, so 0.5 is slow motion at half speed and 60
+ *          plays an hour of traffic in a minute. The Sim
+ *          starts the clock and publishes it in the PARKING
+ *          shared memory (see parking-status.h), then the
+ *          Manager & Fire Alarm System attach to it, so all
+ *          3 programs agree on the time and on the speed.
+ *
+ *          Times are milliseconds since the Sim started.
+ *          Latencies, traces & logs measure this machine, so
+ *          they stay on the real clock (mono_ns & now_ms, both
+ *          CLOCK_MONOTONIC), which every program & tool shares
+ *          from here.
+ *
+ *          A program that never starts or attaches (such as
+ *          ./MICRO-BENCH) gets a real time clock that starts
+ *          when it is first used.
+ ***********************************************/
+#pragma once
+
+#include <stdint.h>     /* for int types */
+
+#define SIM_SPEED_MIN 0.001 /* slowest, 1 simulated ms every real second */
+#define SIM_SPEED_MAX 1000  /* fastest, 1000 simulated ms every real ms */
+
+/**
+ * @brief Starts simulated time at 0 now, publishing it for the other
+ * programs. Call once, before any thread uses the clock.
+ *
+ * @param shm - first byte of the PARKING shared memory, NULL = this program only
+ * @param speed - simulated ms per real ms, SIM_SPEED_MIN..SIM_SPEED_MAX
+ */
+void sim_clock_start(volatile void *shm, double speed);
+
+/**
+ * @brief Follows the clock the Sim published, waiting up to 1 second
+ * for it. Without one (a Sim from an older build), warns and starts
+ * a real time clock of its own. Call once, before any thread uses
+ * the clock.
+ *
+ * @param shm - first byte of the PARKING shared memory
+ * @return int - 0 if attached, -1 if running on its own clock
+ */
+int sim_clock_attach(volatile void *shm);
+
+/**
+ * @brief How fast simulated time runs.
+ *
+ * @return double - simulated ms per real ms
+ */
+double sim_speed(void);
+
+/**
+ * @brief The simulated time.
+ *
+ * @return double - simulated ms since the Sim started
+ */
+double sim_now_ms(void);
+
+/**
+ * @brief Sleeps for simulated milliseconds. A signal may wake it early.
+ *
+ * @param ms - simulated ms to sleep
+ */
+void sim_sleep_ms(double ms);
+
+/**
+ * @brief Sleeps until a simulated time, returning at once if it has
+ * passed. Sleeping until a time rather than for a time keeps a
+ * schedule from drifting.
+ *
+ * @param when - sim_now_ms value to wake at
+ */
+void sim_sleep_until_ms(double when);
+
+/**
+ * @brief How long a simulated time takes in real time.
+ *
+ * @param ms - simulated ms
+ * @return double - real ms
+ */
+double sim_real_ms(double ms);
+
+/**
+ * @brief The real clock (CLOCK_MONOTONIC, like now_ms) at a simulated
+ * time, so simulated timestamps can join real ones in a trace.
+ *
+ * @param when - sim_now_ms value
+ * @return double - CLOCK_MONOTONIC in ms
+ */
+double sim_mono_ms(double when);
+
+/**
+ * @brief Nanoseconds since an arbitrary fixed point (real time, whatever
+ * the SPEED), the same in every program on this machine.
+ *
+ * @return uint64_t - CLOCK_MONOTONIC in ns
+ */
+uint64_t mono_ns(void);
+
+/**
+ * @brief Milliseconds since an arbitrary fixed point, for measuring
+ * how long something took (real time, whatever the SPEED).
+ *
+ * @return double - CLOCK_MONOTONIC in ms
+ */
+double now_ms(void);
+
+/**
+ * @brief Milliseconds of CPU time used by the calling thread so far.
+ *
+ * @return double - CPU milliseconds
+ */
+double thread_cpu_ms(void);
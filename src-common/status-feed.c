@@ -0,0 +1,159 @@
+/************************************************
+ * @file    status-feed.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Source code for status-feed.h
+ ***********************************************/
+#include <string.h>     /* for memcpy & memcmp */
+
+#include "status-feed.h" /* corresponding header */
+
+/* A frame being written */
+typedef struct frame_t {
+    uint8_t *buf;
+    size_t len;
+    uint16_t records;
+} frame_t;
+
+/* function prototypes */
+static void put(frame_t *f, int field, int index, const void *value);
+
+size_t feed_encode(const feed_state_t *now, const feed_state_t *was, uint32_t seq, uint64_t ns, uint8_t *buf) {
+    frame_t f = {buf, sizeof(feed_header_t), 0};
+    feed_header_t h;
+
+    /* compare against the subscriber's copy, or nothing for a snapshot */
+    if (was == NULL || was->ens != now->ens || was->exs != now->exs || was->lvls != now->lvls || was->cap != now->cap) {
+        uint8_t layout[6] = {(uint8_t)now->ens, (uint8_t)now->exs, (uint8_t)now->lvls, 0, 0, 0};
+        uint16_t cap = (uint16_t)now->cap;
+        memcpy(layout + 4, &cap, 2);
+        put(&f, FD_LAYOUT, 0, layout);
+        was = NULL;
+    }
+
+    for (int i = 0; i < now->ens; i++) {
+        if (was == NULL || memcmp(was->en[i].plate, now->en[i].plate, 6) != 0) put(&f, FD_EN_PLATE, i, now->en[i].plate);
+        if (was == NULL || was->en[i].gate != now->en[i].gate) put(&f, FD_EN_GATE, i, &now->en[i].gate);
+        if (was == NULL || was->en[i].sign != now->en[i].sign) put(&f, FD_EN_SIGN, i, &now->en[i].sign);
+    }
+    for (int i = 0; i < now->exs; i++) {
+        if (was == NULL || memcmp(was->ex[i].plate, now->ex[i].plate, 6) != 0) put(&f, FD_EX_PLATE, i, now->ex[i].plate);
+        if (was == NULL || was->ex[i].gate != now->ex[i].gate) put(&f, FD_EX_GATE, i, &now->ex[i].gate);
+    }
+    for (int i = 0; i < now->lvls; i++) {
+        if (was == NULL || memcmp(was->lvl[i].plate, now->lvl[i].plate, 6) != 0) put(&f, FD_LVL_PLATE, i, now->lvl[i].plate);
+        if (was == NULL || was->lvl[i].temp != now->lvl[i].temp) put(&f, FD_LVL_TEMP, i, &now->lvl[i].temp);
+        if (was == NULL || was->lvl[i].alarm != now->lvl[i].alarm) put(&f, FD_LVL_ALARM, i, &now->lvl[i].alarm);
+        if (was == NULL || was->lvl[i].capacity != now->lvl[i].capacity) put(&f, FD_LVL_CAPACITY, i, &now->lvl[i].capacity);
+    }
+    if (was == NULL || was->revenue != now->revenue) put(&f, FD_REVENUE, 0, &now->revenue);
+    if (was == NULL || was->cars != now->cars) put(&f, FD_CARS, 0, &now->cars);
+    if (was == NULL || was->failsafe != now->failsafe) put(&f, FD_FAILSAFE, 0, &now->failsafe);
+
+    if (f.records == 0) return 0;
+
+    h.version = FEED_VERSION;
+    h.kind = (was == NULL) ? FEED_SNAPSHOT : FEED_DELTA;
+    h.records = f.records;
+    h.seq = seq;
+    h.ns = ns;
+    memcpy(buf, &h, sizeof(h));
+    return f.len;
+}
+
+int feed_apply(feed_state_t *state, const uint8_t *buf, size_t len, feed_header_t *header) {
+    size_t at = sizeof(feed_header_t);
+    int applied = 0;
+
+    if (len < sizeof(feed_header_t)) return -1;
+    memcpy(header, buf, sizeof(feed_header_t));
+    if (header->version != FEED_VERSION) return -1;
+    if (header->kind == FEED_SNAPSHOT) memset(state, 0, sizeof(feed_state_t));
+
+    for (int r = 0; r < header->records && at + 2 <= len; r++) {
+        int field = buf[at];
+        int i = buf[at + 1];
+        int size = feed_value_size(field);
+        const uint8_t *v = buf + at + 2;
+
+        /* stop at anything malformed rather than guess */
+        if (size < 0 || i >= FEED_MAX || at + 2 + (size_t)size > len) break;
+        at += 2 + (size_t)size;
+        applied++;
+
+        switch (field) {
+            case FD_LAYOUT: {
+                state->ens = (v[0] <= FEED_MAX) ? v[0] : FEED_MAX;
+                state->exs = (v[1] <= FEED_MAX) ? v[1] : FEED_MAX;
+                state->lvls = (v[2] <= FEED_MAX) ? v[2] : FEED_MAX;
+                uint16_t cap;
+                memcpy(&cap, v + 4, 2);
+                state->cap = cap;
+                break;
+            }
+            case FD_EN_PLATE: memcpy(state->en[i].plate, v, 6); break;
+            case FD_EN_GATE: state->en[i].gate = (char)v[0]; break;
+            case FD_EN_SIGN: state->en[i].sign = (char)v[0]; break;
+            case FD_EX_PLATE: memcpy(state->ex[i].plate, v, 6); break;
+            case FD_EX_GATE: state->ex[i].gate = (char)v[0]; break;
+            case FD_LVL_PLATE: memcpy(state->lvl[i].plate, v, 6); break;
+            case FD_LVL_TEMP: memcpy(&state->lvl[i].temp, v, 2); break;
+            case FD_LVL_ALARM: state->lvl[i].alarm = (char)v[0]; break;
+            case FD_LVL_CAPACITY: memcpy(&state->lvl[i].capacity, v, 2); break;
+            case FD_REVENUE: memcpy(&state->revenue, v, 4); break;
+            case FD_CARS: memcpy(&state->cars, v, 4); break;
+            case FD_FAILSAFE: state->failsafe = (char)v[0]; break;
+            default: break;
+        }
+    }
+    return applied;
+}
+
+int feed_value_size(int field) {
+    int size = -1;
+
+    switch (field) {
+        case FD_LAYOUT:
+        case FD_EN_PLATE:
+        case FD_EX_PLATE:
+        case FD_LVL_PLATE:
+            size = 6;
+            break;
+        case FD_REVENUE:
+        case FD_CARS:
+            size = 4;
+            break;
+        case FD_LVL_TEMP:
+        case FD_LVL_CAPACITY:
+            size = 2;
+            break;
+        case FD_EN_GATE:
+        case FD_EN_SIGN:
+        case FD_EX_GATE:
+        case FD_LVL_ALARM:
+        case FD_FAILSAFE:
+            size = 1;
+            break;
+        default:
+            break;
+    }
+    return size;
+}
+
+/**
+ * @brief Appends 1 record to a frame.
+ *
+ * @param f - frame to append to
+ * @param field - what the record holds
+ * @param index - which entrance, exit or level
+ * @param value - the field's value, feed_value_size bytes
+ */
+static void put(frame_t *f, int field, int index, const void *value) {
+    int size = feed_value_size(field);
+
+    f->buf[f->len] = (uint8_t)field;
+    f->buf[f->len + 1] = (uint8_t)index;
+    memcpy(f->buf + f->len + 2, value, (size_t)size);
+    f->len += 2 + (size_t)size;
+    f->records++;
+}
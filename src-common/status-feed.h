@@ -0,0 +1,121 @@
+/************************************************
+ * @file    status-feed.h
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   API for the live status feed, the compact binary
+ *          frames the Manager publishes on a Unix socket
+ *          (STATUS_SOCKET in config.h) and ./STATUS-VIEWER
+ *          reads, so any no. of dashboards can watch the car
+ *          park without the Manager's terminal.
+ *
+ *          The socket is SOCK_SEQPACKET, so every send is 1
+ *          whole frame. A frame is a feed_header_t followed
+ *          by records, each 1 field byte, 1 index byte and the
+ *          field's value (1, 2, 4 or 6 bytes, see field_t):
+ *
+ *          FEED_SNAPSHOT - every field, sent on connect
+ *          FEED_DELTA    - only the fields that changed since
+ *                          the subscriber's last frame
+ *
+ *          Frames are never queued per subscriber. If one
+ *          cannot keep up its frame is skipped, and the next
+ *          delta carries every change since (conflation), so
+ *          the publisher never waits on a viewer. Both ends are
+ *          on 1 machine, so values are in its byte order.
+ ***********************************************/
+#pragma once
+
+#include <stdint.h>     /* for int types */
+#include <stddef.h>     /* for size_t */
+
+#define FEED_VERSION 1
+#define FEED_MAX 5          /* entrances, exits & levels at most */
+#define FEED_FRAME 512      /* bytes of the largest frame (a snapshot) */
+
+#define FEED_SNAPSHOT 'S'   /* feed_header_t kinds */
+#define FEED_DELTA 'D'
+
+/* What a record holds, index = which entrance, exit or level (0 if none) */
+typedef enum field_t {
+    FD_LAYOUT,          /* 6 bytes: no. of entrances, exits & levels, 0, then uint16 capacity per level */
+    FD_EN_PLATE,        /* 6 bytes: plate on an entrance's LPR, not '\0' terminated */
+    FD_EN_GATE,         /* 1 byte: 'C', 'R', 'O' or 'L' */
+    FD_EN_SIGN,         /* 1 byte: '0'..'4', 'X', 'F', 'E'... or 0 for blank */
+    FD_EX_PLATE,        /* 6 bytes */
+    FD_EX_GATE,         /* 1 byte */
+    FD_LVL_PLATE,       /* 6 bytes */
+    FD_LVL_TEMP,        /* 2 bytes: int16 degrees */
+    FD_LVL_ALARM,       /* 1 byte: '0' or '1' */
+    FD_LVL_CAPACITY,    /* 2 bytes: int16 cars parked */
+    FD_REVENUE,         /* 4 bytes: int32 cents */
+    FD_CARS,            /* 4 bytes: int32 cars entered */
+    FD_FAILSAFE,        /* 1 byte: 1 = Fire Alarm System not responding */
+    FEED_FIELDS         /* no. of fields */
+} field_t;
+
+/* Start of every frame, 16 bytes */
+typedef struct feed_header_t {
+    uint8_t version;    /* FEED_VERSION */
+    uint8_t kind;       /* FEED_SNAPSHOT or FEED_DELTA */
+    uint16_t records;   /* records after the header */
+    uint32_t seq;       /* frames the publisher has sent this subscriber before */
+    uint64_t ns;        /* CLOCK_MONOTONIC when the state was taken */
+} feed_header_t;
+
+/* Everything the feed carries, kept by both ends */
+typedef struct feed_state_t {
+    int ens;
+    int exs;
+    int lvls;
+    int cap;
+    struct {
+        char plate[6];
+        char gate;
+        char sign;
+    } en[FEED_MAX];
+    struct {
+        char plate[6];
+        char gate;
+    } ex[FEED_MAX];
+    struct {
+        char plate[6];
+        int16_t temp;
+        char alarm;
+        int16_t capacity;
+    } lvl[FEED_MAX];
+    int32_t revenue;
+    int32_t cars;
+    char failsafe;
+} feed_state_t;
+
+/**
+ * @brief Writes a frame of the fields of 'now' that differ from 'was',
+ * or of every field when 'was' is NULL (a snapshot).
+ *
+ * @param now - state to send
+ * @param was - state the subscriber already has, NULL if none
+ * @param seq - frames sent to the subscriber before
+ * @param ns - CLOCK_MONOTONIC when 'now' was taken
+ * @param buf - where to write, at least FEED_FRAME bytes
+ * @return size_t - bytes written, 0 if nothing changed
+ */
+size_t feed_encode(const feed_state_t *now, const feed_state_t *was, uint32_t seq, uint64_t ns, uint8_t *buf);
+
+/**
+ * @brief Applies a frame's records to a state.
+ *
+ * @param state - state to update
+ * @param buf - the frame
+ * @param len - bytes in the frame
+ * @param header - set to the frame's header
+ * @return int - records applied, -1 if not a frame of this version
+ */
+int feed_apply(feed_state_t *state, const uint8_t *buf, size_t len, feed_header_t *header);
+
+/**
+ * @brief Bytes of a field's value.
+ *
+ * @param field - the field
+ * @return int - 1, 2, 4 or 6, -1 if unknown
+ */
+int feed_value_size(int field);
@@ -0,0 +1,122 @@
+/************************************************
+ * @file    trace.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Source code for trace.h
+ ***********************************************/
+#include <stdio.h>      /* for IO operations */
+#include <unistd.h>     /* for getpid */
+#include <pthread.h>    /* for mutex locks & thread keys */
+
+#include "trace.h"      /* corresponding header */
+
+static const char *trace_program = "program"; /* for the trace file's name */
+
+#if TRACE
+
+/* Names written to the trace file, in the same order as trace_name_t */
+static const char *trace_names[TRACE_NAMES] = {
+    "entrance_queue", "exit_queue", "lpr_write", "sign_wait", "gate_open", "gate_close", "level_lpr",
+    "decision", "waiting_for_lock", "authorisation", "billing", "capacity", "actuation", "gate_hold",
+    "alarm_raise", "fire_gates"
+};
+
+_Thread_local trace_ring_t *trace_mine = NULL;
+_Thread_local uint32_t trace_tid = 0;
+
+/* -----------------------------------------------
+ *                      RINGS
+ * -----------------------------------------------
+ * trace_m guards claiming & handing back rings,
+ * never held while recording
+ */
+static trace_ring_t rings[TRACE_RINGS];
+static pthread_mutex_t trace_m = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t ring_key;
+static pthread_once_t ring_key_once = PTHREAD_ONCE_INIT;
+static uint32_t threads_seen = 0;
+static uint32_t threads_untraced = 0;
+
+/* function prototypes */
+static void make_key(void);
+static void detach(void *ring);
+
+trace_ring_t *trace_attach(void) {
+    trace_ring_t *r = NULL;
+
+    pthread_once(&ring_key_once, make_key);
+    pthread_mutex_lock(&trace_m);
+    for (int i = 0; i < TRACE_RINGS && r == NULL; i++) {
+        if (!rings[i].in_use) r = &rings[i];
+    }
+    threads_seen++;
+    trace_tid = threads_seen;
+    if (r != NULL) {
+        r->in_use = 1;
+    } else {
+        threads_untraced++;
+    }
+    pthread_mutex_unlock(&trace_m);
+
+    /* a thread without a ring tries again next time it traces */
+    if (r != NULL) pthread_setspecific(ring_key, r);
+    trace_mine = r;
+    return r;
+}
+
+/**
+ * @brief Creates the key whose destructor hands rings back.
+ */
+static void make_key(void) {
+    pthread_key_create(&ring_key, detach);
+}
+
+/**
+ * @brief Hands an ended thread's ring (and its spans) to the next new thread.
+ *
+ * @param ring - the ring
+ */
+static void detach(void *ring) {
+    pthread_mutex_lock(&trace_m);
+    ((trace_ring_t *)ring)->in_use = 0;
+    pthread_mutex_unlock(&trace_m);
+}
+
+#endif
+
+void trace_init(const char *program) {
+    trace_program = program;
+}
+
+void trace_dump(void) {
+#if TRACE
+    char name[64];
+    unsigned long spans = 0;
+    unsigned long lost = 0;
+
+    snprintf(name, sizeof(name), TRACE_FILE, trace_program);
+    FILE *fp = fopen(name, "w");
+    if (fp == NULL) {
+        perror("fopen trace file");
+        return;
+    }
+
+    /* header, then 1 span per line: start(ns) dur(ns) tid name plate seq */
+    fprintf(fp, "# %s %d\n", trace_program, (int)getpid());
+    for (int i = 0; i < TRACE_RINGS; i++) {
+        uint64_t head = atomic_load_explicit(&rings[i].head, memory_order_acquire);
+        uint64_t first = (head > TRACE_EVENTS) ? head - TRACE_EVENTS : 0;
+
+        lost += (unsigned long)first;
+        for (uint64_t j = first; j < head; j++) {
+            trace_event_t *e = &rings[i].events[j & (TRACE_EVENTS - 1)];
+            fprintf(fp, "%lu %lu %u %s %s %u\n", (unsigned long)e->start, (unsigned long)e->dur, e->tid,
+                trace_names[e->name], (e->plate[0] != '\0') ? e->plate : "-", e->seq);
+            spans++;
+        }
+    }
+    fclose(fp);
+    printf("~Trace: %lu spans written to %s (%lu overwritten, %u of %u threads not traced)\n",
+        spans, name, lost, threads_untraced, threads_seen);
+#endif
+}
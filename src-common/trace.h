@@ -0,0 +1,158 @@
+/************************************************
+ * @file    trace.h
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   API for span tracing on the hot paths of all 3
+ *          programs (queues, LPRs, authorisation, billing,
+ *          gates, the alarm), to see which program or lock
+ *          held a slow car up.
+ *
+ *          Only compiled in when TRACE is 1 in config.h,
+ *          otherwise every TRACE_ macro below expands to
+ *          nothing and costs nothing.
+ *
+ *          Every thread records spans into its own ring (no
+ *          lock, the oldest spans are overwritten when full),
+ *          handed to the next new thread when it ends. Spans
+ *          of a car carry its plate, and the Sim also adds the
+ *          car's sequence no., so TRACE-MERGE can join 1 car's
+ *          spans across the 3 programs. When a program ends it
+ *          writes its rings to trace-<program>.txt, then:
+ *
+ *          ./TRACE-MERGE   (writes trace.json for chrome://tracing)
+ *
+ *          The TRACE_RINGS rings are 1 static array, handed
+ *          from ended threads to new ones, so the Fire Alarm
+ *          System (MISRA C, no heap) can trace as well.
+ ***********************************************/
+#pragma once
+
+#include <stdint.h>     /* for int types */
+#include <stdatomic.h>  /* for atomic loads & stores */
+#include <time.h>       /* for the clock */
+
+#include "../config.h"  /* for TRACE */
+
+#define TRACE_RINGS 64          /* threads tracing at once, any more are not traced */
+#define TRACE_EVENTS 8192       /* spans per ring (a power of 2) */
+#define TRACE_FILE "trace-%s.txt" /* %s = program, such as simulator */
+
+/* What a span timed, keep trace_names (trace.c) in the same order */
+typedef enum trace_name_t {
+    TR_EN_QUEUE,        /* Sim: car waiting in an entrance queue */
+    TR_EX_QUEUE,        /* Sim: car waiting in an exit queue */
+    TR_LPR_WRITE,       /* Sim: car read by an LPR, until the Manager is told */
+    TR_SIGN_WAIT,       /* Sim: car waiting for the entrance sign */
+    TR_GATE_OPEN,       /* Sim: car waiting for a gate to raise & open */
+    TR_GATE_CLOSE,      /* Sim: gate lowering -> closed */
+    TR_LEVEL_LPR,       /* Sim: car read by a level's LPR */
+    TR_DECISION,        /* Manager: a whole entrance or exit decision */
+    TR_LOCKS,           /* Manager: waiting for a lock during a decision */
+    TR_AUTH,            /* Manager: authorised plates lookup */
+    TR_BILLING,         /* Manager: billing # table & file */
+    TR_CAPACITY,        /* Manager: finding/freeing a space */
+    TR_ACTUATE,         /* Manager: updating the sign & raising the gate */
+    TR_GATE_HOLD,       /* Manager: gate held open before lowering */
+    TR_ALARM_RAISE,     /* Fire Alarm System: fire detected -> alarms on */
+    TR_FIRE_GATES,      /* Fire Alarm System: alarm raised -> all gates raising */
+    TRACE_NAMES         /* no. of names */
+} trace_name_t;
+
+/* 1 span, 32 bytes */
+typedef struct trace_event_t {
+    uint64_t start;     /* ns, CLOCK_MONOTONIC so all 3 programs agree */
+    uint64_t dur;       /* ns */
+    uint32_t seq;       /* car's sequence no., 0 = unknown */
+    uint32_t tid;       /* thread no. within the program */
+    uint8_t name;       /* trace_name_t */
+    char plate[7];      /* car's plate, "" = not a car's span */
+} trace_event_t;
+
+/* 1 thread's spans, recorded into by its owner alone */
+typedef struct trace_ring_t {
+    _Alignas(64) trace_event_t events[TRACE_EVENTS];
+    volatile _Atomic uint64_t head;     /* spans ever recorded */
+    int in_use;                         /* 0 = free, 1 = owned by a thread */
+} trace_ring_t;
+
+/**
+ * @brief Names the program (for its trace file), before any thread traces.
+ *
+ * @param program - such as "simulator"
+ */
+void trace_init(const char *program);
+
+/**
+ * @brief Writes every ring to trace-<program>.txt, once the tracing
+ * threads have returned. Does nothing when TRACE is 0.
+ */
+void trace_dump(void);
+
+#if TRACE
+
+/* The calling thread's ring, NULL until it first traces */
+extern _Thread_local trace_ring_t *trace_mine;
+extern _Thread_local uint32_t trace_tid;
+
+/**
+ * @brief Claims a ring for the calling thread, only called the first
+ * time a thread traces.
+ *
+ * @return trace_ring_t* - the ring, NULL if none are free
+ */
+trace_ring_t *trace_attach(void);
+
+/**
+ * @brief Reads the clock spans are timed with.
+ *
+ * @return uint64_t - ns
+ */
+static inline uint64_t trace_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000) + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Records a span ending now into the calling thread's ring.
+ *
+ * @param name - what was timed
+ * @param start - when it started (ns, trace_now)
+ * @param plate - car's plate, NULL if not a car's span
+ * @param seq - car's sequence no., 0 if unknown
+ */
+static inline void trace_span(trace_name_t name, uint64_t start, const char *plate, uint32_t seq) {
+    uint64_t end = trace_now(); /* before claiming a ring, so the claim is not timed */
+    trace_ring_t *r = (trace_mine != NULL) ? trace_mine : trace_attach();
+    uint64_t head;
+    trace_event_t *e;
+
+    if (r == NULL) return;
+    head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    e = &r->events[head & (TRACE_EVENTS - 1)];
+    e->start = start;
+    e->dur = end - start;
+    e->seq = seq;
+    e->tid = trace_tid;
+    e->name = (uint8_t)name;
+    for (int i = 0; i < 7; i++) {
+        e->plate[i] = (plate != NULL && i < 6) ? plate[i] : '\0';
+        if (e->plate[i] == '\0') plate = NULL; /* pad after the end of the plate */
+    }
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+}
+
+/* Starts timing a span into a new variable t */
+#define TRACE_START(t) uint64_t t = trace_now()
+/* Records a span started with TRACE_START(t) */
+#define TRACE_SPAN(name, t, plate, seq) trace_span((name), (t), (plate), (seq))
+/* Records a span started at a time in ms (CLOCK_MONOTONIC), such as a car's stamps */
+#define TRACE_SPAN_MS(name, ms, plate, seq) trace_span((name), (uint64_t)((ms) * 1000000), (plate), (seq))
+
+#else
+
+#define TRACE_START(t)
+#define TRACE_SPAN(name, t, plate, seq)
+#define TRACE_SPAN_MS(name, ms, plate, seq)
+
+#endif
@@ -0,0 +1,53 @@
+/************************************************
+ * @file    adaptive-rate.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Source code for adaptive-rate.h
+ ***********************************************/
+#include "adaptive-rate.h"  /* corresponding header */
+#include "detectors.h"      /* for the fire thresholds */
+
+void sampler_init(sampler_t *s, int adaptive, int max_interval) {
+    for (int i = 0; i < CALM_WINDOW; i++) {
+        s->recent[i] = 0;
+    }
+    s->count = 0;
+    s->interval = BASE_INTERVAL;
+    s->max_interval = (max_interval < BASE_INTERVAL) ? BASE_INTERVAL : max_interval;
+    s->adaptive = adaptive;
+    s->wakeups = 0;
+}
+
+int sampler_next(sampler_t *s, int raw) {
+    int lowest = raw;
+    int highest = raw;
+
+    s->wakeups++;
+
+    /* shuffle recent temps down manually and add latest */
+    for (int i = 0; i < (CALM_WINDOW - 1); i++) {
+        s->recent[i] = s->recent[i + 1];
+    }
+    s->recent[CALM_WINDOW - 1] = raw;
+    if (s->count < CALM_WINDOW) s->count++;
+
+    /* find the range of the recent temps */
+    for (int i = CALM_WINDOW - s->count; i < CALM_WINDOW; i++) {
+        if (s->recent[i] < lowest) lowest = s->recent[i];
+        if (s->recent[i] > highest) highest = s->recent[i];
+    }
+
+    /* -----------------------------------------------
+     *   CALM? (WINDOW FULL, FAR BELOW RISE, NO TREND)
+     *   THEN BACK OFF, OTHERWISE SNAP BACK TO 2ms
+     * -------------------------------------------- */
+    if (s->adaptive && s->count == CALM_WINDOW &&
+        highest < (RISE_TEMP - CALM_MARGIN) && (highest - lowest) < SPIKE_DELTA) {
+        s->interval *= 2;
+        if (s->interval > s->max_interval) s->interval = s->max_interval;
+    } else {
+        s->interval = BASE_INTERVAL;
+    }
+
+    return s->interval;
+}
@@ -0,0 +1,51 @@
+/************************************************
+ * @file    adaptive-rate.h
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   API for adapting how often a monitor thread
+ *          samples its temperature sensor. While temps
+ *          are far below the fire thresholds and steady,
+ *          the interval doubles up to a hard maximum,
+ *          snapping back to every 2ms as soon as temps
+ *          approach the thresholds or start to trend.
+ *
+ *          The maximum interval caps the extra detection
+ *          delay: the worst case is the fixed-rate delay
+ *          plus at most 1 maximum interval.
+ ***********************************************/
+#pragma once
+
+#define BASE_INTERVAL 2     /* ms between samples at full rate */
+#define CALM_WINDOW 8       /* no. of recent raw temps checked for a trend */
+#define CALM_MARGIN 10      /* degrees below RISE_TEMP temps must stay to be calm */
+
+/* Sampling state for 1 monitor thread */
+typedef struct sampler_t {
+    int recent[CALM_WINDOW];    /* most recent raw temps, oldest first */
+    int count;                  /* raw temps collected (caps at CALM_WINDOW) */
+    int interval;               /* ms until the next sample */
+    int max_interval;           /* ms, the interval never goes beyond this */
+    int adaptive;               /* 0 = always BASE_INTERVAL, 1 = adapt */
+    unsigned long wakeups;      /* samples taken */
+} sampler_t;
+
+/**
+ * @brief Initialises a sampler before use.
+ *
+ * @param s - sampler to initialise
+ * @param adaptive - 0 = fixed 2ms interval, 1 = adaptive
+ * @param max_interval - longest ms between samples (at least BASE_INTERVAL)
+ */
+void sampler_init(sampler_t *s, int adaptive, int max_interval);
+
+/**
+ * @brief Records a raw temperature sample and decides how long to wait
+ * before the next one. The interval doubles while the recent raw temps
+ * are all CALM_MARGIN+ degrees below RISE_TEMP and vary by less than
+ * SPIKE_DELTA, otherwise it drops straight back to BASE_INTERVAL.
+ *
+ * @param s - sampler to update
+ * @param raw - raw temperature just sampled
+ * @return int - ms to wait before the next sample
+ */
+int sampler_next(sampler_t *s, int raw);
@@ -0,0 +1,367 @@
+/************************************************
+ * @file    detector-bench.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Offline evaluation harness for the fire
+ *          detection algorithms in detectors.h.
+ *          Replays temperature traces through every
+ *          detector as fast as possible, reporting
+ *          detection delay, false alarms, and the cost
+ *          of each sample in nanoseconds. Then replays
+ *          them again with adaptive sampling to compare
+ *          wakeups per hour & detection delay against
+ *          sampling every 2ms.
+ *
+ *          Not part of the Fire Alarm System itself, so
+ *          the MISRA C restrictions (no malloc) are relaxed.
+ *
+ *          Usage:
+ *          $ ./DETECTOR-BENCH                  (synthetic traces)
+ *          $ ./DETECTOR-BENCH trace.txt ...    (recorded traces)
+ *
+ *          Trace files have one raw temperature per line,
+ *          sampled every 2ms. Lines starting with '#' are
+ *          comments, except "# onset n" which marks the
+ *          sample the fire started at (no onset = no fire).
+ ***********************************************/
+#include <stdio.h>      /* for IO operations */
+#include <stdlib.h>     /* for dynamic memory */
+#include <string.h>     /* for string operations */
+#include <stdint.h>     /* for int types */
+
+#include "detectors.h"  /* for the algorithms being evaluated */
+#include "adaptive-rate.h" /* for adaptive sampling */
+#include "../config.h"  /* for MAX_SAMPLE_INTERVAL */
+#include "../src-common/sim-clock.h" /* for timing */
+
+#define SAMPLE_MS 2             /* monitor threads sample every 2ms */
+#define TIMING_REPS 5           /* passes over each trace when timing */
+#define NORMAL_SAMPLES 500000   /* ~17 minutes of quiet carpark */
+#define FIRE_SAMPLES 20000      /* ~40 seconds either side of a fire */
+#define MAX_TRACES 64
+
+/* A temperature trace */
+typedef struct trace_t {
+    char name[64];
+    int *temps;     /* raw temperatures */
+    int n;          /* no. of samples */
+    int onset;      /* sample the fire started at, -1 if no fire */
+} trace_t;
+
+/* Result of replaying 1 trace through 1 detector */
+typedef struct result_t {
+    int delay;          /* samples from onset to alarm, -1 if missed/no fire */
+    int false_alarms;   /* alarms before the onset */
+    double ns_per_sample;
+    unsigned long wakeups; /* samples actually taken */
+} result_t;
+
+/* function prototypes */
+static uint32_t next_rand(uint32_t *seed);
+static int walk(uint32_t *seed, int prev, int min, int max);
+static void add_synthetic(trace_t *traces, int *count);
+static int load_trace(const char *path, trace_t *t);
+static result_t evaluate(const detector_t *d, const trace_t *t, int adaptive);
+
+int main(int argc, char **argv) {
+    trace_t traces[MAX_TRACES];
+    int count = 0;
+
+    /* -----------------------------------------------
+     *       LOAD TRACES FROM FILES, OR GENERATE
+     *       SYNTHETIC TRACES IF NONE GIVEN
+     * -------------------------------------------- */
+    if (argc > 1) {
+        for (int i = 1; i < argc && count < MAX_TRACES; i++) {
+            if (load_trace(argv[i], &traces[count])) count++;
+        }
+    } else {
+        add_synthetic(traces, &count);
+    }
+
+    if (count == 0) {
+        puts("No traces to evaluate");
+        return EXIT_FAILURE;
+    }
+
+    /* -----------------------------------------------
+     *     REPLAY EVERY TRACE THROUGH EVERY DETECTOR
+     * -------------------------------------------- */
+    printf("%-14s %-12s %9s %10s %8s %10s %11s\n",
+        "TRACE", "DETECTOR", "SAMPLES", "DELAY(ms)", "FALSE", "FALSE/HR", "NS/SAMPLE");
+
+    for (int t = 0; t < count; t++) {
+        double hours = ((double)(traces[t].onset < 0 ? traces[t].n : traces[t].onset) * SAMPLE_MS) / 3600000.0;
+
+        for (int d = 0; d < detectors_count; d++) {
+            result_t r = evaluate(&detectors[d], &traces[t], 0);
+            char delay[32];
+
+            if (traces[t].onset < 0) {
+                strcpy(delay, "-");
+            } else if (r.delay < 0) {
+                strcpy(delay, "MISSED");
+            } else {
+                sprintf(delay, "%d", r.delay * SAMPLE_MS);
+            }
+
+            printf("%-14s %-12s %9d %10s %8d %10.2f %11.1f\n",
+                traces[t].name, detectors[d].name, traces[t].n, delay, r.false_alarms,
+                hours > 0 ? r.false_alarms / hours : 0.0, r.ns_per_sample);
+        }
+        puts("");
+    }
+
+    /* -----------------------------------------------
+     *      COMPARE FIXED 2ms AGAINST ADAPTIVE SAMPLING
+     * -----------------------------------------------
+     * The extra delay from adaptive sampling must never be
+     * more than MAX_SAMPLE_INTERVAL (the hard cap)
+     */
+    int max_interval = (MAX_SAMPLE_INTERVAL < BASE_INTERVAL) ? BASE_INTERVAL : MAX_SAMPLE_INTERVAL;
+    int violations = 0;
+
+    printf("ADAPTIVE SAMPLING (at most %dms between samples)\n", max_interval);
+    printf("%-14s %-12s %11s %11s %13s %13s %5s\n",
+        "TRACE", "DETECTOR", "FIXED(ms)", "ADAPT(ms)", "FIXED WAKE/HR", "ADAPT WAKE/HR", "CAP");
+
+    for (int t = 0; t < count; t++) {
+        double hours = ((double)traces[t].n * SAMPLE_MS) / 3600000.0;
+
+        for (int d = 0; d < detectors_count; d++) {
+            result_t fixed = evaluate(&detectors[d], &traces[t], 0);
+            result_t adapt = evaluate(&detectors[d], &traces[t], 1);
+            char fixed_delay[32];
+            char adapt_delay[32];
+            int held = 1;
+
+            /* if the fixed rate catches the fire, adaptive must too within the cap */
+            if (fixed.delay >= 0) {
+                held = adapt.delay >= 0 && (adapt.delay - fixed.delay) * SAMPLE_MS <= max_interval;
+            }
+            if (!held) violations++;
+
+            sprintf(fixed_delay, "%d", fixed.delay * SAMPLE_MS);
+            sprintf(adapt_delay, "%d", adapt.delay * SAMPLE_MS);
+            if (fixed.delay < 0) strcpy(fixed_delay, traces[t].onset < 0 ? "-" : "MISSED");
+            if (adapt.delay < 0) strcpy(adapt_delay, traces[t].onset < 0 ? "-" : "MISSED");
+
+            /* wakeups up until the alarm (or the whole trace if no alarm) */
+            int fixed_n = (fixed.delay >= 0) ? traces[t].onset + fixed.delay + 1 : traces[t].n;
+            int adapt_n = (adapt.delay >= 0) ? traces[t].onset + adapt.delay + 1 : traces[t].n;
+
+            printf("%-14s %-12s %11s %11s %13.0f %13.0f %5s\n",
+                traces[t].name, detectors[d].name, fixed_delay, adapt_delay,
+                fixed.wakeups / (hours * fixed_n / traces[t].n),
+                adapt.wakeups / (hours * adapt_n / traces[t].n), held ? "ok" : "FAIL");
+        }
+        puts("");
+    }
+
+    for (int t = 0; t < count; t++) free(traces[t].temps);
+    return (violations == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * @brief Replays a trace through a detector, first to measure accuracy
+ * (stopping at the first alarm after the onset), then several more times
+ * without stopping to measure the cost of each sample.
+ *
+ * An alarm before the onset is a false alarm, the detector is reset
+ * (as if the alarm was cleared) and the replay continues.
+ *
+ * With adaptive sampling, samples are skipped while the sampler backs
+ * off (each trace sample is 2ms apart), the timing passes are skipped.
+ *
+ * @param d - detector to evaluate
+ * @param t - trace to replay
+ * @param adaptive - 0 = sample every 2ms, 1 = adaptive sampling
+ * @return result_t - delay, false alarms, ns/sample and wakeups
+ */
+static result_t evaluate(const detector_t *d, const trace_t *t, int adaptive) {
+    result_t r = {-1, 0, 0, 0};
+    smoother_t smoother;
+    detector_state_t state;
+    sampler_t sampler;
+    int smoothed = 0;
+    volatile int alarms = 0; /* volatile so the timing loop is not optimised away */
+
+    /* -----------------------------------------------
+     *                  ACCURACY PASS
+     * -------------------------------------------- */
+    smoother_reset(&smoother);
+    d->reset(&state);
+    sampler_init(&sampler, adaptive, MAX_SAMPLE_INTERVAL);
+
+    for (int i = 0; i < t->n; i += sampler_next(&sampler, t->temps[i]) / SAMPLE_MS) {
+        if (smoother_push(&smoother, t->temps[i], &smoothed) && d->update(&state, smoothed)) {
+            if (t->onset < 0 || i < t->onset) {
+                r.false_alarms++;
+                smoother_reset(&smoother);
+                d->reset(&state);
+            } else {
+                r.delay = i - t->onset;
+                r.wakeups = sampler.wakeups + 1;
+                break;
+            }
+        }
+    }
+    if (r.delay < 0) r.wakeups = sampler.wakeups;
+    if (adaptive) return r;
+
+    /* -----------------------------------------------
+     *                  TIMING PASSES
+     * -------------------------------------------- */
+    uint64_t start = mono_ns();
+    for (int rep = 0; rep < TIMING_REPS; rep++) {
+        smoother_reset(&smoother);
+        d->reset(&state);
+        for (int i = 0; i < t->n; i++) {
+            if (smoother_push(&smoother, t->temps[i], &smoothed)) alarms += d->update(&state, smoothed);
+        }
+    }
+    r.ns_per_sample = (double)(mono_ns() - start) / ((double)t->n * TIMING_REPS);
+
+    return r;
+}
+
+/**
+ * @brief Generates the synthetic traces, each reproducible as the
+ * seed is fixed. Temperatures follow the same +-1 random walk as the
+ * Simulator (see simulate-temp.c) within a window of temps.
+ *
+ * normal    - 26..33 the whole time (false alarms only)
+ * rise      - 26..33 then 52..59 (config.h's TRIGGER RISE)
+ * spike     - 26..33 then 26..46 (config.h's TRIGGER SPIKE)
+ * ramp      - 26..33 then climbs 1 degree every 2 samples
+ * slow-rise - 26..33 then climbs 1 degree every 50 samples
+ *
+ * @param traces - array to add traces to
+ * @param count - no. of traces in the array, incremented per trace added
+ */
+static void add_synthetic(trace_t *traces, int *count) {
+    const char *names[] = {"normal", "rise", "spike", "ramp", "slow-rise"};
+    uint32_t seed = 403;
+
+    for (int k = 0; k < 5; k++) {
+        trace_t *t = &traces[*count];
+        int n = (k == 0) ? NORMAL_SAMPLES : FIRE_SAMPLES * 2;
+        int base = 26;
+
+        strcpy(t->name, names[k]);
+        t->temps = malloc(sizeof(int) * n);
+        if (t->temps == NULL) {
+            printf("~Out of memory for the %s trace, skipping it\n", names[k]);
+            continue;
+        }
+        t->n = n;
+        t->onset = (k == 0) ? -1 : FIRE_SAMPLES;
+
+        for (int i = 0; i < n; i++) {
+            int since = i - FIRE_SAMPLES; /* samples since the fire started */
+            int temp;
+
+            /* random walk within the window of temps */
+            if (k == 1 && since >= 0) {
+                base = walk(&seed, base, 52, 59);
+            } else if (k == 2 && since >= 0) {
+                base = walk(&seed, base, 26, 46);
+            } else {
+                base = walk(&seed, base, 26, 33);
+            }
+
+            /* then climb on top of the walk */
+            temp = base;
+            if (k == 3 && since >= 0) temp += since / 2;
+            if (k == 4 && since >= 0) temp += since / 50;
+
+            t->temps[i] = temp;
+        }
+        (*count)++;
+    }
+}
+
+/**
+ * @brief Loads a trace file (see top of file for the format).
+ *
+ * @param path - file to read
+ * @param t - trace to fill
+ * @return int - 1 if loaded, 0 if the file could not be read (or held)
+ */
+static int load_trace(const char *path, trace_t *t) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        perror(path);
+        return 0;
+    }
+
+    size_t size = 1024;
+    char line[1000]; /* buffer to ensure whole line is read */
+    const char *base = strrchr(path, '/');
+
+    snprintf(t->name, sizeof(t->name), "%s", base != NULL ? base + 1 : path);
+    t->temps = malloc(sizeof(int) * size);
+    if (t->temps == NULL) {
+        printf("~Out of memory for %s, skipping it\n", path);
+        fclose(fp);
+        return 0;
+    }
+    t->n = 0;
+    t->onset = -1;
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if (line[0] == '#') {
+            sscanf(line, "# onset %d", &t->onset);
+            continue;
+        }
+
+        /* if we've run out of memory, realloc the array */
+        if (t->n >= (int)size) {
+            int *grown = realloc(t->temps, sizeof(int) * size * 2);
+            if (grown == NULL) {
+                printf("~Out of memory for %s, skipping it\n", path);
+                free(t->temps);
+                fclose(fp);
+                return 0;
+            }
+            t->temps = grown;
+            size *= 2;
+        }
+        if (sscanf(line, "%d", &t->temps[t->n]) == 1) t->n++;
+    }
+    fclose(fp);
+    return 1;
+}
+
+/**
+ * @brief Xorshift random numbers, so traces are the same on every machine.
+ *
+ * @param seed - state, updated in place
+ * @return uint32_t - next random number
+ */
+static uint32_t next_rand(uint32_t *seed) {
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 17;
+    *seed ^= *seed << 5;
+    return *seed;
+}
+
+/**
+ * @brief Moves a temperature up or down by at most 1 degree, staying
+ * within min..max (jumping back into bounds like the Simulator does).
+ *
+ * @param seed - random state
+ * @param prev - previous temperature
+ * @param min - lowest temperature
+ * @param max - highest temperature
+ * @return int - next temperature
+ */
+static int walk(uint32_t *seed, int prev, int min, int max) {
+    int lo = prev - 1;
+    int hi = prev + 1;
+
+    if (lo < min) lo = min;
+    if (hi > max) hi = max;
+    if (lo > hi) lo = hi;
+    return lo + (int)(next_rand(seed) % (uint32_t)((hi - lo) + 1));
+}
@@ -0,0 +1,246 @@
+/************************************************
+ * @file    detectors.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Source code for detectors.h
+ ***********************************************/
+#include <string.h>     /* for string operations */
+
+#include "detectors.h"  /* corresponding header */
+
+#define EWMA_ALPHA 0.3  /* weight of the newest smoothed temp in the EWMA level */
+#define EWMA_BETA 0.05  /* weight of the newest change in the EWMA trend */
+#define CUSUM_K 5.0     /* degrees above the baseline we allow before accumulating */
+#define CUSUM_H 40.0    /* cumulative degrees above the allowance to trigger */
+#define REGRESSION_DELTA 12 /* fitted rise across the window to trigger (a step of 8 fits as ~12) */
+#define CUSUM_ALPHA 0.01 /* how quickly the CUSUM baseline follows the temperature */
+
+/* function prototypes */
+static void window_reset(detector_state_t *s);
+static void window_push(detector_state_t *s, int smoothed);
+static int rise_update(detector_state_t *s, int smoothed);
+static int spike_update(detector_state_t *s, int smoothed);
+static int legacy_update(detector_state_t *s, int smoothed);
+static int ewma_update(detector_state_t *s, int smoothed);
+static int cusum_update(detector_state_t *s, int smoothed);
+static int regression_update(detector_state_t *s, int smoothed);
+
+/* -----------------------------------------------
+ *              DETECTOR REGISTRY
+ * -----------------------------------------------
+ * To add a detector, write its reset/update functions
+ * and add it here. The first entry is the default.
+ */
+const detector_t detectors[] = {
+    {"rise+spike", "90% of last 30 smoothed temps 58+ OR newest 8+ above oldest", window_reset, legacy_update},
+    {"rise", "90% of last 30 smoothed temps are 58+ degrees", window_reset, rise_update},
+    {"spike", "newest smoothed temp 8+ degrees above oldest of last 30", window_reset, spike_update},
+    {"ewma", "EWMA level 58+ OR EWMA trend of 8+ degrees per 30 temps", window_reset, ewma_update},
+    {"cusum", "CUSUM of temps above a slow moving baseline", window_reset, cusum_update},
+    {"regression", "least-squares slope of last 30 temps of 12+ degrees per 30 temps", window_reset, regression_update},
+};
+const int detectors_count = (int)(sizeof(detectors) / sizeof(detectors[0]));
+
+void smoother_reset(smoother_t *s) {
+    for (int i = 0; i < MEDIAN_WINDOW; i++) {
+        s->raw[i] = 0;
+    }
+    s->count = 0;
+}
+
+int smoother_push(smoother_t *s, int raw, int *smoothed) {
+    int sorted[MEDIAN_WINDOW];
+    int produced = 0;
+
+    /* shuffle raw temps down manually and add latest */
+    for (int i = 0; i < (MEDIAN_WINDOW - 1); i++) {
+        s->raw[i] = s->raw[i + 1];
+    }
+    s->raw[MEDIAN_WINDOW - 1] = raw;
+    if (s->count < MEDIAN_WINDOW) s->count++;
+
+    /* once we have 5 raw temps, sort a copy (so the raw temps stay
+    in the order they arrived) to find the median */
+    if (s->count == MEDIAN_WINDOW) {
+        for (int i = 0; i < MEDIAN_WINDOW; i++) {
+            sorted[i] = s->raw[i];
+        }
+        *smoothed = bubble_sort(sorted, MEDIAN_WINDOW);
+        produced = 1;
+    }
+    return produced;
+}
+
+const detector_t *find_detector(const char *name) {
+    const detector_t *found = NULL;
+
+    for (int i = 0; i < detectors_count; i++) {
+        if (found == NULL && strcmp(detectors[i].name, name) == 0) found = &detectors[i];
+    }
+    return found;
+}
+
+int bubble_sort(int *arr, int size) {
+    int temp;
+
+    for(int i = 0; i < (size - 1);i++) {
+        for(int j = 0; j < (size - i - 1); j++) {
+            if(arr[j] > arr[j+1]) {
+             /* swap to keep ascending order */
+             temp = arr[j];
+             arr[j] = arr[j+1];
+             arr[j+1] = temp;
+            }
+        }
+    }
+
+    return arr[(size - 1) / 2]; /* median */
+}
+
+/* -----------------------------------------------
+ *           WINDOW OF RECENT SMOOTHED TEMPS
+ * -------------------------------------------- */
+static void window_reset(detector_state_t *s) {
+    for (int i = 0; i < SMOOTHED_WINDOW; i++) {
+        s->window[i] = 0;
+    }
+    s->count = 0;
+    s->level = 0;
+    s->trend = 0;
+    s->sum = 0;
+}
+
+static void window_push(detector_state_t *s, int smoothed) {
+    for (int i = 0; i < (SMOOTHED_WINDOW - 1); i++) {
+        s->window[i] = s->window[i + 1];
+    }
+    s->window[SMOOTHED_WINDOW - 1] = smoothed;
+    if (s->count < SMOOTHED_WINDOW) s->count++;
+}
+
+/* -----------------------------------------------
+ *                RISE ALGORITHM
+ * -----------------------------------------------
+ * If 90% of the last 30 smoothed temps are 58+ degrees,
+ * this is considered a high temperature
+ */
+static int rise_update(detector_state_t *s, int smoothed) {
+    int highs = 0;
+
+    window_push(s, smoothed);
+    if (s->count < SMOOTHED_WINDOW) return 0;
+
+    for (int i = 0; i < SMOOTHED_WINDOW; i++) {
+        if (s->window[i] >= RISE_TEMP) highs++;
+    }
+    return (highs >= SMOOTHED_WINDOW * RISE_RATIO) ? 1 : 0;
+}
+
+/* -----------------------------------------------
+ *                SPIKE ALGORITHM
+ * -----------------------------------------------
+ * If the newest temp is 8+ degrees higher than the oldest
+ * temp (out of the last 30), this is a high rate-of-rise
+ */
+static int spike_update(detector_state_t *s, int smoothed) {
+    window_push(s, smoothed);
+    if (s->count < SMOOTHED_WINDOW) return 0;
+
+    return (s->window[SMOOTHED_WINDOW - 1] - s->window[0] >= SPIKE_DELTA) ? 1 : 0;
+}
+
+/* -----------------------------------------------
+ *          RISE + SPIKE (ORIGINAL BEHAVIOUR)
+ * -------------------------------------------- */
+static int legacy_update(detector_state_t *s, int smoothed) {
+    int highs = 0;
+
+    window_push(s, smoothed);
+    if (s->count < SMOOTHED_WINDOW) return 0;
+
+    for (int i = 0; i < SMOOTHED_WINDOW; i++) {
+        if (s->window[i] >= RISE_TEMP) highs++;
+    }
+    if (highs >= SMOOTHED_WINDOW * RISE_RATIO) return 1;
+    return (s->window[SMOOTHED_WINDOW - 1] - s->window[0] >= SPIKE_DELTA) ? 1 : 0;
+}
+
+/* -----------------------------------------------
+ *          EWMA (HOLT'S LEVEL + TREND)
+ * -----------------------------------------------
+ * Level follows the temperature, trend follows how
+ * quickly the level changes. Triggers on a high level
+ * (like RISE) or a steep trend (like SPIKE) without
+ * having to wait for a full window of temps.
+ */
+static int ewma_update(detector_state_t *s, int smoothed) {
+    double prev = s->level;
+
+    if (s->count == 0) {
+        /* first temp seeds the level */
+        s->level = smoothed;
+        s->trend = 0;
+        s->count = 1;
+        return 0;
+    }
+
+    s->level = (EWMA_ALPHA * smoothed) + ((1 - EWMA_ALPHA) * (prev + s->trend));
+    s->trend = (EWMA_BETA * (s->level - prev)) + ((1 - EWMA_BETA) * s->trend);
+
+    if (s->level >= RISE_TEMP) return 1;
+    return (s->trend * (SMOOTHED_WINDOW - 1) >= SPIKE_DELTA) ? 1 : 0;
+}
+
+/* -----------------------------------------------
+ *                    CUSUM
+ * -----------------------------------------------
+ * Accumulates how far temps sit above a baseline (minus
+ * an allowance for normal variation). The baseline is the
+ * average of the first 30 temps, then slowly follows the
+ * temperature only while nothing is accumulating.
+ */
+static int cusum_update(detector_state_t *s, int smoothed) {
+
+    /* learn the baseline from the first 30 temps */
+    if (s->count < SMOOTHED_WINDOW) {
+        s->count++;
+        s->level += (smoothed - s->level) / s->count;
+        return 0;
+    }
+
+    s->sum += smoothed - s->level - CUSUM_K;
+    if (s->sum < 0) s->sum = 0;
+
+    if (s->sum == 0) s->level += CUSUM_ALPHA * (smoothed - s->level);
+
+    return (s->sum >= CUSUM_H) ? 1 : 0;
+}
+
+/* -----------------------------------------------
+ *          LINEAR REGRESSION RATE-OF-RISE
+ * -----------------------------------------------
+ * Least-squares slope of the last 30 smoothed temps,
+ * less sensitive to a single outlier than SPIKE which
+ * only compares the oldest & newest temps.
+ */
+static int regression_update(detector_state_t *s, int smoothed) {
+    double mean_x = (SMOOTHED_WINDOW - 1) / 2.0;
+    double mean_y = 0;
+    double num = 0;
+    double den = 0;
+
+    window_push(s, smoothed);
+    if (s->count < SMOOTHED_WINDOW) return 0;
+
+    for (int i = 0; i < SMOOTHED_WINDOW; i++) {
+        mean_y += s->window[i];
+    }
+    mean_y /= SMOOTHED_WINDOW;
+
+    for (int i = 0; i < SMOOTHED_WINDOW; i++) {
+        num += (i - mean_x) * (s->window[i] - mean_y);
+        den += (i - mean_x) * (i - mean_x);
+    }
+
+    return ((num / den) * (SMOOTHED_WINDOW - 1) >= REGRESSION_DELTA) ? 1 : 0;
+}
@@ -0,0 +1,87 @@
+/************************************************
+ * @file    detectors.h
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   API for pluggable fire detection algorithms.
+ *          Raw temperatures are first smoothed (median of
+ *          the 5 most recent raw temps), then each smoothed
+ *          temp is fed to a detector which decides if there
+ *          is a possible fire.
+ *
+ *          No dynamic memory is used (MISRA C), every detector
+ *          keeps its state in a fixed-size detector_state_t
+ *          owned by the caller (one per level).
+ ***********************************************/
+#pragma once
+
+#define MEDIAN_WINDOW 5     /* median of 5 most recent temps = next smoothed temp */
+#define SMOOTHED_WINDOW 30  /* only keep the most recent 30 smoothed temps */
+#define RISE_TEMP 58        /* smoothed temps this hot or hotter are "high" */
+#define RISE_RATIO 0.9      /* ratio of high temps in the window to trigger */
+#define SPIKE_DELTA 8       /* degrees between oldest & newest smoothed temps to trigger */
+
+/* Raw temperatures waiting to be smoothed */
+typedef struct smoother_t {
+    int raw[MEDIAN_WINDOW];
+    int count;              /* raw temps collected so far (caps at MEDIAN_WINDOW) */
+} smoother_t;
+
+/* State for every detector, only the fields a detector needs are used */
+typedef struct detector_state_t {
+    int window[SMOOTHED_WINDOW];    /* most recent smoothed temps, oldest first */
+    int count;                      /* smoothed temps in the window (caps at SMOOTHED_WINDOW) */
+    double level;                   /* EWMA level / CUSUM baseline */
+    double trend;                   /* EWMA trend (degrees per smoothed temp) */
+    double sum;                     /* CUSUM cumulative sum */
+} detector_state_t;
+
+/* A fire detection algorithm */
+typedef struct detector_t {
+    const char *name;                                   /* short name, used in config.h */
+    const char *description;                            /* one line summary */
+    void (*reset)(detector_state_t *s);                 /* clear all state */
+    int (*update)(detector_state_t *s, int smoothed);   /* 1 = possible fire, 0 = no fire */
+} detector_t;
+
+/* All available detectors, the first is the default */
+extern const detector_t detectors[];
+extern const int detectors_count;
+
+/**
+ * @brief Clears a smoother before use.
+ *
+ * @param s - smoother to reset
+ */
+void smoother_reset(smoother_t *s);
+
+/**
+ * @brief Adds a raw temperature to the smoother. Once 5 raw temps
+ * have been collected, every new raw temp produces a smoothed temp
+ * (the median of the 5 most recent raw temps).
+ *
+ * @param s - smoother to add to
+ * @param raw - latest raw temperature
+ * @param smoothed - set to the smoothed temp if one was produced
+ * @return int - 1 if a smoothed temp was produced, 0 if not
+ */
+int smoother_push(smoother_t *s, int raw, int *smoothed);
+
+/**
+ * @brief Finds a detector by name.
+ *
+ * @param name - name of the detector, such as "rise+spike" or "cusum"
+ * @return const detector_t* - the detector, NULL if not found
+ */
+const detector_t *find_detector(const char *name);
+
+/**
+ * @brief Bubble sorting algorithm, iterating from
+ * left to right swapping values to ensure ascending
+ * order. Once in ascending order, the median will
+ * always be in the middle index of the array.
+ *
+ * @param arr - first item in integer array
+ * @param size - number of items in array
+ * @return int - the median of the array (middle val)
+ */
+int bubble_sort(int *arr, int size);
@@ -12,15 +12,25 @@
 #include <sys/mman.h>  /* for mapping shared like MAP_SHARED */
 #include <unistd.h>    /* for misc like sleep */
 #include <stdlib.h>     /* violates MISRA C but necessary to pass arg safely into threads */
+#include <stdio.h>      /* for reporting sampling statistics */
+#include <string.h>     /* for clearing statistics */
 
 #include "../config.h"      /* client's configurations */
 #include "monitor-temp.h"   /* for detecting fire threads */
 #include "fire-gate.h"      /* for opening boomgates threads */
 #include "fire-evac.h"      /* for evacuation sign threads */
 #include "fire-common.h"    /* common among fire alarm sys */
+#include "rt-profile.h"     /* for real-time threads */
+#include "fire-metrics.h"   /* for serving metrics */
+#include "../src-common/trace.h" /* for tracing spans */
+#include "../src-common/lock-prof.h" /* for profiling locks */
+#include "../src-common/mem-account.h" /* for accounting memory */
+#include "../src-common/run-config.h" /* for overriding config.h */
+#include "../src-common/sim-clock.h" /* for the Sim's time */
 
 #define SHARED_MEM_NAME "PARKING" /* name of shared memory obj */
-#define SHARED_MEM_SIZE 2920      /* size in bytes */
+#define SHARED_MEM_SIZE PARKING_SIZE /* hardware + status area, in bytes */
+#define BEAT_COST_SAMPLES 1000000 /* beats timed to measure what a heartbeat costs */
 
 /* -----------------------------------------------
  *      INIT GLOBAL EXTERNS FROM fire-common.h
@@ -31,14 +41,26 @@
 volatile _Atomic int ENS = ENTRANCES;
 volatile _Atomic int EXS = EXITS;
 volatile _Atomic int LVLS = LEVELS;
-volatile _Atomic int SLOW = SLOW_MOTION;
+volatile _Atomic int ADAPTIVE = ADAPTIVE_SAMPLING;
+volatile _Atomic int MAX_INTERVAL = MAX_SAMPLE_INTERVAL;
+volatile _Atomic int RT = RT_PROFILE;
+volatile _Atomic int RT_DET_CPU = RT_DETECT_CPU;
+volatile _Atomic int RT_ACT_CPU = RT_ACTUATE_CPU;
+volatile _Atomic int HB_PERIOD = HEARTBEAT_PERIOD;
 
 volatile void *shm;                     /* first byte of shared memory object */
 volatile _Atomic int end_simulation = 0;/* 0 = no, 1 = yes */
 volatile _Atomic int alarm_active = 0;  /* 0 = off, 1 = on */
 pthread_mutex_t alarm_m = PTHREAD_MUTEX_INITIALIZER;
 pthread_cond_t alarm_c = PTHREAD_COND_INITIALIZER;
+const detector_t *fire_detector = &detectors[0];
+monitor_stats_t monitor_stats[5];
+double alarm_raised_ms = 0;
+hdr_t gate_latency;
+hdr_t evac_latency;
 
+/* function prototypes */
+static void print_latency(const char *name, hdr_t *h);
 
 int main(void) {
     /* -----------------------------------------------
@@ -49,13 +71,24 @@ int main(void) {
      * Check bounds here ONCE for simplicity and fall
      * back to defaults if out of bounds.
      */
-    int DU = DURATION; /* within this scope only as it does not need to be global */
-
-    if (ENTRANCES < 1 || ENTRANCES > 5) ENS = 5;
-    if (EXITS < 1 || EXITS > 5) EXS = 5;
-    if (LEVELS < 1 || LEVELS > 5) LVLS = 5;
-    if (SLOW_MOTION < 1) SLOW = 1;
-    if (DURATION < 1) DU = 60;
+    int DU = config_int("DURATION", DURATION); /* within this scope only as it does not need to be global */
+    int MP = config_int("METRICS_PORT", METRICS_PORT);
+    ENS = config_int("ENTRANCES", ENTRANCES);
+    EXS = config_int("EXITS", EXITS);
+    LVLS = config_int("LEVELS", LEVELS);
+
+    if (ENS < 1 || ENS > 5) ENS = 5;
+    if (EXS < 1 || EXS > 5) EXS = 5;
+    if (LVLS < 1 || LVLS > 5) LVLS = 5;
+    if (DU < 1) DU = 60;
+    if (find_detector(DETECTOR) != NULL) fire_detector = find_detector(DETECTOR);
+    if (ADAPTIVE_SAMPLING != 0 && ADAPTIVE_SAMPLING != 1) ADAPTIVE = 1;
+    if (MAX_SAMPLE_INTERVAL < 2) MAX_INTERVAL = 2;
+    if (RT_PROFILE != 0 && RT_PROFILE != 1) RT = 0;
+    if (RT_DETECT_CPU < -1 || RT_DETECT_CPU >= sysconf(_SC_NPROCESSORS_CONF)) RT_DET_CPU = -1;
+    if (HEARTBEAT_PERIOD < 1) HB_PERIOD = 20;
+    if (RT_ACTUATE_CPU < -1 || RT_ACTUATE_CPU >= sysconf(_SC_NPROCESSORS_CONF)) RT_ACT_CPU = -1;
+    if (MP != 0 && (MP < 1024 || MP > 65533)) MP = 9310;
 
     /* -----------------------------------------------
      *       LOCATE THE SHARED MEMORY OBJECT
@@ -77,23 +110,48 @@ int main(void) {
         pthread_t gate_thread;   
         pthread_t temp_threads[LVLS];
 
+        /* run on the Sim's clock (and SPEED), before any thread sleeps */
+        sim_clock_attach(shm);
+
+        /* -----------------------------------------------
+         *   REAL-TIME PROFILE - LOCK MEMORY & PREFAULT
+         *   THE SHARED MEMORY BEFORE ANY THREAD NEEDS IT
+         * -------------------------------------------- */
+        memset(monitor_stats, 0, sizeof(monitor_stats));
+        hdr_reset(&gate_latency);
+        hdr_reset(&evac_latency);
+        if (RT) {
+            printf("~RT profile on: detectors priority %d (CPU %d), actuators priority %d (CPU %d)\n",
+                RT_DETECT_PRIORITY, RT_DET_CPU, RT_ACTUATE_PRIORITY, RT_ACT_CPU);
+            rt_profile_process(shm, SHARED_MEM_SIZE);
+        }
+
+        /* serve metrics on the port after the Manager's */
+        fire_metrics_init();
+        lockprof_init("Fire Alarm System");
+        mem_init("Fire Alarm System");
+        if (MP != 0) metrics_serve(MP + 2);
+        trace_init("fire-alarm");
+        event_init("fire-alarm", ENS, EXS, LVLS);
+
         for (int i = 0; i < LVLS; i++) {
-            int *arg = malloc(sizeof(*arg)); /* violates misra c but passing the i value within a for loop causes unpredictable
+            int *arg = mem_malloc(sizeof(*arg), MEM_ARGS); /* violates misra c but passing the i value within a for loop causes unpredictable
             behaviour as the for loop can change the true value of i, meaning each thread fucks up */
 
             /* if malloc succeeded, the value of arg pointer is 'i' */
             if (arg != NULL) {
                 *arg = i;
-                pthread_create(&temp_threads[i], NULL, monitor_temp, (void *)arg);
+                rt_create(&temp_threads[i], RT_DETECT, RT_DET_CPU, RT, monitor_temp, (void *)arg);
             }
         }
         
-        pthread_create(&evac_thread, NULL, evac_sign, NULL);
-        pthread_create(&gate_thread, NULL, open_gate, NULL);
+        rt_create(&evac_thread, RT_ACTUATE, RT_ACT_CPU, RT, evac_sign, NULL);
+        rt_create(&gate_thread, RT_ACTUATE, RT_ACT_CPU, RT, open_gate, NULL);
 
         /* -----------------------------------------------
          *          ALERT ALL THREADS TO FINISH
          * -------------------------------------------- */
+        double started = now_ms();
         sleep(DU);
         end_simulation = 1;
         pthread_cond_broadcast(&alarm_c);
@@ -106,8 +164,53 @@ int main(void) {
         }
         pthread_join(evac_thread, NULL);
         pthread_join(gate_thread, NULL);
+        metrics_stop();
 
-        
+        /* -----------------------------------------------
+         *    REPORT HOW OFTEN THE MONITORS WOKE UP AND
+         *    HOW MUCH CPU THEY USED (PER LEVEL PER HOUR)
+         * -------------------------------------------- */
+        double hours = (now_ms() - started) / 3600000;
+        for (int i = 0; i < LVLS; i++) {
+            printf("~Level %d monitor (%s sampling): %.0f wakeups/hour, %.1f CPU ms/hour\n", i + 1,
+                ADAPTIVE ? "adaptive" : "fixed 2ms", monitor_stats[i].wakeups / hours, monitor_stats[i].cpu_ms / hours);
+        }
+
+        /* -----------------------------------------------
+         *   REPORT HEARTBEATS AND WHAT A SINGLE BEAT COSTS
+         *   (TIMED ON A SPARE SLOT SO THE WATCHDOG IS
+         *   NOT DISTURBED)
+         * -------------------------------------------- */
+        heartbeat_t spare = {0};
+        double before = now_ms();
+        for (int i = 0; i < BEAT_COST_SAMPLES; i++) {
+            heartbeat_beat(&spare);
+        }
+        double beat_ns = (now_ms() - before) * 1000000 / BEAT_COST_SAMPLES;
+        parking_status_t *status = parking_status(shm);
+        for (int i = 0; i < LVLS; i++) {
+            printf("~Level %d monitor heartbeat: %lu beats\n", i + 1, (unsigned long)status->fire[HB_MONITOR + i].beats);
+        }
+        printf("~Evac/gate heartbeats: %lu/%lu beats, %.1fns per beat\n", (unsigned long)status->fire[HB_EVAC].beats,
+            (unsigned long)status->fire[HB_GATE].beats, beat_ns);
+
+        /* -----------------------------------------------
+         *    REPORT SCHEDULING LATENCY (HOW LATE THREADS
+         *    WOKE UP) AND DETECT-TO-ACTUATE TIMES
+         * -------------------------------------------- */
+        printf("~Scheduling (%s):\n", RT ? "real-time profile" : "normal");
+        for (int i = 0; i < LVLS; i++) {
+            char name[48];
+            snprintf(name, sizeof(name), "Level %d wakeup lateness", i + 1);
+            print_latency(name, &monitor_stats[i].wakeup);
+        }
+        print_latency("Alarm -> gates raising", &gate_latency);
+        print_latency("Alarm -> EVACUATE signs", &evac_latency);
+        metrics_report("Fire Alarm System");
+        lockprof_report();
+        mem_report();
+        trace_dump();
+        event_stop();
 
     } else {
         /* if we reach here, when Main exits, it'll exit
@@ -123,4 +226,19 @@ int main(void) {
     if (munmap((void *)shm, SHARED_MEM_SIZE) == -1) exit = 1;
     close(shm_fd);
     return exit;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Prints 1 line of the scheduling report, like hdr_print but
+ * saying so when nothing was recorded (such as no fire ever raised).
+ *
+ * @param name - what was measured
+ * @param h - histogram to print
+ */
+static void print_latency(const char *name, hdr_t *h) {
+    if (h->total == 0) {
+        printf("\t%-24s no samples\n", name);
+    } else {
+        hdr_print(stdout, name, h);
+    }
+}
@@ -10,8 +10,67 @@ needing to control sensitive timings in milliseconds, minimised by only 1 functi
 #include <time.h>
 
 #include "fire-common.h"  /* corresponding header */
+#include "../src-common/lock-prof.h" /* for profiling the alarm lock */
+#include "../src-common/sim-clock.h" /* for the Sim's time */
+
+/* function prototypes */
+static void timespec_add_ms(struct timespec *ts, int ms);
 
 void sleep_for_millis(int ms) {
-   struct timespec remaining, requested = {(ms / 1000) * SLOW, ((ms % 1000) * 1000000) * SLOW};
-   nanosleep(&requested, &remaining);
-}
\ No newline at end of file
+   sim_sleep_ms(ms);
+}
+
+heartbeat_t *heartbeat_start(int slot) {
+    heartbeat_t *h = &parking_status(shm)->fire[slot];
+    heartbeat_beat(h);
+    h->state = HB_ALIVE;
+    return h;
+}
+
+void heartbeat_stop(heartbeat_t *h) {
+    h->state = HB_STOPPED;
+}
+
+void sleep_beating(heartbeat_t *h, int ms) {
+    int done = 0;
+    double until = sim_now_ms() + ms;
+
+    /* sleep in HEARTBEAT_PERIOD chunks towards an absolute time so
+    the beats do not make the whole sleep any longer */
+    while (!end_simulation && !done) {
+        double chunk = sim_now_ms() + HB_PERIOD;
+        if (chunk >= until) {
+            chunk = until;
+            done = 1;
+        }
+
+        sim_sleep_until_ms(chunk);
+        heartbeat_beat(h);
+    }
+}
+
+void wait_for_alarm(heartbeat_t *h) {
+    while (!alarm_active && !end_simulation) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline); /* condition variables time out on the real time clock */
+        timespec_add_ms(&deadline, HB_PERIOD);
+
+        PROF_COND_TIMEDWAIT(&alarm_c, &alarm_m, &deadline, LK_ALARM);
+        heartbeat_beat(h);
+    }
+}
+
+/**
+ * @brief Moves a time forward by 'ms' milliseconds.
+ * 
+ * @param ts - time to move
+ * @param ms - milliseconds to add
+ */
+static void timespec_add_ms(struct timespec *ts, int ms) {
+    ts->tv_sec += ms / 1000;
+    ts->tv_nsec += (long)(ms % 1000) * 1000000;
+    if (ts->tv_nsec >= 1000000000) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000;
+    }
+}
@@ -9,6 +9,11 @@
 #include <stdint.h>    /* for 16-bit integer type */
 #include <pthread.h>   /* for mutex/condition types */
 
+#include "detectors.h" /* for detector type */
+#include "../src-common/hdr-histogram.h" /* for latency histograms */
+#include "../src-common/parking-status.h" /* for heartbeats */
+#include "../src-common/parking-types.h" /* for car park types */
+
 /* -----------------------------------------------
  *     ALL GLOBALS USED IN FIRE ALARM SOFTWARE
  * -----------------------------------------------
@@ -22,63 +27,71 @@
 extern volatile _Atomic int ENS;
 extern volatile _Atomic int EXS;
 extern volatile _Atomic int LVLS;
-extern volatile _Atomic int SLOW;
+extern volatile _Atomic int ADAPTIVE;      /* 0 = sample every 2ms, 1 = adaptive sampling */
+extern volatile _Atomic int MAX_INTERVAL;  /* longest ms between samples when adaptive */
+extern volatile _Atomic int RT;            /* 0 = normal threads, 1 = real-time profile */
+extern volatile _Atomic int RT_DET_CPU;    /* CPU for monitor threads, -1 = any */
+extern volatile _Atomic int RT_ACT_CPU;    /* CPU for gate & evac threads, -1 = any */
+extern volatile _Atomic int HB_PERIOD;     /* longest ms between heartbeats */
 
 extern volatile void *shm;                     /* first byte of shared memory object */
 extern volatile _Atomic int end_simulation;/* 0 = no, 1 = yes */
 extern volatile _Atomic int alarm_active;  /* 0 = off, 1 = on */
 extern pthread_mutex_t alarm_m;
 extern pthread_cond_t alarm_c;
+extern const detector_t *fire_detector;    /* algorithm used by all monitor threads */
+extern double alarm_raised_ms;             /* when the alarm last went from off to on (guarded by alarm_m) */
+extern hdr_t gate_latency;                 /* alarm raised -> all gates raising (gate thread only) */
+extern hdr_t evac_latency;                 /* alarm raised -> all signs showing 'E' (evac thread only) */
 
+/* Per level monitor thread statistics, reported when the Fire Alarm System ends */
+typedef struct monitor_stats_t {
+    unsigned long wakeups;  /* samples taken */
+    double cpu_ms;          /* CPU time used by the thread */
+    hdr_t wakeup;           /* how late the thread woke up from each sleep */
+} monitor_stats_t;
 
-/* -----------------------------------------------
- *                 NESTED TYPES
- * -------------------------------------------- */
-typedef struct LPR_t {
-    pthread_mutex_t lock;
-    pthread_cond_t condition;
-    char plate[7];      /* 6 chars +1 for string null terminator */
-    char padding[1];    /* as we +1 above, we only need to +1 for padding, not +2 */
-} LPR_t;
-
-typedef struct boom_t {
-    pthread_mutex_t lock;
-    pthread_cond_t condition;
-    char status;        /* C,R,L,O - Closed, Raising, Lowering, Opened */
-    char padding[7];
-} boom_t;
+extern monitor_stats_t monitor_stats[5];   /* 1 per level (5 levels at most) */
 
-typedef struct info_t {
-    pthread_mutex_t lock;
-    pthread_cond_t condition;
-    char display;       /* X,F,number - Not authorised, Full, Assigned level*/
-    char padding[7];
-} info_t;
 
-/* -----------------------------------------------
- *                 PARENT TYPES
- * -------------------------------------------- */
-typedef struct entrance_t {
-    LPR_t sensor;
-    boom_t gate;
-    info_t sign;
-} entrance_t;
+/**
+ * @brief Sleeps for 'ms' milliseconds of simulated time (the Sim's
+ * clock, see sim-clock.h)
+ * 
+ * @param ms - milliseconds to sleep
+ */
+void sleep_for_millis(int ms);
 
-typedef struct exit_t {
-    LPR_t sensor;
-    boom_t gate;
-} exit_t;
+/**
+ * @brief Marks a heartbeat slot as alive and beats it once, so the
+ * Manager's watchdog starts watching it.
+ * 
+ * @param slot - HB_MONITOR + level, HB_EVAC or HB_GATE
+ * @return heartbeat_t* - the slot, for the thread to keep beating
+ */
+heartbeat_t *heartbeat_start(int slot);
 
-typedef struct level_t {
-    LPR_t sensor;
-    volatile _Atomic int16_t temp_sensor;    /* 2 bytes - signed 16 bit int */
-    volatile _Atomic char alarm;            /* 1 byte  - either a '0' or a '1' */
-    char padding[5];
-} level_t;
+/**
+ * @brief Marks a heartbeat slot as stopped on purpose, so the
+ * Manager's watchdog stops watching it.
+ * 
+ * @param h - slot to stop
+ */
+void heartbeat_stop(heartbeat_t *h);
 
 /**
- * @brief Sleeps for 'ms' milliseconds
+ * @brief Sleeps for 'ms' milliseconds of simulated time, waking up
+ * every HEARTBEAT_PERIOD (simulated) to beat. Returns early if the simulation ends.
  * 
+ * @param h - slot to beat
  * @param ms - milliseconds to sleep
  */
-void sleep_for_millis(int ms);
\ No newline at end of file
+void sleep_beating(heartbeat_t *h, int ms);
+
+/**
+ * @brief Waits until the alarm is active or the simulation ends,
+ * waking up every HEARTBEAT_PERIOD to beat. alarm_m must be locked.
+ * 
+ * @param h - slot to beat
+ */
+void wait_for_alarm(heartbeat_t *h);
@@ -8,12 +8,21 @@
 #include <string.h>     /* for string operations */
 
 #include "fire-common.h"    /* common among fire alarm sys */
+#include "rt-profile.h"     /* for real-time threads */
 #include "fire-evac.h"      /* corresponding header */
+#include "fire-metrics.h"   /* for recording metrics */
+#include "../src-common/lock-prof.h" /* for profiling locks */
+#include "../src-common/sim-clock.h" /* for the real clock */
 
 void *evac_sign(void *args) {
 
     (void)args; /* supresses unused var warning - args param is unused but mandatory */
     int active = 0; /* 0 = no, 1 = yes */
+    double raised = 0;  /* when the alarm we are acting on was raised */
+    double acted = 0;   /* the last raise we measured, so each alarm is only measured once */
+
+    rt_prefault_stack();
+    heartbeat_t *hb = heartbeat_start(HB_EVAC); /* tell the Manager we are alive */
 
     /* -----------------------------------------------
      *       LOOP WHILE SIMULATION HASN'T ENDED
@@ -21,13 +30,14 @@ void *evac_sign(void *args) {
     while(!end_simulation) {
         active = 0; /* reset */
 
-        /* Wait until the alarm is active then store in another 
-        variable so we can unlock and let other threads see
-        if the alarm is active */ 
-        pthread_mutex_lock(&alarm_m);
-        while (!alarm_active && !end_simulation) pthread_cond_wait(&alarm_c, &alarm_m);
+        /* Wait until the alarm is active (beating while we wait) then
+        store in another variable so we can unlock and let other threads
+        see if the alarm is active */ 
+        PROF_METRICS_LOCK(&alarm_m, LK_ALARM, MET_LOCK_ALARM);
+        wait_for_alarm(hb);
         if (alarm_active) active = 1; 
-        pthread_mutex_unlock(&alarm_m);
+        raised = alarm_raised_ms;
+        PROF_UNLOCK(&alarm_m, LK_ALARM);
 
         /* -----------------------------------------------
          *   IF THERE IS A FIRE & SIM HASN'T ENDED...
@@ -41,16 +51,25 @@ void *evac_sign(void *args) {
                 for (int e = 0; e < ENS; e++) {
                     entrance_t *en = (entrance_t *)((char *)shm + (int)(sizeof(entrance_t) * e));
 
-                    pthread_mutex_lock(&en->sign.lock);
-                    en->sign.display = msg[i];
-                    pthread_mutex_unlock(&en->sign.lock);
+                    PROF_LOCK(&en->sign.lock, LK_EN_SIGN + e);
+                    parking_set(shm, &en->sign.display, msg[i]);
+                    PROF_UNLOCK(&en->sign.lock, LK_EN_SIGN + e);
                     pthread_cond_broadcast(&en->sign.condition);
                 }
+
+                /* every sign now shows the first letter */
+                if (i == 0 && raised > acted) {
+                    hdr_record(&evac_latency, (uint64_t)((now_ms() - raised) * 1000000));
+                    metric_observe_us(MET_TO_EVAC, (uint64_t)((now_ms() - raised) * 1000));
+                    acted = raised;
+                }
                 sleep_for_millis(20);
+                heartbeat_beat(hb);
             }
         }
         /* as we must let other threads access the "alarm_active", we will have to loop back up,
         lock-read-unlock the "alarm_active" again then display EVACUATE if there is still a fire */
     }
+    heartbeat_stop(hb);
     return NULL;
 }
\ No newline at end of file
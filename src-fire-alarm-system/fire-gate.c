@@ -5,15 +5,24 @@
  * @brief   Source code for fire-gate.h
  ***********************************************/
 #include <pthread.h> /* for mutex/condition types */
-#include <unistd.h>  /* for misc like sleep */
 
 #include "fire-common.h"    /* common among fire alarm sys */
+#include "rt-profile.h"     /* for real-time threads */
 #include "fire-gate.h"      /* corresponding header */
+#include "fire-metrics.h"   /* for recording metrics */
+#include "../src-common/trace.h" /* for tracing spans */
+#include "../src-common/lock-prof.h" /* for profiling locks */
+#include "../src-common/sim-clock.h" /* for the real clock */
 
 void *open_gate(void *args) {
 
     (void)args; /* supresses unused var warning - args param is unused but mandatory */
     int active = 0; /* 0 = no, 1 = yes */
+    double raised = 0;  /* when the alarm we are acting on was raised */
+    double acted = 0;   /* the last raise we measured, so each alarm is only measured once */
+
+    rt_prefault_stack();
+    heartbeat_t *hb = heartbeat_start(HB_GATE); /* tell the Manager we are alive */
 
     /* -----------------------------------------------
      *       LOOP WHILE SIMULATION HASN'T ENDED
@@ -21,13 +30,14 @@ void *open_gate(void *args) {
     while(!end_simulation) {
         active = 0; /* reset */
 
-        /* Wait until the alarm is active then store in another 
-        variable so we can unlock and let other threads see
-        if the alarm is active */ 
-        pthread_mutex_lock(&alarm_m);
-        while (!alarm_active && !end_simulation) pthread_cond_wait(&alarm_c, &alarm_m);
+        /* Wait until the alarm is active (beating while we wait) then
+        store in another variable so we can unlock and let other threads
+        see if the alarm is active */ 
+        PROF_METRICS_LOCK(&alarm_m, LK_ALARM, MET_LOCK_ALARM);
+        wait_for_alarm(hb);
         if (alarm_active) active = 1; 
-        pthread_mutex_unlock(&alarm_m);
+        raised = alarm_raised_ms;
+        PROF_UNLOCK(&alarm_m, LK_ALARM);
 
         /* -----------------------------------------------
          *   IF THERE IS A FIRE & SIM HASN'T ENDED...
@@ -37,28 +47,36 @@ void *open_gate(void *args) {
             for (int i = 0; i < ENS; i++) {
                 entrance_t *en = (entrance_t *)((char *)shm + (int)(sizeof(entrance_t) * i));
 
-                pthread_mutex_lock(&en->gate.lock);
-                if (en->gate.status == 'C') en->gate.status = 'R';
-                pthread_mutex_unlock(&en->gate.lock);
+                PROF_LOCK(&en->gate.lock, LK_EN_GATE + i);
+                if (en->gate.status == 'C') parking_set(shm, &en->gate.status, 'R');
+                PROF_UNLOCK(&en->gate.lock, LK_EN_GATE + i);
                 pthread_cond_broadcast(&en->gate.condition);
             }
 
             for (int i = 0; i < EXS; i++) {
                 exit_t *ex = (exit_t *)((char *)shm + (int)((sizeof(entrance_t) * ENS) + (sizeof(exit_t) * i)));
 
-                pthread_mutex_lock(&ex->gate.lock);
-                if (ex->gate.status == 'C') ex->gate.status = 'R';
-                pthread_mutex_unlock(&ex->gate.lock);
+                PROF_LOCK(&ex->gate.lock, LK_EX_GATE + i);
+                if (ex->gate.status == 'C') parking_set(shm, &ex->gate.status, 'R');
+                PROF_UNLOCK(&ex->gate.lock, LK_EX_GATE + i);
                 pthread_cond_broadcast(&ex->gate.condition);
             }
+
+            if (raised > acted) {
+                hdr_record(&gate_latency, (uint64_t)((now_ms() - raised) * 1000000));
+                metric_observe_us(MET_TO_GATES, (uint64_t)((now_ms() - raised) * 1000));
+                TRACE_SPAN_MS(TR_FIRE_GATES, raised, NULL, 0);
+                acted = raised;
+            }
         }
         /* unlike the EVACUATE sign, we will only need to open once,
         (but check now and then if the gate is closed to raise again) 
         otherwise we'll be looping forever - this 5s pause saves resources */
-        sleep(5);
+        sleep_beating(hb, 5000);
 
         /* as we must let other threads access the "alarm_active", we will have to loop back up,
         lock-read-unlock the "alarm_active" again then display EVACUATE if there is still a fire */
     }
+    heartbeat_stop(hb);
     return NULL;
 }
\ No newline at end of file
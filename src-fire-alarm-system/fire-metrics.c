@@ -0,0 +1,35 @@
+/************************************************
+ * @file    fire-metrics.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Source code for fire-metrics.h
+ ***********************************************/
+#include "fire-metrics.h"   /* corresponding header */
+#include "fire-common.h"    /* for the alarm */
+
+/* function prototypes */
+static double alarm_state(void);
+
+const metric_def_t fire_metrics[FIRE_METRICS] = {
+    {"fire_samples_total", "Temperatures read by all level monitors", METRIC_COUNTER, NULL},
+    {"fire_detections_total", "Smoothed temperatures the detector called a fire", METRIC_COUNTER, NULL},
+    {"fire_alarms_raised_total", "Times the alarm went from off to on", METRIC_COUNTER, NULL},
+    {"fire_monitor_wakeup_lateness_seconds", "How much later than asked a level monitor woke up", METRIC_HISTOGRAM, NULL},
+    {"fire_alarm_to_gates_seconds", "Time from the alarm being raised to every gate raising", METRIC_HISTOGRAM, NULL},
+    {"fire_alarm_to_evacuate_seconds", "Time from the alarm being raised to every sign showing EVACUATE", METRIC_HISTOGRAM, NULL},
+    {"fire_lock_wait_seconds{lock=\"alarm\"}", "Time spent waiting for a lock", METRIC_HISTOGRAM, NULL},
+    {"fire_alarm_active", "1 = alarm on", METRIC_GAUGE, alarm_state},
+};
+
+void fire_metrics_init(void) {
+    metrics_init(fire_metrics, FIRE_METRICS);
+}
+
+/**
+ * @brief Reads whether the alarm is on.
+ *
+ * @return double - 1 or 0
+ */
+static double alarm_state(void) {
+    return (double)alarm_active;
+}
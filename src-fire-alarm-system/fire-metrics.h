@@ -0,0 +1,31 @@
+/************************************************
+ * @file    fire-metrics.h
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   The Fire Alarm System's metrics, recorded by index
+ *          with metric_inc/metric_observe_us etc (see metrics.h)
+ *          and served on METRICS_PORT + 2.
+ ***********************************************/
+#pragma once
+
+#include "../src-common/metrics.h" /* for recording metrics */
+
+/* Index of each metric in fire_metrics (keep both in the same order) */
+typedef enum fire_metric_t {
+    MET_SAMPLES,        /* temps read by all monitors */
+    MET_DETECTIONS,     /* smoothed temps the detector called a fire */
+    MET_ALARMS,         /* alarm went from off to on */
+    MET_WAKEUP,         /* how late monitors woke up */
+    MET_TO_GATES,       /* alarm raised -> all gates raising */
+    MET_TO_EVAC,        /* alarm raised -> all signs showing 'E' */
+    MET_LOCK_ALARM,     /* waits for the alarm lock */
+    MET_ALARM_ACTIVE,   /* read on scrape */
+    FIRE_METRICS        /* no. of metrics */
+} fire_metric_t;
+
+extern const metric_def_t fire_metrics[FIRE_METRICS];
+
+/**
+ * @brief Sets up the Fire Alarm System's metrics, before any thread records.
+ */
+void fire_metrics_init(void);
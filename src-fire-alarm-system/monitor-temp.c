@@ -5,35 +5,43 @@
  * @brief   Source code for monitor-temp.h
  ***********************************************/
 #include <pthread.h> /* for mutex/condition types */
-#include <unistd.h>  /* for misc like sleep */
 
 #include "fire-common.h"    /* common among fire alarm sys */
+#include "rt-profile.h"     /* for real-time threads */
 #include "monitor-temp.h"   /* corresponding header */
+#include "adaptive-rate.h"  /* for how often to sample */
+#include "fire-metrics.h"   /* for recording metrics */
+#include "../src-common/trace.h" /* for tracing spans */
+#include "../src-common/lock-prof.h" /* for profiling locks */
+#include "../src-common/mem-account.h" /* for freeing args */
+#include "../src-common/sim-clock.h" /* for the real length of a sleep */
 
 /* function prototypes */
 void toggle_all_alarms(int active);
-int bubble_sort(int *arr,int size);
 
 void *monitor_temp(void *args) {
     
     /* deconstruct args to locate corresponding level */
     int id = *(int *)args;
+    mem_free(args);
     int addr = (int)((sizeof(entrance_t) * ENS) + (sizeof(exit_t) * EXS) + (sizeof(level_t) * id));
     level_t *l = (level_t *)((char *)shm + addr);
 
     /* define other variables here with default values */
-    int highs = 0;
-
-    int temps[MEDIAN_WINDOW];
-    int smoothed[SMOOTHED_WINDOW];
-
-    for (int i = 0; i < 4; i++) {
-        temps[i] = 0;
-    }
-
-    for (int i = 0; i < 29; i++) {
-        smoothed[i] = 0;
-    }
+    smoother_t smoother;
+    detector_state_t state;
+    sampler_t sampler;
+    int smoothed = 0;
+    int raw = 0;
+    int interval = 0;
+    double before = 0;
+    double late = 0;
+
+    rt_prefault_stack();
+    heartbeat_t *hb = heartbeat_start(HB_MONITOR + id); /* tell the Manager we are alive */
+    smoother_reset(&smoother);
+    fire_detector->reset(&state);
+    sampler_init(&sampler, ADAPTIVE, MAX_INTERVAL);
 
     /* -----------------------------------------------
      *       LOOP WHILE SIMULATION HASN'T ENDED
@@ -41,116 +49,65 @@ void *monitor_temp(void *args) {
     while(!end_simulation) {
         
         /* -----------------------------------------------
-         * SHUFFLE TEMPS DOWN MANUALLY AS WE CANNOT USE MALLOC DUE TO MISRA C
-         *                  ADD LATEST LEVEL TEMP
+         *  ADD LATEST LEVEL TEMP, ONCE WE HAVE 5 RAW TEMPS
+         *  EVERY NEW TEMP PRODUCES A SMOOTHED TEMP (MEDIAN)
          * -------------------------------------------- */
-        for (int i = 0; i < 4; i++) {
-            temps[i] = temps[i + 1];
-        }
-        temps[4] = (int)l->temp_sensor;
-            
-        /* -----------------------------------------------
-         *           ONCE WE HAVE 5 RAW TEMPS
-         * AKA ONCE WE'VE READ 5 TEMPS, THEY WILL PUSH OUT
-         *              ALL 0 PLACEHOLDERS
-         * -------------------------------------------- */
-        if (temps[0] != 0) {
-
-            /* GET THE MEDIAN */
-            int median = 0;           
-            median = bubble_sort(temps, MEDIAN_WINDOW);
-
-            /* -----------------------------------------------
-             * SHUFFLE TEMPS DOWN MANUALLY AS WE CANNOT USE MALLOC DUE TO MISRA C
-             *          ADD MEDIAN AS THE LATEST SMOOTHED TEMP
-             * -------------------------------------------- */
-            for (int i = 0; i < 29; i++) {
-                smoothed[i] = smoothed[i + 1];
-            }
-            smoothed[29] = median;
+        raw = (int)l->temp_sensor;
+        metric_inc(MET_SAMPLES);
+        if (smoother_push(&smoother, raw, &smoothed)) {
 
             /* -----------------------------------------------
-             * COUNT HOW MANY SMOOTHED TEMPS ARE 58+ DEGREES
-             * -------------------------------------------- */
-            for (int i = 0; i <= 29; i++) {
-                if (smoothed[i] >= 58) highs++;
-            }
-
-            /* -----------------------------------------------
-            *           ONCE WE HAVE 30 SMOOTHED TEMPS
-            * AKA ONCE WE'VE SMOOTHED 30 TEMPS, THEY WILL PUSH OUT
-            *              ALL 0 PLACEHOLDERS
-            * -------------------------------------------- */
-            if (smoothed[0] != 0) {
-
-                /* -----------------------------------------------
-                 *                RISE ALGORITHM
-                 * -----------------------------------------------
-                 * If 90% of the last 30 smoothed temps are 58+ degrees,
-                 * this is considered a high temperature, activate alarm
-                 * and alert EVACUATE sign and gate threads to wake up
-                 */
-                if (highs >= SMOOTHED_WINDOW * 0.9) {
-                    pthread_mutex_lock(&alarm_m);
-                    alarm_active = 1;
-                    if(alarm_active) {
-                        toggle_all_alarms(alarm_active);
-                    }
-                    pthread_mutex_unlock(&alarm_m);
-                    pthread_cond_broadcast(&alarm_c);
-
-                    /* print here "rise algorithm triggered" for demonstration only */
-
-                    sleep(6); /* slow down constant looping if the alarm is already activated */
+             *          FEED SMOOTHED TEMP TO THE DETECTOR
+             * -----------------------------------------------
+             * If the detector thinks there is a fire, activate alarm
+             * and alert EVACUATE sign and gate threads to wake up
+             */
+            if (fire_detector->update(&state, smoothed)) {
+                metric_inc(MET_DETECTIONS);
+                TRACE_START(detected);
+                PROF_METRICS_LOCK(&alarm_m, LK_ALARM, MET_LOCK_ALARM);
+                if (!alarm_active) {
+                    alarm_raised_ms = now_ms(); /* start of detect-to-actuate */
+                    metric_inc(MET_ALARMS);
                 }
-
-                /* -----------------------------------------------
-                 *                SPIKE ALGORITHM
-                 * -----------------------------------------------
-                 * If the newest temp is 8+ degrees higher than the oldest
-                 * temp (out of the last 30), this is a high rate-of-rise.
-                 * and alert EVACUATE sign and gate threads to wake up
-                 */
-                if (smoothed[29] - smoothed[0] >= 8) {
-                    pthread_mutex_lock(&alarm_m);
-                    alarm_active = 1;
-                    if(alarm_active) {
-                        toggle_all_alarms(alarm_active); 
-                    }
-                    pthread_mutex_unlock(&alarm_m);
-                    pthread_cond_broadcast(&alarm_c);
-                    
-                    /* print here "spike algorithm triggered" for demonstration only */
-
-                    sleep(6); /* slow down constant looping if the alarm is already activated */
+                alarm_active = 1;
+                if(alarm_active) {
+                    toggle_all_alarms(alarm_active);
                 }
-            }
-        }
-        sleep_for_millis(2); /* collect temperatures every 2ms */
-    }
+                PROF_UNLOCK(&alarm_m, LK_ALARM);
+                pthread_cond_broadcast(&alarm_c);
+                TRACE_SPAN(TR_ALARM_RAISE, detected, NULL, 0);
 
-    return NULL;
-}
-
-int bubble_sort(int *arr, int size) { 
-    int temp;
+                /* print here "rise/spike algorithm triggered" for demonstration only */
 
-    for(int i = 0; i < (size - 1);i++) {
-        for(int j = 0; j < (size - i - 1); j++) {
-            if(arr[j] > arr[j+1]) {
-             /* swap to keep ascending order */
-             temp = arr[j];
-             arr[j] = arr[j+1];
-             arr[j+1] = temp;
+                sleep_beating(hb, 6000); /* slow down constant looping if the alarm is already activated */
             }
         }
+
+        /* collect temperatures every 2ms, or less often while
+        temps are low & steady if adaptive sampling is on (still
+        beating every HEARTBEAT_PERIOD through a long interval) */
+        interval = sampler_next(&sampler, raw);
+        before = now_ms();
+        sleep_beating(hb, interval);
+
+        /* how much later than asked did we wake up */
+        late = (now_ms() - before - sim_real_ms(interval)) * 1000;
+        hdr_record(&monitor_stats[id].wakeup, (late > 0) ? (uint64_t)(late * 1000) : 0);
+        metric_observe_us(MET_WAKEUP, (late > 0) ? (uint64_t)late : 0);
     }
 
-    return arr[(size - 1) / 2]; /* median */
+    /* record how hard this thread worked, for the report in Main */
+    monitor_stats[id].wakeups = sampler.wakeups;
+    monitor_stats[id].cpu_ms = thread_cpu_ms();
+    heartbeat_stop(hb);
+
+    return NULL;
 }
 
 void toggle_all_alarms(int active) {
 
+    parking_write_begin(shm);
     for (int i = 0; i < LVLS; i++) {
         int addr = (int)((sizeof(entrance_t) * ENS) + (sizeof(exit_t) * EXS) + (sizeof(level_t) * i));
         level_t *l = (level_t *)((char *)shm + addr);
@@ -160,5 +117,7 @@ void toggle_all_alarms(int active) {
         } else {
             l->alarm = '0';
         }
+        EVENT_SET(shm, &l->alarm, l->alarm);
     }
+    parking_write_end(shm);
 }
\ No newline at end of file
@@ -10,15 +10,15 @@
  ***********************************************/
 #pragma once
 
-#define MEDIAN_WINDOW 5     /* median of 5 most recent temps = next smoothed temp */
-#define SMOOTHED_WINDOW 30  /* only keep the most recent 30 smoothed temps */
+#include "detectors.h" /* for smoothing & detection algorithms */
 
 /**
  * @brief Monitor the temperature sensor of a level. After collecting 5
  * raw temperatures, find the median which will be the smoothed temp. Repeat
  * until we have collected 30 smoothed temperatures.
  * 
- * Uses 2 algorithms for detecting fires using the most recent 30 smoothed temps.
+ * Each smoothed temp is fed to the DETECTOR chosen in config.h. By default
+ * uses 2 algorithms for detecting fires using the most recent 30 smoothed temps.
  * 
  * 1.   If 90% of them are 58+ degrees, trigger the alarm as 
  *      there is a HIGH RISE in temperature indicating a fire.
@@ -27,7 +27,12 @@
  *      the oldest smoothed temp, trigger the alarm as there is
  *      a SPIKE in temperature indicating a fire.
  * 
- * @param args - thread id to help locate corresponding level
+ * See detectors.h for the other algorithms available.
+ * 
+ * Samples every 2ms, or if ADAPTIVE_SAMPLING is on, less often while the
+ * temps are low & steady (see adaptive-rate.h).
+ * 
+ * @param args - thread id to help locate corresponding level, freed by the thread
  * @return void* - return NULL upon completion
  */
 void *monitor_temp(void *args);
@@ -40,15 +45,3 @@ void *monitor_temp(void *args);
  * @param active - indicate if alarm is active, 0 = no, 1 = yes
  */
 void toggle_all_alarms(int active);
-
-/**
- * @brief Bubble sorting algorithm, iterating from
- * left to right swapping values to ensure ascending
- * order. Once in ascending order, the median will
- * always be in the middle index of the array.
- * 
- * @param arr - first item in integer array
- * @param size - number of items in array
- * @return int - the median of the array (middle val)
- */
-int bubble_sort(int *arr, int size);
\ No newline at end of file
@@ -0,0 +1,69 @@
+/************************************************
+ * @file    rt-profile.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Source code for rt-profile.h
+ ***********************************************/
+#define _GNU_SOURCE     /* for CPU affinity */
+#include <stdio.h>      /* for IO operations */
+#include <string.h>     /* for memset */
+#include <sched.h>      /* for SCHED_FIFO & CPU sets */
+#include <unistd.h>     /* for page size */
+#include <sys/mman.h>   /* for mlockall */
+
+#include "rt-profile.h" /* corresponding header */
+
+int rt_profile_process(volatile void *shm, size_t size) {
+    int result = 0;
+    long page = sysconf(_SC_PAGESIZE);
+    volatile char sink = 0;
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        perror("~RT profile: mlockall (carrying on without)");
+        result = -1;
+    }
+
+    /* read 1 byte per page so every page of the shared memory is mapped in */
+    for (size_t i = 0; i < size; i += (size_t)page) {
+        sink = ((volatile char *)shm)[i];
+    }
+    (void)sink;
+
+    return result;
+}
+
+int rt_create(pthread_t *thread, rt_role_t role, int cpu, int enabled, void *(*fn)(void *), void *arg) {
+    int result = -1;
+
+    if (enabled) {
+        pthread_attr_t attr;
+        struct sched_param param;
+        cpu_set_t cpus;
+
+        pthread_attr_init(&attr);
+        param.sched_priority = (role == RT_ACTUATE) ? RT_ACTUATE_PRIORITY : RT_DETECT_PRIORITY;
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+        pthread_attr_setschedparam(&attr, &param);
+
+        if (cpu >= 0) {
+            CPU_ZERO(&cpus);
+            CPU_SET(cpu, &cpus);
+            pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+        }
+
+        result = pthread_create(thread, &attr, fn, arg);
+        pthread_attr_destroy(&attr);
+
+        if (result != 0) printf("~RT profile: cannot create real-time thread (%s), using a normal thread\n", strerror(result));
+    }
+
+    /* profile off, or not permitted */
+    if (result != 0) result = pthread_create(thread, NULL, fn, arg);
+    return result;
+}
+
+void rt_prefault_stack(void) {
+    volatile char stack[RT_STACK_PREFAULT];
+    memset((char *)stack, 0, sizeof(stack));
+}
@@ -0,0 +1,65 @@
+/************************************************
+ * @file    rt-profile.h
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   API for the opt-in real-time profile of the
+ *          Fire Alarm System (RT_PROFILE in config.h).
+ *          Gives the detector (monitor) and actuator
+ *          (gate, evac) threads SCHED_FIFO priorities,
+ *          pins them to reserved CPUs, locks the process
+ *          in memory and prefaults stacks & shared memory,
+ *          so the busy Simulator and Manager cannot delay
+ *          a fire being detected and acted on.
+ *
+ *          How late threads wake up and detect-to-actuate
+ *          times are recorded whether or not the profile is
+ *          on (hdr_t histograms in fire-common.h), so both
+ *          can be compared.
+ ***********************************************/
+#pragma once
+
+#include <pthread.h>    /* for thread types */
+#include <stddef.h>     /* for size_t */
+
+#define RT_DETECT_PRIORITY 80   /* SCHED_FIFO priority of monitor threads */
+#define RT_ACTUATE_PRIORITY 90  /* higher, so acting on a fire preempts monitoring */
+#define RT_STACK_PREFAULT 65536 /* bytes of stack touched by each thread up front */
+
+/* Role of a thread, deciding its priority & CPU */
+typedef enum rt_role_t {
+    RT_DETECT,
+    RT_ACTUATE
+} rt_role_t;
+
+/**
+ * @brief Applies the process wide parts of the profile: locks all current
+ * and future memory (mlockall) and touches every page of the shared memory
+ * so no page fault happens while handling a fire. Prints a warning and
+ * carries on without them if not permitted.
+ *
+ * @param shm - first byte of the shared memory
+ * @param size - size of the shared memory
+ * @return int - 0 if applied, -1 if not permitted
+ */
+int rt_profile_process(volatile void *shm, size_t size);
+
+/**
+ * @brief Creates a thread. With the profile on, the thread runs SCHED_FIFO
+ * at its role's priority on its role's CPU (cpu < 0 = any CPU). Falls back
+ * to a normal thread if real-time scheduling is not permitted.
+ *
+ * @param thread - set to the new thread
+ * @param role - detector or actuator
+ * @param cpu - CPU to pin to, -1 = do not pin
+ * @param enabled - 0 = normal thread, 1 = real-time profile
+ * @param fn - thread function
+ * @param arg - thread args
+ * @return int - 0 on success, like pthread_create
+ */
+int rt_create(pthread_t *thread, rt_role_t role, int cpu, int enabled, void *(*fn)(void *), void *arg);
+
+/**
+ * @brief Touches RT_STACK_PREFAULT bytes of the calling thread's stack so
+ * later calls do not page fault. Call at the start of each thread.
+ */
+void rt_prefault_stack(void);
@@ -0,0 +1,168 @@
+/************************************************
+ * @file    integrated.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Main file for the integrated build. Runs the
+ *          Simulator, Manager & Fire Alarm System in 1
+ *          process, for profiling the whole car park with
+ *          1 perf record, sanitizer runs and repeatable
+ *          benchmarks:
+ *
+ *          $ CARPARK_DURATION=30 ./INTEGRATED
+ *          $ perf record -g ./INTEGRATED
+ *
+ *          Each program is its own code, unchanged, linked
+ *          in with its main renamed & its other symbols kept
+ *          to itself (see Makefile), so the 3 copies of the
+ *          common code (metrics, clocks, lock profiles, memory
+ *          accounting...) stay apart as in 3 processes. They
+ *          share the PARKING region in memory (see
+ *          parking-region.h) instead of /dev/shm.
+ *
+ *          The Sim starts first, then once it has started its
+ *          clock the Fire Alarm System & Manager, and each
+ *          runs for DURATION as it would in its own terminal.
+ *          The programs read config.h & their CARPARK_
+ *          overrides as usual, except HEADLESS defaults to 1
+ *          as they share 1 terminal. A program that exits on
+ *          an error ends all 3.
+ ***********************************************/
+#include <stdio.h>      /* for IO operations */
+#include <stdlib.h>     /* for setenv */
+#include <stdint.h>     /* for int types */
+#include <stdatomic.h>  /* for reading the Sim's clock */
+#include <pthread.h>    /* for thread operations */
+#include <signal.h>     /* for blocking SIGUSR1 */
+#include <time.h>       /* for timing the run */
+#include <sys/mman.h>   /* for unmapping the region */
+
+#include "parking-region.h" /* for the in-memory PARKING region */
+#include "../src-common/parking-status.h" /* for the Sim's clock */
+
+#define START_TIMEOUT_MS 5000   /* for the Sim to create PARKING & start its clock */
+
+/* the 3 programs' mains, renamed when linked in (see Makefile) */
+int simulator_main(void);
+int manager_main(void);
+int fire_alarm_main(void);
+
+/* A program running in its own thread */
+typedef struct program_t {
+    const char *name;
+    int (*main)(void);
+    pthread_t thread;
+    int status;         /* what its main returned */
+} program_t;
+
+/* function prototypes */
+static void *run(void *arg);
+static int clock_started(volatile void *shm);
+static double seconds(void);
+
+/**
+ * @brief   Entry point for the INTEGRATED build. Starts the
+ *          3 programs in order, waits for all of them to
+ *          return and ends with the worst of their statuses.
+ *
+ * @return  int - 0 if every program succeeded
+ */
+int main(void) {
+    program_t sim = {"Simulator", simulator_main, 0, 0};
+    program_t fire = {"Fire Alarm System", fire_alarm_main, 0, 0};
+    program_t man = {"Manager", manager_main, 0, 0};
+    double began = seconds();
+
+    /* 3 status displays cannot share 1 terminal, unless asked for */
+    setenv("CARPARK_HEADLESS", "1", 0);
+
+    /* SIGUSR1 asks the Manager for a decision latency dump, block it
+    in every thread so only the Manager's latency thread (which waits
+    for it) gets it, as in the Manager's own process */
+    sigset_t usr1;
+    sigemptyset(&usr1);
+    sigaddset(&usr1, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &usr1, NULL);
+
+    /* -----------------------------------------------
+     *      START THE SIM, WAIT FOR IT TO CREATE THE
+     *      PARKING REGION & START SIMULATED TIME
+     * -------------------------------------------- */
+    puts("~Integrated: starting the Simulator");
+    pthread_create(&sim.thread, NULL, run, &sim);
+
+    volatile void *shm = parking_region_wait(PARKING_SIZE, START_TIMEOUT_MS);
+    if (shm == NULL || !clock_started(shm)) {
+        puts("~Integrated: the Simulator did not start, waiting for it to return");
+        pthread_join(sim.thread, NULL);
+        return EXIT_FAILURE;
+    }
+
+    /* -----------------------------------------------
+     *   THEN THE FIRE ALARM SYSTEM & MANAGER, AS FROM
+     *   THEIR OWN TERMINALS
+     * -------------------------------------------- */
+    puts("~Integrated: starting the Fire Alarm System & Manager");
+    pthread_create(&fire.thread, NULL, run, &fire);
+    pthread_create(&man.thread, NULL, run, &man);
+
+    /* -----------------------------------------------
+     *          JOIN ALL 3 BEFORE EXIT
+     * -------------------------------------------- */
+    pthread_join(man.thread, NULL);
+    pthread_join(fire.thread, NULL);
+    pthread_join(sim.thread, NULL);
+
+    int status = EXIT_SUCCESS;
+    program_t *all[3] = {&sim, &man, &fire};
+    for (int i = 0; i < 3; i++) {
+        if (all[i]->status != EXIT_SUCCESS) {
+            printf("~Integrated: the %s returned %d\n", all[i]->name, all[i]->status);
+            status = EXIT_FAILURE;
+        }
+    }
+    munmap((void *)shm, PARKING_SIZE);
+    integrated_shm_unlink("PARKING");
+    printf("~Integrated: all 3 programs returned after %.1fs\n", seconds() - began);
+    return status;
+}
+
+/**
+ * @brief Thread running 1 program's main.
+ *
+ * @param arg - the program_t, its status set when main returns
+ * @return void* - NULL when main returns
+ */
+static void *run(void *arg) {
+    program_t *p = (program_t *)arg;
+
+    p->status = p->main();
+    return NULL;
+}
+
+/**
+ * @brief Waits for the Sim to publish its clock, which it does once
+ * PARKING is initialised & before any of its threads start.
+ *
+ * @param shm - first byte of the PARKING region
+ * @return int - 1 once started, 0 after START_TIMEOUT_MS
+ */
+static int clock_started(volatile void *shm) {
+    for (int waited = 0; waited < START_TIMEOUT_MS; waited += 10) {
+        if (atomic_load(&parking_status(shm)->clock.origin) != 0) return 1;
+        struct timespec nap = {0, 10000000};
+        nanosleep(&nap, NULL);
+    }
+    return 0;
+}
+
+/**
+ * @brief Seconds since an arbitrary fixed point.
+ *
+ * @return double - CLOCK_MONOTONIC in seconds
+ */
+static double seconds(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ((double)ts.tv_nsec / 1e9);
+}
@@ -0,0 +1,99 @@
+/************************************************
+ * @file    parking-region.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Source code for parking-region.h
+ ***********************************************/
+#define _GNU_SOURCE     /* for memfd_create */
+#include <stdio.h>      /* for IO operations */
+#include <errno.h>      /* for telling the callers why */
+#include <fcntl.h>      /* for O_CREAT */
+#include <unistd.h>     /* for dup & close */
+#include <pthread.h>    /* for the region's lock */
+#include <time.h>       /* for naps while it is sized */
+#include <sys/mman.h>   /* for memfd_create & mmap */
+#include <sys/stat.h>   /* for the region's size */
+
+#include "parking-region.h" /* corresponding header */
+
+#define SIZE_POLL_MS 10 /* between checks that the Sim sized the region */
+
+/* the region, -1 until the Sim creates it */
+static pthread_mutex_t region_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t region_cond = PTHREAD_COND_INITIALIZER;
+static int region_fd = -1;
+
+int integrated_shm_open(const char *name, int oflag, mode_t mode) {
+    int fd = -1;
+
+    (void)mode;
+    pthread_mutex_lock(&region_lock);
+    if (region_fd < 0 && (oflag & O_CREAT)) {
+        region_fd = memfd_create(name, 0);
+        if (region_fd >= 0) pthread_cond_broadcast(&region_cond);
+    }
+
+    /* each caller closes its own descriptor, as with shm_open */
+    if (region_fd >= 0) fd = dup(region_fd);
+    else errno = ENOENT;
+    pthread_mutex_unlock(&region_lock);
+    return fd;
+}
+
+int integrated_shm_unlink(const char *name) {
+    int removed = -1;
+
+    (void)name;
+    pthread_mutex_lock(&region_lock);
+    if (region_fd >= 0) {
+        close(region_fd);
+        region_fd = -1;
+        removed = 0;
+    } else {
+        errno = ENOENT;
+    }
+    pthread_mutex_unlock(&region_lock);
+    return removed;
+}
+
+volatile void *parking_region_wait(size_t size, int timeout_ms) {
+    struct timespec until;
+    int fd = -1;
+
+    /* -----------------------------------------------
+     *          WAIT FOR THE SIM TO CREATE IT
+     * -------------------------------------------- */
+    clock_gettime(CLOCK_REALTIME, &until);
+    until.tv_sec += timeout_ms / 1000;
+    until.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+    if (until.tv_nsec >= 1000000000) {
+        until.tv_sec++;
+        until.tv_nsec -= 1000000000;
+    }
+
+    pthread_mutex_lock(&region_lock);
+    while (region_fd < 0) {
+        if (pthread_cond_timedwait(&region_cond, &region_lock, &until) == ETIMEDOUT) break;
+    }
+    if (region_fd >= 0) fd = dup(region_fd);
+    pthread_mutex_unlock(&region_lock);
+    if (fd < 0) return NULL;
+
+    /* -----------------------------------------------
+     *  THEN TO SIZE IT, AS TOUCHING PAST ITS END WOULD
+     *  RAISE SIGBUS
+     * -------------------------------------------- */
+    struct stat st;
+    for (int waited = 0; fstat(fd, &st) == 0 && (size_t)st.st_size < size; waited += SIZE_POLL_MS) {
+        if (waited >= timeout_ms) {
+            close(fd);
+            return NULL;
+        }
+        struct timespec nap = {0, SIZE_POLL_MS * 1000000};
+        nanosleep(&nap, NULL);
+    }
+
+    volatile void *region = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    return (region == MAP_FAILED) ? NULL : region;
+}
@@ -0,0 +1,52 @@
+/************************************************
+ * @file    parking-region.h
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   API for the in-memory PARKING region of the
+ *          integrated build (see integrated.c), standing in
+ *          for the POSIX shared memory object.
+ *
+ *          The 3 programs' shm_open & shm_unlink calls are
+ *          renamed to these when they are linked into 1
+ *          process (see Makefile), so their code is unchanged.
+ *          The region is a memfd, which every program maps as
+ *          it would map the shared memory object, so it lives
+ *          in this process only & never touches /dev/shm.
+ *
+ *          PARKING is the only shared memory the programs
+ *          use, so there is 1 region whatever the name.
+ ***********************************************/
+#pragma once
+
+#include <stddef.h>     /* for size_t */
+#include <sys/types.h>  /* for mode_t */
+
+/**
+ * @brief Opens the region in place of shm_open, creating it if asked.
+ *
+ * @param name - name of the shared memory object
+ * @param oflag - O_RDWR, O_CREAT...
+ * @param mode - unused, the region is private to this process
+ * @return int - a new file descriptor of the region, -1 with errno
+ * set to ENOENT if it was not created yet
+ */
+int integrated_shm_open(const char *name, int oflag, mode_t mode);
+
+/**
+ * @brief Removes the region in place of shm_unlink. Programs that
+ * mapped it keep their mapping.
+ *
+ * @param name - name of the shared memory object
+ * @return int - 0 on success, -1 with errno set to ENOENT if there is none
+ */
+int integrated_shm_unlink(const char *name);
+
+/**
+ * @brief Waits for the Simulator to create & size the region, then
+ * maps it for the caller.
+ *
+ * @param size - bytes to map, once the region is at least this big
+ * @param timeout_ms - longest to wait
+ * @return volatile void* - first byte of the region, NULL on timeout
+ */
+volatile void *parking_region_wait(size_t size, int timeout_ms);
@@ -0,0 +1,169 @@
+/************************************************
+ * @file    decision-latency.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Source code for decision-latency.h
+ ***********************************************/
+#include <stdio.h>      /* for IO operations */
+#include <stdlib.h>     /* for free */
+#include <time.h>       /* for clocks & timestamps */
+#include <signal.h>     /* for waiting on SIGUSR1 */
+#include <pthread.h>    /* for mutex locks */
+
+#include "decision-latency.h"   /* corresponding header */
+#include "man-common.h"         /* for flag & args type */
+#include "../src-common/trace.h" /* for tracing spans */
+#include "../src-common/mem-account.h" /* for accounting memory */
+#include "../src-common/sim-clock.h" /* for the real clock */
+
+#define SIGNAL_POLL 100 /* ms between checks of whether the simulation ended */
+
+stage_set_t entrance_latency[5];
+stage_set_t exit_latency[5];
+
+/* merged copy of every thread's histograms, guarded by merged_lock */
+static stage_set_t merged;
+static pthread_mutex_t merged_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const char *stage_names[STAGES] = {
+    "waiting for locks", "authorisation lookup", "billing", "capacity", "actuation", "total"
+};
+
+/* names of the stages in JSON */
+static const char *stage_keys[STAGES] = {"locks", "auth", "billing", "capacity", "actuate", "total"};
+
+#if TRACE
+/* span traced for each stage, the total traces the whole decision */
+static const trace_name_t stage_traces[STAGES] = {
+    TR_LOCKS, TR_AUTH, TR_BILLING, TR_CAPACITY, TR_ACTUATE, TR_DECISION
+};
+#endif
+
+/* function prototypes */
+static void dump_sets(FILE *fp, const char *title, stage_set_t *sets, int count);
+static void merge_sets(stage_set_t *sets, int count);
+static void json_sets(FILE *fp, const char *name, stage_set_t *sets, int count);
+
+void stopwatch_start(stopwatch_t *sw, stage_set_t *set, const char *plate) {
+    sw->set = set;
+    sw->plate = plate;
+    sw->start = mono_ns();
+    sw->lap = sw->start;
+    for (int i = 0; i < STAGES; i++) {
+        sw->spent[i] = 0;
+    }
+    sw->used = 0;
+}
+
+void stopwatch_lap(stopwatch_t *sw, stage_t stage) {
+    uint64_t now = mono_ns();
+
+    TRACE_SPAN(stage_traces[stage], sw->lap, sw->plate, 0);
+    sw->spent[stage] += now - sw->lap;
+    sw->used |= 1u << stage;
+    sw->lap = now;
+}
+
+void stopwatch_stop(stopwatch_t *sw) {
+    sw->spent[STAGE_TOTAL] = mono_ns() - sw->start;
+    sw->used |= 1u << STAGE_TOTAL;
+    TRACE_SPAN(stage_traces[STAGE_TOTAL], sw->start, sw->plate, 0);
+
+    for (int i = 0; i < STAGES; i++) {
+        if (sw->used & (1u << i)) hdr_record(&sw->set->stages[i], sw->spent[i]);
+    }
+}
+
+void latency_dump(FILE *fp, int ens, int exs) {
+    pthread_mutex_lock(&merged_lock);
+    dump_sets(fp, "Entrance decisions (LPR -> sign set)", entrance_latency, ens);
+    dump_sets(fp, "Exit decisions (LPR -> gate raising)", exit_latency, exs);
+    pthread_mutex_unlock(&merged_lock);
+}
+
+void latency_json(FILE *fp, int ens, int exs) {
+    pthread_mutex_lock(&merged_lock);
+    json_sets(fp, "entrance_decisions", entrance_latency, ens);
+    fprintf(fp, ",\n");
+    json_sets(fp, "exit_decisions", exit_latency, exs);
+    fprintf(fp, "\n");
+    pthread_mutex_unlock(&merged_lock);
+}
+
+void *latency_signals(void *args) {
+    args_t *a = (args_t *)args;
+    sigset_t usr1;
+    struct timespec patience = {0, SIGNAL_POLL * 1000000};
+
+    sigemptyset(&usr1);
+    sigaddset(&usr1, SIGUSR1);
+
+    while (!end_simulation) {
+        if (sigtimedwait(&usr1, NULL, &patience) == SIGUSR1) {
+            FILE *fp = fopen(LATENCY_FILE, "a");
+            if (fp != NULL) {
+                time_t now = time(NULL);
+                fprintf(fp, "~Decision latency at %s", ctime(&now));
+                latency_dump(fp, a->ENS, a->EXS);
+                fclose(fp);
+            }
+        }
+    }
+    mem_free(a);
+    return NULL;
+}
+
+/**
+ * @brief Merges the sets of several threads and prints every stage.
+ * merged_lock must be locked.
+ *
+ * @param fp - where to print
+ * @param title - what the decisions are
+ * @param sets - 1 set per thread
+ * @param count - no. of threads
+ */
+static void dump_sets(FILE *fp, const char *title, stage_set_t *sets, int count) {
+    merge_sets(sets, count);
+
+    fprintf(fp, "~%s:\n", title);
+    if (merged.stages[STAGE_TOTAL].total == 0) fprintf(fp, "\tno decisions yet\n");
+    for (int s = 0; s < STAGES; s++) {
+        hdr_print(fp, stage_names[s], &merged.stages[s]);
+    }
+}
+
+/**
+ * @brief Merges the sets of several threads into 'merged'.
+ * merged_lock must be locked.
+ *
+ * @param sets - 1 set per thread
+ * @param count - no. of threads
+ */
+static void merge_sets(stage_set_t *sets, int count) {
+    for (int s = 0; s < STAGES; s++) {
+        hdr_reset(&merged.stages[s]);
+        for (int t = 0; t < count; t++) {
+            hdr_merge(&merged.stages[s], &sets[t].stages[s]);
+        }
+    }
+}
+
+/**
+ * @brief Merges the sets of several threads and writes every stage as
+ * 1 JSON member. merged_lock must be locked.
+ *
+ * @param fp - where to write
+ * @param name - name of the member
+ * @param sets - 1 set per thread
+ * @param count - no. of threads
+ */
+static void json_sets(FILE *fp, const char *name, stage_set_t *sets, int count) {
+    merge_sets(sets, count);
+
+    fprintf(fp, "  \"%s\": {", name);
+    for (int s = 0; s < STAGES; s++) {
+        fprintf(fp, "%s\n    \"%s\": ", (s > 0) ? "," : "", stage_keys[s]);
+        hdr_json(fp, &merged.stages[s]);
+    }
+    fprintf(fp, "\n  }");
+}
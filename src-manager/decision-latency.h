@@ -0,0 +1,115 @@
+/************************************************
+ * @file    decision-latency.h
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   API for timing each entrance & exit decision,
+ *          stage by stage, in HDR histograms (p50..p99.9).
+ *
+ *          Entrance: LPR wake-up -> sign set (& gate raising).
+ *          Exit:     LPR wake-up -> gate raising.
+ *
+ *          Each entrance/exit thread owns its histograms and
+ *          times a decision with a stopwatch, adding the time
+ *          since the last lap to a stage. Time spent waiting
+ *          for any lock goes to STAGE_LOCKS so the other stages
+ *          are the work alone. Histograms of all threads are
+ *          merged when dumped: when the Manager ends (also as
+ *          JSON with RESULTS_DIR in config.h), and on SIGUSR1
+ *          (appended to LATENCY_FILE, as the terminal belongs
+ *          to the status display):
+ *
+ *          kill -USR1 $(pidof MANAGER)
+ ***********************************************/
+#pragma once
+
+#include <stdio.h>      /* for FILE type */
+#include <stdint.h>     /* for int types */
+
+#include "../src-common/hdr-histogram.h" /* for HDR histograms */
+
+#define LATENCY_FILE "decision-latency.txt"
+
+typedef enum stage_t {
+    STAGE_LOCKS,        /* waiting for any lock */
+    STAGE_AUTH,         /* authorised plates lookup */
+    STAGE_BILLING,      /* billing # table & file */
+    STAGE_CAPACITY,     /* finding/freeing a space */
+    STAGE_ACTUATE,      /* updating the sign & raising the gate */
+    STAGE_TOTAL,        /* the whole decision */
+    STAGES              /* no. of stages */
+} stage_t;
+
+/* 1 thread's histograms, 1 per stage */
+typedef struct stage_set_t {
+    hdr_t stages[STAGES];
+} stage_set_t;
+
+/* Times 1 decision */
+typedef struct stopwatch_t {
+    stage_set_t *set;       /* where to record */
+    uint64_t start;         /* ns */
+    uint64_t lap;           /* ns, end of the last lap */
+    uint64_t spent[STAGES]; /* ns per stage so far */
+    unsigned used;          /* bit per stage lapped, only those are recorded */
+    const char *plate;      /* plate being decided on, for tracing */
+} stopwatch_t;
+
+/* 1 set per entrance & exit thread (5 of each at most) */
+extern stage_set_t entrance_latency[5];
+extern stage_set_t exit_latency[5];
+
+/**
+ * @brief Starts timing a decision, call as soon as the LPR wakes the thread.
+ *
+ * @param sw - stopwatch to start
+ * @param set - the calling thread's histograms
+ * @param plate - plate being decided on (read until stopped)
+ */
+void stopwatch_start(stopwatch_t *sw, stage_set_t *set, const char *plate);
+
+/**
+ * @brief Adds the time since the last lap (or start) to a stage,
+ * also tracing it as a span when TRACE is on.
+ *
+ * @param sw - stopwatch
+ * @param stage - what the thread was doing since the last lap
+ */
+void stopwatch_lap(stopwatch_t *sw, stage_t stage);
+
+/**
+ * @brief Records every stage lapped, and the total, in the histograms.
+ *
+ * @param sw - stopwatch to stop
+ */
+void stopwatch_stop(stopwatch_t *sw);
+
+/**
+ * @brief Merges the histograms of every entrance & exit and prints
+ * each stage's p50, p90, p99, p99.9 & max.
+ *
+ * @param fp - where to print
+ * @param ens - no. of entrances
+ * @param exs - no. of exits
+ */
+void latency_dump(FILE *fp, int ens, int exs);
+
+/**
+ * @brief Merges the histograms like latency_dump, writing each stage's
+ * count, p50, p90, p99, p99.9 & max as the JSON members
+ * "entrance_decisions" & "exit_decisions" (for ./LOAD-TEST).
+ *
+ * @param fp - where to write, inside a JSON object
+ * @param ens - no. of entrances
+ * @param exs - no. of exits
+ */
+void latency_json(FILE *fp, int ens, int exs);
+
+/**
+ * @brief Appends a dump to LATENCY_FILE every time the Manager receives
+ * SIGUSR1, until the simulation ends. SIGUSR1 must be blocked in every
+ * thread (block it in Main before creating threads).
+ *
+ * @param args - includes no. of ENTRANCES/EXITS, freed within
+ * @return void* - return NULL upon completion
+ */
+void *latency_signals(void *args);
@@ -5,138 +5,206 @@
  * @brief   Source code for display-status.h
  ***********************************************/
 #include <stdio.h>      /* for IO operations */
-#include <stdlib.h>     /* for NULL & sys clear */
+#include <stdlib.h>     /* for NULL & free */
 #include <string.h>     /* for string operations */
-#include <pthread.h>    /* for mutex locking */
+#include <pthread.h>    /* for thread types */
 #include <time.h>       /* for sleeping */
 
+#include "display-status.h" /* corresponding header */
+#include "screen.h"     /* for diff rendering */
+#include "../src-common/parking-snapshot.h" /* for lock-free snapshots */
+#include "manage-gate.h"/* for clocks */
 #include "man-common.h" /* for car park types */
 #include "../config.h"  /* for no. of ENTRANCES/EXITS/LEVELS */
+#include "../src-common/mem-account.h" /* for accounting memory */
+#include "../src-common/sim-clock.h" /* for the simulated time */
+
+/* Manager's own figures shown alongside the hardware */
+typedef struct totals_t {
+    int lvl_capacity[5];
+    int total_cars;
+    int revenue;
+    int failsafe;
+    double sim_ms;          /* simulated time */
+    mem_usage_t mem;        /* heap memory of every tag */
+    double allocs_per_s;    /* over the last second or so */
+} totals_t;
+
+/* function prototypes */
+static void take_totals(args_t *a, totals_t *totals);
+static void draw(screen_t *scr, args_t *a, parking_snapshot_t *snap, totals_t *totals);
 
 void *display(void *args) {
     
     /* Deconstruct args */
     args_t *a = (args_t *)args;
+    parking_snapshot_t snap;
+    totals_t totals;
+    unsigned long retries = 0;   /* snapshots taken again due to writes */
+    unsigned long gave_up = 0;   /* frames drawn from an inconsistent snapshot */
     
     /* -----------------------------------------------
      *        SETUP TIMESPEC TO SLEEP FOR 50ms
-     * -------------------------------------------- */
+     * -----------------------------------------------
+     * Real time, the screen refreshes as often at any
+     * SPEED and shows the simulated time instead
+     */
     int millis = 50;
     struct timespec remaining, requested = {(millis / 1000), ((millis % 1000) * 1000000)};
 
+    screen_t *scr = screen_open();
+    if (scr == NULL) {
+        mem_free(a);
+        return NULL;
+    }
+    double cpu_before = thread_cpu_ms();
+
     /* -----------------------------------------------
-     *     LOCATE ALL ENTRANCES, EXITS, & LEVELS
-     * -------------------------------------------- */
-    entrance_t *en[a->ENS];
-    exit_t *ex[a->EXS];
-    level_t *lvl[a->LVLS];
+     *       LOOP WHILE SIMULATION HASN'T ENDED
+     * -----------------------------------------------
+     * Snapshot the car park without taking any locks (so
+     * the entrance & exit threads are never held up by the
+     * display), draw the copy off screen, then send only
+     * what changed to the terminal
+     */
+    while (!end_simulation) {
+        if (parking_snapshot(shm, a->ENS, a->EXS, a->LVLS, &snap) != 0) gave_up++;
+        retries += snap.retries;
+        take_totals(a, &totals);
+        draw(scr, a, &snap, &totals);
+        screen_flush(scr);
 
-    for (int i = 0; i < a->ENS; i++) {
-        en[i] = (entrance_t *)((char *)shm + (sizeof(entrance_t) * i));
+        /* -----------------------------------------------
+         *              SLEEP FOR 50 MILLIS
+         * -------------------------------------------- */
+        nanosleep(&requested, &remaining);
     }
-    for (int i = 0; i < a->EXS; i++) {
-        ex[i] = (exit_t *)((char *)shm + (sizeof(entrance_t) * a->ENS) + (sizeof(exit_t) * i));
+
+    double cpu_ms = thread_cpu_ms() - cpu_before;
+    unsigned long frames = scr->frames;
+    unsigned long bytes = scr->bytes;
+    screen_close(scr);
+
+    if (frames > 0) {
+        printf("~Display: %lu frames, %.0fus CPU and %lu bytes written per frame\n", frames,
+            cpu_ms * 1000 / frames, bytes / frames);
+        printf("~Display: %lu snapshot retries, %lu inconsistent snapshots\n", retries, gave_up);
     }
+    mem_free(a);
+    return NULL;
+}
+
+/**
+ * @brief Copies the Manager's capacities, totals & heap memory without locking,
+ * each value is read in one go so is never half written.
+ * 
+ * @param a - includes no. of LEVELS
+ * @param totals - set to the copy
+ */
+static void take_totals(args_t *a, totals_t *totals) {
     for (int i = 0; i < a->LVLS; i++) {
-        lvl[i] = (level_t *)((char *)shm + (sizeof(entrance_t) * a->ENS) + (sizeof(exit_t) * a->EXS) + (sizeof(level_t) * i));
+        totals->lvl_capacity[i] = ((volatile int *)curr_capacity)[i];
     }
+    totals->total_cars = total_cars_entered;
+    totals->revenue = revenue;
+    totals->failsafe = fire_failsafe;
+    totals->sim_ms = sim_now_ms();
+
+    /* the allocation rate is only worked out once a second, so it reads steadily */
+    static uint64_t last_allocs = 0;
+    static double last_ms = 0;
+    static double rate = 0;
+    double now = now_ms();
+
+    totals->mem = mem_usage(MEM_TAGS);
+    if (now - last_ms >= 1000) {
+        if (last_ms > 0) rate = (double)(totals->mem.allocs - last_allocs) * 1000 / (now - last_ms);
+        last_allocs = totals->mem.allocs;
+        last_ms = now;
+    }
+    totals->allocs_per_s = rate;
+}
+
+/**
+ * @brief Draws a snapshot of the car park onto the screen.
+ * 
+ * @param scr - screen to draw on
+ * @param a - includes no. of ENTRANCES/EXITS/LEVELS & CAPACITY
+ * @param snap - snapshot of the hardware to draw
+ * @param totals - Manager's figures to draw
+ */
+static void draw(screen_t *scr, args_t *a, parking_snapshot_t *snap, totals_t *totals) {
+    screen_printf(scr, "\n\n");
+    screen_printf(scr, "█▀▀ ▄▀█ █▀█ █▀█ ▄▀█ █▀█ █▄▀   █▀ ▀█▀ ▄▀█ ▀█▀ █░█ █▀\n");
+    screen_printf(scr, "█▄▄ █▀█ █▀▄ █▀▀ █▀█ █▀▄ █░█   ▄█ ░█░ █▀█ ░█░ █▄█ ▄█ -JM\n");
+    screen_printf(scr, "\n");
 
     /* -----------------------------------------------
-     *       LOOP WHILE SIMULATION HASN'T ENDED
+     *        PRINT STATUS OF ENTRANCE HARDWARE
      * -------------------------------------------- */
-    while (!end_simulation) {
-        system("clear");
-        puts("");
-        puts("");
-        puts("█▀▀ ▄▀█ █▀█ █▀█ ▄▀█ █▀█ █▄▀   █▀ ▀█▀ ▄▀█ ▀█▀ █░█ █▀");
-        puts("█▄▄ █▀█ █▀▄ █▀▀ █▀█ █▀▄ █░█   ▄█ ░█░ █▀█ ░█░ █▄█ ▄█ -JM");
-        puts("");
+    for (int i = 0; i < a->ENS; i++) {
+        screen_printf(scr, "ENTRANCE #%d:\t", i + 1);
 
-        /* -----------------------------------------------
-         *        PRINT STATUS OF ENTRANCE HARDWARE
-         * -------------------------------------------- */
-        for (int i = 0; i < a->ENS; i++) {
-            printf("ENTRANCE #%d:\t", i + 1);
-
-            pthread_mutex_lock(&en[i]->sensor.lock);
-            if (strlen(en[i]->sensor.plate) < 6) {
-                printf("LPR(------) ");
-            } else {
-                printf("LPR(%s) ", en[i]->sensor.plate);
-            }
-            pthread_mutex_unlock(&en[i]->sensor.lock);
-
-            pthread_mutex_lock(&en[i]->gate.lock);
-            printf("Gate(%c) ", en[i]->gate.status);
-            pthread_mutex_unlock(&en[i]->gate.lock);
-
-            pthread_mutex_lock(&en[i]->sign.lock);
-            if (en[i]->sign.display == 0) {
-                printf("Sign(-)\n");
-            } else {
-                printf("Sign(%c)\n", en[i]->sign.display);
-            }
-            pthread_mutex_unlock(&en[i]->sign.lock);
+        if (strlen(snap->en[i].plate) < 6) {
+            screen_printf(scr, "LPR(------) ");
+        } else {
+            screen_printf(scr, "LPR(%s) ", snap->en[i].plate);
         }
-        puts("");
 
-        /* -----------------------------------------------
-         *         PRINT STATUS OF EXIT HARDWARE
-         * -------------------------------------------- */
-        for (int i = 0; i < a->EXS; i++) {
-            printf("EXIT #%d:\t", i + 1);
-
-            pthread_mutex_lock(&ex[i]->sensor.lock);
-            if (strlen(ex[i]->sensor.plate) < 6) {
-                printf("LPR(------) ");
-            } else {
-                printf("LPR(%s) ", ex[i]->sensor.plate);
-            }
-            pthread_mutex_unlock(&ex[i]->sensor.lock);
-
-            pthread_mutex_lock(&ex[i]->gate.lock);
-            printf("Gate(%c)\n", ex[i]->gate.status);
-            pthread_mutex_unlock(&ex[i]->gate.lock);
+        screen_printf(scr, "Gate(%c) ", snap->en[i].gate);
+
+        if (snap->en[i].sign == 0) {
+            screen_printf(scr, "Sign(-)\n");
+        } else {
+            screen_printf(scr, "Sign(%c)\n", snap->en[i].sign);
         }
-        puts("");
+    }
+    screen_printf(scr, "\n");
 
-        /* -----------------------------------------------
-         *         PRINT STATUS OF LEVEL HARDWARE
-         * -------------------------------------------- */
-        int total = 0; /* kill 2 birds with 1 stone and get total here */
-        for (int i = 0; i < a->LVLS; i++) {
-            printf("LEVEL #%d:\t", i + 1);
-
-            pthread_mutex_lock(&lvl[i]->sensor.lock);
-            if (strlen(lvl[i]->sensor.plate) < 6) {
-                printf("LPR(------) ");
-            } else {
-                printf("LPR(%s) ", lvl[i]->sensor.plate);
-            }
-            pthread_mutex_unlock(&lvl[i]->sensor.lock);
-
-            printf("Temp(%d°) ", lvl[i]->temp_sensor); /* no mutex as temp is volatile */
-
-            printf("Alarm(%c) ", lvl[i]->alarm); /* no mutex as alarm is volatile */
-
-            pthread_mutex_lock(&curr_capacity_lock);
-            printf("Capacity(%d/%d)parked\n", curr_capacity[i], a->CAP);
-            total += curr_capacity[i];
-            pthread_mutex_unlock(&curr_capacity_lock);
+    /* -----------------------------------------------
+     *         PRINT STATUS OF EXIT HARDWARE
+     * -------------------------------------------- */
+    for (int i = 0; i < a->EXS; i++) {
+        screen_printf(scr, "EXIT #%d:\t", i + 1);
+
+        if (strlen(snap->ex[i].plate) < 6) {
+            screen_printf(scr, "LPR(------) ");
+        } else {
+            screen_printf(scr, "LPR(%s) ", snap->ex[i].plate);
         }
 
-        /* -----------------------------------------------
-         *                  PRINT TOTALS
-         * -------------------------------------------- */
-        printf("\n\t TOTAL CAPACITY: %d/%d parked", total, a->CAP * a->LVLS);
-        printf("\n\tTOTAL CUSTOMERS: %d cars", total_cars_entered);
-        printf("\n\t  TOTAL REVENUE: $%.2f\n\n", (float)revenue / 100);
+        screen_printf(scr, "Gate(%c)\n", snap->ex[i].gate);
+    }
+    screen_printf(scr, "\n");
 
-        /* -----------------------------------------------
-         *              SLEEP FOR 50 MILLIS
-         * -------------------------------------------- */
-        nanosleep(&requested, &remaining);
+    /* -----------------------------------------------
+     *         PRINT STATUS OF LEVEL HARDWARE
+     * -------------------------------------------- */
+    int total = 0; /* kill 2 birds with 1 stone and get total here */
+    for (int i = 0; i < a->LVLS; i++) {
+        screen_printf(scr, "LEVEL #%d:\t", i + 1);
+
+        if (strlen(snap->lvl[i].plate) < 6) {
+            screen_printf(scr, "LPR(------) ");
+        } else {
+            screen_printf(scr, "LPR(%s) ", snap->lvl[i].plate);
+        }
+
+        screen_printf(scr, "Temp(%d°) ", snap->lvl[i].temp);
+        screen_printf(scr, "Alarm(%c) ", snap->lvl[i].alarm);
+        screen_printf(scr, "Capacity(%d/%d)parked\n", totals->lvl_capacity[i], a->CAP);
+        total += totals->lvl_capacity[i];
     }
-    free(a);
-    return NULL;
-}
\ No newline at end of file
+
+    /* -----------------------------------------------
+     *                  PRINT TOTALS
+     * -------------------------------------------- */
+    screen_printf(scr, "\n\t TOTAL CAPACITY: %d/%d parked", total, a->CAP * a->LVLS);
+    screen_printf(scr, "\n\tTOTAL CUSTOMERS: %d cars", totals->total_cars);
+    screen_printf(scr, "\n\t  TOTAL REVENUE: $%.2f", (float)totals->revenue / 100);
+    long secs = (long)(totals->sim_ms / 1000);
+    screen_printf(scr, "\n\t SIMULATED TIME: %02ld:%02ld:%02ld (%gx)", secs / 3600, (secs / 60) % 60, secs % 60, sim_speed());
+    screen_printf(scr, "\n\t    HEAP MEMORY: %.1fKB (%.1fKB peak) %.0f allocs/s\n\n", (double)totals->mem.live / 1024,
+        (double)totals->mem.peak / 1024, totals->allocs_per_s);
+    if (totals->failsafe) screen_printf(scr, "\tFIRE ALARM SYSTEM NOT RESPONDING - GATES RAISED\n");
+}
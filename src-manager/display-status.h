@@ -9,7 +9,7 @@
 /**
  * @brief Formats terminal to elegantly display all
  * car-park's hardware statuses. Refreshes every 50ms
- * to prevent fatigue.
+ * to prevent fatigue, only redrawing what changed.
  * 
  * @param args - collection of values
  * @return void* - return NULL upon completion
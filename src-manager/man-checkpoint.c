@@ -0,0 +1,182 @@
+/************************************************
+ * @file    man-checkpoint.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Source code for man-checkpoint.h
+ ***********************************************/
+#include <stdio.h>          /* for IO operations */
+#include <string.h>         /* for string operations */
+#include <stdatomic.h>      /* for reading the run */
+
+#include "man-checkpoint.h" /* corresponding header */
+#include "man-common.h"     /* for the billing table & capacities */
+#include "../src-common/checkpoint.h" /* for the checkpoint file */
+#include "../src-common/mem-account.h" /* for accounting memory */
+#include "../src-common/parking-status.h" /* for the run */
+
+/* function prototypes */
+static checkpoint_sim_t *read_sim(const char *path, uint64_t *run);
+static checkpoint_man_t *read_man(const char *path, uint64_t run, int lvls);
+static const checkpoint_bill_t *find_bill(const checkpoint_man_t *man, const char *plate);
+
+int man_checkpoint_restore(const char *path, int lvls, int cap) {
+    uint64_t run = 0;
+    checkpoint_sim_t *sim = read_sim(path, &run);
+
+    if (sim == NULL) {
+        printf("~No Simulator checkpoint in %s to reconcile the bills with, starting empty\n", path);
+        return -1;
+    }
+    if (sim->lvls != lvls || sim->cap != cap) {
+        printf("~Checkpoint in %s is of %d levels of %d, starting empty\n", path, sim->lvls, sim->cap);
+        mem_free(sim);
+        return -1;
+    }
+
+    checkpoint_man_t *man = read_man(path, run, lvls);
+    if (man == NULL) printf("~No Manager checkpoint in %s from the Simulator's run, billing its cars from when they entered\n", path);
+
+    /* -----------------------------------------------
+     *   A BILL FOR EVERY CAR THE SIM HAS INSIDE OR AT
+     *   AN EXIT, FROM WHEN IT WAS BILLED BEFORE
+     * -------------------------------------------- */
+    const checkpoint_car_t *cars = (const checkpoint_car_t *)((const char *)(sim + 1) + sim->devices);
+    int kept = 0;
+    int rebuilt = 0;
+
+    for (uint32_t i = 0; i < sim->cars; i++) {
+        const checkpoint_car_t *c = &cars[i];
+        if (c->place == CHECKPOINT_EN_QUEUE) continue; /* not at the LPR yet, so never billed */
+
+        char plate[PLATE_SIZE + 1];
+        memcpy(plate, c->plate, PLATE_SIZE);
+        plate[PLATE_SIZE] = '\0';
+        if (hashtable_find(bill_ht, plate) != NULL) continue; /* the same plate twice */
+
+        const checkpoint_bill_t *b = (man != NULL) ? find_bill(man, plate) : NULL;
+        int level = (b != NULL) ? b->level : c->floor;
+        if (level < 0 || level >= lvls) continue;
+
+        hashtable_add(bill_ht, plate, level);
+        node_t *bill = hashtable_find(bill_ht, plate);
+        if (bill == NULL) continue; /* not a plate */
+
+        bill->start = checkpoint_rebase((b != NULL) ? b->start : c->stamps[CHECKPOINT_ENTERED], sim->at);
+        curr_capacity[level]++;
+        if (b != NULL) kept++;
+        else rebuilt++;
+    }
+
+    /* -----------------------------------------------
+     *          THEN THE TOTALS SO FAR
+     * -------------------------------------------- */
+    if (man != NULL) {
+        revenue = man->revenue;
+        total_cars_entered = man->cars_entered;
+        printf("~Restored %d bills from %s (%d dropped, their cars left with the Simulator), revenue $%.2f\n",
+            kept + rebuilt, path, (int)man->bills - kept, (float)man->revenue / 100);
+        mem_free(man);
+    } else {
+        printf("~Restored %d bills from %s\n", kept + rebuilt, path);
+    }
+    if (man != NULL && rebuilt > 0) printf("~%d cars inside had no bill, billed from when they entered\n", rebuilt);
+    mem_free(sim);
+    return kept + rebuilt;
+}
+
+int man_checkpoint_save(const char *path, int lvls) {
+    uint32_t bills = 0;
+
+    for (size_t i = 0; i < bill_ht->size; i++) {
+        for (node_t *n = bill_ht->buckets[i]; n != NULL; n = n->next) bills++;
+    }
+
+    size_t size = sizeof(checkpoint_man_t) + (sizeof(checkpoint_bill_t) * bills);
+    checkpoint_man_t *part = mem_calloc(1, size, MEM_CHECKPOINT);
+    if (part == NULL) {
+        perror("malloc checkpoint");
+        return -1;
+    }
+
+    part->lvls = lvls;
+    part->revenue = revenue;
+    part->cars_entered = total_cars_entered;
+    part->bills = bills;
+    for (int i = 0; i < lvls && i < CHECKPOINT_LEVELS; i++) part->capacity[i] = curr_capacity[i];
+
+    checkpoint_bill_t *to = (checkpoint_bill_t *)(part + 1);
+    for (size_t i = 0; i < bill_ht->size; i++) {
+        for (node_t *n = bill_ht->buckets[i]; n != NULL; n = n->next, to++) {
+            memcpy(to->plate, n->plate, PLATE_SIZE);
+            to->level = n->assigned_lvl;
+            to->start = n->start;
+        }
+    }
+
+    int saved = -1;
+    uint64_t run = atomic_load(&parking_status(shm)->clock.origin);
+    if (checkpoint_write(path, CHECKPOINT_MANAGER, run, part, size) == 0) {
+        printf("~Checkpoint of %u bills saved to %s\n", bills, path);
+        saved = (int)bills;
+    }
+    mem_free(part);
+    return saved;
+}
+
+/**
+ * @brief Loads the Sim's part, checking its size adds up.
+ *
+ * @param path - checkpoint file
+ * @param run - set to the run it was taken in
+ * @return checkpoint_sim_t* - the part (free with mem_free), NULL if missing or damaged
+ */
+static checkpoint_sim_t *read_sim(const char *path, uint64_t *run) {
+    size_t size = 0;
+    checkpoint_sim_t *sim = checkpoint_read(path, CHECKPOINT_SIMULATOR, run, &size);
+
+    if (sim != NULL && (size < sizeof(*sim)
+        || size != sizeof(*sim) + sim->devices + (size_t)sim->cars * sizeof(checkpoint_car_t))) {
+        mem_free(sim);
+        return NULL;
+    }
+    return sim;
+}
+
+/**
+ * @brief Loads the Manager's part, only if it was taken in the same run
+ * as the Sim's (so both agree on every time) with the same levels.
+ *
+ * @param path - checkpoint file
+ * @param run - the Sim's part's run
+ * @param lvls - LEVELS after checking bounds
+ * @return checkpoint_man_t* - the part (free with mem_free), NULL if missing, damaged or another run's
+ */
+static checkpoint_man_t *read_man(const char *path, uint64_t run, int lvls) {
+    uint64_t man_run = 0;
+    size_t size = 0;
+    checkpoint_man_t *man = checkpoint_read(path, CHECKPOINT_MANAGER, &man_run, &size);
+
+    if (man != NULL && (man_run != run || size < sizeof(*man) || man->lvls != lvls
+        || size != sizeof(*man) + (size_t)man->bills * sizeof(checkpoint_bill_t))) {
+        mem_free(man);
+        return NULL;
+    }
+    return man;
+}
+
+/**
+ * @brief Finds a car's bill in the Manager's part. A linear search, as
+ * there are at most LEVELS x CAPACITY bills & it is only done once.
+ *
+ * @param man - the Manager's part
+ * @param plate - plate to find, upper case
+ * @return const checkpoint_bill_t* - the bill, NULL if the car was not billed
+ */
+static const checkpoint_bill_t *find_bill(const checkpoint_man_t *man, const char *plate) {
+    const checkpoint_bill_t *bills = (const checkpoint_bill_t *)(man + 1);
+
+    for (uint32_t i = 0; i < man->bills; i++) {
+        if (memcmp(bills[i].plate, plate, PLATE_SIZE) == 0) return &bills[i];
+    }
+    return NULL;
+}
@@ -0,0 +1,41 @@
+/************************************************
+ * @file    man-checkpoint.h
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   API for the Manager's part of the checkpoint
+ *          file (see checkpoint.h): the billing table, the
+ *          capacity of each level, revenue & cars entered.
+ *
+ *          Restoring reconciles the bills with the Sim's part,
+ *          which the Sim restores first. A bill is kept only
+ *          for a car the Sim has inside or queued at an exit,
+ *          as a car caught at a gate when the run ended left
+ *          with it. A car inside without a bill (the Manager
+ *          ended before saving) is billed from when the Sim
+ *          saw it enter. Each level's capacity is then counted
+ *          from the bills kept.
+ ***********************************************/
+#pragma once
+
+/**
+ * @brief Refills the billing table, capacities, revenue & cars
+ * entered from a checkpoint, before any thread starts. Only
+ * restores a checkpoint of a car park with the same LEVELS &
+ * CAPACITY, otherwise the Manager starts empty.
+ *
+ * @param path - checkpoint file
+ * @param lvls - LEVELS after checking bounds
+ * @param cap - CAPACITY after checking bounds
+ * @return int - no. of bills restored, -1 if nothing could be
+ */
+int man_checkpoint_restore(const char *path, int lvls, int cap);
+
+/**
+ * @brief Saves the Manager's part of the checkpoint. Call once every
+ * thread has returned, before the shared memory is unmapped.
+ *
+ * @param path - checkpoint file
+ * @param lvls - LEVELS after checking bounds
+ * @return int - no. of bills saved, -1 if the file could not be written
+ */
+int man_checkpoint_save(const char *path, int lvls);
@@ -8,13 +8,7 @@
  * access all of its attributes (with arrow notation). Also 
  * includes global capacity counts with lock/cond-var.
  * 
- * Formulas for locating segments of the PARKING shared memory, 
- * where 'i' increments from 0 to less-than the number of 
- * ENTRANCES/EXITS/LEVELS respectively.
- * 
- * entrances: (sizeof(en) * i)
- * exits:     (sizeof(en) * total en) + (sizeof(ex) * i)
- * levels:    (sizeof(en) * total en) + (sizeof(ex) * total ex) + (sizeof(lvl) * i)
+ * See parking-types.h for the layout of the PARKING shared memory.
  ***********************************************/
 #pragma once
 
@@ -22,6 +16,8 @@
 #include <stdint.h>             /* for 16-bit integer type */
 
 #include "plates-hash-table.h"  /* for # table type */
+#include "../src-common/parking-types.h" /* for car park types */
+#include "../src-common/parking-status.h" /* for counting hardware writes */
 
 /* -----------------------------------------------
  *      ALL GLOBALS USED IN MANAGER SOFTWARE
@@ -36,7 +32,10 @@
 extern volatile _Atomic int end_simulation;      /* global flag - threads exit gracefully */
 extern volatile _Atomic int revenue;             /* total $$$ */
 extern volatile _Atomic int total_cars_entered;  /* total cars in/out */
-extern volatile _Atomic int SLOW;                /* slow down time by... */
+extern volatile _Atomic int HB_PERIOD;           /* ms between watchdog checks */
+extern volatile _Atomic int WD_TIMEOUT;          /* ms without a Fire Alarm heartbeat before failing safe */
+extern volatile _Atomic int WD_GRACE;            /* ms more for the Fire Alarm System to start */
+extern volatile _Atomic int fire_failsafe;       /* 1 = Fire Alarm System stalled, gates up & no entry */
 
 extern volatile  void *shm;                      /* first byte of shared mem */
 
@@ -62,49 +61,4 @@ typedef struct args_t {
     int EXS;    /* EXITS after checking bounds */
     int LVLS;   /* LEVELS after checking bounds */
     int CAP;    /* CAPACITY after checking bounds */
-} args_t;
-
-/* -----------------------------------------------
- *                 NESTED TYPES
- * -------------------------------------------- */
-typedef struct LPR_t {
-    pthread_mutex_t lock;
-    pthread_cond_t condition;
-    char plate[7];      /* 6 chars +1 for string null terminator */
-    char padding[1];    /* as we +1 above, we only need to +1 for padding, not +2 */
-} LPR_t;
-
-typedef struct boom_t {
-    pthread_mutex_t lock;
-    pthread_cond_t condition;
-    char status;        /* C,R,L,O - Closed, Raising, Lowering, Opened */
-    char padding[7];
-} boom_t;
-
-typedef struct info_t {
-    pthread_mutex_t lock;
-    pthread_cond_t condition;
-    char display;       /* X,F,number - Not authorised, Full, Assigned level*/
-    char padding[7];
-} info_t;
-
-/* -----------------------------------------------
- *                 PARENT TYPES
- * -------------------------------------------- */
-typedef struct entrance_t {
-    LPR_t sensor;
-    boom_t gate;
-    info_t sign;
-} entrance_t;
-
-typedef struct exit_t {
-    LPR_t sensor;
-    boom_t gate;
-} exit_t;
-
-typedef struct level_t {
-    LPR_t sensor;
-    volatile _Atomic int16_t temp_sensor;    /* 2 bytes - signed 16 bit int */
-    volatile _Atomic char alarm;            /* 1 byte  - either a '0' or a '1' */
-    char padding[5];
-} level_t;
\ No newline at end of file
+} args_t;
\ No newline at end of file
@@ -0,0 +1,84 @@
+/************************************************
+ * @file    man-metrics.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Source code for man-metrics.h
+ ***********************************************/
+#include <pthread.h>        /* for mutex locks */
+
+#include "man-metrics.h"    /* corresponding header */
+#include "man-common.h"     /* for the Manager's globals */
+#include "../src-common/lock-prof.h" /* for profiling locks */
+
+static int levels = 0; /* LEVELS after checking bounds */
+
+/* function prototypes */
+static double revenue_dollars(void);
+static double cars_entered(void);
+static double cars_inside(void);
+static double failsafe(void);
+
+const metric_def_t man_metrics[MAN_METRICS] = {
+    {"manager_decisions_total{result=\"admitted\"}", "Cars checked at an entrance, by what the sign showed", METRIC_COUNTER, NULL},
+    {"manager_decisions_total{result=\"denied\"}", "", METRIC_COUNTER, NULL},
+    {"manager_decisions_total{result=\"full\"}", "", METRIC_COUNTER, NULL},
+    {"manager_decisions_total{result=\"fire\"}", "", METRIC_COUNTER, NULL},
+    {"manager_decision_seconds", "Time from a plate being read at an entrance to the sign being updated", METRIC_HISTOGRAM, NULL},
+    {"manager_exits_total", "Cars billed at an exit", METRIC_COUNTER, NULL},
+    {"manager_gate_hold_seconds", "Time from a gate being seen open to the Manager lowering it", METRIC_HISTOGRAM, NULL},
+    {"manager_lock_wait_seconds{lock=\"authorised\"}", "Time spent waiting for a lock", METRIC_HISTOGRAM, NULL},
+    {"manager_lock_wait_seconds{lock=\"billing\"}", "", METRIC_HISTOGRAM, NULL},
+    {"manager_lock_wait_seconds{lock=\"capacity\"}", "", METRIC_HISTOGRAM, NULL},
+    {"manager_revenue_dollars_total", "Total billed", METRIC_COUNTER, revenue_dollars},
+    {"manager_cars_entered_total", "Cars assigned a level", METRIC_COUNTER, cars_entered},
+    {"manager_cars_inside", "Cars assigned a level that have not left", METRIC_GAUGE, cars_inside},
+    {"manager_fire_failsafe", "1 = Fire Alarm System stalled, gates up & no entry", METRIC_GAUGE, failsafe},
+};
+
+void man_metrics_init(int lvls) {
+    levels = lvls;
+    metrics_init(man_metrics, MAN_METRICS);
+}
+
+/**
+ * @brief Reads the revenue, kept in cents.
+ *
+ * @return double - dollars
+ */
+static double revenue_dollars(void) {
+    return (double)revenue / 100;
+}
+
+/**
+ * @brief Reads the no. of cars that entered.
+ *
+ * @return double - cars
+ */
+static double cars_entered(void) {
+    return (double)total_cars_entered;
+}
+
+/**
+ * @brief Adds up the current capacity of every level.
+ *
+ * @return double - cars
+ */
+static double cars_inside(void) {
+    int total = 0;
+
+    PROF_LOCK(&curr_capacity_lock, LK_CAPACITY);
+    for (int i = 0; i < levels; i++) {
+        total += curr_capacity[i];
+    }
+    PROF_UNLOCK(&curr_capacity_lock, LK_CAPACITY);
+    return (double)total;
+}
+
+/**
+ * @brief Reads whether the Manager has failed safe.
+ *
+ * @return double - 1 or 0
+ */
+static double failsafe(void) {
+    return (double)fire_failsafe;
+}
@@ -0,0 +1,39 @@
+/************************************************
+ * @file    man-metrics.h
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   The Manager's metrics, recorded by index with
+ *          metric_inc/metric_observe_us etc (see metrics.h)
+ *          and served on METRICS_PORT + 1.
+ ***********************************************/
+#pragma once
+
+#include "../src-common/metrics.h" /* for recording metrics */
+
+/* Index of each metric in man_metrics (keep both in the same order) */
+typedef enum man_metric_t {
+    MET_ADMITTED,       /* entrance decisions by result */
+    MET_DENIED,
+    MET_FULL,
+    MET_FIRE,
+    MET_DECISION,       /* plate read -> sign updated */
+    MET_EXITS,          /* cars billed at an exit */
+    MET_GATE_HOLD,      /* gate seen open -> lowered by a gate thread */
+    MET_LOCK_AUTH,      /* waits for the # tables & capacities */
+    MET_LOCK_BILL,
+    MET_LOCK_CAP,
+    MET_REVENUE,        /* read on scrape */
+    MET_CARS_ENTERED,
+    MET_CARS_INSIDE,
+    MET_FAILSAFE,
+    MAN_METRICS         /* no. of metrics */
+} man_metric_t;
+
+extern const metric_def_t man_metrics[MAN_METRICS];
+
+/**
+ * @brief Sets up the Manager's metrics, before any thread records.
+ *
+ * @param lvls - LEVELS after checking bounds
+ */
+void man_metrics_init(int lvls);
@@ -7,12 +7,17 @@
 #include <stdio.h>      /* for IO operations */
 #include <string.h>     /* for string operations */
 #include <stdlib.h>     /* for misc */
-#include <time.h>       /* for timespec/nanosleep */
 
 #include "manage-entrance.h"
 #include "plates-hash-table.h"
 #include "man-common.h"
+#include "man-metrics.h"
+#include "manage-gate.h"
+#include "decision-latency.h"
+#include "../src-common/lock-prof.h"
+#include "../src-common/mem-account.h"
 #include "../config.h"
+#include "../src-common/sim-clock.h"
 
 void *manage_entrance(void *args) {
 
@@ -26,6 +31,7 @@ void *manage_entrance(void *args) {
     first level as there will always be at least 1 level */
     int addr = (int)((sizeof(entrance_t) * a->ENS) + (sizeof(exit_t) * a->EXS)); /* offset of where levels begin */
     level_t *lvl = (level_t *)((char *)shm + addr + (sizeof(level_t) * 0)); /* first level */
+    stopwatch_t sw; /* times each decision */
 
 
     /* -----------------------------------------------
@@ -35,10 +41,12 @@ void *manage_entrance(void *args) {
         /* -----------------------------------------------
          *        WAIT FOR SIM TO READ PLATE INTO LPR
          * --------------------------------------------- */
-        pthread_mutex_lock(&en->sensor.lock);
+        PROF_LOCK(&en->sensor.lock, LK_EN_LPR + a->id);
         while (strcmp(en->sensor.plate, "") == 0 && !end_simulation) {
-            pthread_cond_wait(&en->sensor.condition, &en->sensor.lock);
+            PROF_COND_WAIT(&en->sensor.condition, &en->sensor.lock, LK_EN_LPR + a->id);
         }
+        double read_at = now_ms(); /* start of the decision */
+        stopwatch_start(&sw, &entrance_latency[a->id], (const char *)en->sensor.plate);
 
         /* Gate is either opened or closed by here - see SIMULATE-ENTRANCE.c */
 
@@ -47,20 +55,23 @@ void *manage_entrance(void *args) {
          * -----------------------------------------------
          * Unlock sign after we've updated the display
          */
-        pthread_mutex_lock(&en->sign.lock);
+        PROF_LOCK(&en->sign.lock, LK_EN_SIGN + a->id);
+        stopwatch_lap(&sw, STAGE_LOCKS);
 
         /* -----------------------------------------------
          *  VERIFY CAR ONLY IF THE SIMULATION HASN'T ENDED
-         *              AND THERE IS NO FIRE
+         *   AND THERE IS NO FIRE (OR FIRE ALARM STALL)
          * -------------------------------------------- */
-        if (!end_simulation && lvl->alarm != '1') {
+        if (!end_simulation && lvl->alarm != '1' && !fire_failsafe) {
             /* -----------------------------------------------
              *  VALIDATE LICENSE PLATE IN AUTHORISED # TABLE
              * -------------------------------------------- */
-            pthread_mutex_lock(&auth_ht_lock);
+            PROF_METRICS_LOCK(&auth_ht_lock, LK_AUTH, MET_LOCK_AUTH);
+            stopwatch_lap(&sw, STAGE_LOCKS);
             node_t *authorised = hashtable_find(auth_ht, en->sensor.plate);
-            pthread_mutex_unlock(&auth_ht_lock);
+            PROF_UNLOCK(&auth_ht_lock, LK_AUTH);
             pthread_cond_broadcast(&auth_ht_cond);
+            stopwatch_lap(&sw, STAGE_AUTH);
 
             /* -----------------------------------------------
              *            LOCK THE BILLING # TABLE
@@ -70,8 +81,10 @@ void *manage_entrance(void *args) {
              * left the car park, the entry in the billing # table will have been deleted,
              * allowing the car to return, as if it is visiting again in real-life.
              */
-            pthread_mutex_lock(&bill_ht_lock);
+            PROF_METRICS_LOCK(&bill_ht_lock, LK_BILL, MET_LOCK_BILL);
+            stopwatch_lap(&sw, STAGE_LOCKS);
             node_t *dupe = hashtable_find(bill_ht, en->sensor.plate);
+            stopwatch_lap(&sw, STAGE_BILLING);
 
             /* -----------------------------------------------
              *       LOCK THE CURRENT CAPACITIES ARRAY
@@ -79,11 +92,13 @@ void *manage_entrance(void *args) {
              * Grab the total capacity and do not unlock yet in-case the car enters and,
              * we need to update the current capacity for the assigned level
              */
-            pthread_mutex_lock(&curr_capacity_lock);
+            PROF_METRICS_LOCK(&curr_capacity_lock, LK_CAPACITY, MET_LOCK_CAP);
+            stopwatch_lap(&sw, STAGE_LOCKS);
             int total_cap = 0;
             for (int i = 0; i < a->LVLS; i++) {
                 total_cap += curr_capacity[i];
             }
+            stopwatch_lap(&sw, STAGE_CAPACITY);
 
             /* -----------------------------------------------
              *            ASSIGNED FLOOR VARIABLE
@@ -107,13 +122,15 @@ void *manage_entrance(void *args) {
              *    IF NOT AUTHORISED OR ALREADY IN CAR PARK
              * -------------------------------------------- */
             if (authorised == NULL || dupe != NULL) {
-                en->sign.display = 'X';
+                parking_set(shm, &en->sign.display, 'X');
+                metric_inc(MET_DENIED);
 
             /* -----------------------------------------------
              *              IF CAR PARK IS FULL
              * -------------------------------------------- */
             } else if (total_cap >= (a->CAP * a->LVLS)) {
-                en->sign.display = 'F';
+                parking_set(shm, &en->sign.display, 'F');
+                metric_inc(MET_FULL);
 
             /* -----------------------------------------------
              *       IF AUTHORISED AND CAR PARK HAS SPACE
@@ -129,62 +146,76 @@ void *manage_entrance(void *args) {
                         break;
                     }
                 }
+                stopwatch_lap(&sw, STAGE_CAPACITY);
 
                 /* check assigned floor bounds for safety */
-                if (floor_to_goto >= 0 || floor_to_goto <= 5) {
+                if (floor_to_goto >= 0 && floor_to_goto < a->LVLS) {
                     /* add to billing # table with assigned floor
                     (function will add the current time) */
                     hashtable_add(bill_ht, en->sensor.plate, floor_to_goto);
+                    stopwatch_lap(&sw, STAGE_BILLING);
 
                     /* set the sign's display to the assigned floor */
-                    en->sign.display = (char)(floor_to_goto + '0');
+                    parking_set(shm, &en->sign.display, (char)(floor_to_goto + '0'));
                     total_cars_entered++;
+                    metric_inc(MET_ADMITTED);
                     /* -----------------------------------------------
                     *              RAISE GATE IF CLOSED
                     * -------------------------------------------- */
-                    pthread_mutex_lock(&en->gate.lock);
-                    if (en->gate.status == 'C') en->gate.status = 'R';
-                    pthread_mutex_unlock(&en->gate.lock);
+                    PROF_LOCK(&en->gate.lock, LK_EN_GATE + a->id);
+                    if (en->gate.status == 'C') parking_set(shm, &en->gate.status, 'R');
+                    PROF_UNLOCK(&en->gate.lock, LK_EN_GATE + a->id);
                     pthread_cond_broadcast(&en->gate.condition);
 
                     assigned = 1;
 
                 } else {
                     /* safety check - carpark full after all */
-                    en->sign.display = 'F';
+                    parking_set(shm, &en->sign.display, 'F');
+                    metric_inc(MET_FULL);
                 }
             }
 
+            stopwatch_lap(&sw, STAGE_ACTUATE);
+
             /* -----------------------------------------------
              *    UNLOCK BILLING # TABLE
              *    UNLOCK CURRENT CAPACITIES ARRAY
              *    UNLOCK SIGN
              * -------------------------------------------- */
-            pthread_mutex_unlock(&bill_ht_lock);
-            pthread_mutex_unlock(&curr_capacity_lock);
+            PROF_UNLOCK(&bill_ht_lock, LK_BILL);
+            PROF_UNLOCK(&curr_capacity_lock, LK_CAPACITY);
 
             /* Broadcast to Sim that sign has been updated
              * and Broadcast to all manager threads that the
              * billing # table and current capacities are available again */
             pthread_cond_broadcast(&bill_ht_cond);
             pthread_cond_broadcast(&curr_capacity_cond);
+            metric_observe_us(MET_DECISION, (uint64_t)((now_ms() - read_at) * 1000));
+            stopwatch_stop(&sw);
 
             /* IF the car was assigned a level but before the
             Sim could read the level (in sign), the fire alarm
             jumps in and changes it to EVACUATE... we de-assign
             the car as it never entered. */
             if (assigned && lvl->alarm == '1') {
-                pthread_mutex_lock(&curr_capacity_lock);
+                PROF_METRICS_LOCK(&curr_capacity_lock, LK_CAPACITY, MET_LOCK_CAP);
                 curr_capacity[floor_to_goto]--;
-                pthread_mutex_unlock(&curr_capacity_lock);
+                PROF_UNLOCK(&curr_capacity_lock, LK_CAPACITY);
             }
+        } else if (!end_simulation) {
+            /* a fire's EVACUATE comes from the Fire Alarm System, while it
+            is stalled we answer each car 'F' as if full, so the Sim never
+            waits on a sign nobody will set */
+            if (lvl->alarm != '1') parking_set(shm, &en->sign.display, 'F');
+            metric_inc(MET_FIRE); /* turned away by a fire (or a stalled Fire Alarm System) */
         }
 
         /* -----------------------------------------------
          *           RESET & UNLOCK THE LPR SENSOR
          * --------------------------------------------- */
-        strcpy(en->sensor.plate, "");
-        pthread_mutex_unlock(&en->sensor.lock);
+        parking_set_plate(shm, en->sensor.plate, "");
+        PROF_UNLOCK(&en->sensor.lock, LK_EN_LPR + a->id);
 
         /* -----------------------------------------------
          * UNLOCK & BROADCAST SIGN SO THAT SIM CHECKS IT
@@ -192,16 +223,14 @@ void *manage_entrance(void *args) {
          * 8 millisecond pause before we broadcast to the Manager
          * that the LPR is ready, this is so that we can allow the 
          * DISPLAY STATUS thread to read & display status of LPR */
-        pthread_mutex_unlock(&en->sign.lock);
+        PROF_UNLOCK(&en->sign.lock, LK_EN_SIGN + a->id);
 
-        /* we DON'T use our custom sleep_for_millis function because the client can slow down
-        time using the "SLOW MOTION" variable but we want this time to be constistent */
-        int millis = 8; 
-        struct timespec remaining, requested = {(millis / 1000), ((millis % 1000) * 1000000)};
-        nanosleep(&requested, &remaining);
+        /* simulated like every other delay, so the handshake keeps pace with
+        the cars at any SPEED */
+        sleep_for_millis(8);
 
         pthread_cond_broadcast(&en->sign.condition);
     }
-    free(a);
+    mem_free(a);
     return NULL;
 }
\ No newline at end of file
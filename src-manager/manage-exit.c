@@ -12,6 +12,11 @@
 #include "manage-exit.h"/* corresponding header */
 #include "plates-hash-table.h"
 #include "man-common.h"
+#include "man-metrics.h"
+#include "decision-latency.h"
+#include "../src-common/lock-prof.h"
+#include "../src-common/mem-account.h"
+#include "../src-common/sim-clock.h"
 
 /* function prototypes */
 void write_file(char *name, char *plate, double bill);
@@ -23,6 +28,7 @@ void *manage_exit(void *args) {
      * -------------------------------------------- */
     args_t *a = (args_t *)args;
     exit_t *ex = (exit_t *)((char *)shm + a->addr);
+    stopwatch_t sw; /* times each decision */
 
     /* -----------------------------------------------
      *       LOOP WHILE SIMULATION HASN'T ENDED
@@ -31,78 +37,90 @@ void *manage_exit(void *args) {
         /* -----------------------------------------------
          *        WAIT FOR SIM TO READ PLATE INTO LPR
          * --------------------------------------------- */
-        pthread_mutex_lock(&ex->sensor.lock);
+        PROF_LOCK(&ex->sensor.lock, LK_EX_LPR + a->id);
         while (strcmp(ex->sensor.plate, "") == 0 && !end_simulation) {
-            pthread_cond_wait(&ex->sensor.condition, &ex->sensor.lock);
+            PROF_COND_WAIT(&ex->sensor.condition, &ex->sensor.lock, LK_EX_LPR + a->id);
         }
         /* Gate is either opened or closed by here */
+        stopwatch_start(&sw, &exit_latency[a->id], (const char *)ex->sensor.plate);
 
         /* Check if the simulation has ended, if so? skip to the end */
         if (!end_simulation) {
             /* find plate's start time and calc the difference to bill,
             appending file or creating if it does not already exist,
             then unlock ASAP and broadcast so other threads may use */
-            pthread_mutex_lock(&bill_ht_lock);
+            PROF_METRICS_LOCK(&bill_ht_lock, LK_BILL, MET_LOCK_BILL);
+            stopwatch_lap(&sw, STAGE_LOCKS);
             node_t *car = hashtable_find(bill_ht, ex->sensor.plate);
-            pthread_mutex_unlock(&bill_ht_lock);
+            PROF_UNLOCK(&bill_ht_lock, LK_BILL);
             pthread_cond_broadcast(&bill_ht_cond);
+            stopwatch_lap(&sw, STAGE_BILLING);
 
             if (car != NULL) {
                 /* -----------------------------------------------
                  *          BILL CAR @ 5c PER MILLISECOND
-                 * -------------------------------------------- */
+                 * -----------------------------------------------
+                 * of simulated time, so a car is billed the same at any SPEED
+                 */
                 uint64_t elapsed = 0;
                 double bill = 0;
-                struct timespec stop;
-                clock_gettime(CLOCK_MONOTONIC_RAW, &stop);
 
-                /* elapsed formula from https://stackoverflow.com/a/10192994 with modifications */
-                elapsed = ((stop.tv_sec - car->start.tv_sec) * 1000000 + (stop.tv_nsec - car->start.tv_nsec) / 1000) / 1000;
+                elapsed = (uint64_t)(sim_now_ms() - car->start);
                 bill = (double)(elapsed * 5); /* divide 100 for dollars $$$ */
 
                 /* -----------------------------------------------
                  *               APPEND BILLING FILE
                  * -------------------------------------------- */
                 write_file("billing.txt", car->plate, bill);
+                EVENT(EV_BILL, car->plate, bill);
                 revenue = revenue + bill;
+                metric_inc(MET_EXITS);
+                stopwatch_lap(&sw, STAGE_BILLING);
 
                 /* -----------------------------------------------
                  *             UPDATE CURRENT CAPACITY
                  * -------------------------------------------- */
-                pthread_mutex_lock(&curr_capacity_lock);
+                PROF_METRICS_LOCK(&curr_capacity_lock, LK_CAPACITY, MET_LOCK_CAP);
+                stopwatch_lap(&sw, STAGE_LOCKS);
                 /* stay within bounds (at least 0) */
                 if (curr_capacity[car->assigned_lvl] > 0) {
                     curr_capacity[car->assigned_lvl]--;
                 }
-                pthread_mutex_unlock(&curr_capacity_lock);
+                PROF_UNLOCK(&curr_capacity_lock, LK_CAPACITY);
                 pthread_cond_broadcast(&curr_capacity_cond);
+                stopwatch_lap(&sw, STAGE_CAPACITY);
 
                 /* -----------------------------------------------
                  *          REMOVE CAR FROM BILLING # TABLE
                  * -----------------------------------------------
                  * in-case same car returns again
                  */
-                pthread_mutex_lock(&bill_ht_lock);
+                PROF_METRICS_LOCK(&bill_ht_lock, LK_BILL, MET_LOCK_BILL);
+                stopwatch_lap(&sw, STAGE_LOCKS);
                 hashtable_delete(bill_ht, ex->sensor.plate);
-                pthread_mutex_unlock(&bill_ht_lock);
+                PROF_UNLOCK(&bill_ht_lock, LK_BILL);
                 pthread_cond_broadcast(&bill_ht_cond);
+                stopwatch_lap(&sw, STAGE_BILLING);
             }
 
             /* -----------------------------------------------
              *             RAISE GATE IF CLOSED
              * -------------------------------------------- */
-            pthread_mutex_lock(&ex->gate.lock);
-            if (ex->gate.status == 'C') ex->gate.status = 'R';
-            pthread_mutex_unlock(&ex->gate.lock);
+            PROF_LOCK(&ex->gate.lock, LK_EX_GATE + a->id);
+            stopwatch_lap(&sw, STAGE_LOCKS);
+            if (ex->gate.status == 'C') parking_set(shm, &ex->gate.status, 'R');
+            PROF_UNLOCK(&ex->gate.lock, LK_EX_GATE + a->id);
             pthread_cond_broadcast(&ex->gate.condition);
+            stopwatch_lap(&sw, STAGE_ACTUATE);
+            stopwatch_stop(&sw);
         }
         /* -----------------------------------------------
          *           RESET & UNLOCK LPR SENSOR
          * -------------------------------------------- */
-        strcpy(ex->sensor.plate, ""); /* reset LPR */
-        pthread_mutex_unlock(&ex->sensor.lock);
+        parking_set_plate(shm, ex->sensor.plate, ""); /* reset LPR */
+        PROF_UNLOCK(&ex->sensor.lock, LK_EX_LPR + a->id);
     }
-    free(a);
+    mem_free(a);
     return NULL;
 }
 
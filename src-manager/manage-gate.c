@@ -5,10 +5,14 @@
  * @brief   Source code for manage-gate.h
  ***********************************************/
 #include <stdio.h>   /* for IO operations */
-#include <time.h>    /* for time operations */
 
 #include "manage-gate.h"
 #include "man-common.h"
+#include "man-metrics.h"
+#include "../src-common/trace.h"
+#include "../src-common/lock-prof.h"
+#include "../src-common/mem-account.h"
+#include "../src-common/sim-clock.h"
 
 /* function prototypes */
 void sleep_for_millis(int ms);
@@ -18,6 +22,7 @@ void *manage_en_gate(void *args) {
     /* deconstruct args and locate corresponding shared memory */
     args_t *a = (args_t *)args;
     entrance_t *en = (entrance_t *)((char *)shm + a->addr);
+    int gate = LK_EN_GATE + a->id; /* lock profile id */
     int opened; /* 0 = no, 1 = yes */
     
     /* The fire alarm sys will always set off ALL alarms, so only check 
@@ -29,20 +34,29 @@ void *manage_en_gate(void *args) {
         opened = 0;
 
         /* wait until gate is opened */
-        pthread_mutex_lock(&en->gate.lock);
-        if (en->gate.status != 'O') pthread_cond_wait(&en->gate.condition, &en->gate.lock);
+        PROF_LOCK(&en->gate.lock, gate);
+        if (en->gate.status != 'O') PROF_COND_WAIT(&en->gate.condition, &en->gate.lock, gate);
         if (en->gate.status == 'O') opened = 1; /* store a copy so we can unlock the gate for other threads */
-        pthread_mutex_unlock(&en->gate.lock);
+        PROF_UNLOCK(&en->gate.lock, gate);
 
         /* If there's no fire and the gate is opened, keep open for 20ms before lowering */
-        if (!end_simulation && lvl->alarm != '1' && opened) {
+        if (!end_simulation && lvl->alarm != '1' && !fire_failsafe && opened) {
+            double seen = now_ms();
+            TRACE_START(hold);
             sleep_for_millis(20);
 
-            pthread_mutex_lock(&en->gate.lock);
-            if (en->gate.status == 'O') en->gate.status = 'L';
-            pthread_mutex_unlock(&en->gate.lock);
+            PROF_LOCK(&en->gate.lock, gate);
+            if (en->gate.status == 'O') parking_set(shm, &en->gate.status, 'L');
+            PROF_UNLOCK(&en->gate.lock, gate);
+            TRACE_SPAN(TR_GATE_HOLD, hold, NULL, 0);
+            metric_observe_us(MET_GATE_HOLD, (uint64_t)((now_ms() - seen) * 1000));
+        } else if (opened) {
+            /* gate stays open for the fire (or a stalled Fire Alarm System),
+            check again in 20ms rather than spinning on the open gate */
+            sleep_for_millis(20);
         }
     }
+    mem_free(a);
     return NULL;
 }
 
@@ -51,6 +65,7 @@ void *manage_ex_gate(void *args) {
     /* deconstruct args and locate corresponding shared memory */
     args_t *a = (args_t *)args;
     exit_t *ex = (exit_t *)((char *)shm + a->addr);
+    int gate = LK_EX_GATE + a->id; /* lock profile id */
     int opened; /* 0 = no, 1 = yes */
 
     /* The fire alarm sys will always set off ALL alarms, so only check 
@@ -62,24 +77,32 @@ void *manage_ex_gate(void *args) {
         opened = 0;
 
         /* wait until gate is opened */
-        pthread_mutex_lock(&ex->gate.lock);
-        if (ex->gate.status != 'O') pthread_cond_wait(&ex->gate.condition, &ex->gate.lock);
+        PROF_LOCK(&ex->gate.lock, gate);
+        if (ex->gate.status != 'O') PROF_COND_WAIT(&ex->gate.condition, &ex->gate.lock, gate);
         if (ex->gate.status == 'O') opened = 1; /* store a copy so we can unlock the gate for other threads */
-        pthread_mutex_unlock(&ex->gate.lock);
+        PROF_UNLOCK(&ex->gate.lock, gate);
 
         /* If there's no fire and the gate is opened, keep open for 20ms before lowering */
-        if (!end_simulation && lvl->alarm != '1' && opened) {
+        if (!end_simulation && lvl->alarm != '1' && !fire_failsafe && opened) {
+            double seen = now_ms();
+            TRACE_START(hold);
             sleep_for_millis(20);
 
-            pthread_mutex_lock(&ex->gate.lock);
-            if (ex->gate.status == 'O') ex->gate.status = 'L';
-            pthread_mutex_unlock(&ex->gate.lock);
+            PROF_LOCK(&ex->gate.lock, gate);
+            if (ex->gate.status == 'O') parking_set(shm, &ex->gate.status, 'L');
+            PROF_UNLOCK(&ex->gate.lock, gate);
+            TRACE_SPAN(TR_GATE_HOLD, hold, NULL, 0);
+            metric_observe_us(MET_GATE_HOLD, (uint64_t)((now_ms() - seen) * 1000));
+        } else if (opened) {
+            /* gate stays open for the fire (or a stalled Fire Alarm System),
+            check again in 20ms rather than spinning on the open gate */
+            sleep_for_millis(20);
         }
     }
+    mem_free(a);
     return NULL;
 }
 
 void sleep_for_millis(int ms) {
-    struct timespec remaining, requested = {(ms / 1000) * SLOW, ((ms % 1000) * 1000000) * SLOW};
-    nanosleep(&requested, &remaining);
-}
\ No newline at end of file
+    sim_sleep_ms(ms);
+}
@@ -14,7 +14,7 @@
  * @brief Waits until the corresponding gate is left open,
  * gate must remain open for 20ms before lowering.
  * 
- * @param args - includes thread id + address of entrance
+ * @param args - includes thread id + address of entrance, freed by the thread
  * @return void* - return NULL upon completion
  */
 void *manage_en_gate(void *args);
@@ -23,13 +23,14 @@ void *manage_en_gate(void *args);
  * @brief Waits until the corresponding gate is left open,
  * gate must remain open for 20ms before lowering.
  * 
- * @param args - includes thread id + address of entrance
+ * @param args - includes thread id + address of entrance, freed by the thread
  * @return void* - return NULL upon completion
  */
 void *manage_ex_gate(void *args);
 
 /**
- * @brief Sleeps for 'ms' milliseconds
+ * @brief Sleeps for 'ms' milliseconds of simulated time (the Sim's
+ * clock, see sim-clock.h)
  * 
  * @param ms - milliseconds to sleep
  */
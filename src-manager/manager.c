@@ -16,6 +16,7 @@
 #include <sys/mman.h>   /* for mapping shared like MAP_SHARED */
 #include <unistd.h>     /* for misc like sleep */
 #include <stddef.h>     /* for offsetof */
+#include <signal.h>     /* for blocking SIGUSR1 */
 
 /* header APIs + read config file */
 #include "plates-hash-table.h"
@@ -23,11 +24,22 @@
 #include "manage-exit.h"
 #include "manage-gate.h"
 #include "display-status.h"
+#include "watchdog.h"
+#include "decision-latency.h"
+#include "publish-status.h"
+#include "man-checkpoint.h"
 #include "man-common.h"
+#include "man-metrics.h"
 #include "../config.h"
+#include "../src-common/parking-status.h"
+#include "../src-common/trace.h"
+#include "../src-common/lock-prof.h"
+#include "../src-common/mem-account.h"
+#include "../src-common/run-config.h"
+#include "../src-common/sim-clock.h"
 
 #define SHARED_MEM_NAME "PARKING"
-#define SHARED_MEM_SIZE 2920    /* size in bytes */
+#define SHARED_MEM_SIZE PARKING_SIZE    /* hardware + status area, in bytes */
 #define TABLE_SIZE 100          /* buckets for hash tables */
 
 /* -----------------------------------------------
@@ -36,7 +48,10 @@
 volatile _Atomic int end_simulation = 0;        /* 0 = no, 1 = yes */
 volatile _Atomic int revenue = 0;               /* initially $0 */
 volatile _Atomic int total_cars_entered = 0;    /* initially 0 cars */
-volatile _Atomic int SLOW;                      /* slow down time by... */
+volatile _Atomic int HB_PERIOD;                 /* ms between watchdog checks */
+volatile _Atomic int WD_TIMEOUT;                /* ms without a heartbeat before failing safe */
+volatile _Atomic int WD_GRACE;                  /* ms more for the Fire Alarm System to start */
+volatile _Atomic int fire_failsafe = 0;         /* 0 = Fire Alarm System fine, 1 = stalled */
 volatile void *shm;                             /* first byte of shared memory */
 int *curr_capacity;
 pthread_mutex_t curr_capacity_lock;
@@ -50,7 +65,7 @@ pthread_cond_t bill_ht_cond;
 
 /* function prototypes */
 void read_file(char *name, htab_t *table);
-bool validate_plate(char *plate);
+static void write_results(const char *dir, int ens, int exs);
 
 /**
  * @brief   Entry point for the MANAGER software.
@@ -69,60 +84,92 @@ int main(void) {
      * -----------------------------------------------
      * As the number of ENTRANCES/CAPACITY/CHANCE etc are
      * subject to human error, bounds must be checked.
-     * Check bounds here ONCE for simplicity.
+     * Check bounds here ONCE for simplicity. Some may be
+     * overridden when starting (see run-config.h), those
+     * are checked the same way.
      */
-    int ENS = ENTRANCES;
-    int EXS = EXITS;
-    int LVLS = LEVELS;
-    int CAP = CAPACITY;
-    int DU = DURATION;
-    SLOW = SLOW_MOTION;
+    int ENS = config_int("ENTRANCES", ENTRANCES);
+    int EXS = config_int("EXITS", EXITS);
+    int LVLS = config_int("LEVELS", LEVELS);
+    int CAP = config_int("CAPACITY", CAPACITY);
+    int DU = config_int("DURATION", DURATION);
+    int MP = config_int("METRICS_PORT", METRICS_PORT);
+    int HL = config_int("HEADLESS", HEADLESS);
+    const char *RESULTS = config_str("RESULTS_DIR", RESULTS_DIR);
+    const char *SOCK = config_str("STATUS_SOCKET", STATUS_SOCKET);
+    const char *CK = config_str("CHECKPOINT_FILE", CHECKPOINT_FILE);
+    const char *RESTORE = config_str("RESTORE_FILE", RESTORE_FILE);
+    HB_PERIOD = HEARTBEAT_PERIOD;
+    WD_TIMEOUT = WATCHDOG_TIMEOUT;
+    WD_GRACE = WATCHDOG_GRACE;
 
     puts("~Verifying ENTRANCES, EXITS, LEVELS are 1..5 inclusive...");
-    if (ENTRANCES < 1 || ENTRANCES > 5) {
+    if (ENS < 1 || ENS > 5) {
         ENS = 5;
         printf("\tENTRANCES out of bounds. Falling back to defaults (5)\n");
     }
     
-    if (EXITS < 1 || EXITS > 5) {
+    if (EXS < 1 || EXS > 5) {
         EXS = 5;
         printf("\tEXITS out of bounds. Falling back to defaults (5)\n");
     }
     
-    if (LEVELS < 1 || LEVELS > 5) {
+    if (LVLS < 1 || LVLS > 5) {
         LVLS = 5;
         printf("\tLEVELS out of bounds. Falling back to defaults (5)\n");
     }
 
     puts("~Verifying CAPACITY is greater than 0...");
-    if (CAPACITY < 1) {
+    if (CAP < 1) {
         CAP = 20;
         printf("\tCAPACITY out of bounds. Falling back to defaults (20)\n");
     }
 
     puts("~Verifying DURATION is greater than 0...");
-    if (DURATION < 1) {
+    if (DU < 1) {
         DU = 60;
         printf("\tDURATION out of bounds. Falling back to defaults (1 minute)\n");
     }
 
-    puts("~Verifying SLOW MOTION is at least 1...");
-    if (SLOW_MOTION < 1) {
-        SLOW = 1;
-        printf("\tSLOW MOTION out of bounds. Falling back to defaults (1)\n");
+    puts("~Verifying HEARTBEAT PERIOD is at least 1, WATCHDOG TIMEOUT is above it & WATCHDOG GRACE is 0 or more...");
+    if (HEARTBEAT_PERIOD < 1) {
+        HB_PERIOD = 20;
+        printf("\tHEARTBEAT PERIOD out of bounds. Falling back to defaults (20ms)\n");
+    }
+
+    if (WATCHDOG_TIMEOUT <= HB_PERIOD) {
+        WD_TIMEOUT = HB_PERIOD * 5;
+        printf("\tWATCHDOG TIMEOUT out of bounds. Falling back to %dms\n", WD_TIMEOUT);
+    }
+
+    if (WATCHDOG_GRACE < 0) {
+        WD_GRACE = 5000;
+        printf("\tWATCHDOG GRACE out of bounds. Falling back to defaults (5000ms)\n");
+    }
+
+    puts("~Verifying METRICS PORT is 0 (off) or 1024..65533...");
+    if (MP != 0 && (MP < 1024 || MP > 65533)) {
+        MP = 9310;
+        printf("\tMETRICS PORT out of bounds. Falling back to defaults (9310)\n");
+    }
+
+    puts("~Verifying HEADLESS is 0 or 1...");
+    if (HL != 0 && HL != 1) {
+        HL = 0;
+        printf("\tHEADLESS out of bounds. Falling back to defaults (0)\n");
     }
 
     /* Allocate dynamic memory to array to keep track of each level's current capacity,
      * all capacities are initially 0 meaning no cars are assigned */
-    curr_capacity = calloc(LVLS, sizeof(int));
+    curr_capacity = mem_calloc(LVLS, sizeof(int), MEM_OTHER);
 
     /* -----------------------------------------------
      *              CREATE NEW # TABLES...
      *              FOR AUTHORISING
      *              FOR BILLING
      * -------------------------------------------- */
-    auth_ht = new_hashtable(TABLE_SIZE);
-    bill_ht = new_hashtable(TABLE_SIZE);
+    auth_ht = new_hashtable(TABLE_SIZE, MEM_AUTH);
+    bill_ht = new_hashtable(TABLE_SIZE, MEM_BILLING);
 
     /* -----------------------------------------------
      *      READ AUTHORISED LICENSE PLATES FILE
@@ -147,6 +194,35 @@ int main(void) {
         exit(1);
     }
 
+    /* run on the Sim's clock (and SPEED), before any thread sleeps */
+    sim_clock_attach(shm);
+    if (sim_speed() != 1) printf("~Simulated time runs at %gx real time\n", sim_speed());
+
+    /* SIGUSR1 asks for a decision latency dump, block it before any
+    thread starts so only the latency thread (which waits for it) gets it */
+    sigset_t usr1;
+    sigemptyset(&usr1);
+    sigaddset(&usr1, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &usr1, NULL);
+
+    /* -----------------------------------------------
+     *      START SERVING METRICS (SIM USES THE PORT
+     *      ITSELF, THE MANAGER THE NEXT ONE UP)
+     * -------------------------------------------- */
+    man_metrics_init(LVLS);
+    trace_init("manager");
+    event_init("manager", ENS, EXS, LVLS);
+    lockprof_init("Manager");
+    mem_init("Manager");
+    if (MP != 0 && metrics_serve(MP + 1) == 0) printf("~Metrics on http://127.0.0.1:%d/metrics\n", MP + 1);
+    if (SOCK[0] != '\0') printf("~Status feed on %s, watch with ./STATUS-VIEWER %s\n", SOCK, SOCK);
+
+    /* -----------------------------------------------
+     *   CARRY ON BILLING FROM A CHECKPOINT, ON THE SIM'S
+     *   CLOCK (BEFORE ANY THREAD READS THE TABLE)
+     * -------------------------------------------- */
+    if (RESTORE[0] != '\0') man_checkpoint_restore(RESTORE, LVLS, CAP);
+
     /* -----------------------------------------------
      *      START ENTRANCE, EXIT, & STATUS THREADS
      * -------------------------------------------- */
@@ -156,13 +232,15 @@ int main(void) {
     pthread_t ex_threads[EXS];
     pthread_t ex_gates[EXS];
     pthread_t status_thread;
+    pthread_t watchdog_thread;
+    pthread_t latency_thread;
     int addr = 0;
 
     args_t *a;
 
     for (int i = 0; i < ENS; i++) {
         /* set up args - will be freed within their thread */
-        a = malloc(sizeof(args_t) * 1);
+        a = mem_malloc(sizeof(args_t) * 1, MEM_ARGS);
         
         a->id = i;
         a->addr = (int)(sizeof(entrance_t) * i);
@@ -171,13 +249,16 @@ int main(void) {
         a->LVLS = LVLS;
         a->CAP = CAP;
 
+        /* the gate gets its own copy, as manage_entrance frees its args when it returns */
+        args_t *ga = mem_malloc(sizeof(args_t) * 1, MEM_ARGS);
+        *ga = *a;
+        pthread_create(&en_gates[i], NULL, manage_en_gate, (void *)ga);
         pthread_create(&en_threads[i], NULL, manage_entrance, (void *)a);
-        pthread_create(&en_gates[i], NULL, manage_en_gate, (void *)a);
     }
 
     for (int i = 0; i < EXS; i++) {
         /* set up args - will be freed within their thread */
-        a = malloc(sizeof(args_t) * 1);
+        a = mem_malloc(sizeof(args_t) * 1, MEM_ARGS);
         
         a->id = i;
         a->addr = (int)((sizeof(entrance_t) * ENS) + (sizeof(exit_t) * i));
@@ -186,21 +267,67 @@ int main(void) {
         a->LVLS = LVLS;
         a->CAP = CAP;
 
+        /* the gate gets its own copy, as manage_exit frees its args when it returns */
+        args_t *ga = mem_malloc(sizeof(args_t) * 1, MEM_ARGS);
+        *ga = *a;
+        pthread_create(&ex_gates[i], NULL, manage_ex_gate, (void *)ga);
         pthread_create(&ex_threads[i], NULL, manage_exit, (void *)a);
-        pthread_create(&ex_gates[i], NULL, manage_ex_gate, (void *)a);
+    }
+
+    /* set up args - will be freed within their thread,
+    no display when headless as nobody is watching the terminal */
+    if (!HL) {
+        a = mem_malloc(sizeof(args_t) * 1, MEM_ARGS);
+
+        a->id = 0;
+        a->addr = 0;
+        a->ENS = ENS;
+        a->EXS = EXS;
+        a->LVLS = LVLS;
+        a->CAP = CAP;
+
+        pthread_create(&status_thread, NULL, display, (void *)a);
     }
 
     /* set up args - will be freed within their thread */
-    a = malloc(sizeof(args_t) * 1);
+    args_t *wa = mem_malloc(sizeof(args_t) * 1, MEM_ARGS);
 
-    a->id = 0;
-    a->addr = 0;
-    a->ENS = ENS;
-    a->EXS = EXS;
-    a->LVLS = LVLS;
-    a->CAP = CAP;
+    wa->id = 0;
+    wa->addr = 0;
+    wa->ENS = ENS;
+    wa->EXS = EXS;
+    wa->LVLS = LVLS;
+    wa->CAP = CAP;
 
-    pthread_create(&status_thread, NULL, display, (void *)a);
+    pthread_create(&watchdog_thread, NULL, watchdog, (void *)wa);
+
+    /* set up args - will be freed within their thread */
+    args_t *la = mem_malloc(sizeof(args_t) * 1, MEM_ARGS);
+
+    la->id = 0;
+    la->addr = 0;
+    la->ENS = ENS;
+    la->EXS = EXS;
+    la->LVLS = LVLS;
+    la->CAP = CAP;
+
+    pthread_create(&latency_thread, NULL, latency_signals, (void *)la);
+
+    /* set up args - will be freed within their thread */
+    pthread_t publish_thread;
+    int publishing = (SOCK[0] != '\0');
+    if (publishing) {
+        args_t *pa = mem_malloc(sizeof(args_t) * 1, MEM_ARGS);
+
+        pa->id = 0;
+        pa->addr = 0;
+        pa->ENS = ENS;
+        pa->EXS = EXS;
+        pa->LVLS = LVLS;
+        pa->CAP = CAP;
+
+        pthread_create(&publish_thread, NULL, publish_status, (void *)pa);
+    }
 
     /* -----------------------------------------------
      *          ALERT ALL THREADS TO FINISH
@@ -239,9 +366,22 @@ int main(void) {
         pthread_join(ex_threads[i], NULL);
         pthread_join(ex_gates[i], NULL);
     }
-    pthread_join(status_thread, NULL);
+    if (!HL) pthread_join(status_thread, NULL);
+    pthread_join(watchdog_thread, NULL);
+    pthread_join(latency_thread, NULL);
+    if (publishing) pthread_join(publish_thread, NULL);
     puts("~Manager ending, now cleaning up...");
+    metrics_stop();
+    watchdog_report();
+    publish_report();
+    latency_dump(stdout, ENS, EXS);
+    if (RESULTS[0] != '\0') write_results(RESULTS, ENS, EXS);
+    lockprof_report();
+    trace_dump();
+    event_stop();
+    metrics_report("Manager");
     puts("~All threads returned");
+    if (CK[0] != '\0') man_checkpoint_save(CK, LVLS);
 
     /* -----------------------------------------------
      *          UNMAP SHARED MEMORY
@@ -253,8 +393,8 @@ int main(void) {
     hashtable_destroy(auth_ht);
     hashtable_destroy(bill_ht);
     puts("~Hash tables destroyed");
-    free(curr_capacity);
-    free(a);
+    mem_free(curr_capacity);
+    mem_report();
     puts("~Goodbye");
     puts("");
     return EXIT_SUCCESS;
@@ -293,31 +433,26 @@ void read_file(char *name, htab_t *table) {
 }
 
 /**
- * @brief Validates license plate strings via their format (111AAA).
- * 
- * @param p - plate to validate
- * @return true - if valid
- * @return false - if illegal
+ * @brief Writes the run's results to manager.json in a folder, for
+ * ./LOAD-TEST to collect: cars entered, revenue & decision latency.
+ *
+ * @param dir - folder to write to, must exist
+ * @param ens - no. of entrances
+ * @param exs - no. of exits
  */
-bool validate_plate(char *p) {
-    /* check if plate is correct length */
-    if (strlen(p) != 6) return false;
-    
-    /* slice string in half - first 3, last 3 */
-    char first[4];
-    char last[4];
-    strncpy(first, p, 3);
-    strncpy(last, p + 3, 3);
-    first[3] = '\0';
-    last[3] = '\0';
+static void write_results(const char *dir, int ens, int exs) {
+    char path[512];
 
-    /* for debugging... */
-    //printf("FIRST3\t%s\n", first);
-    //printf("LAST3\t%s\n", last);
-
-    /* check if plate is correct format: 111AAA */
-    for (int i = 0; i < 3; i++) {
-        if (!(isdigit(first[i]) && isalpha(last[i]))) return false;
+    snprintf(path, sizeof(path), "%s/manager.json", dir);
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) {
+        perror("Writing results");
+        return;
     }
-    return true;
-}
\ No newline at end of file
+    fprintf(fp, "{\n  \"cars_entered\": %d,\n  \"revenue_dollars\": %.2f,\n  \"fire_failsafe\": %d,\n",
+        total_cars_entered, (double)revenue / 100, fire_failsafe);
+    latency_json(fp, ens, exs);
+    fprintf(fp, "}\n");
+    fclose(fp);
+    printf("~Results written to %s\n", path);
+}
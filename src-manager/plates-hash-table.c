@@ -7,17 +7,18 @@
 #include <stdio.h>      /* for IO operations */
 #include <stdlib.h>     /* for dynamic memory */
 #include <string.h>     /* for string operations */
-#include <time.h>       /* for clock */
 #include <stdbool.h>    /* for bool operations */
 #include <ctype.h>      /* for isalpha, isdigit... */
 
 #include "plates-hash-table.h"
+#include "../src-common/sim-clock.h" /* for when a car is added */
 
-htab_t *new_hashtable(size_t h_size) {
+htab_t *new_hashtable(size_t h_size, mem_tag_t tag) {
     
-    htab_t *h = malloc(sizeof(htab_t) * 1);
+    htab_t *h = mem_malloc(sizeof(htab_t) * 1, tag);
     h->size = h_size;
-    h->buckets = malloc(sizeof(node_t*) * h_size);
+    h->tag = tag;
+    h->buckets = mem_malloc(sizeof(node_t*) * h_size, tag);
     
     for (int i = 0; i < (int)h_size; i++) {
         h->buckets[i] = NULL;
@@ -83,9 +84,9 @@ void hashtable_add(htab_t *h, char *plate, int assigned_lvl) {
     if (slot == NULL) {
         
         /* set up the new node */
-        node_t *new_n = malloc(sizeof(node_t) * 1);
+        node_t *new_n = mem_malloc(sizeof(node_t) * 1, h->tag);
         strcpy(new_n->plate, plate);
-        clock_gettime(CLOCK_MONOTONIC_RAW, &new_n->start);
+        new_n->start = sim_now_ms();
         new_n->assigned_lvl = assigned_lvl;
         new_n->next = NULL;
         
@@ -106,9 +107,9 @@ void hashtable_add(htab_t *h, char *plate, int assigned_lvl) {
     /* reached here if the plate is NOT a duplicate, and we've
     found the end of the linked list - set up the new node and
     point it to NULL as this is the now the tail node */
-    node_t *new_n = malloc(sizeof(node_t) * 1);
+    node_t *new_n = mem_malloc(sizeof(node_t) * 1, h->tag);
     strcpy(new_n->plate, plate);
-    clock_gettime(CLOCK_MONOTONIC_RAW, &new_n->start);
+    new_n->start = sim_now_ms();
     new_n->assigned_lvl = assigned_lvl;
     new_n->next = NULL;
 
@@ -137,13 +138,13 @@ void hashtable_delete(htab_t *h, char *plate) {
             /* if the plate is the head */
             if (previous == NULL) {
                 h->buckets[key] = current->next;
-                free(current);
+                mem_free(current);
                 return;
             
             /* if plate is in the middle/end of the list */
             } else {
                 previous->next = current->next;
-                free(current);
+                mem_free(current);
                 return;
             }
         }
@@ -187,15 +188,39 @@ bool hashtable_destroy(htab_t *h) {
         /* traverse and free until end of list (NULL) */
         while (bucket != NULL) {
             node_t *next = bucket->next;
-            free(bucket);
+            mem_free(bucket);
             bucket = next;
         }
     }
 
     /* free buckets array */
-    free(h->buckets);
+    mem_free(h->buckets);
     h->buckets = NULL;
     h->size = 0;
+    mem_free(h);
 
     return true;
-}
\ No newline at end of file
+}
+
+bool validate_plate(char *p) {
+    /* check if plate is correct length */
+    if (strlen(p) != 6) return false;
+    
+    /* slice string in half - first 3, last 3 */
+    char first[4];
+    char last[4];
+    strncpy(first, p, 3);
+    strncpy(last, p + 3, 3);
+    first[3] = '\0';
+    last[3] = '\0';
+
+    /* for debugging... */
+    //printf("FIRST3\t%s\n", first);
+    //printf("LAST3\t%s\n", last);
+
+    /* check if plate is correct format: 111AAA */
+    for (int i = 0; i < 3; i++) {
+        if (!(isdigit(first[i]) && isalpha(last[i]))) return false;
+    }
+    return true;
+}
@@ -22,14 +22,15 @@
 #include <string.h>     /* for string operations */
 #include <stdbool.h>    /* for bool operations */
 #include <ctype.h>      /* for isalpha, isdigit */
-#include <sys/time.h>   /* for timeval type */
+
+#include "../src-common/mem-account.h" /* for accounting memory */
 
 #define PLATE_SIZE 6
 
 /* Plate type */
 typedef struct node_t {
     char plate[PLATE_SIZE];
-    struct timespec start;
+    double start;       /* sim_now_ms when added, for billing */
     int assigned_lvl;
     struct node_t *next;
 } node_t;
@@ -38,15 +39,17 @@ typedef struct node_t {
 typedef struct htab_t {
     node_t **buckets;
     size_t size;
+    mem_tag_t tag;  /* what the table's memory is accounted to */
 } htab_t;
 
 /**
  * @brief Returns a new # table after creating and initialising.
  * 
  * @param h_size - no. of buckets aka size of # table's key col
+ * @param tag - what the table's memory is accounted to (MEM_AUTH/MEM_BILLING)
  * @return htab_t* - pointer to the # table
  */
-htab_t *new_hashtable(size_t h_size);
+htab_t *new_hashtable(size_t h_size, mem_tag_t tag);
 
 /**
  * @brief Prints a given #table
@@ -118,9 +121,19 @@ node_t *hashtable_find(htab_t *h, char *plate);
 
 /**
  * @brief Destroy an initialised # table by traversing all linked lists,
- * freeing each node. Then freeing all the buckets.
+ * freeing each node. Then freeing all the buckets and the table itself.
  * 
  * @param h - # table to destroy
  * @return true - once destroyed
  */
 bool hashtable_destroy(htab_t *h);
+
+/**
+ * @brief Validates license plate strings via their format (111AAA),
+ * before they are added to a # table.
+ * 
+ * @param p - plate to validate
+ * @return true - if valid
+ * @return false - if illegal
+ */
+bool validate_plate(char *p);
@@ -0,0 +1,275 @@
+/************************************************
+ * @file    publish-status.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Source code for publish-status.h
+ ***********************************************/
+#include <stdio.h>      /* for IO operations */
+#include <string.h>     /* for string operations */
+#include <errno.h>      /* for telling a full socket apart */
+#include <fcntl.h>      /* for non-blocking accepts */
+#include <poll.h>       /* for noticing viewers leave */
+#include <time.h>       /* for sleeping & timestamps */
+#include <unistd.h>     /* for close & unlink */
+#include <sys/socket.h> /* for sockets */
+#include <sys/un.h>     /* for Unix socket addresses */
+#include <sys/ioctl.h>  /* for bytes a viewer has not read */
+#include <linux/sockios.h> /* for SIOCOUTQ */
+
+#include "publish-status.h" /* corresponding header */
+#include "man-common.h" /* for car park types */
+#include "../config.h"  /* for STATUS_SOCKET */
+#include "../src-common/run-config.h"       /* for overriding STATUS_SOCKET */
+#include "../src-common/parking-snapshot.h" /* for lock-free snapshots */
+#include "../src-common/status-feed.h"      /* for the frames */
+#include "../src-common/mem-account.h"      /* for accounting memory */
+#include "../src-common/sim-clock.h"        /* for clocks */
+
+#define PUBLISH_BEHIND 1024     /* unread bytes (kernel's count, about 1 frame) a viewer may have before frames are skipped */
+
+/* 1 attached viewer */
+typedef struct subscriber_t {
+    int fd;             /* -1 = free slot */
+    int synced;         /* 0 = needs a snapshot, 1 = has 'sent' */
+    uint32_t seq;       /* frames sent to it */
+    feed_state_t sent;  /* state as of its last frame */
+} subscriber_t;
+
+/* Publisher statistics, only written by the publisher thread */
+typedef struct publish_stats_t {
+    unsigned long attached;
+    unsigned long turned_away;
+    unsigned long snapshots;
+    unsigned long frames;       /* snapshots & deltas */
+    unsigned long skipped;      /* frames not sent as the viewer was behind */
+    unsigned long long bytes;
+    unsigned long periods;
+    double cpu_ms;              /* CPU time used by all periods */
+} publish_stats_t;
+
+static subscriber_t subs[PUBLISH_SUBSCRIBERS];
+static publish_stats_t stats;
+
+/* function prototypes */
+static int listen_on(const char *path);
+static void attach(int listen_fd);
+static void detach_gone(void);
+static void take_state(args_t *a, parking_snapshot_t *snap, feed_state_t *state);
+static void copy_plate(char *to, const char *from);
+
+void *publish_status(void *args) {
+
+    /* deconstruct args */
+    args_t *a = (args_t *)args;
+    parking_snapshot_t snap;
+    feed_state_t state;
+    uint8_t frame[FEED_FRAME];
+    struct timespec remaining, requested = {(PUBLISH_PERIOD / 1000), ((PUBLISH_PERIOD % 1000) * 1000000)};
+
+    for (int i = 0; i < PUBLISH_SUBSCRIBERS; i++) subs[i].fd = -1;
+    const char *path = config_str("STATUS_SOCKET", STATUS_SOCKET);
+    int listen_fd = listen_on(path);
+    if (listen_fd < 0) {
+        mem_free(a);
+        return NULL;
+    }
+
+    /* -----------------------------------------------
+     *       LOOP WHILE SIMULATION HASN'T ENDED
+     * -----------------------------------------------
+     * Take 1 state per period and send each viewer what
+     * it has not seen. A viewer whose socket is full is
+     * skipped, it gets every change at once later on
+     */
+    while (!end_simulation) {
+        double cpu_before = thread_cpu_ms();
+        struct timespec ts;
+
+        attach(listen_fd);
+        detach_gone();
+        parking_snapshot(shm, a->ENS, a->EXS, a->LVLS, &snap);
+        take_state(a, &snap, &state);
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        uint64_t ns = ((uint64_t)ts.tv_sec * 1000000000) + (uint64_t)ts.tv_nsec;
+
+        for (int i = 0; i < PUBLISH_SUBSCRIBERS; i++) {
+            subscriber_t *s = &subs[i];
+            if (s->fd < 0) continue;
+
+            size_t len = feed_encode(&state, s->synced ? &s->sent : NULL, s->seq, ns, frame);
+            if (len == 0) continue; /* nothing new */
+
+            /* a viewer still reading older frames gets this one's changes
+            with a later frame, rather than queueing up stale frames */
+            int unread = 0;
+            if (ioctl(s->fd, SIOCOUTQ, &unread) == 0 && unread > PUBLISH_BEHIND) {
+                stats.skipped++;
+                continue;
+            }
+
+            if (send(s->fd, frame, len, MSG_DONTWAIT | MSG_NOSIGNAL) == (ssize_t)len) {
+                if (!s->synced) stats.snapshots++;
+                s->sent = state;
+                s->synced = 1;
+                s->seq++;
+                stats.frames++;
+                stats.bytes += len;
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                stats.skipped++;
+            } else {
+                close(s->fd);
+                s->fd = -1;
+            }
+        }
+        stats.cpu_ms += thread_cpu_ms() - cpu_before;
+        stats.periods++;
+
+        nanosleep(&requested, &remaining);
+    }
+
+    /* viewers see the feed end (their recv returns 0) */
+    for (int i = 0; i < PUBLISH_SUBSCRIBERS; i++) {
+        if (subs[i].fd >= 0) close(subs[i].fd);
+        subs[i].fd = -1;
+    }
+    close(listen_fd);
+    unlink(path);
+    mem_free(a);
+    return NULL;
+}
+
+void publish_report(void) {
+    if (stats.attached == 0 && stats.turned_away == 0) return;
+
+    printf("~Status feed: %lu viewers attached (%lu turned away), %lu frames (%lu snapshots) sent, %lu skipped for slow viewers\n",
+        stats.attached, stats.turned_away, stats.frames, stats.snapshots, stats.skipped);
+    if (stats.frames > 0) {
+        printf("~Status feed: %.1f bytes per frame, %.0fus CPU per period\n", (double)stats.bytes / (double)stats.frames,
+            stats.cpu_ms * 1000 / (double)stats.periods);
+    }
+}
+
+/**
+ * @brief Creates the Unix socket viewers attach to, replacing one left
+ * behind by an earlier run.
+ *
+ * @param path - where to create it
+ * @return int - the listening socket, -1 if it could not be created
+ */
+static int listen_on(const char *path) {
+    struct sockaddr_un addr;
+    int fd = -1;
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        printf("\tSTATUS SOCKET path too long, not publishing status\n");
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    unlink(path);
+    fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    if (fd < 0) {
+        perror("status feed socket");
+    } else if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, PUBLISH_SUBSCRIBERS) < 0
+        || fcntl(fd, F_SETFL, O_NONBLOCK) < 0) {
+        printf("\tSTATUS SOCKET %s unavailable, not publishing status\n", path);
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Accepts every viewer waiting to attach, they get a snapshot
+ * with the next frame.
+ *
+ * @param listen_fd - listening socket
+ */
+static void attach(int listen_fd) {
+    int fd;
+
+    while ((fd = accept(listen_fd, NULL, NULL)) >= 0) {
+        int slot = -1;
+        for (int i = 0; i < PUBLISH_SUBSCRIBERS && slot < 0; i++) {
+            if (subs[i].fd < 0) slot = i;
+        }
+        if (slot < 0) {
+            close(fd);
+            stats.turned_away++;
+            continue;
+        }
+
+        subs[slot].fd = fd;
+        subs[slot].synced = 0;
+        subs[slot].seq = 0;
+        stats.attached++;
+    }
+}
+
+/**
+ * @brief Frees the slots of viewers that have gone, viewers never send
+ * so anything readable is their end of the socket closing.
+ */
+static void detach_gone(void) {
+    for (int i = 0; i < PUBLISH_SUBSCRIBERS; i++) {
+        struct pollfd p = {subs[i].fd, POLLIN, 0};
+
+        if (subs[i].fd >= 0 && poll(&p, 1, 0) > 0) {
+            close(subs[i].fd);
+            subs[i].fd = -1;
+        }
+    }
+}
+
+/**
+ * @brief Builds the state to publish from a snapshot of the hardware
+ * and the Manager's own figures, read without locking like the display.
+ *
+ * @param a - includes no. of ENTRANCES/EXITS/LEVELS & CAPACITY
+ * @param snap - snapshot of the hardware
+ * @param state - set to the state
+ */
+static void take_state(args_t *a, parking_snapshot_t *snap, feed_state_t *state) {
+    memset(state, 0, sizeof(feed_state_t));
+    state->ens = a->ENS;
+    state->exs = a->EXS;
+    state->lvls = a->LVLS;
+    state->cap = a->CAP;
+
+    for (int i = 0; i < a->ENS; i++) {
+        copy_plate(state->en[i].plate, snap->en[i].plate);
+        state->en[i].gate = snap->en[i].gate;
+        state->en[i].sign = snap->en[i].sign;
+    }
+    for (int i = 0; i < a->EXS; i++) {
+        copy_plate(state->ex[i].plate, snap->ex[i].plate);
+        state->ex[i].gate = snap->ex[i].gate;
+    }
+    for (int i = 0; i < a->LVLS; i++) {
+        copy_plate(state->lvl[i].plate, snap->lvl[i].plate);
+        state->lvl[i].temp = snap->lvl[i].temp;
+        state->lvl[i].alarm = snap->lvl[i].alarm;
+        state->lvl[i].capacity = (int16_t)((volatile int *)curr_capacity)[i];
+    }
+    state->revenue = revenue;
+    state->cars = total_cars_entered;
+    state->failsafe = (char)fire_failsafe;
+}
+
+/**
+ * @brief Copies a plate up to its '\0', padding with '\0' to 6 chars so
+ * a changed plate always compares as changed.
+ *
+ * @param to - 6 chars
+ * @param from - plate from a snapshot
+ */
+static void copy_plate(char *to, const char *from) {
+    int ended = 0;
+
+    for (int i = 0; i < 6; i++) {
+        if (from[i] == '\0') ended = 1;
+        to[i] = ended ? '\0' : from[i];
+    }
+}
@@ -0,0 +1,33 @@
+/************************************************
+ * @file    publish-status.h
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   API for publishing the car park's status to any
+ *          no. of viewers (./STATUS-VIEWER) over the Unix
+ *          socket STATUS_SOCKET in config.h, see
+ *          src-common/status-feed.h for the frames sent.
+ *
+ *          Like the status display, the publisher takes
+ *          lock-free snapshots, so viewers attaching and
+ *          detaching never hold up the entrances & exits.
+ ***********************************************/
+#pragma once
+
+#define PUBLISH_PERIOD 50       /* ms between frames, as often as the display redraws */
+#define PUBLISH_SUBSCRIBERS 16  /* viewers attached at once, more are turned away */
+
+/**
+ * @brief Accepts viewers and every PUBLISH_PERIOD ms sends each
+ * the changes since its last frame (a snapshot when it attaches),
+ * skipping viewers whose socket is full.
+ *
+ * @param args - includes no. of ENTRANCES/EXITS/LEVELS & CAPACITY, freed within
+ * @return void* - return NULL upon completion
+ */
+void *publish_status(void *args);
+
+/**
+ * @brief Prints how many viewers attached and how many frames and
+ * bytes were sent or skipped. Call after the publisher has returned.
+ */
+void publish_report(void);
@@ -0,0 +1,162 @@
+/************************************************
+ * @file    screen.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Source code for screen.h
+ ***********************************************/
+#include <stdio.h>      /* for IO operations */
+#include <stdlib.h>     /* for dynamic memory */
+#include <string.h>     /* for string operations */
+#include <stdarg.h>     /* for printf style args */
+
+#include "screen.h"     /* corresponding header */
+#include "../src-common/mem-account.h" /* for accounting memory */
+
+#define ALT_SCREEN_ON "\033[?1049h\033[2J\033[?25l"    /* alternate buffer, clear, hide cursor */
+#define ALT_SCREEN_OFF "\033[?25h\033[?1049l"          /* show cursor, normal buffer */
+
+/* function prototypes */
+static void blank(cell_t cells[SCREEN_ROWS][SCREEN_COLS]);
+static void put_cell(screen_t *s, const char *ch, int len);
+static void out_append(screen_t *s, const char *bytes, size_t len);
+
+screen_t *screen_open(void) {
+    screen_t *s = mem_malloc(sizeof(screen_t) * 1, MEM_SCREEN);
+    if (s == NULL) return NULL;
+
+    /* the terminal starts blank, so does the first frame */
+    blank(s->front);
+    blank(s->back);
+    s->row = 0;
+    s->col = 0;
+    s->out_len = 0;
+    s->frames = 0;
+    s->bytes = 0;
+
+    fputs(ALT_SCREEN_ON, stdout);
+    fflush(stdout);
+    return s;
+}
+
+void screen_printf(screen_t *s, const char *fmt, ...) {
+    char line[SCREEN_ROWS * SCREEN_COLS * 4];
+    va_list ap;
+
+    va_start(ap, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    if (n < 0) return;
+    if (n >= (int)sizeof(line)) n = sizeof(line) - 1;
+
+    for (int i = 0; i < n;) {
+        unsigned char b = (unsigned char)line[i];
+
+        if (b == '\n') {
+            s->row++;
+            s->col = 0;
+            i++;
+        } else if (b == '\t') {
+            do {
+                put_cell(s, " ", 1);
+            } while (s->col % SCREEN_TAB != 0 && s->col < SCREEN_COLS);
+            i++;
+        } else {
+            /* length of this UTF-8 character from its first byte */
+            int len = (b < 0x80) ? 1 : ((b >> 5) == 0x6) ? 2 : ((b >> 4) == 0xe) ? 3 : 4;
+            if (i + len > n) len = n - i;
+            put_cell(s, &line[i], len);
+            i += len;
+        }
+    }
+}
+
+void screen_flush(screen_t *s) {
+    char move[32];
+    s->out_len = 0;
+
+    /* -----------------------------------------------
+     *   FIND EACH RUN OF CHANGED CELLS, MOVE THE
+     *   CURSOR TO ITS START AND WRITE JUST THE RUN
+     * -------------------------------------------- */
+    for (int r = 0; r < SCREEN_ROWS; r++) {
+        int c = 0;
+        while (c < SCREEN_COLS) {
+            if (memcmp(&s->front[r][c], &s->back[r][c], sizeof(cell_t)) == 0) {
+                c++;
+                continue;
+            }
+
+            int n = snprintf(move, sizeof(move), "\033[%d;%dH", r + 1, c + 1);
+            out_append(s, move, (size_t)n);
+
+            while (c < SCREEN_COLS && memcmp(&s->front[r][c], &s->back[r][c], sizeof(cell_t)) != 0) {
+                out_append(s, s->back[r][c].ch, strnlen(s->back[r][c].ch, sizeof(s->back[r][c].ch)));
+                s->front[r][c] = s->back[r][c];
+                c++;
+            }
+        }
+    }
+
+    if (s->out_len > 0) {
+        fwrite(s->out, 1, s->out_len, stdout);
+        fflush(stdout);
+    }
+    s->bytes += s->out_len;
+    s->frames++;
+
+    /* start the next frame */
+    blank(s->back);
+    s->row = 0;
+    s->col = 0;
+}
+
+void screen_close(screen_t *s) {
+    fputs(ALT_SCREEN_OFF, stdout);
+    fflush(stdout);
+    mem_free(s);
+}
+
+/**
+ * @brief Fills a grid with spaces.
+ * 
+ * @param cells - grid to fill
+ */
+static void blank(cell_t cells[SCREEN_ROWS][SCREEN_COLS]) {
+    for (int r = 0; r < SCREEN_ROWS; r++) {
+        for (int c = 0; c < SCREEN_COLS; c++) {
+            memset(cells[r][c].ch, 0, sizeof(cells[r][c].ch));
+            cells[r][c].ch[0] = ' ';
+        }
+    }
+}
+
+/**
+ * @brief Puts 1 character at the cursor of the frame being built and
+ * moves the cursor right, dropping it if off the screen.
+ * 
+ * @param s - screen to put to
+ * @param ch - UTF-8 bytes of the character
+ * @param len - no. of bytes (1..4)
+ */
+static void put_cell(screen_t *s, const char *ch, int len) {
+    if (s->row < SCREEN_ROWS && s->col < SCREEN_COLS) {
+        cell_t *cell = &s->back[s->row][s->col];
+        memset(cell->ch, 0, sizeof(cell->ch));
+        memcpy(cell->ch, ch, (size_t)len);
+    }
+    s->col++;
+}
+
+/**
+ * @brief Appends bytes to the output for this flush.
+ * 
+ * @param s - screen to append to
+ * @param bytes - bytes to append
+ * @param len - no. of bytes
+ */
+static void out_append(screen_t *s, const char *bytes, size_t len) {
+    if (s->out_len + len <= sizeof(s->out)) {
+        memcpy(s->out + s->out_len, bytes, len);
+        s->out_len += len;
+    }
+}
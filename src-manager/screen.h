@@ -0,0 +1,74 @@
+/************************************************
+ * @file    screen.h
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   API for a diff-rendering terminal screen.
+ *          Each frame is printed into an off-screen grid
+ *          of cells (printf style), then only the cells
+ *          that changed since the last frame are sent to
+ *          the terminal using ANSI cursor addressing, in
+ *          a single write. Drawn on the alternate screen
+ *          buffer so the terminal is left as it was.
+ *
+ *          Every character is assumed to take up 1 column
+ *          (true for the box drawing characters & degree
+ *          symbol used by the Manager's display).
+ ***********************************************/
+#pragma once
+
+#include <stddef.h>     /* for size_t */
+
+#define SCREEN_ROWS 40
+#define SCREEN_COLS 100
+#define SCREEN_TAB 8    /* tab stops every 8 columns */
+
+/* 1 character, UTF-8 encoded (up to 4 bytes, unused bytes are 0) */
+typedef struct cell_t {
+    char ch[4];
+} cell_t;
+
+typedef struct screen_t {
+    cell_t front[SCREEN_ROWS][SCREEN_COLS]; /* what the terminal shows */
+    cell_t back[SCREEN_ROWS][SCREEN_COLS];  /* frame being printed */
+    int row;                                /* where the next character goes */
+    int col;
+    char out[SCREEN_ROWS * SCREEN_COLS * 16]; /* escape codes & characters for 1 flush */
+    size_t out_len;
+    unsigned long frames;                   /* frames flushed so far */
+    unsigned long bytes;                    /* bytes written to the terminal so far */
+} screen_t;
+
+/**
+ * @brief Creates a screen and switches the terminal to the alternate
+ * screen buffer (cleared, cursor hidden).
+ * 
+ * @return screen_t* - the screen, NULL if out of memory
+ */
+screen_t *screen_open(void);
+
+/**
+ * @brief Prints into the frame being built, like printf. '\n' moves to
+ * the start of the next row, '\t' to the next tab stop. Anything past the
+ * edge of the screen is dropped.
+ * 
+ * @param s - screen to print to
+ * @param fmt - printf format
+ * @param ... - printf args
+ */
+void screen_printf(screen_t *s, const char *fmt, ...);
+
+/**
+ * @brief Sends the cells that changed since the last frame to the
+ * terminal, then starts a new (blank) frame at the top left.
+ * 
+ * @param s - screen to flush
+ */
+void screen_flush(screen_t *s);
+
+/**
+ * @brief Switches the terminal back to the normal screen buffer (cursor
+ * shown) and frees the screen.
+ * 
+ * @param s - screen to close
+ */
+void screen_close(screen_t *s);
@@ -0,0 +1,176 @@
+/************************************************
+ * @file    watchdog.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Source code for watchdog.h
+ ***********************************************/
+#include <stdio.h>      /* for IO operations */
+#include <stdlib.h>     /* for free */
+#include <stdint.h>     /* for int types */
+
+#include "watchdog.h"   /* corresponding header */
+#include "manage-gate.h"/* for clocks */
+#include "man-common.h" /* for car park types */
+#include "../src-common/parking-status.h" /* for heartbeats */
+#include "../src-common/lock-prof.h" /* for profiling locks */
+#include "../src-common/mem-account.h" /* for accounting memory */
+#include "../src-common/sim-clock.h" /* for sleeping & SPEED */
+
+/* Watchdog statistics, only written by the watchdog thread */
+typedef struct watchdog_stats_t {
+    unsigned long checks;
+    double cpu_ms;          /* CPU time used by all checks */
+    int trips;              /* times we failed safe */
+    int recoveries;         /* times the beats resumed */
+    double detect_min_ms;   /* time from the last beat seen to failing safe */
+    double detect_max_ms;
+    double detect_sum_ms;
+    int never_started;      /* 1 if we failed safe as no slot was used in time (not a trip) */
+} watchdog_stats_t;
+
+static watchdog_stats_t stats;
+
+/* function prototypes */
+static void fail_safe(args_t *a, int active);
+static double real_ms(int ms);
+
+void *watchdog(void *args) {
+
+    /* deconstruct args and locate the heartbeats */
+    args_t *a = (args_t *)args;
+    parking_status_t *status = parking_status(shm);
+
+    uint64_t last_beats[HEARTBEAT_SLOTS];
+    double last_change[HEARTBEAT_SLOTS]; /* when each slot last beat (as far as we saw) */
+    double timeout = real_ms(WD_TIMEOUT);
+    double began = now_ms();
+    int started = 0; /* 1 once any slot has been used */
+
+    for (int i = 0; i < HEARTBEAT_SLOTS; i++) {
+        last_beats[i] = status->fire[i].beats;
+        last_change[i] = now_ms();
+    }
+
+    /* -----------------------------------------------
+     *       LOOP WHILE SIMULATION HASN'T ENDED
+     * -------------------------------------------- */
+    while (!end_simulation) {
+        double cpu_before = thread_cpu_ms();
+        double now = now_ms();
+        double stalled_for = 0; /* longest silence of a stalled slot, 0 = none stalled */
+
+        /* -----------------------------------------------
+         *      LOOK FOR ALIVE SLOTS THAT STOPPED BEATING
+         * -------------------------------------------- */
+        for (int i = 0; i < HEARTBEAT_SLOTS; i++) {
+            uint64_t beats = status->fire[i].beats;
+
+            if (status->fire[i].state != HB_ALIVE || beats != last_beats[i]) {
+                /* not watched, or beat since last check */
+                last_beats[i] = beats;
+                last_change[i] = now;
+            } else if (now - last_change[i] > timeout && now - last_change[i] > stalled_for) {
+                stalled_for = now - last_change[i];
+            }
+            if (status->fire[i].state != HB_UNUSED) started = 1;
+        }
+
+        /* -----------------------------------------------
+         *    A FIRE ALARM SYSTEM THAT NEVER STARTED (OR
+         *    DIED BEFORE ITS FIRST BEAT) IS STALLED TOO
+         * -------------------------------------------- */
+        int never_started = !started && now - began > timeout + real_ms(WD_GRACE);
+
+        /* -----------------------------------------------
+         *        FAIL SAFE ON A STALL, RECOVER WHEN
+         *        EVERY ALIVE SLOT IS BEATING AGAIN
+         * -------------------------------------------- */
+        if (never_started && !fire_failsafe) {
+            fire_failsafe = 1;
+            fail_safe(a, 1);
+            stats.never_started = 1;
+
+        } else if (stalled_for > 0 && !fire_failsafe) {
+            fire_failsafe = 1;
+            fail_safe(a, 1);
+
+            if (stats.trips == 0 || stalled_for < stats.detect_min_ms) stats.detect_min_ms = stalled_for;
+            if (stalled_for > stats.detect_max_ms) stats.detect_max_ms = stalled_for;
+            stats.detect_sum_ms += stalled_for;
+            stats.trips++;
+
+        } else if (stalled_for == 0 && !never_started && fire_failsafe) {
+            fire_failsafe = 0;
+            fail_safe(a, 0);
+            stats.recoveries++;
+        }
+
+        stats.checks++;
+        stats.cpu_ms += thread_cpu_ms() - cpu_before;
+        sim_sleep_ms(real_ms(HB_PERIOD) * sim_speed());
+    }
+    mem_free(a);
+    return NULL;
+}
+
+void watchdog_report(void) {
+    printf("~Watchdog: %lu checks every %dms, %.0fns CPU per check\n", stats.checks, (int)real_ms(HB_PERIOD),
+        (stats.checks > 0) ? stats.cpu_ms * 1000000 / stats.checks : 0);
+
+    if (stats.never_started) {
+        printf("~Watchdog: Fire Alarm System not started within %dms of the Manager, failed safe until %s\n",
+            (int)real_ms(WD_TIMEOUT + WD_GRACE), (stats.trips > 0 || !fire_failsafe) ? "it started" : "the end");
+    }
+    if (stats.trips > 0) {
+        printf("~Watchdog: Fire Alarm System stalled %d time(s), recovered %d time(s), detected after %.0f/%.0f/%.0fms (min/mean/max, bound %dms)\n",
+            stats.trips, stats.recoveries, stats.detect_min_ms, stats.detect_sum_ms / stats.trips, stats.detect_max_ms,
+            (int)real_ms(WD_TIMEOUT + HB_PERIOD));
+    } else if (!stats.never_started) {
+        printf("~Watchdog: no Fire Alarm System stalls\n");
+    }
+}
+
+/**
+ * @brief Fails safe by raising every gate, or once recovered, lowers
+ * the gates left open. The entrance signs are left to the entrance
+ * threads, which answer every car 'F' while failed safe & go back to
+ * deciding once recovered, so no sign is left showing a stale 'F'.
+ * 
+ * @param a - includes no. of ENTRANCES/EXITS
+ * @param active - 1 = fail safe, 0 = recovered
+ */
+static void fail_safe(args_t *a, int active) {
+    for (int i = 0; i < a->ENS; i++) {
+        entrance_t *en = (entrance_t *)((char *)shm + (sizeof(entrance_t) * i));
+
+        PROF_LOCK(&en->gate.lock, LK_EN_GATE + i);
+        if (active && en->gate.status == 'C') parking_set(shm, &en->gate.status, 'R');
+        if (!active && en->gate.status == 'O') parking_set(shm, &en->gate.status, 'L');
+        PROF_UNLOCK(&en->gate.lock, LK_EN_GATE + i);
+        pthread_cond_broadcast(&en->gate.condition);
+    }
+
+    for (int i = 0; i < a->EXS; i++) {
+        exit_t *ex = (exit_t *)((char *)shm + (sizeof(entrance_t) * a->ENS) + (sizeof(exit_t) * i));
+
+        PROF_LOCK(&ex->gate.lock, LK_EX_GATE + i);
+        if (active && ex->gate.status == 'C') parking_set(shm, &ex->gate.status, 'R');
+        if (!active && ex->gate.status == 'O') parking_set(shm, &ex->gate.status, 'L');
+        PROF_UNLOCK(&ex->gate.lock, LK_EX_GATE + i);
+        pthread_cond_broadcast(&ex->gate.condition);
+    }
+}
+
+/**
+ * @brief A watchdog time in real ms, stretched in slow motion like the
+ * heartbeats are. Fast-forward does not shorten it, as a stall is the
+ * Fire Alarm System stopping on this machine, and faster simulated
+ * time only makes its beats come sooner.
+ *
+ * @param ms - ms from config.h
+ * @return double - real ms
+ */
+static double real_ms(int ms) {
+    double speed = sim_speed();
+    return (speed < 1) ? ms / speed : ms;
+}
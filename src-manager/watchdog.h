@@ -0,0 +1,35 @@
+/************************************************
+ * @file    watchdog.h
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   API for the Fire Alarm System watchdog.
+ *          Every Fire Alarm thread beats a heartbeat in
+ *          the PARKING shared memory. If any beat stops
+ *          for WATCHDOG_TIMEOUT ms (a crashed or stalled
+ *          Fire Alarm System) fires would go undetected,
+ *          so the Manager fails safe: raises all gates,
+ *          shows 'F' on every entrance sign and lets no
+ *          more cars in until the beats resume.
+ *
+ *          Threads that end on purpose stop being watched.
+ *          A Fire Alarm System that has not started within
+ *          WATCHDOG_TIMEOUT + WATCHDOG_GRACE ms of the
+ *          Manager counts as a stall too.
+ ***********************************************/
+#pragma once
+
+/**
+ * @brief Checks the Fire Alarm heartbeats every HEARTBEAT_PERIOD ms,
+ * failing safe on a stall and recovering when the beats resume.
+ * 
+ * @param args - includes no. of ENTRANCES/EXITS, freed within
+ * @return void* - return NULL upon completion
+ */
+void *watchdog(void *args);
+
+/**
+ * @brief Prints how often the watchdog checked, what each check cost,
+ * how many stalls it caught and how long each took to detect.
+ * Call after the watchdog thread has returned.
+ */
+void watchdog_report(void);
@@ -0,0 +1,71 @@
+/************************************************
+ * @file    balance.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Source code for balance.h
+ ***********************************************/
+#include <stdio.h>      /* for NULL */
+#include <stdbool.h>    /* for bool type */
+
+#include "balance.h"    /* corresponding header */
+
+/* set once in Main, before any car is queued */
+static balance_mode_t mode = BALANCE_OFF;
+
+/* Names printed for each balance_mode_t, in the same order */
+static const char *mode_names[BALANCE_MODES] = {"off", "shortest queue", "work stealing"};
+
+/* function prototypes */
+static int longest_sibling(queue_t **qs, int n, int own);
+
+void balance_init(balance_mode_t new_mode) {
+    mode = new_mode;
+}
+
+const char *balance_name(void) {
+    return mode_names[mode];
+}
+
+int balance_join(queue_t **qs, int n, int chosen) {
+    if (mode != BALANCE_SHORTEST) return chosen;
+
+    /* its own queue unless another is shorter */
+    int shortest = chosen;
+    for (int i = 0; i < n; i++) {
+        if (qs[i]->length < qs[shortest]->length) shortest = i;
+    }
+    return shortest;
+}
+
+bool balance_ready(queue_t **qs, int n, int own) {
+    if (qs[own]->head != NULL) return true;
+    return mode == BALANCE_STEAL && longest_sibling(qs, n, own) >= 0;
+}
+
+car_t *balance_take(queue_t **qs, int n, int own, bool *stolen) {
+    *stolen = false;
+    if (qs[own]->head != NULL || mode != BALANCE_STEAL) return pop_queue(qs[own]);
+
+    int from = longest_sibling(qs, n, own);
+    if (from < 0) return NULL;
+    *stolen = true;
+    return steal_queue(qs[from]);
+}
+
+/**
+ * @brief Finds the longest queue other than this one.
+ *
+ * @param qs - entrance or exit queues
+ * @param n - no. of queues
+ * @param own - queue to leave out
+ * @return int - longest sibling queue, -1 if every sibling is empty
+ */
+static int longest_sibling(queue_t **qs, int n, int own) {
+    int longest = -1;
+
+    for (int i = 0; i < n; i++) {
+        if (i == own || qs[i]->length == 0) continue;
+        if (longest < 0 || qs[i]->length > qs[longest]->length) longest = i;
+    }
+    return longest;
+}
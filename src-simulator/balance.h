@@ -0,0 +1,84 @@
+/************************************************
+ * @file    balance.h
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   API for balancing the cars between the
+ *          entrance queues and between the exit queues
+ *          (BALANCE_MODE in config.h).
+ *
+ *          Off, each car keeps the entrance the traffic
+ *          profile chose and the exit it picked at random,
+ *          so a gate slowed by an 'X' or a closed gate
+ *          builds a line while the others sit idle.
+ *
+ *          Shortest queue, each car joins the shortest
+ *          line when it arrives (its own on a tie).
+ *
+ *          Work stealing, each car joins its own line, and
+ *          an entrance or exit with no car of its own takes
+ *          the car at the back of the longest sibling line.
+ *
+ *          Every call is made under the lock of the queues
+ *          it is given (en_queues_lock or ex_queues_lock).
+ ***********************************************/
+#pragma once
+
+#include <stdbool.h>    /* for bool type */
+
+#include "queue.h"      /* for queue types */
+
+typedef enum balance_mode_t {
+    BALANCE_OFF,        /* the original, no balancing */
+    BALANCE_SHORTEST,   /* join the shortest queue on arrival */
+    BALANCE_STEAL,      /* idle entrances & exits steal from the longest queue */
+    BALANCE_MODES       /* no. of modes */
+} balance_mode_t;
+
+/**
+ * @brief Sets how cars are balanced, before any car is queued.
+ *
+ * @param mode - BALANCE_MODE after checking bounds
+ */
+void balance_init(balance_mode_t mode);
+
+/**
+ * @brief Names the mode cars are balanced by, for reports.
+ *
+ * @return const char* - "off", "shortest queue" or "work stealing"
+ */
+const char *balance_name(void);
+
+/**
+ * @brief Picks the queue an arriving car joins.
+ *
+ * @param qs - entrance or exit queues
+ * @param n - no. of queues
+ * @param chosen - queue the car was sent to
+ * @return int - queue to join, 0..n-1
+ */
+int balance_join(queue_t **qs, int n, int chosen);
+
+/**
+ * @brief Whether an entrance or exit has a car to serve, its own or,
+ * when stealing, 1 waiting in a sibling queue.
+ *
+ * @param qs - entrance or exit queues
+ * @param n - no. of queues
+ * @param own - this entrance's or exit's queue
+ * @return true - if balance_take would return a car
+ * @return false - if it would wait
+ */
+bool balance_ready(queue_t **qs, int n, int own);
+
+/**
+ * @brief Takes the next car for an entrance or exit to serve: the
+ * front of its own queue, or when stealing & its own is empty, the
+ * back of the longest sibling queue.
+ *
+ * @param qs - entrance or exit queues
+ * @param n - no. of queues
+ * @param own - this entrance's or exit's queue
+ * @param stolen - set to true if the car came from a sibling queue
+ * @return car_t* - car to serve, NULL if there is none
+ */
+car_t *balance_take(queue_t **qs, int n, int own, bool *stolen);
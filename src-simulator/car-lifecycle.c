@@ -6,54 +6,279 @@
  ***********************************************/
 #include <stdio.h>          /* for IO operations */
 #include <pthread.h>        /* for mutex locks */
-#include <stdlib.h>         /* for rand */
 #include <string.h>         /* for string operations */
+#include <math.h>           /* for fmax */
 
 #include "car-lifecycle.h"  /* corresponding header */
+#include "timer-wheel.h"    /* for waiting without a thread */
+#include "balance.h"        /* for joining the shortest queue */
 #include "queue.h"          /* for joining exit queue */
-#include "sleep.h"          /* for parking n milliseconds */
 #include "parking.h"        /* for shared memory types */
-#include "sim-common.h"     /* for the rand lock */
-
-void *car_lifecycle(void *args) {
-    /* deconstruct args */
-    args_t *a = (args_t *)args;
-    car_t *c = (car_t *)a->car;
-    int stay = 0;
-    int exit = 0;
-
-    /* calculate address of level n */
-    level_t *lvl = (level_t *)((char *)shm + a->addr);
-
-    /* lock rand ONCE here to grab all random values needed 
-    so we can let other threads use rand ASAP */
-    pthread_mutex_lock(&rand_lock);
-    stay = (rand() % 9901) + 100; /* %9901 = 0..9900 and +100 = 100..10000 */
-    exit = rand() % a->EXS;
-    pthread_mutex_unlock(&rand_lock);
-
-    //printf("%s will now park on floor %d for %dms\n", c->plate, c->floor + 1, stay);
-
-    /* drive for 10ms to parking space,
-    trigger LPR then park for 100..10000ms
-    trigger LPR then drive for 10ms to random exit */
-    sleep_for_millis(10);
-    pthread_mutex_lock(&lvl->sensor.lock);
-    strcpy(lvl->sensor.plate, c->plate);
-    pthread_mutex_unlock(&lvl->sensor.lock);
-    sleep_for_millis(stay);
-    pthread_mutex_lock(&lvl->sensor.lock);
-    strcpy(lvl->sensor.plate, c->plate);
-    pthread_mutex_unlock(&lvl->sensor.lock);
-    sleep_for_millis(10);
-
-    /* queue up @ random exit */
-    pthread_mutex_lock(&ex_queues_lock);
-    push_queue(ex_queues[exit], c);
-    pthread_mutex_unlock(&ex_queues_lock);
-    pthread_cond_broadcast(&ex_queues_cond);
-
-
-    /* thread ends here but car data flow continues to a random exit */
+#include "sim-common.h"     /* for the exit queues */
+#include "sim-metrics.h"    /* for recording metrics */
+#include "journey.h"        /* for timing car journeys */
+#include "../src-common/trace.h" /* for tracing spans */
+#include "../src-common/lock-prof.h" /* for profiling locks */
+#include "../src-common/mem-account.h" /* for accounting memory */
+#include "../src-common/lpr-trace.h" /* for capturing LPR readings */
+#include "../src-common/sim-clock.h" /* for simulated time */
+
+#define DRIVE_MS 10             /* to a parking space, then to an exit */
+#define LIFECYCLE_SLOTS 4096    /* ms per turn of the wheel, longer stays go round more than once */
+
+/* A car inside, waiting in the wheel for its next move */
+typedef struct lifecycle_t {
+    wheel_entry_t timer;    /* first, so an entry is its lifecycle */
+    car_t *car;
+    int addr;               /* address of its level in shared memory */
+    int exit;               /* exit it leaves by */
+    car_state_t state;
+} lifecycle_t;
+
+/* wheel & ready list, both guarded by lifecycle_lock */
+static pthread_mutex_t lifecycle_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ready_cond = PTHREAD_COND_INITIALIZER;
+static wheel_t wheel;
+static wheel_entry_t *ready_head = NULL;   /* due moves, oldest first */
+static wheel_entry_t *ready_tail = NULL;
+static double max_late = 0;                /* ms, latest move made */
+static unsigned long admitted = 0;
+
+static volatile _Atomic int stopping = 0;  /* 0 = no, 1 = yes */
+static pthread_t ticker;
+static pthread_t *workers = NULL;
+static int n_workers = 0;
+static int n_exits = 0;
+
+/* function prototypes */
+static void *tick(void *args);
+static void *work(void *args);
+static void move(lifecycle_t *l);
+static void schedule(lifecycle_t *l, double due);
+static void set_level_lpr(car_t *c, int addr);
+
+int lifecycle_start(int n, int exs) {
+    if (wheel_init(&wheel, LIFECYCLE_SLOTS, sim_now_ms()) != 0) return -1;
+    workers = mem_malloc(sizeof(pthread_t) * (size_t)n, MEM_LIFECYCLE);
+    if (workers == NULL) {
+        wheel_destroy(&wheel);
+        return -1;
+    }
+    n_workers = n;
+    n_exits = exs;
+
+    pthread_create(&ticker, NULL, tick, NULL);
+    for (int i = 0; i < n; i++) pthread_create(&workers[i], NULL, work, NULL);
+    return 0;
+}
+
+void lifecycle_admit(car_t *c, int addr) {
+    lifecycle_t *l = mem_malloc(sizeof(lifecycle_t) * 1, MEM_LIFECYCLE);
+    if (l == NULL) {
+        perror("malloc car lifecycle");
+        mem_free(c); /* car cannot park, leaves Sim */
+        return;
+    }
+
+    /* its stay & exit were drawn when it spawned */
+    metric_gauge_add(MET_PARKED, 1);
+    l->exit = c->exit % n_exits;
+
+    //printf("%s will now park on floor %d for %ldms\n", c->plate, c->floor + 1, c->duration);
+
+    l->car = c;
+    l->addr = addr;
+    l->state = DRIVING_IN;
+    schedule(l, sim_now_ms() + DRIVE_MS);
+}
+
+void lifecycle_resume(car_t *c, int addr, int exit, car_state_t state, double due) {
+    lifecycle_t *l = mem_malloc(sizeof(lifecycle_t) * 1, MEM_LIFECYCLE);
+    if (l == NULL) {
+        perror("malloc car lifecycle");
+        mem_free(c); /* car cannot be restored, leaves Sim */
+        return;
+    }
+
+    metric_gauge_add(MET_PARKED, 1);
+    l->car = c;
+    l->addr = addr;
+    l->exit = exit % n_exits;
+    l->state = state;
+    schedule(l, due);
+}
+
+void lifecycle_stop(lifecycle_visit_t visit) {
+    stopping = 1;
+    pthread_cond_broadcast(&ready_cond);
+    pthread_join(ticker, NULL);
+    for (int i = 0; i < n_workers; i++) pthread_join(workers[i], NULL);
+    mem_free(workers);
+    workers = NULL;
+
+    /* cars still parked or driving when the Sim ended leave with it */
+    pthread_mutex_lock(&lifecycle_lock);
+    wheel_entry_t *left = wheel_destroy(&wheel);
+    if (ready_tail != NULL) {
+        ready_tail->next = left;
+        left = ready_head;
+    }
+    ready_head = ready_tail = NULL;
+    pthread_mutex_unlock(&lifecycle_lock);
+
+    while (left != NULL) {
+        lifecycle_t *l = (lifecycle_t *)left;
+        left = left->next;
+        if (visit != NULL) visit(l->car, l->state, l->exit, l->timer.due);
+        metric_gauge_add(MET_PARKED, -1);
+        mem_free(l->car);
+        mem_free(l);
+    }
+}
+
+void lifecycle_report(void) {
+    printf("~%lu cars parked by %d workers, at most %zu inside at once, moves up to %.1fms late\n",
+        admitted, n_workers, wheel.peak, max_late);
+}
+
+/**
+ * @brief Ticker thread. Moves the wheel on every millisecond (of real
+ * time, when simulated time runs faster), handing the moves that are
+ * due to the workers.
+ *
+ * @param args - unused
+ * @return void* - NULL when stopped
+ */
+static void *tick(void *args) {
+    (void)args;
+    double period = fmax(1, sim_speed()); /* simulated ms */
+
+    while (!stopping) {
+        sim_sleep_ms(period);
+
+        PROF_LOCK(&lifecycle_lock, LK_LIFECYCLE);
+        wheel_entry_t *due = wheel_advance(&wheel, sim_now_ms());
+        int any = (due != NULL);
+        while (due != NULL) {
+            wheel_entry_t *e = due;
+            due = e->next;
+            e->next = NULL;
+            if (ready_tail == NULL) ready_head = e;
+            else ready_tail->next = e;
+            ready_tail = e;
+        }
+        PROF_UNLOCK(&lifecycle_lock, LK_LIFECYCLE);
+        if (any) pthread_cond_broadcast(&ready_cond);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Worker thread. Makes the moves that are due, 1 at a time.
+ *
+ * @param args - unused
+ * @return void* - NULL when stopped
+ */
+static void *work(void *args) {
+    (void)args;
+
+    while (!stopping) {
+        PROF_LOCK(&lifecycle_lock, LK_LIFECYCLE);
+        while (ready_head == NULL && !stopping) PROF_COND_WAIT(&ready_cond, &lifecycle_lock, LK_LIFECYCLE);
+        wheel_entry_t *e = ready_head;
+        if (e != NULL) {
+            ready_head = e->next;
+            if (ready_head == NULL) ready_tail = NULL;
+        }
+        double late = (e != NULL) ? fmax(0, sim_now_ms() - e->due) : 0; /* due within the ms is on time */
+        if (late > max_late) max_late = late;
+        PROF_UNLOCK(&lifecycle_lock, LK_LIFECYCLE);
+
+        if (e != NULL) {
+            metric_observe_us(MET_LIFECYCLE_LAG, (uint64_t)(late * 1000));
+            move((lifecycle_t *)e);
+        }
+    }
     return NULL;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Makes a car's next move, then waits for the one after, or
+ * queues it at its exit at the end of its lifecycle.
+ *
+ * @param l - car's lifecycle, freed once the car is queued
+ */
+static void move(lifecycle_t *l) {
+    car_t *c = l->car;
+
+    switch (l->state) {
+    case DRIVING_IN:
+        /* drove to its parking space, trigger LPR then park */
+        set_level_lpr(c, l->addr);
+        car_stamp(c, STAMP_PARKED);
+        l->state = PARKED;
+        schedule(l, l->timer.due + c->duration);
+        return;
+    case PARKED:
+        /* leaving, trigger LPR then drive to its exit */
+        set_level_lpr(c, l->addr);
+        l->state = DRIVING_OUT;
+        schedule(l, l->timer.due + DRIVE_MS);
+        return;
+    case DRIVING_OUT:
+        break;
+    }
+
+    /* queue up @ its exit, unless the sim has ended (Main
+    frees the exit queues once the exit threads return,
+    so checks under the queues' lock) */
+    car_stamp(c, STAMP_EX_QUEUED);
+    int queued = 0; /* 0 = no, 1 = yes */
+    PROF_METRICS_LOCK(&ex_queues_lock, LK_EX_QUEUES, MET_LOCK_EX);
+    if (!end_simulation) {
+        push_queue(ex_queues[balance_join(ex_queues, n_exits, l->exit)], c);
+        queued = 1;
+    }
+    PROF_UNLOCK(&ex_queues_lock, LK_EX_QUEUES);
+    metric_gauge_add(MET_PARKED, -1);
+    if (queued) {
+        metric_gauge_add(MET_EX_QUEUE, 1);
+        pthread_cond_broadcast(&ex_queues_cond);
+    } else {
+        mem_free(c);
+    }
+
+    /* car data flow continues to its exit */
+    mem_free(l);
+}
+
+/**
+ * @brief Puts a car in the wheel until its next move is due.
+ *
+ * @param l - car's lifecycle
+ * @param due - simulated ms of its next move
+ */
+static void schedule(lifecycle_t *l, double due) {
+    l->timer.due = due;
+    PROF_LOCK(&lifecycle_lock, LK_LIFECYCLE);
+    if (l->state == DRIVING_IN) admitted++;
+    wheel_add(&wheel, &l->timer);
+    PROF_UNLOCK(&lifecycle_lock, LK_LIFECYCLE);
+}
+
+/**
+ * @brief Writes a car's plate to its level's LPR.
+ *
+ * @param c - car
+ * @param addr - address of its level in shared memory
+ */
+static void set_level_lpr(car_t *c, int addr) {
+    level_t *lvl = (level_t *)((char *)shm + addr);
+
+    TRACE_START(reading);
+    PROF_LOCK(&lvl->sensor.lock, LK_LVL_LPR + c->floor);
+    parking_set_plate(shm, lvl->sensor.plate, c->plate);
+    lpr_capture(LPR_LEVEL, c->floor, c->plate);
+    PROF_UNLOCK(&lvl->sensor.lock, LK_LVL_LPR + c->floor);
+    TRACE_SPAN(TR_LEVEL_LPR, reading, c->plate, (uint32_t)c->seq);
+}
@@ -2,27 +2,79 @@
  * @file    car-lifecycle.h
  * @author  Johnny Madigan
  * @date    October 2021
- * @brief   API for a car's lifecycle. Only to be
- *          called by SIMULATE ENTRANCE THREADS when
- *          letting cars into the carpark. As cars
- *          move individually once inside, each car
- *          needs its own thread, especially for
- *          parking for different times simultaneously.
+ * @brief   API for a car's lifecycle. Cars are handed
+ *          over by SIMULATE ENTRANCE THREADS once they
+ *          drive in. Once a car is ready to leave, it
+ *          drives to a random exit queuing up to be billed
+ *          before leaving the Sim - all times are in
+ *          simulated milliseconds.
+ *
+ *          Cars take 10ms to drive to their parking space
+ *          Cars park for as long as the traffic profile chose (100..10000ms by default)
+ *          Cars take 10ms to drive to a random exit
+ *
+ *          Each car inside is a small state machine (a few
+ *          dozen bytes) waiting in a timer wheel for its next
+ *          move, not a thread of its own. 1 ticker thread
+ *          moves the wheel on and a fixed pool of workers
+ *          make the moves that are due, so the no. of threads
+ *          stays the same however many cars are parked.
  ***********************************************/
 #pragma once
 
+#include "queue.h"      /* for car types */
+
+/* Where a car is up to, each state ends with the next move */
+typedef enum car_state_t {
+    DRIVING_IN,         /* to its parking space, then triggers the level LPR */
+    PARKED,             /* until it leaves, then triggers the level LPR again */
+    DRIVING_OUT         /* to its exit, then queues up there */
+} car_state_t;
+
+/* Shown each car still inside when the lifecycles stop (for checkpoints) */
+typedef void (*lifecycle_visit_t)(car_t *c, car_state_t state, int exit, double due);
+
+/**
+ * @brief Starts the ticker & workers, before any car drives in.
+ *
+ * @param workers - no. of worker threads, LIFECYCLE_WORKERS after checking bounds
+ * @param exs - no. of exits cars may leave by
+ * @return int - 0 on success, -1 if it could not start (out of memory)
+ */
+int lifecycle_start(int workers, int exs);
+
+/**
+ * @brief Sends a car that just drove in off to park. Picks how long
+ * it stays (unless the traffic profile did) & which exit it leaves by.
+ *
+ * @param c - car, freed at an exit (or here if it cannot park)
+ * @param addr - address of its level in shared memory
+ */
+void lifecycle_admit(car_t *c, int addr);
+
+/**
+ * @brief Puts a car back inside where a checkpoint left it, before
+ * the entrances start.
+ *
+ * @param c - car, with its stay & stamps restored
+ * @param addr - address of its level in shared memory
+ * @param exit - exit it leaves by
+ * @param state - where it is up to
+ * @param due - simulated ms of its next move
+ */
+void lifecycle_resume(car_t *c, int addr, int exit, car_state_t state, double due);
+
+/**
+ * @brief Stops the ticker & workers, freeing any car still inside.
+ * Call once end_simulation is set & the entrances have returned,
+ * before the exit queues are freed.
+ *
+ * @param visit - shown each car still inside before it is freed, NULL = none
+ */
+void lifecycle_stop(lifecycle_visit_t visit);
+
 /**
- * @brief Authorised cars that enter (carpark not full)
- * are given their own thread so they can drive/park
- * simultaneously. Once a car is ready to leave, it
- * will drive to a random exit queuing up to be billed
- * before leaving the Sim - all times are in milliseconds. 
- * 
- * Cars take 10ms to drive to its parking space
- * Cars park for 100..10000ms
- * Cars take 10ms to drive to a random exit
- * 
- * @param car - the car
- * @return void* - NULL upon completion
+ * @brief Prints how many cars were inside at most & how late the
+ * workers made their moves.
  */
-void *car_lifecycle(void *car);
\ No newline at end of file
+void lifecycle_report(void);
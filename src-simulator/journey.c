@@ -0,0 +1,400 @@
+/************************************************
+ * @file    journey.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Source code for journey.h
+ ***********************************************/
+#include <stdio.h>          /* for IO operations */
+#include <stdint.h>         /* for int types */
+#include <string.h>         /* for telling signs apart */
+#include <stdatomic.h>      /* for atomic counters */
+#include <math.h>           /* for fmax */
+
+#include "journey.h"        /* corresponding header */
+#include "traffic.h"        /* for the no. of generators */
+#include "balance.h"        /* for the balancing mode */
+#include "../src-common/hdr-histogram.h" /* for latency histograms */
+
+#define GENERATOR_BEHIND_MS 1.0 /* p99 generator lag past which the generator is the bottleneck */
+
+/* Histograms of 1 entrance or exit, only written by its thread */
+typedef struct journey_set_t {
+    hdr_t queue_wait;   /* joined the queue -> reached the front */
+    hdr_t service;      /* reached the front -> through the gate (or turned away) */
+    hdr_t in_system;    /* spawned -> left the Sim */
+    uint64_t waited_ns; /* all queue waits, for the mean */
+    uint64_t busy_ns;   /* all service times, for utilisation */
+    uint64_t stolen;    /* cars taken from another queue */
+    uint64_t full;      /* cars turned away by an 'F' */
+    uint64_t denied;    /* cars turned away by an 'X' */
+    uint64_t evacuated; /* cars turned away by EVACUATE */
+} journey_set_t;
+
+static journey_set_t entrances[5];
+static journey_set_t exits[5];
+static hdr_t lags[TRAFFIC_MAX_GENERATORS]; /* due -> queued, only written by that generator */
+
+static double origin = 0; /* when journey_init was called (sim_now_ms) */
+
+/* Cars in & out of the system, for throughput & Little's law */
+static volatile _Atomic uint64_t arrivals = 0;
+static volatile _Atomic uint64_t restored = 0;      /* from a checkpoint, inside when the run began */
+static volatile _Atomic uint64_t departures = 0;
+static volatile _Atomic uint64_t departed_us = 0;   /* total time in system of cars that left */
+static volatile _Atomic uint64_t spawned_us = 0;    /* total spawn time (since origin) of cars inside */
+
+/* function prototypes */
+static uint64_t ns_between(car_t *c, car_stamp_t from, car_stamp_t to);
+static void depart(car_t *c);
+static void print_ms(const char *name, hdr_t *h);
+static void count_cars(int ens, int exs, uint64_t *admitted, uint64_t *exited);
+static void count_turned_away(int ens, uint64_t *full, uint64_t *denied, uint64_t *evacuated);
+static void json_sets(FILE *fp, const char *name, journey_set_t *sets, int count, double secs);
+static void merge_lags(hdr_t *into);
+static void serve(journey_set_t *j, uint64_t wait_ns, uint64_t service_ns);
+static void print_balance(const char *name, journey_set_t *sets, int count, double secs);
+
+void journey_init(void) {
+    origin = sim_now_ms();
+}
+
+void journey_arrive(car_t *c) {
+    c->duration = 0;
+    for (int i = 0; i < CAR_STAMPS; i++) c->stamps[i] = 0;
+    car_stamp(c, STAMP_SPAWNED);
+    c->seq = (int)(atomic_fetch_add(&arrivals, 1) + atomic_load(&restored)) + 1;
+    atomic_fetch_add(&spawned_us, (uint64_t)((c->stamps[STAMP_SPAWNED] - origin) * 1000));
+}
+
+void journey_restored(car_t *c) {
+    /* spawned before the run began, so adds nothing to spawned_us */
+    c->seq = (int)atomic_fetch_add(&restored, 1) + 1;
+}
+
+void journey_lag(int gen, uint64_t ns) {
+    hdr_record(&lags[gen], ns);
+}
+
+void journey_entrance(int id, car_t *c, char sign) {
+    journey_set_t *j = &entrances[id];
+    uint64_t wait = ns_between(c, STAMP_EN_QUEUED, STAMP_EN_SERVED);
+
+    if (strchr("XFEVACUATE", sign) == NULL) {
+        serve(j, wait, ns_between(c, STAMP_EN_SERVED, STAMP_ENTERED));
+    } else {
+        serve(j, wait, ns_between(c, STAMP_EN_SERVED, STAMP_SIGNED));
+        hdr_record(&j->in_system, ns_between(c, STAMP_SPAWNED, STAMP_SIGNED));
+        if (sign == 'F') j->full++;
+        else if (sign == 'X') j->denied++;
+        else if (sign != 0) j->evacuated++;
+        depart(c);
+    }
+}
+
+void journey_exit(int id, car_t *c) {
+    journey_set_t *j = &exits[id];
+
+    serve(j, ns_between(c, STAMP_EX_QUEUED, STAMP_EX_SERVED), ns_between(c, STAMP_EX_SERVED, STAMP_LEFT));
+    hdr_record(&j->in_system, ns_between(c, STAMP_SPAWNED, STAMP_LEFT));
+    depart(c);
+}
+
+void journey_entrance_stole(int id) {
+    entrances[id].stolen++;
+}
+
+void journey_exit_stole(int id) {
+    exits[id].stolen++;
+}
+
+void journey_report(int ens, int exs) {
+    double secs = (sim_now_ms() - origin) / 1000;
+    uint64_t in = atomic_load(&arrivals);
+    uint64_t before = atomic_load(&restored);
+    uint64_t out = atomic_load(&departures);
+    uint64_t inside = in + before - out;
+    uint64_t admitted = 0;
+    uint64_t exited = 0;
+
+    uint64_t full = 0;
+    uint64_t denied = 0;
+    uint64_t evacuated = 0;
+
+    count_cars(ens, exs, &admitted, &exited);
+    count_turned_away(ens, &full, &denied, &evacuated);
+    if (secs <= 0) return;
+
+    printf("~Car journeys over %.1fs: %lu arrived (%.2f/s), %lu admitted (%.2f/s), %lu turned away, %lu exited (%.2f/s), %lu still inside\n",
+        secs, (unsigned long)in, in / secs, (unsigned long)admitted, admitted / secs,
+        (unsigned long)(out - exited), (unsigned long)exited, exited / secs, (unsigned long)inside);
+    if (before > 0) printf("~%lu cars were restored from a checkpoint, inside the system when the run began\n", (unsigned long)before);
+    if (out > exited) {
+        printf("~Turned away: %lu as the car park was full ('F'), %lu not authorised ('X'), %lu evacuating, %lu as the Sim ended\n",
+            (unsigned long)full, (unsigned long)denied, (unsigned long)evacuated, (unsigned long)(out - exited - full - denied - evacuated));
+    }
+
+    /* -----------------------------------------------
+     *       GENERATOR LAG - WAS THE GENERATOR ITSELF
+     *       THE BOTTLENECK, QUEUEING CARS LATE?
+     * -------------------------------------------- */
+    static hdr_t lag; /* 18KB, kept off the stack */
+    merge_lags(&lag);
+    if (lag.total > 0) {
+        double p99 = (double)hdr_percentile(&lag, 99) / 1000000;
+        hdr_print(stdout, "generator lag (due -> queued)", &lag);
+        if (p99 > GENERATOR_BEHIND_MS) {
+            printf("~The generator fell behind its schedule (p99 %.2fms late), add GENERATORS or lower the rates\n", p99);
+        }
+    }
+
+    for (int i = 0; i < ens; i++) {
+        journey_set_t *j = &entrances[i];
+        printf("~Entrance %d: %.1f%% busy, %lu cars taken from other queues\n", i + 1,
+            (double)j->busy_ns / (secs * 1e7), (unsigned long)j->stolen);
+        print_ms("queue wait", &j->queue_wait);
+        print_ms("service", &j->service);
+        print_ms("in system (turned away)", &j->in_system);
+    }
+    for (int i = 0; i < exs; i++) {
+        journey_set_t *j = &exits[i];
+        printf("~Exit %d: %.1f%% busy, %lu cars taken from other queues\n", i + 1,
+            (double)j->busy_ns / (secs * 1e7), (unsigned long)j->stolen);
+        print_ms("queue wait", &j->queue_wait);
+        print_ms("service", &j->service);
+        print_ms("in system", &j->in_system);
+    }
+
+    /* -----------------------------------------------
+     *   BALANCING - HOW EVENLY THE GATES WERE BUSY &
+     *   THE WAIT OF ALL QUEUES, TO COMPARE THE MODES
+     * -------------------------------------------- */
+    printf("~Queues balanced by %s (BALANCE_MODE):\n", balance_name());
+    print_balance("entrances", entrances, ens, secs);
+    print_balance("exits", exits, exs, secs);
+
+    /* -----------------------------------------------
+     *                  LITTLE'S LAW
+     * -----------------------------------------------
+     * L = lambda x W. The average no. of cars inside (L)
+     * is the area under cars-inside over time, divided by
+     * time. Each car that left adds its whole time inside,
+     * each car still inside adds the time since it spawned.
+     * W only comes from cars that left, so the 2 sides only
+     * agree once the run is long next to the time inside.
+     */
+    if (out == 0) return;
+    double area_us = (double)atomic_load(&departed_us) + ((double)inside * secs * 1000000) - (double)atomic_load(&spawned_us);
+    double l = area_us / (secs * 1000000);
+    double lambda = in / secs;
+    double w = (double)atomic_load(&departed_us) / (double)out / 1000000;
+    double lw = lambda * w;
+
+    printf("~Little's law: L = %.2f cars inside on average, lambda x W = %.2f/s x %.3fs = %.2f cars (%.1f%% apart)\n",
+        l, lambda, w, lw, (l > 0) ? ((lw - l) / l) * 100 : 0.0);
+}
+
+void journey_json(FILE *fp, int ens, int exs, int rate) {
+    static hdr_t merged; /* 18KB, kept off the stack */
+    double secs = (sim_now_ms() - origin) / 1000;
+    uint64_t in = atomic_load(&arrivals);
+    uint64_t before = atomic_load(&restored);
+    uint64_t out = atomic_load(&departures);
+    uint64_t admitted = 0;
+    uint64_t exited = 0;
+
+    uint64_t full = 0;
+    uint64_t denied = 0;
+    uint64_t evacuated = 0;
+
+    count_cars(ens, exs, &admitted, &exited);
+    count_turned_away(ens, &full, &denied, &evacuated);
+    if (secs <= 0) secs = 1;
+
+    fprintf(fp, "{\n  \"seconds\": %.3f,\n  \"arrival_rate\": %d,\n  \"balance_mode\": \"%s\",\n", secs, rate, balance_name());
+    fprintf(fp, "  \"cars\": {\"arrived\": %lu, \"admitted\": %lu, \"turned_away\": %lu, \"full\": %lu, \"denied\": %lu, \"evacuated\": %lu, \"exited\": %lu, \"inside\": %lu, \"restored\": %lu},\n",
+        (unsigned long)in, (unsigned long)admitted, (unsigned long)(out - exited), (unsigned long)full, (unsigned long)denied,
+        (unsigned long)evacuated, (unsigned long)exited, (unsigned long)(in + before - out), (unsigned long)before);
+    fprintf(fp, "  \"per_second\": {\"arrived\": %.3f, \"admitted\": %.3f, \"turned_away\": %.3f, \"exited\": %.3f},\n",
+        in / secs, admitted / secs, (out - exited) / secs, exited / secs);
+
+    merge_lags(&merged);
+    fprintf(fp, "  \"generator_lag\": ");
+    hdr_json(fp, &merged);
+    fprintf(fp, ",\n");
+
+    /* every entrance/exit merged, 1 histogram at a time */
+    const char *names[3] = {"queue_wait", "service", "in_system"};
+    for (int side = 0; side < 2; side++) {
+        journey_set_t *sets = (side == 0) ? entrances : exits;
+        int count = (side == 0) ? ens : exs;
+
+        for (int k = 0; k < 3; k++) {
+            hdr_reset(&merged);
+            for (int i = 0; i < count; i++) {
+                hdr_t *h = (k == 0) ? &sets[i].queue_wait : (k == 1) ? &sets[i].service : &sets[i].in_system;
+                hdr_merge(&merged, h);
+            }
+            fprintf(fp, "  \"%s_%s\": ", (side == 0) ? "entrance" : "exit", names[k]);
+            hdr_json(fp, &merged);
+            fprintf(fp, ",\n");
+        }
+    }
+    json_sets(fp, "entrances", entrances, ens, secs);
+    fprintf(fp, ",\n");
+    json_sets(fp, "exits", exits, exs, secs);
+    fprintf(fp, "\n}\n");
+}
+
+/**
+ * @brief Measures the time between 2 stages of a car's journey.
+ *
+ * @param c - car
+ * @param from - earlier stage
+ * @param to - later stage
+ * @return uint64_t - ns, 0 if either stage was never stamped
+ */
+static uint64_t ns_between(car_t *c, car_stamp_t from, car_stamp_t to) {
+    double ms = c->stamps[to] - c->stamps[from];
+
+    if (c->stamps[from] == 0 || c->stamps[to] == 0 || ms < 0) return 0;
+    return (uint64_t)(ms * 1000000);
+}
+
+/**
+ * @brief Counts a car as having left the system.
+ *
+ * @param c - car, stamped as spawned & as its last stage
+ */
+static void depart(car_t *c) {
+    double left = (c->stamps[STAMP_LEFT] != 0) ? c->stamps[STAMP_LEFT] : c->stamps[STAMP_SIGNED];
+    uint64_t spawned = (uint64_t)(fmax(0, c->stamps[STAMP_SPAWNED] - origin) * 1000); /* restored cars were inside from the start */
+
+    atomic_fetch_add(&departures, 1);
+    atomic_fetch_add(&departed_us, (uint64_t)(fmax(0, left - origin) * 1000) - spawned);
+    atomic_fetch_sub(&spawned_us, spawned);
+}
+
+/**
+ * @brief Prints 1 line with the count, p50, p90, p99, p99.9 & max
+ * in milliseconds, nothing if the histogram is empty.
+ *
+ * @param name - what the values are
+ * @param h - histogram to print
+ */
+static void print_ms(const char *name, hdr_t *h) {
+    if (h->total > 0) {
+        printf("\t%-24s %8lu  p50 %9.1fms  p90 %9.1fms  p99 %9.1fms  p99.9 %9.1fms  max %9.1fms\n",
+            name, (unsigned long)h->total,
+            hdr_percentile(h, 50) / 1e6, hdr_percentile(h, 90) / 1e6,
+            hdr_percentile(h, 99) / 1e6, hdr_percentile(h, 99.9) / 1e6, h->max / 1e6);
+    }
+}
+
+/**
+ * @brief Counts the cars that drove in at an entrance and that left
+ * through an exit, from the histograms of each.
+ *
+ * @param ens - no. of entrances
+ * @param exs - no. of exits
+ * @param admitted - set to cars admitted
+ * @param exited - set to cars exited
+ */
+static void count_cars(int ens, int exs, uint64_t *admitted, uint64_t *exited) {
+    for (int i = 0; i < ens; i++) *admitted += entrances[i].service.total - entrances[i].in_system.total;
+    for (int i = 0; i < exs; i++) *exited += exits[i].in_system.total;
+}
+
+/**
+ * @brief Counts the cars turned away because the car park was full,
+ * because their plate was not authorised and because of a fire. The
+ * rest were still at the sign when the Sim ended.
+ *
+ * @param ens - no. of entrances
+ * @param full - set to cars turned away by an 'F'
+ * @param denied - set to cars turned away by an 'X'
+ * @param evacuated - set to cars turned away by EVACUATE
+ */
+static void count_turned_away(int ens, uint64_t *full, uint64_t *denied, uint64_t *evacuated) {
+    for (int i = 0; i < ens; i++) {
+        *full += entrances[i].full;
+        *denied += entrances[i].denied;
+        *evacuated += entrances[i].evacuated;
+    }
+}
+
+/**
+ * @brief Writes the queue wait, utilisation & cars stolen of each
+ * entrance or exit as a JSON array, to show how evenly cars spread
+ * over them.
+ *
+ * @param fp - where to write
+ * @param name - name of the array
+ * @param sets - 1 set per entrance or exit
+ * @param count - no. of sets
+ * @param secs - length of the run, simulated seconds
+ */
+static void json_sets(FILE *fp, const char *name, journey_set_t *sets, int count, double secs) {
+    fprintf(fp, "  \"%s\": [", name);
+    for (int i = 0; i < count; i++) {
+        fprintf(fp, "%s\n    {\"utilisation\": %.4f, \"stolen\": %lu, \"queue_wait\": ", (i > 0) ? "," : "",
+            (double)sets[i].busy_ns / (secs * 1e9), (unsigned long)sets[i].stolen);
+        hdr_json(fp, &sets[i].queue_wait);
+        fprintf(fp, "}");
+    }
+    fprintf(fp, "\n  ]");
+}
+
+/**
+ * @brief Merges every generator's lag into 1 histogram.
+ *
+ * @param into - histogram to fill, reset first
+ */
+static void merge_lags(hdr_t *into) {
+    hdr_reset(into);
+    for (int i = 0; i < TRAFFIC_MAX_GENERATORS; i++) hdr_merge(into, &lags[i]);
+}
+
+/**
+ * @brief Records a car served by an entrance or exit.
+ *
+ * @param j - the entrance's or exit's set
+ * @param wait_ns - joined the queue -> reached the front
+ * @param service_ns - reached the front -> through the gate (or turned away)
+ */
+static void serve(journey_set_t *j, uint64_t wait_ns, uint64_t service_ns) {
+    hdr_record(&j->queue_wait, wait_ns);
+    hdr_record(&j->service, service_ns);
+    j->waited_ns += wait_ns;
+    j->busy_ns += service_ns;
+}
+
+/**
+ * @brief Prints 1 line for all entrances or exits: the least & most busy
+ * gate, the mean & p99 queue wait of every queue merged, and the cars
+ * taken from other queues.
+ *
+ * @param name - "entrances" or "exits"
+ * @param sets - 1 set per entrance or exit
+ * @param count - no. of sets
+ * @param secs - length of the run, simulated seconds
+ */
+static void print_balance(const char *name, journey_set_t *sets, int count, double secs) {
+    static hdr_t waits; /* 18KB, kept off the stack */
+    uint64_t waited = 0;
+    uint64_t stolen = 0;
+    double least = 100;
+    double most = 0;
+
+    hdr_reset(&waits);
+    for (int i = 0; i < count; i++) {
+        double busy = (double)sets[i].busy_ns / (secs * 1e7);
+        if (busy < least) least = busy;
+        if (busy > most) most = busy;
+        hdr_merge(&waits, &sets[i].queue_wait);
+        waited += sets[i].waited_ns;
+        stolen += sets[i].stolen;
+    }
+    printf("\t%-9s %.1f..%.1f%% busy, queue wait mean %.1fms p99 %.1fms max %.1fms, %lu cars taken from other queues\n",
+        name, least, most, (waits.total > 0) ? (double)waited / (double)waits.total / 1e6 : 0.0,
+        hdr_percentile(&waits, 99) / 1e6, waits.max / 1e6, (unsigned long)stolen);
+}
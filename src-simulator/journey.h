@@ -0,0 +1,142 @@
+/************************************************
+ * @file    journey.h
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   API for timing each car's journey through the
+ *          car park, for capacity planning.
+ *
+ *          Every car is timestamped at each stage (see
+ *          car_stamp_t in queue.h). When a car leaves an
+ *          entrance or exit, that entrance's or exit's thread
+ *          records its queue wait, service time (front of the
+ *          queue -> through the gate or turned away) and, if
+ *          it is leaving the Sim, its total time in the system
+ *          into HDR histograms only that thread writes.
+ *
+ *          Each entrance & exit also adds up how long its
+ *          gate was busy (utilisation) and its queue waits
+ *          (mean), and counts the cars it took from the
+ *          other queues when balancing (see balance.h).
+ *
+ *          The car generators record how late they queued
+ *          each car after it was due, so a generator that
+ *          cannot keep up with its schedule is noticed.
+ *
+ *          Every time is simulated (see sim-clock.h), so rates
+ *          are per simulated second whatever the SPEED.
+ *
+ *          At the end of a run, journey_report prints the
+ *          histograms, throughput, and checks Little's law
+ *          (cars inside = arrival rate x time inside), and
+ *          journey_json writes the same figures for ./LOAD-TEST.
+ ***********************************************/
+#pragma once
+
+#include <stdio.h>      /* for FILE type */
+#include <stdint.h>     /* for int types */
+
+#include "queue.h"      /* for car types */
+#include "../src-common/sim-clock.h" /* for timestamps */
+
+/**
+ * @brief Starts the clock that throughput is measured against,
+ * before any car spawns.
+ */
+void journey_init(void);
+
+/**
+ * @brief Timestamps a stage of a car's journey, in simulated time.
+ *
+ * @param c - car
+ * @param s - stage just reached
+ */
+static inline void car_stamp(car_t *c, car_stamp_t s) {
+    c->stamps[s] = sim_now_ms();
+}
+
+/**
+ * @brief Counts a newly spawned car as inside the system, clearing
+ * its stamps then stamping it as spawned & numbering it.
+ *
+ * @param c - new car
+ */
+void journey_arrive(car_t *c);
+
+/**
+ * @brief Counts a car restored from a checkpoint as inside the system
+ * since the run began & numbers it, keeping its stamps. Only called
+ * before the first car spawns.
+ *
+ * @param c - restored car
+ */
+void journey_restored(car_t *c);
+
+/**
+ * @brief Records how late a car was queued at its entrance after it
+ * was due (open loop arrivals only), only called by that generator.
+ *
+ * @param gen - generator 0..TRAFFIC_MAX_GENERATORS-1
+ * @param ns - queued minus due, in ns
+ */
+void journey_lag(int gen, uint64_t ns);
+
+/**
+ * @brief Records a car leaving an entrance, either through the gate
+ * or turned away (leaving the system), only called by that
+ * entrance's thread.
+ *
+ * @param id - entrance 0..4
+ * @param c - car, stamped up to STAMP_ENTERED or STAMP_SIGNED
+ * @param sign - what the sign showed, a level if it drove in, 'F' (full),
+ * 'X' (denied), a letter of EVACUATE or nothing (the Sim ended) if turned away
+ */
+void journey_entrance(int id, car_t *c, char sign);
+
+/**
+ * @brief Records a car leaving the system through an exit, only
+ * called by that exit's thread.
+ *
+ * @param id - exit 0..4
+ * @param c - car, stamped up to STAMP_LEFT
+ */
+void journey_exit(int id, car_t *c);
+
+/**
+ * @brief Counts a car an entrance took from another entrance's queue,
+ * only called by that entrance's thread.
+ *
+ * @param id - entrance 0..4
+ */
+void journey_entrance_stole(int id);
+
+/**
+ * @brief Counts a car an exit took from another exit's queue, only
+ * called by that exit's thread.
+ *
+ * @param id - exit 0..4
+ */
+void journey_exit_stole(int id);
+
+/**
+ * @brief Prints the queue wait, service time & time in system of
+ * every entrance & exit, how busy each was, how cars were balanced
+ * between them, throughput, and how well the cars inside
+ * match Little's law. Only called once every thread has returned.
+ *
+ * @param ens - ENTRANCES after checking bounds
+ * @param exs - EXITS after checking bounds
+ */
+void journey_report(int ens, int exs);
+
+/**
+ * @brief Writes the run's throughput and the queue wait, service time &
+ * time in system of all entrances & exits merged (and each entrance's &
+ * exit's queue wait, utilisation & cars stolen) as 1 JSON object. Only called once every thread
+ * has returned.
+ *
+ * @param fp - where to write
+ * @param ens - ENTRANCES after checking bounds
+ * @param exs - EXITS after checking bounds
+ * @param rate - ARRIVAL_RATE after checking bounds, 0 if not fixed
+ */
+void journey_json(FILE *fp, int ens, int exs, int rate);
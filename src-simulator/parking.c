@@ -13,6 +13,7 @@
 #include <unistd.h>     /* for misc */
 
 #include "parking.h"    /* corresponding header */
+#include "../src-common/mem-account.h" /* for accounting memory */
 
 volatile void *create_shared_memory(char *name, size_t size) {
 
@@ -64,7 +65,7 @@ void init_shared_memory(volatile void *shm, int entrances, int exits, int levels
      * PLACED SIDE BY SIDE
      * -------------------------------------------- */
     for (int i = 0; i < entrances; i++) {
-        entrance_t *en = malloc(sizeof(entrance_t) * 1);
+        entrance_t *en = mem_malloc(sizeof(entrance_t) * 1, MEM_OTHER);
 
         /* apply attribute to mutexes & conditions for this entrance */
         pthread_mutex_init(&en->sensor.lock, &mattr);
@@ -77,7 +78,7 @@ void init_shared_memory(volatile void *shm, int entrances, int exits, int levels
         memcpy((char *)shm + offset, en, sizeof(entrance_t) * 1);
         offset += sizeof(entrance_t);
         /* as we copied items in, we no longer need to keep the original */
-        free(en);
+        mem_free(en);
     }
 
     /* for debugging...
@@ -90,7 +91,7 @@ void init_shared_memory(volatile void *shm, int entrances, int exits, int levels
      * PLACED SIDE BY SIDE
      * -------------------------------------------- */
     for (int i = 0; i < exits; i++) {
-        exit_t *ex = malloc(sizeof(exit_t) * 1);
+        exit_t *ex = mem_malloc(sizeof(exit_t) * 1, MEM_OTHER);
 
         /* apply attribute to mutexes & conditions for this exit */
         pthread_mutex_init(&ex->sensor.lock, &mattr);
@@ -102,7 +103,7 @@ void init_shared_memory(volatile void *shm, int entrances, int exits, int levels
         offset += sizeof(exit_t);
 
         /* as we copied items in, we no longer need to keep the original */
-        free(ex);
+        mem_free(ex);
     }
 
     /* -----------------------------------------------
@@ -111,7 +112,7 @@ void init_shared_memory(volatile void *shm, int entrances, int exits, int levels
      * PLACED SIDE BY SIDE
      * -------------------------------------------- */
     for (int i = 0; i < levels; i++) {
-        level_t *lvl = malloc(sizeof(level_t) * 1);
+        level_t *lvl = mem_malloc(sizeof(level_t) * 1, MEM_OTHER);
 
         /* apply attribute to mutexes & conditions for this level */
         pthread_mutex_init(&lvl->sensor.lock, &mattr);
@@ -121,7 +122,7 @@ void init_shared_memory(volatile void *shm, int entrances, int exits, int levels
         offset += sizeof(level_t);
 
         /* as we copied items in, we no longer need to keep the original */
-        free(lvl);
+        mem_free(lvl);
     }
 
     /* -----------------------------------------------
@@ -9,22 +9,25 @@
 #include <stdbool.h>    /* for bool type */
 
 #include "queue.h"      /* corresponding header */
+#include "../src-common/mem-account.h" /* for accounting memory */
 
 void init_queue(queue_t *q) {
     q->head = NULL;
     q->tail = NULL;
+    q->length = 0;
 }
 
 bool push_queue(queue_t *q, car_t *c) {
 
-    node_t *new_node = malloc(sizeof(node_t) * 1);
-    new_node->car = c;
-    new_node->next = NULL;
+    node_t *new_node = mem_malloc(sizeof(node_t) * 1, MEM_QUEUE);
 
     if (new_node == NULL) {
         puts("malloc failed for adding node to queue");
         return false;
     }
+    new_node->car = c;
+    new_node->next = NULL;
+    new_node->prev = q->tail;
 
     /* add car to the back of the line */
     if (q->tail != NULL) q->tail->next = new_node;
@@ -33,6 +36,7 @@ bool push_queue(queue_t *q, car_t *c) {
     /* if the queue was empty, the car will also be the head */
     if (q->head == NULL) q->head = new_node;
 
+    q->length++;
     return true;
 }
 
@@ -48,9 +52,31 @@ car_t *pop_queue(queue_t *q) {
     /* pop it */
     q->head = q->head->next;
     if (q->head == NULL) q->tail = NULL;
+    else q->head->prev = NULL;
+    q->length--;
     
     /* free it */
-    free(temp);
+    mem_free(temp);
+    return c;
+}
+
+car_t *steal_queue(queue_t *q) {
+
+    /* if queue is empty, abandon */
+    if (q->tail == NULL) return NULL;
+
+    /* store the car so we can still return it after we take it */
+    node_t *temp = q->tail;
+    car_t *c = temp->car;
+
+    /* take it from the back of the line */
+    q->tail = q->tail->prev;
+    if (q->tail == NULL) q->head = NULL;
+    else q->tail->next = NULL;
+    q->length--;
+
+    /* free it */
+    mem_free(temp);
     return c;
 }
 
@@ -72,8 +98,10 @@ void empty_queue(queue_t *q) {
     while (current != NULL) {
         node_t *temp = current;
         current = current->next;
-        free(temp);
+        mem_free(temp->car); /* car never left the queue */
+        mem_free(temp);
     }
     q->head = NULL;
     q->tail = NULL;
+    q->length = 0;
 }
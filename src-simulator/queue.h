@@ -10,20 +10,39 @@
 #include <pthread.h>    /* for mutexes and conditions */
 #include <stdbool.h>    /* for bool type */
 
+/* Stages of a car's journey, each timestamped on the car (see journey.h) */
+typedef enum car_stamp_t {
+    STAMP_SPAWNED,      /* created */
+    STAMP_EN_QUEUED,    /* joined an entrance queue */
+    STAMP_EN_SERVED,    /* reached the front, driving up to the LPR */
+    STAMP_SIGNED,       /* read the entrance sign */
+    STAMP_ENTERED,      /* drove through the entrance gate */
+    STAMP_PARKED,       /* triggered its level's LPR */
+    STAMP_EX_QUEUED,    /* joined an exit queue */
+    STAMP_EX_SERVED,    /* reached the front, driving up to the LPR */
+    STAMP_LEFT,         /* drove through the exit gate */
+    CAR_STAMPS          /* no. of stages */
+} car_stamp_t;
+
 typedef struct car_t {
     char plate[7];  /* 6 chars +1 for string null terminator */
     int floor;      /* keep note of assigned floor */
-    long duration;  /* milliseconds */
+    long duration;  /* milliseconds parked */
+    int exit;       /* exit it will leave by */
+    int seq;        /* spawned n-th, joins the car's trace spans across programs */
+    double stamps[CAR_STAMPS]; /* when each stage was reached (sim_now_ms), 0 = not yet */
 } car_t;
 
 typedef struct node_t {
     car_t *car;
     struct node_t *next;
+    struct node_t *prev;    /* car in front, so the back can be stolen */
 } node_t;
 
 typedef struct queue_t {
     node_t *head;   /* front of the line */
     node_t *tail;   /* back of the line */
+    int length;     /* cars in the line */
 } queue_t;
 
 /**
@@ -52,6 +71,15 @@ bool push_queue(queue_t *q, car_t *c);
  */
 car_t *pop_queue(queue_t *q);
 
+/**
+ * @brief Takes the car at the back of the queue, the one that would
+ * wait longest, for another entrance or exit to serve instead.
+ *
+ * @param q - queue to take from
+ * @return car_t* - car at the back of the queue, NULL if empty
+ */
+car_t *steal_queue(queue_t *q);
+
 /**
  * @brief Prints all cars' license plates in a queue
  * 
@@ -60,8 +88,8 @@ car_t *pop_queue(queue_t *q);
 void print_queue(queue_t *q);
 
 /**
- * @brief Empties a queue by freeing all items, where the head
- * and tail become NULL again.
+ * @brief Empties a queue by freeing all items & the cars still
+ * waiting in it, where the head and tail become NULL again.
  * 
  * @param q - queue to empty
  */
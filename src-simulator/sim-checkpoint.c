@@ -0,0 +1,241 @@
+/************************************************
+ * @file    sim-checkpoint.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Source code for sim-checkpoint.h
+ ***********************************************/
+#include <stdio.h>          /* for IO operations */
+#include <string.h>         /* for string operations */
+#include <stdatomic.h>      /* for reading the run */
+
+#include "sim-checkpoint.h" /* corresponding header */
+#include "parking.h"        /* for shared memory types */
+#include "sim-common.h"     /* for the queues */
+#include "sim-metrics.h"    /* for the queue gauges */
+#include "journey.h"        /* for counting restored cars */
+#include "../src-common/checkpoint.h" /* for the checkpoint file */
+#include "../src-common/mem-account.h" /* for accounting memory */
+#include "../src-common/parking-status.h" /* for the run */
+#include "../src-common/sim-clock.h" /* for simulated time */
+
+/* cars to save, kept as the lifecycles stop & then as the queues are read */
+static checkpoint_car_t *kept = NULL;
+static uint32_t n_kept = 0;
+static uint32_t room = 0;   /* cars kept can grow to before a realloc */
+
+/* each level's temperature in the restored checkpoint, 0 = none */
+static int temps[CHECKPOINT_LEVELS];
+
+/* function prototypes */
+static int keep(const car_t *c, checkpoint_place_t place, int index, int state, double due);
+static int keep_queues(queue_t **qs, int n, checkpoint_place_t place);
+static car_t *restore_car(const checkpoint_car_t *from, double at);
+
+int sim_checkpoint_restore(const char *path, int ens, int exs, int lvls, int cap) {
+    uint64_t run = 0;
+    size_t size = 0;
+    checkpoint_sim_t *part = checkpoint_read(path, CHECKPOINT_SIMULATOR, &run, &size);
+
+    if (part == NULL) {
+        printf("~No Simulator checkpoint in %s, starting empty\n", path);
+        return -1;
+    }
+    if (size < sizeof(*part) || part->devices != PARKING_STATUS_OFFSET
+        || size != sizeof(*part) + part->devices + (size_t)part->cars * sizeof(checkpoint_car_t)) {
+        printf("~Simulator checkpoint in %s is damaged, starting empty\n", path);
+        mem_free(part);
+        return -1;
+    }
+    if (part->ens != ens || part->exs != exs || part->lvls != lvls || part->cap != cap) {
+        printf("~Checkpoint in %s is of %d entrances, %d exits & %d levels of %d, starting empty\n",
+            path, part->ens, part->exs, part->lvls, part->cap);
+        mem_free(part);
+        return -1;
+    }
+
+    /* -----------------------------------------------
+     *   EACH LEVEL'S TEMPERATURE FROM THE DEVICES
+     * -------------------------------------------- */
+    const char *devices = (const char *)(part + 1);
+    int levels_addr = (int)((sizeof(entrance_t) * ens) + (sizeof(exit_t) * exs));
+    for (int i = 0; i < lvls; i++) {
+        const level_t *l = (const level_t *)(devices + levels_addr + (sizeof(level_t) * i));
+        temps[i] = l->temp_sensor;
+    }
+
+    /* -----------------------------------------------
+     *  EVERY CAR BACK WHERE IT WAS, QUEUES IN ORDER
+     * -------------------------------------------- */
+    const checkpoint_car_t *cars = (const checkpoint_car_t *)(devices + part->devices);
+    int placed[3] = {0, 0, 0}; /* per checkpoint_place_t */
+
+    for (uint32_t i = 0; i < part->cars; i++) {
+        const checkpoint_car_t *from = &cars[i];
+        if (from->place < CHECKPOINT_EN_QUEUE || from->place > CHECKPOINT_EX_QUEUE || from->index < 0) continue;
+        if (from->place == CHECKPOINT_INSIDE && (from->floor < 0 || from->floor >= lvls
+            || from->state < DRIVING_IN || from->state > DRIVING_OUT)) continue;
+
+        car_t *c = restore_car(from, part->at);
+        if (c == NULL) {
+            perror("malloc restored car");
+            break;
+        }
+        journey_restored(c);
+
+        switch (from->place) {
+        case CHECKPOINT_EN_QUEUE:
+            pthread_mutex_lock(&en_queues_lock);
+            push_queue(en_queues[from->index % ens], c);
+            pthread_mutex_unlock(&en_queues_lock);
+            metric_gauge_add(MET_EN_QUEUE, 1);
+            break;
+        case CHECKPOINT_EX_QUEUE:
+            pthread_mutex_lock(&ex_queues_lock);
+            push_queue(ex_queues[from->index % exs], c);
+            pthread_mutex_unlock(&ex_queues_lock);
+            metric_gauge_add(MET_EX_QUEUE, 1);
+            break;
+        default:
+            lifecycle_resume(c, levels_addr + (int)(sizeof(level_t) * from->floor), from->index,
+                (car_state_t)from->state, checkpoint_rebase(from->due, part->at));
+            break;
+        }
+        placed[from->place]++;
+    }
+
+    printf("~Restored %d cars from %s: %d waiting at entrances, %d inside, %d waiting at exits\n",
+        placed[0] + placed[1] + placed[2], path, placed[CHECKPOINT_EN_QUEUE],
+        placed[CHECKPOINT_INSIDE], placed[CHECKPOINT_EX_QUEUE]);
+    mem_free(part);
+    return placed[0] + placed[1] + placed[2];
+}
+
+int sim_checkpoint_temperature(int level) {
+    return (level >= 0 && level < CHECKPOINT_LEVELS) ? temps[level] : 0;
+}
+
+void sim_checkpoint_keep(car_t *c, car_state_t state, int exit, double due) {
+    if (keep(c, CHECKPOINT_INSIDE, exit, (int)state, due) != 0) perror("malloc checkpoint car");
+}
+
+int sim_checkpoint_save(const char *path, int ens, int exs, int lvls, int cap) {
+    /* -----------------------------------------------
+     *   THE QUEUED CARS AFTER THE CARS INSIDE, EACH
+     *   LINE FROM ITS FRONT
+     * -------------------------------------------- */
+    pthread_mutex_lock(&en_queues_lock);
+    int ok = keep_queues(en_queues, ens, CHECKPOINT_EN_QUEUE);
+    pthread_mutex_unlock(&en_queues_lock);
+
+    pthread_mutex_lock(&ex_queues_lock);
+    ok = ok && keep_queues(ex_queues, exs, CHECKPOINT_EX_QUEUE);
+    pthread_mutex_unlock(&ex_queues_lock);
+
+    /* -----------------------------------------------
+     *      THEN THE PART: SIZES, DEVICES & CARS
+     * -------------------------------------------- */
+    size_t size = sizeof(checkpoint_sim_t) + PARKING_STATUS_OFFSET + (sizeof(checkpoint_car_t) * n_kept);
+    checkpoint_sim_t *part = ok ? mem_malloc(size, MEM_CHECKPOINT) : NULL;
+    int saved = -1;
+
+    if (part != NULL) {
+        part->at = sim_now_ms();
+        part->ens = ens;
+        part->exs = exs;
+        part->lvls = lvls;
+        part->cap = cap;
+        part->devices = PARKING_STATUS_OFFSET;
+        part->cars = n_kept;
+        memcpy((char *)(part + 1), (const char *)shm, PARKING_STATUS_OFFSET);
+        memcpy((char *)(part + 1) + PARKING_STATUS_OFFSET, kept, sizeof(checkpoint_car_t) * n_kept);
+
+        uint64_t run = atomic_load(&parking_status(shm)->clock.origin);
+        if (checkpoint_write(path, CHECKPOINT_SIMULATOR, run, part, size) == 0) {
+            printf("~Checkpoint of %u cars saved to %s\n", n_kept, path);
+            saved = (int)n_kept;
+        }
+        mem_free(part);
+    } else {
+        perror("malloc checkpoint");
+    }
+
+    if (kept != NULL) mem_free(kept);
+    kept = NULL;
+    n_kept = room = 0;
+    return saved;
+}
+
+/**
+ * @brief Adds a car to the cars to save, its times as they are.
+ *
+ * @param c - car
+ * @param place - where it is
+ * @param index - entrance or exit it waits at, or the exit it will leave by
+ * @param state - its lifecycle state when inside, otherwise 0
+ * @param due - simulated ms of its next move when inside, otherwise 0
+ * @return int - 0 on success, -1 if out of memory
+ */
+static int keep(const car_t *c, checkpoint_place_t place, int index, int state, double due) {
+    if (n_kept == room) {
+        uint32_t more = (room == 0) ? 64 : room * 2;
+        checkpoint_car_t *grown = mem_realloc(kept, sizeof(checkpoint_car_t) * more, MEM_CHECKPOINT);
+        if (grown == NULL) return -1;
+        kept = grown;
+        room = more;
+    }
+
+    checkpoint_car_t *to = &kept[n_kept++];
+    memset(to, 0, sizeof(*to));
+    memcpy(to->plate, c->plate, sizeof(c->plate));
+    to->place = place;
+    to->index = index;
+    to->floor = c->floor;
+    to->state = state;
+    to->seq = c->seq;
+    to->exit = c->exit;
+    to->duration = (double)c->duration;
+    to->due = due;
+    for (int s = 0; s < CAR_STAMPS && s < CHECKPOINT_STAMPS; s++) to->stamps[s] = c->stamps[s];
+    return 0;
+}
+
+/**
+ * @brief Adds every car waiting in a set of queues to the cars to
+ * save. Called under the queues' lock.
+ *
+ * @param qs - entrance or exit queues
+ * @param n - no. of queues
+ * @param place - CHECKPOINT_EN_QUEUE or CHECKPOINT_EX_QUEUE
+ * @return int - 1 on success, 0 if out of memory
+ */
+static int keep_queues(queue_t **qs, int n, checkpoint_place_t place) {
+    for (int i = 0; i < n; i++) {
+        for (node_t *node = qs[i]->head; node != NULL; node = node->next) {
+            if (keep(node->car, place, i, 0, 0) != 0) return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Makes a car from a checkpoint, its times moved to this run's
+ * clock. It is numbered again as it joins this run (journey_restored).
+ *
+ * @param from - car in the checkpoint
+ * @param at - sim_now_ms the checkpoint was taken
+ * @return car_t* - the car, NULL if out of memory
+ */
+static car_t *restore_car(const checkpoint_car_t *from, double at) {
+    car_t *c = mem_malloc(sizeof(car_t) * 1, MEM_CAR);
+    if (c == NULL) return NULL;
+
+    memcpy(c->plate, from->plate, sizeof(c->plate));
+    c->plate[sizeof(c->plate) - 1] = '\0';
+    c->floor = from->floor;
+    c->duration = (long)from->duration;
+    c->exit = (from->exit >= 0) ? from->exit : 0;
+    for (int s = 0; s < CAR_STAMPS; s++) {
+        c->stamps[s] = (s < CHECKPOINT_STAMPS) ? checkpoint_rebase(from->stamps[s], at) : 0;
+    }
+    return c;
+}
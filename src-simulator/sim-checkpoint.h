@@ -0,0 +1,73 @@
+/************************************************
+ * @file    sim-checkpoint.h
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   API for the Simulator's part of the checkpoint
+ *          file (see checkpoint.h).
+ *
+ *          Saving, at the end of a run once every thread has
+ *          returned: the cars still inside are kept as the
+ *          lifecycles stop (sim_checkpoint_keep), then the cars
+ *          waiting in the entrance & exit queues (in line
+ *          order) and the PARKING devices are added to them.
+ *
+ *          Restoring, once the lifecycles have started & before
+ *          the entrances, exits & car generators do: queued cars
+ *          rejoin their line, cars inside carry on driving in,
+ *          parking (for what is left of their stay) or driving
+ *          out, and each level's temperature carries on from
+ *          where it was. Every time is moved to this run's clock
+ *          as if the checkpoint was taken at simulated 0.
+ ***********************************************/
+#pragma once
+
+#include "queue.h"          /* for car types */
+#include "car-lifecycle.h"  /* for lifecycle states */
+
+/**
+ * @brief Puts the cars of a checkpoint back where they were. Only
+ * restores a checkpoint of a car park with the same ENTRANCES,
+ * EXITS, LEVELS & CAPACITY, otherwise the Sim starts empty.
+ *
+ * @param path - checkpoint file
+ * @param ens - ENTRANCES after checking bounds
+ * @param exs - EXITS after checking bounds
+ * @param lvls - LEVELS after checking bounds
+ * @param cap - CAPACITY after checking bounds
+ * @return int - no. of cars restored, -1 if nothing could be
+ */
+int sim_checkpoint_restore(const char *path, int ens, int exs, int lvls, int cap);
+
+/**
+ * @brief The temperature a level was at when the restored checkpoint
+ * was taken, for the temperature thread to carry on from.
+ *
+ * @param level - 0..LEVELS-1
+ * @return int - degrees, 0 if nothing was restored
+ */
+int sim_checkpoint_temperature(int level);
+
+/**
+ * @brief Keeps a car still inside as the lifecycles stop, to save it
+ * (a lifecycle_visit_t).
+ *
+ * @param c - car, freed once this returns
+ * @param state - where it is up to
+ * @param exit - exit it leaves by
+ * @param due - simulated ms of its next move
+ */
+void sim_checkpoint_keep(car_t *c, car_state_t state, int exit, double due);
+
+/**
+ * @brief Saves the Sim's part of the checkpoint: the cars kept, every
+ * car still queued & the PARKING devices. Call once every thread has
+ * returned & the lifecycles have stopped, before the queues are freed.
+ *
+ * @param path - checkpoint file
+ * @param ens - ENTRANCES after checking bounds
+ * @param exs - EXITS after checking bounds
+ * @param lvls - LEVELS after checking bounds
+ * @param cap - CAPACITY after checking bounds
+ * @return int - no. of cars saved, -1 if the file could not be written
+ */
+int sim_checkpoint_save(const char *path, int ens, int exs, int lvls, int cap);
@@ -7,6 +7,7 @@
 #pragma once
 
 #include "queue.h" /* for queue types */
+#include "../src-common/parking-status.h" /* for counting hardware writes */
 
 /* -----------------------------------------------
  *      ALL GLOBALS USED IN SIMULATOR SOFTWARE
@@ -21,7 +22,6 @@
 extern volatile _Atomic int end_simulation; /* global flag - threads exit gracefully */
 extern volatile void *shm;                  /* pointer to first byte of shared memory */
 extern pthread_mutex_t rand_lock;           /* mutex lock - for rand calls as seed is global */
-extern volatile _Atomic int SLOW;           /* scale to slow down timings across entire program */
 extern queue_t **en_queues;                 /* entrance queues */
 extern queue_t **ex_queues;                 /* exit queues */
 extern pthread_mutex_t en_queues_lock;
@@ -40,7 +40,8 @@ typedef struct args_t {
     int MIN_T;  /* MIN temperature */
     int MAX_T;  /* MAX temperature */ 
     float CH;   /* CHANCE after checking bounds */
-    car_t *car; /* car for car-lifecycle threads */
-    queue_t *queue; /* queues */
+    int RATE;   /* ARRIVAL_RATE after checking bounds */
+    int GENS;   /* GENERATORS after checking bounds */
+    int SD;     /* SEED, or the time if 0 */
 } args_t;
 
@@ -0,0 +1,43 @@
+/************************************************
+ * @file    sim-metrics.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Source code for sim-metrics.h
+ ***********************************************/
+#include "sim-metrics.h"    /* corresponding header */
+#include "sim-common.h"     /* for the shared memory */
+
+/* function prototypes */
+static double hardware_writes(void);
+
+const metric_def_t sim_metrics[SIM_METRICS] = {
+    {"simulator_cars_spawned_total", "Cars created and sent to an entrance queue", METRIC_COUNTER, NULL},
+    {"simulator_cars_total{result=\"admitted\"}", "Cars that reached an entrance sign, by whether they drove in", METRIC_COUNTER, NULL},
+    {"simulator_cars_total{result=\"turned_away\"}", "", METRIC_COUNTER, NULL},
+    {"simulator_cars_exited_total", "Cars that drove out of an exit", METRIC_COUNTER, NULL},
+    {"simulator_queue_depth{queue=\"entrance\"}", "Cars waiting in all entrance or exit queues", METRIC_GAUGE, NULL},
+    {"simulator_queue_depth{queue=\"exit\"}", "", METRIC_GAUGE, NULL},
+    {"simulator_cars_parked", "Cars inside the car park, not yet queued at an exit", METRIC_GAUGE, NULL},
+    {"simulator_gate_open_seconds{gate=\"entrance\"}", "Time from a boom gate opening to closing again", METRIC_HISTOGRAM, NULL},
+    {"simulator_gate_open_seconds{gate=\"exit\"}", "", METRIC_HISTOGRAM, NULL},
+    {"simulator_lock_wait_seconds{lock=\"entrance_queues\"}", "Time spent waiting for a lock", METRIC_HISTOGRAM, NULL},
+    {"simulator_lock_wait_seconds{lock=\"exit_queues\"}", "", METRIC_HISTOGRAM, NULL},
+    {"simulator_lock_wait_seconds{lock=\"rand\"}", "", METRIC_HISTOGRAM, NULL},
+    {"simulator_generator_lag_seconds", "Time from a car being due to its generator queueing it", METRIC_HISTOGRAM, NULL},
+    {"simulator_lifecycle_lag_seconds", "Time from a parked car's next move being due to a worker making it", METRIC_HISTOGRAM, NULL},
+    {"simulator_temperature_steps_total", "Steps taken by the thermal engine", METRIC_COUNTER, NULL},
+    {"parking_hardware_writes_total", "Changes to the car park hardware by all 3 programs", METRIC_COUNTER, hardware_writes},
+};
+
+void sim_metrics_init(void) {
+    metrics_init(sim_metrics, SIM_METRICS);
+}
+
+/**
+ * @brief Reads how many hardware writes have finished.
+ *
+ * @return double - writes
+ */
+static double hardware_writes(void) {
+    return (double)parking_status(shm)->version.ended;
+}
@@ -0,0 +1,39 @@
+/************************************************
+ * @file    sim-metrics.h
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   The Simulator's metrics, recorded by index with
+ *          metric_inc/metric_observe_us etc (see metrics.h)
+ *          and served on METRICS_PORT.
+ ***********************************************/
+#pragma once
+
+#include "../src-common/metrics.h" /* for recording metrics */
+
+/* Index of each metric in sim_metrics (keep both in the same order) */
+typedef enum sim_metric_t {
+    MET_SPAWNED,        /* cars created */
+    MET_ADMITTED,       /* cars by what the entrance sign told them */
+    MET_TURNED_AWAY,
+    MET_EXITED,         /* cars that drove out of an exit */
+    MET_EN_QUEUE,       /* cars waiting in queues */
+    MET_EX_QUEUE,
+    MET_PARKED,         /* cars between an entrance & an exit queue */
+    MET_GATE_EN,        /* gate opened -> closed */
+    MET_GATE_EX,
+    MET_LOCK_EN,        /* waits for the queues & rand */
+    MET_LOCK_EX,
+    MET_LOCK_RAND,
+    MET_GEN_LAG,        /* car due -> queued by its generator */
+    MET_LIFECYCLE_LAG,  /* car's move due -> made by a worker */
+    MET_TEMP_STEPS,     /* thermal engine steps */
+    MET_HW_WRITES,      /* read on scrape */
+    SIM_METRICS         /* no. of metrics */
+} sim_metric_t;
+
+extern const metric_def_t sim_metrics[SIM_METRICS];
+
+/**
+ * @brief Sets up the Simulator's metrics, before any thread records.
+ */
+void sim_metrics_init(void);
@@ -8,7 +8,6 @@
 #include <stdlib.h>             /* for freeing & rand */
 #include <string.h>             /* for string operations */
 #include <pthread.h>            /* for multi-threading */
-#include <time.h>               /* for timespec/nanosleep */
 
 #include "simulate-entrance.h"  /* corresponding header */
 #include "sleep.h"              /* for boomgate timing */
@@ -16,6 +15,14 @@
 #include "queue.h"              /* for queue operations */
 #include "sim-common.h"         /* for flag & rand lock */
 #include "car-lifecycle.h"      /* for sending authorised cars off */
+#include "balance.h"            /* for taking cars from other queues */
+#include "sim-metrics.h"        /* for recording metrics */
+#include "journey.h"            /* for timing car journeys */
+#include "../src-common/trace.h" /* for tracing spans */
+#include "../src-common/lock-prof.h" /* for profiling locks */
+#include "../src-common/mem-account.h" /* for accounting memory */
+#include "../src-common/lpr-trace.h" /* for capturing LPR readings */
+#include "../src-common/sim-clock.h" /* for the real clock */
 
 void *simulate_entrance(void *args) {
 
@@ -25,60 +32,25 @@ void *simulate_entrance(void *args) {
      * Freed at the end of this thread.
      */
     args_t *a = (args_t *)args;
-    queue_t *q = a->queue;
     entrance_t *en = (entrance_t*)((char *)shm + a->addr);
-
-    /* -----------------------------------------------
-     *          ARGS FOR AUTHORISED CARS
-     *        SENT OFF IN THEIR OWN THREADS
-     * -----------------------------------------------
-     * Freed at the end of this thread.
-     */
-    args_t *new_a = malloc(sizeof(args_t) * 1);
-    
-    new_a->id = a->id;
-    new_a->addr = 0; /* will be changed to each car's assigned level */
-    new_a->ENS = a->ENS;
-    new_a->EXS = a->EXS;
-    new_a->LVLS = a->LVLS;
-    new_a->CAP = a->CAP;
-    new_a->MIN_T = a->MIN_T;
-    new_a->MAX_T = a->MAX_T;
-    new_a->CH = a->CH;
-    new_a->car = NULL; /* will be changed with each authorised car */
-    new_a->queue = NULL;
+    double opened_at = 0; /* when the gate last opened */
 
     /* -----------------------------------------------
      *          GATE STARTS OFF CLOSED
      *          LPR STARTS OFF EMPTY
      *          SIGN STARTS OFF BLANK
      * -------------------------------------------- */
-    pthread_mutex_lock(&en->gate.lock);
-    en->gate.status = 'C';
-    pthread_mutex_unlock(&en->gate.lock);
+    PROF_LOCK(&en->gate.lock, LK_EN_GATE + a->id);
+    parking_set(shm, &en->gate.status, 'C');
+    PROF_UNLOCK(&en->gate.lock, LK_EN_GATE + a->id);
 
-    pthread_mutex_lock(&en->sensor.lock);
-    strcpy(en->sensor.plate, "");
-    pthread_mutex_unlock(&en->sensor.lock);
+    PROF_LOCK(&en->sensor.lock, LK_EN_LPR + a->id);
+    parking_set_plate(shm, en->sensor.plate, "");
+    PROF_UNLOCK(&en->sensor.lock, LK_EN_LPR + a->id);
 
-    pthread_mutex_lock(&en->sign.lock);
-    en->sign.display = 0;
-    pthread_mutex_unlock(&en->sign.lock);
-
-    /* -----------------------------------------------
-     *      CREATE THREAD DETACHABLE ATTRIBUTE
-     * -----------------------------------------------
-     * As authorised cars that enter are sent off in
-     * their own "CAR-LIFECYCLE" thread, these threads
-     * must be detached upon creation so when they finish,
-     * their memory can be freed/cleaned up immediately.
-     * 
-     * (detached instead of join as we cannot pause the
-     * entrance to wait for each individual car to park)
-     */
-    pthread_attr_t detached;
-    pthread_attr_init(&detached);
-    pthread_attr_setdetachstate(&detached, PTHREAD_CREATE_DETACHED);
+    PROF_LOCK(&en->sign.lock, LK_EN_SIGN + a->id);
+    parking_set(shm, &en->sign.display, 0);
+    PROF_UNLOCK(&en->sign.lock, LK_EN_SIGN + a->id);
 
     /* -----------------------------------------------
      *       LOOP WHILE SIMULATION HASN'T ENDED
@@ -88,10 +60,17 @@ void *simulate_entrance(void *args) {
         /* -----------------------------------------------
          *         WAIT UNTIL THERE'S A CAR WAITING
          * -------------------------------------------- */
-        pthread_mutex_lock(&en_queues_lock);
-        while (q->head == NULL && !end_simulation) pthread_cond_wait(&en_queues_cond, &en_queues_lock);
-        car_t *c = pop_queue(q);
-        pthread_mutex_unlock(&en_queues_lock);
+        bool stolen = false; /* taken from another entrance's queue */
+        PROF_METRICS_LOCK(&en_queues_lock, LK_EN_QUEUES, MET_LOCK_EN);
+        while (!balance_ready(en_queues, a->ENS, a->id) && !end_simulation) PROF_COND_WAIT(&en_queues_cond, &en_queues_lock, LK_EN_QUEUES);
+        car_t *c = balance_take(en_queues, a->ENS, a->id, &stolen);
+        PROF_UNLOCK(&en_queues_lock, LK_EN_QUEUES);
+        if (c != NULL) {
+            metric_gauge_add(MET_EN_QUEUE, -1);
+            if (stolen) journey_entrance_stole(a->id);
+            car_stamp(c, STAMP_EN_SERVED);
+            TRACE_SPAN_MS(TR_EN_QUEUE, sim_mono_ms(c->stamps[STAMP_EN_QUEUED]), c->plate, (uint32_t)c->seq);
+        }
 
         /* -----------------------------------------------
          *         CHECK IF GATE IS LOWERING
@@ -101,10 +80,13 @@ void *simulate_entrance(void *args) {
          * then the Manager will lower the gate, and we will
          * close it here
          */
-        pthread_mutex_lock(&en->gate.lock);
+        PROF_LOCK(&en->gate.lock, LK_EN_GATE + a->id);
         if (en->gate.status == 'L') {
+            TRACE_START(closing);
             sleep_for_millis(10);
-            en->gate.status = 'C';
+            parking_set(shm, &en->gate.status, 'C');
+            TRACE_SPAN(TR_GATE_CLOSE, closing, NULL, 0);
+            metric_observe_us(MET_GATE_EN, (uint64_t)((now_ms() - opened_at) * 1000));
         }
 
         /* -----------------------------------------------
@@ -115,9 +97,10 @@ void *simulate_entrance(void *args) {
          */
         if (en->gate.status == 'R') {
             sleep_for_millis(10);
-            en->gate.status = 'O';
+            parking_set(shm, &en->gate.status, 'O');
+            opened_at = now_ms();
         }
-        pthread_mutex_unlock(&en->gate.lock);
+        PROF_UNLOCK(&en->gate.lock, LK_EN_GATE + a->id);
         pthread_cond_broadcast(&en->gate.condition);
 
 
@@ -127,29 +110,33 @@ void *simulate_entrance(void *args) {
              * THEN UNLOCK & BROADCAST LPR SO MAN CHECKS IT
              * -------------------------------------------- */
             sleep_for_millis(2);
-            pthread_mutex_lock(&en->sensor.lock);
-            strcpy(en->sensor.plate, c->plate);
-            pthread_mutex_unlock(&en->sensor.lock);
+            TRACE_START(lpr);
+            PROF_LOCK(&en->sensor.lock, LK_EN_LPR + a->id);
+            parking_set_plate(shm, en->sensor.plate, c->plate);
+            lpr_capture(LPR_ENTRANCE, a->id, c->plate);
+            PROF_UNLOCK(&en->sensor.lock, LK_EN_LPR + a->id);
 
             /* 8 millisecond pause before we broadcast to the Manager
             that the LPR is ready, this is so that we can allow the 
             DISPLAY STATUS thread to read & display status of LPR */
 
-            /* we DON'T use our custom sleep_for_millis function because the client can slow down
-            time using the "SLOW MOTION" variable but we want this time to be constistent */
-            int millis = 8; 
-            struct timespec remaining, requested = {(millis / 1000), ((millis % 1000) * 1000000)};
-            nanosleep(&requested, &remaining);
+            /* simulated like every other delay, so the handshake keeps pace with
+            the cars at any SPEED */
+            sleep_for_millis(8);
 
             pthread_cond_broadcast(&en->sensor.condition);
+            TRACE_SPAN(TR_LPR_WRITE, lpr, c->plate, (uint32_t)c->seq);
 
             /* -----------------------------------------------
              *      LOCK THE SIGN THEN
              *      WAIT FOR THE MANAGER TO VALIDATE PLATE
              *      AND UPDATE THE SIGN
              * -------------------------------------------- */
-            pthread_mutex_lock(&en->sign.lock);
-            while (en->sign.display == 0 && !end_simulation) pthread_cond_wait(&en->sign.condition, &en->sign.lock);
+            TRACE_START(sign);
+            PROF_LOCK(&en->sign.lock, LK_EN_SIGN + a->id);
+            while (en->sign.display == 0 && !end_simulation) PROF_COND_WAIT(&en->sign.condition, &en->sign.lock, LK_EN_SIGN + a->id);
+            car_stamp(c, STAMP_SIGNED);
+            TRACE_SPAN(TR_SIGN_WAIT, sign, c->plate, (uint32_t)c->seq);
 
             /* -----------------------------------------------
              *      IF SIGN SAYS CAR IS...
@@ -158,13 +145,16 @@ void *simulate_entrance(void *args) {
              *          OR THERE'S A FIRE   (EVACUATE)
              * -------------------------------------------- */
             if (strchr("XFEVACUATE", en->sign.display) != NULL) {
-                free(c); /* car leaves Sim */
+                journey_entrance(a->id, c, en->sign.display);
+                mem_free(c); /* car leaves Sim */
+                metric_inc(MET_TURNED_AWAY);
             
             /* -----------------------------------------------
              *         IF AUTHORISED & ASSIGNED A LEVEL
              * -------------------------------------------- */
             } else if (!end_simulation) {
                 c->floor = (int)en->sign.display - '0'; /* assign to floor */
+                metric_inc(MET_ADMITTED);
 
                 /* -----------------------------------------------
                  *        IF GATE IS CLOSED? WAIT FOR IT START RAISING
@@ -172,37 +162,40 @@ void *simulate_entrance(void *args) {
                  *        THEN BROADCAST TO "MANAGE-GATE" THREADS
                  *        SO GATE STAYS OPEN FOR 20ms BEFORE LOWERING
                  * -------------------------------------------- */
-                pthread_mutex_lock(&en->gate.lock);
-                while (en->gate.status == 'C' && !end_simulation) pthread_cond_wait(&en->gate.condition, &en->gate.lock);
+                TRACE_START(gate);
+                PROF_LOCK(&en->gate.lock, LK_EN_GATE + a->id);
+                while (en->gate.status == 'C' && !end_simulation) PROF_COND_WAIT(&en->gate.condition, &en->gate.lock, LK_EN_GATE + a->id);
                 if (en->gate.status == 'R') {
                     sleep_for_millis(10);
-                    en->gate.status = 'O';
+                    parking_set(shm, &en->gate.status, 'O');
+                    opened_at = now_ms();
                 }
-                pthread_mutex_unlock(&en->gate.lock);
+                PROF_UNLOCK(&en->gate.lock, LK_EN_GATE + a->id);
                 pthread_cond_broadcast(&en->gate.condition);
+                car_stamp(c, STAMP_ENTERED);
+                TRACE_SPAN(TR_GATE_OPEN, gate, c->plate, (uint32_t)c->seq);
+                journey_entrance(a->id, c, en->sign.display);
 
                 /* -----------------------------------------------
-                 * SEND CARS OFF IN THEIR OWN "CAR-LIFECYCLE" THREAD
+                 *     SEND CARS OFF ON THEIR "CAR-LIFECYCLE"
                  * -----------------------------------------------
-                 * As cars move independently once inside.
+                 * As cars move independently once inside, the
+                 * lifecycle workers move them from here on.
                  */
-                pthread_t new_car_thread;
-
-                new_a->car = c;
-                new_a->addr = (int)((sizeof(entrance_t) * a->ENS) + (sizeof(exit_t) * a->EXS) + (sizeof(level_t) * c->floor));
-                
-                pthread_create(&new_car_thread, &detached, car_lifecycle, (void *)new_a);
+                lifecycle_admit(c, (int)((sizeof(entrance_t) * a->ENS) + (sizeof(exit_t) * a->EXS) + (sizeof(level_t) * c->floor)));
+            } else {
+                mem_free(c); /* Sim ended while the car waited at the sign */
             }
 
             /* -----------------------------------------------
              *             RESET & UNLOCK THE SIGN
              * -------------------------------------------- */
-            en->sign.display = 0; /* reset sign */
-            pthread_mutex_unlock(&en->sign.lock);
+            parking_set(shm, &en->sign.display, 0); /* reset sign */
+            PROF_UNLOCK(&en->sign.lock, LK_EN_SIGN + a->id);
+        } else if (c != NULL) {
+            mem_free(c); /* Sim ended while the car was queued */
         }
     }
-    free(args);
-    free(new_a);
-    pthread_attr_destroy(&detached);
+    mem_free(args);
     return NULL;
 }
\ No newline at end of file
@@ -8,13 +8,20 @@
 #include <stdlib.h>         /* for freeing & rand */
 #include <string.h>         /* for string operations */
 #include <pthread.h>        /* for multi-threading */
-#include <time.h>           /* for timespec/nanosleep */
 
 #include "simulate-exit.h"  /* corresponding header */
 #include "sleep.h"          /* for boomgate timings */
 #include "parking.h"        /* for shared memory types */
 #include "queue.h"          /* for queue operations */
 #include "sim-common.h"     /* for flag & rand lock */
+#include "balance.h"        /* for taking cars from other queues */
+#include "sim-metrics.h"    /* for recording metrics */
+#include "journey.h"        /* for timing car journeys */
+#include "../src-common/trace.h" /* for tracing spans */
+#include "../src-common/lock-prof.h" /* for profiling locks */
+#include "../src-common/mem-account.h" /* for accounting memory */
+#include "../src-common/lpr-trace.h" /* for capturing LPR readings */
+#include "../src-common/sim-clock.h" /* for the real clock */
 
 void *simulate_exit(void *args) {
 
@@ -22,15 +29,15 @@ void *simulate_exit(void *args) {
      *    DECONSTRUCT ARGS & LOCATE SHARED EXIT
      * -------------------------------------------- */
     args_t *a = (args_t *)args;
-    queue_t *q = a->queue;
     exit_t *ex = (exit_t*)((char *)shm + a->addr);
+    double opened_at = 0; /* when the gate last opened */
 
     /* -----------------------------------------------
      *          GATE STARTS OFF CLOSED
      * -------------------------------------------- */
-    pthread_mutex_lock(&ex->gate.lock);
-    ex->gate.status = 'C';
-    pthread_mutex_unlock(&ex->gate.lock);
+    PROF_LOCK(&ex->gate.lock, LK_EX_GATE + a->id);
+    parking_set(shm, &ex->gate.status, 'C');
+    PROF_UNLOCK(&ex->gate.lock, LK_EX_GATE + a->id);
 
     /* -----------------------------------------------
      *       LOOP WHILE SIMULATION HASN'T ENDED
@@ -45,12 +52,19 @@ void *simulate_exit(void *args) {
          * Main can wake up these threads, and instead of waiting
          * again, threads can skip the rest of the loop and return
          */
-        pthread_mutex_lock(&ex_queues_lock);
-        while (q->head == NULL && !end_simulation) {
-            pthread_cond_wait(&ex_queues_cond, &ex_queues_lock);
+        bool stolen = false; /* taken from another exit's queue */
+        PROF_METRICS_LOCK(&ex_queues_lock, LK_EX_QUEUES, MET_LOCK_EX);
+        while (!balance_ready(ex_queues, a->EXS, a->id) && !end_simulation) {
+            PROF_COND_WAIT(&ex_queues_cond, &ex_queues_lock, LK_EX_QUEUES);
+        }
+        car_t *c = balance_take(ex_queues, a->EXS, a->id, &stolen);
+        PROF_UNLOCK(&ex_queues_lock, LK_EX_QUEUES);
+        if (c != NULL) {
+            metric_gauge_add(MET_EX_QUEUE, -1);
+            if (stolen) journey_exit_stole(a->id);
+            car_stamp(c, STAMP_EX_SERVED);
+            TRACE_SPAN_MS(TR_EX_QUEUE, sim_mono_ms(c->stamps[STAMP_EX_QUEUED]), c->plate, (uint32_t)c->seq);
         }
-        car_t *c = pop_queue(q);
-        pthread_mutex_unlock(&ex_queues_lock);
 
         /* -----------------------------------------------
          *         CHECK IF GATE IS LOWERING
@@ -60,10 +74,13 @@ void *simulate_exit(void *args) {
          * then the Manager will lower the gate, and we will
          * close it here
          */
-        pthread_mutex_lock(&ex->gate.lock);
+        PROF_LOCK(&ex->gate.lock, LK_EX_GATE + a->id);
         if (ex->gate.status == 'L') {
+            TRACE_START(closing);
             sleep_for_millis(10);
-            ex->gate.status = 'C';
+            parking_set(shm, &ex->gate.status, 'C');
+            TRACE_SPAN(TR_GATE_CLOSE, closing, NULL, 0);
+            metric_observe_us(MET_GATE_EX, (uint64_t)((now_ms() - opened_at) * 1000));
         }
 
         /* -----------------------------------------------
@@ -74,9 +91,10 @@ void *simulate_exit(void *args) {
          */
         if (ex->gate.status == 'R') {
             sleep_for_millis(10);
-            ex->gate.status = 'O';
+            parking_set(shm, &ex->gate.status, 'O');
+            opened_at = now_ms();
         }
-        pthread_mutex_unlock(&ex->gate.lock);
+        PROF_UNLOCK(&ex->gate.lock, LK_EX_GATE + a->id);
         pthread_cond_broadcast(&ex->gate.condition);
 
         if (c != NULL && !end_simulation) {
@@ -85,21 +103,22 @@ void *simulate_exit(void *args) {
              * THEN UNLOCK & BROADCAST LPR SO MAN CHECKS IT
              * -----------------------------------------------
              * specification does not say to wait 2ms like entrance (so immediately trigger) */
-            pthread_mutex_lock(&ex->sensor.lock);
-            strcpy(ex->sensor.plate, c->plate);
-            pthread_mutex_unlock(&ex->sensor.lock);
+            TRACE_START(lpr);
+            PROF_LOCK(&ex->sensor.lock, LK_EX_LPR + a->id);
+            parking_set_plate(shm, ex->sensor.plate, c->plate);
+            lpr_capture(LPR_EXIT, a->id, c->plate);
+            PROF_UNLOCK(&ex->sensor.lock, LK_EX_LPR + a->id);
         
             /* 8 millisecond pause before we broadcast to the Manager
             that the LPR is ready, this is so that we can allow the 
             DISPLAY STATUS thread to read & display status of LPR */
 
-            /* we DON'T use our custom sleep_for_millis function because the client can slow down
-            time using the "SLOW MOTION" variable but we want this time to be constistent */
-            int millis = 8; 
-            struct timespec remaining, requested = {(millis / 1000), ((millis % 1000) * 1000000)};
-            nanosleep(&requested, &remaining);
+            /* simulated like every other delay, so the handshake keeps pace with
+            the cars at any SPEED */
+            sleep_for_millis(8);
 
             pthread_cond_broadcast(&ex->sensor.condition);
+            TRACE_SPAN(TR_LPR_WRITE, lpr, c->plate, (uint32_t)c->seq);
 
             /* -----------------------------------------------
              *        IF GATE IS CLOSED? WAIT FOR IT START RAISING
@@ -107,18 +126,26 @@ void *simulate_exit(void *args) {
              *        THEN BROADCAST TO "MANAGE-GATE" THREADS
              *        SO GATE STAYS OPEN FOR 20ms BEFORE LOWERING
              * -------------------------------------------- */
-            pthread_mutex_lock(&ex->gate.lock);
-            while (ex->gate.status == 'C' && !end_simulation) pthread_cond_wait(&ex->gate.condition, &ex->gate.lock);
+            TRACE_START(gate);
+            PROF_LOCK(&ex->gate.lock, LK_EX_GATE + a->id);
+            while (ex->gate.status == 'C' && !end_simulation) PROF_COND_WAIT(&ex->gate.condition, &ex->gate.lock, LK_EX_GATE + a->id);
             if (ex->gate.status == 'R') {
                 sleep_for_millis(10);
-                ex->gate.status = 'O';
+                parking_set(shm, &ex->gate.status, 'O');
+                opened_at = now_ms();
             }
-            pthread_mutex_unlock(&ex->gate.lock);
+            PROF_UNLOCK(&ex->gate.lock, LK_EX_GATE + a->id);
             pthread_cond_broadcast(&ex->gate.condition);
 
-            free(c); /* car leaves Sim */
+            car_stamp(c, STAMP_LEFT);
+            TRACE_SPAN(TR_GATE_OPEN, gate, c->plate, (uint32_t)c->seq);
+            journey_exit(a->id, c);
+            mem_free(c); /* car leaves Sim */
+            metric_inc(MET_EXITED);
+        } else if (c != NULL) {
+            mem_free(c); /* Sim ended while the car was queued */
         }
     }
-    free(args);
+    mem_free(args);
     return NULL;
 }
\ No newline at end of file
@@ -6,56 +6,76 @@
  ***********************************************/
 #include <stdio.h>      /* for IO operations */
 #include <pthread.h>    /* for mutex locks/condition vars */
-#include <stdlib.h>     /* for rand calls */
+#include <stdlib.h>     /* for freeing */
+#include <stdint.h>     /* for int types */
+#include <time.h>       /* for time-based seed */
 
 #include "simulate-temp.h"
+#include "thermal.h"    /* for the thermal engine */
 #include "parking.h"    /* for shared memory types */
 #include "sim-common.h" /* for args type/rand lock etc */
 #include "sleep.h"      /* for milli sleep */
+#include "sim-metrics.h" /* for recording metrics */
+#include "sim-checkpoint.h" /* for restored temperatures */
+#include "../src-common/mem-account.h" /* for accounting memory */
+#include "../config.h"  /* for SCENARIO_FILE & TEMP_SEED */
 
 #define GREATEST(a,b) ((a>b) ? a:b)
 #define SMALLEST(a,b) ((a<b) ? a:b)
 
 void *simulate_temp(void *args) {
     
-    /* deconstruct args */
+    /* deconstruct args, addr is where the levels begin */
     args_t *a = (args_t *)args;
-    level_t *lvl = (level_t*)((char *)shm + a->addr);
+    level_t *lvl[a->LVLS];
+
+    for (int i = 0; i < a->LVLS; i++) {
+        lvl[i] = (level_t *)((char *)shm + a->addr + (sizeof(level_t) * i));
+    }
 
     /* ensure max temp is always greater than min, swap if needed */
     int temp = GREATEST(a->MAX_T, a->MIN_T); 
     a->MIN_T = SMALLEST(a->MIN_T, a->MAX_T);
     a->MAX_T = temp;
 
-    int change = 1; /* how much the temperature can change up or down */
-    int min_change;
-    int max_change;
-    int prev_temp = a->MIN_T;
-    int rand_temp;
-    int ms = 0;     /* generate new temp every few millis */
+    /* -----------------------------------------------
+     *   CREATE THE ENGINE & LOAD SCHEDULED FIRES
+     * -----------------------------------------------
+     * Seed of 0 = different temperatures every run
+     */
+    uint32_t seed = (TEMP_SEED != 0) ? (uint32_t)TEMP_SEED : (uint32_t)time(NULL);
+    thermal_t *t = thermal_new(a->LVLS, a->MIN_T, a->MAX_T, seed);
+    if (t == NULL) {
+        perror("malloc thermal engine");
+        exit(1);
+    }
 
+    /* carry on from a restored checkpoint's temperatures, if in the window */
+    for (int i = 0; i < a->LVLS; i++) {
+        int warm = sim_checkpoint_temperature(i);
+        if (warm >= a->MIN_T && warm <= a->MAX_T) t->ambient[i] = t->temp[i] = (float)warm;
+    }
+
+    printf("~Temperature seed %u\n", seed);
+    int fires = thermal_load_scenario(t, SCENARIO_FILE);
+    if (fires > 0) printf("~%d fire(s) scheduled from %s\n", fires, SCENARIO_FILE);
+
+    /* -----------------------------------------------
+     *   ADVANCE ALL LEVELS TOGETHER EVERY 2 MILLIS
+     * -------------------------------------------- */
     while (!end_simulation) {
+        thermal_step(t);
+        metric_inc(MET_TEMP_STEPS);
 
-        /* set new window that temperature can change within, 
-        if window falls out of bounds, bring back up to MIN_T
-        and back down to MAX_T */
-        if ((min_change = prev_temp - change) < a->MIN_T) min_change = a->MIN_T;
-        if ((max_change = prev_temp + change) > a->MAX_T) max_change = a->MAX_T;
-
-        /* get random temp & sleep duration */
-        pthread_mutex_lock(&rand_lock);
-        /* change temp up or down by...
-        also max_change +1 to be ensure 0..max_change inclusive */
-        rand_temp = rand() % ((max_change  - min_change) + 1);
-        rand_temp += min_change;             /* bring temp back into bounds */
-        ms = (rand() % 5) + 1;               /* 0..4 +1 = 1..5 */
-        pthread_mutex_unlock(&rand_lock);
-
-        /* apply random temp every 1..5 millis */
-        sleep_for_millis(ms);
-        lvl->temp_sensor = rand_temp;
-        prev_temp = rand_temp;
+        parking_write_begin(shm);
+        for (int i = 0; i < a->LVLS; i++) {
+            lvl[i]->temp_sensor = (int16_t)(t->temp[i] + 0.5f); /* round to nearest degree */
+        }
+        parking_write_end(shm);
+        sleep_for_millis(THERMAL_TICK);
     }
-    free(a);
+
+    thermal_free(t);
+    mem_free(a);
     return NULL;
-}
\ No newline at end of file
+}
@@ -7,12 +7,16 @@
 #pragma once
 
 /**
- * @brief Updates temperature per floor every 1..5 millis.
- * Algorithm used keeps the temperature within the global
- * MIN and MAX values (configurable in config.h). As temperature
- * changes, it can only go up or down by 1 degree.
+ * @brief Updates the temperature of every level every 2 millis
+ * using the thermal engine (see thermal.h). Without any fires the
+ * temperature stays within the global MIN and MAX values (configurable
+ * in config.h), only going up or down by 1 degree at a time.
+ * 
+ * Fires are scheduled in the SCENARIO_FILE (see config.h), so rises,
+ * spikes, and spreading fires can be tested without recompiling. The
+ * same TEMP_SEED always gives the same temperatures.
  * 
  * @param args - collection of items
  * @return void* - NULL upon completion
  */
-void *simulate_temp(void *args);
\ No newline at end of file
+void *simulate_temp(void *args);
@@ -21,11 +21,29 @@
 #include "simulate-entrance.h"
 #include "simulate-exit.h"
 #include "simulate-temp.h"
+#include "car-lifecycle.h"
+#include "sim-checkpoint.h"
+#include "balance.h"
 #include "sim-common.h"
+#include "sim-metrics.h"
+#include "journey.h"
+#include "traffic.h"
 #include "../config.h"
+#include "../src-common/parking-status.h"
+#include "../src-common/trace.h"
+#include "../src-common/lock-prof.h"
+#include "../src-common/mem-account.h"
+#include "../src-common/run-config.h"
+#include "../src-common/lpr-trace.h"
+#include "../src-common/sim-clock.h"
 
 #define SHARED_MEM_NAME "PARKING"
-#define SHARED_MEM_SIZE 2920    /* size in bytes */
+#define SHARED_MEM_SIZE PARKING_SIZE    /* hardware + status area, in bytes */
+#define MAX_ARRIVAL_RATE 1000           /* cars per second */
+#define MAX_LIFECYCLE_WORKERS 64
+
+/* function prototypes */
+static void write_results(const char *dir, int ens, int exs, int rate);
 
 /* -----------------------------------------------
  *      INIT GLOBAL EXTERNS FROM sim-common.h
@@ -33,7 +51,6 @@
 volatile _Atomic int end_simulation = 0; /* 0 = no, 1 = yes */
 volatile void *shm;             /* set once in main */
 pthread_mutex_t rand_lock;      /* for rand calls */
-volatile _Atomic int SLOW;      /* slow down time by... */
 queue_t **en_queues;            /* entrance queues */
 queue_t **ex_queues;            /* exit queues */
 pthread_mutex_t en_queues_lock; 
@@ -56,7 +73,7 @@ pthread_cond_t ex_queues_cond;
  * @return  int - indicating program's success or failure 
  */
 int main (void) {
-    system("clear");
+    if (config_int("HEADLESS", HEADLESS) != 1) system("clear");
     puts("");
     puts("");
     puts("█▀ █ █▀▄▀█ █░█ █░░ ▄▀█ ▀█▀ █▀█ █▀█");
@@ -69,48 +86,60 @@ int main (void) {
      * -----------------------------------------------
      * As the number of ENTRANCES/CAPACITY/CHANCE etc are
      * subject to human error, bounds must be checked.
-     * Check bounds here ONCE for simplicity.
+     * Check bounds here ONCE for simplicity. Some may be
+     * overridden when starting (see run-config.h), those
+     * are checked the same way.
      */
-    int ENS = ENTRANCES;
-    int EXS = EXITS;
-    int LVLS = LEVELS;
-    int CAP = CAPACITY;
-    float CH = CHANCE;
-    int DU = DURATION;
+    int ENS = config_int("ENTRANCES", ENTRANCES);
+    int EXS = config_int("EXITS", EXITS);
+    int LVLS = config_int("LEVELS", LEVELS);
+    int CAP = config_int("CAPACITY", CAPACITY);
+    float CH = (float)config_double("CHANCE", CHANCE);
+    int DU = config_int("DURATION", DURATION);
     int MIN_T = MIN_TEMP;
     int MAX_T = MAX_TEMP;
-    SLOW = SLOW_MOTION;
+    int MP = config_int("METRICS_PORT", METRICS_PORT);
+    int RATE = config_int("ARRIVAL_RATE", ARRIVAL_RATE);
+    int GENS = config_int("GENERATORS", GENERATORS);
+    int WORKERS = config_int("LIFECYCLE_WORKERS", LIFECYCLE_WORKERS);
+    int BM = config_int("BALANCE_MODE", BALANCE_MODE);
+    int SD = config_int("SEED", SEED);
+    const char *RESULTS = config_str("RESULTS_DIR", RESULTS_DIR);
+    const char *CAPTURE = config_str("LPR_CAPTURE", LPR_CAPTURE);
+    const char *CK = config_str("CHECKPOINT_FILE", CHECKPOINT_FILE);
+    const char *RESTORE = config_str("RESTORE_FILE", RESTORE_FILE);
+    double SP = config_double("SPEED", SPEED);
 
     puts("~Verifying ENTRANCES, EXITS, LEVELS are 1..5 inclusive...");
-    if (ENTRANCES < 1 || ENTRANCES > 5) {
+    if (ENS < 1 || ENS > 5) {
         ENS = 5;
         printf("\tENTRANCES out of bounds. Falling back to defaults (5)\n");
     }
     
-    if (EXITS < 1 || EXITS > 5) {
+    if (EXS < 1 || EXS > 5) {
         EXS = 5;
         printf("\tEXITS out of bounds. Falling back to defaults (5)\n");
     }
     
-    if (LEVELS < 1 || LEVELS > 5) {
+    if (LVLS < 1 || LVLS > 5) {
         LVLS = 5;
         printf("\tLEVELS out of bounds. Falling back to defaults (5)\n");
     }
 
     puts("~Verifying CAPACITY is greater than 0...");
-    if (CAPACITY < 1) {
+    if (CAP < 1) {
         CAP = 20;
         printf("\tCAPACITY out of bounds. Falling back to defaults (20)\n");
     }
     
     puts("~Verifying CHANCE is 0..1 inclusive...");
-    if (CHANCE < 0 || CHANCE > 1) {
+    if (CH < 0 || CH > 1) {
         CH = 0.5;
         printf("\tCHANCE out of bounds. Falling back to defaults (50%%)\n");
     }
 
     puts("~Verifying DURATION is greater than 0...");
-    if (DURATION < 1) {
+    if (DU < 1) {
         DU = 60;
         printf("\tDURATION out of bounds. Falling back to defaults (1 minute)\n");
     }
@@ -132,19 +161,58 @@ int main (void) {
         printf("\tMAX TEMPERATURE out of bounds. Falling back to defaults (33 degrees)\n");
     }
 
-    puts("~Verifying SLOW MOTION is at least 1...");
-    if (SLOW_MOTION < 1) {
-        SLOW = 1;
-        printf("\tSLOW MOTION out of bounds. Falling back to defaults (1)\n");
+    puts("~Verifying SPEED is 0.001..1000...");
+    if (!(SP >= SIM_SPEED_MIN && SP <= SIM_SPEED_MAX)) {
+        SP = 1;
+        printf("\tSPEED out of bounds. Falling back to defaults (1 = real time)\n");
+    }
+
+    puts("~Verifying METRICS PORT is 0 (off) or 1024..65533...");
+    if (MP != 0 && (MP < 1024 || MP > 65533)) {
+        MP = 9310;
+        printf("\tMETRICS PORT out of bounds. Falling back to defaults (9310)\n");
+    }
+
+    puts("~Verifying ARRIVAL RATE is 0 (random 1..100ms gaps) or up to 1000 cars per second...");
+    if (RATE < 0 || RATE > MAX_ARRIVAL_RATE) {
+        RATE = 0;
+        printf("\tARRIVAL RATE out of bounds. Falling back to defaults (0)\n");
+    }
+
+    puts("~Verifying GENERATORS is 1..8...");
+    if (GENS < 1 || GENS > TRAFFIC_MAX_GENERATORS) {
+        GENS = 1;
+        printf("\tGENERATORS out of bounds. Falling back to defaults (1)\n");
+    }
+
+    puts("~Verifying LIFECYCLE WORKERS is 1..64...");
+    if (WORKERS < 1 || WORKERS > MAX_LIFECYCLE_WORKERS) {
+        WORKERS = 2;
+        printf("\tLIFECYCLE WORKERS out of bounds. Falling back to defaults (2)\n");
+    }
+
+    puts("~Verifying BALANCE MODE is 0 (off), 1 (shortest queue) or 2 (work stealing)...");
+    if (BM < BALANCE_OFF || BM >= BALANCE_MODES) {
+        BM = BALANCE_OFF;
+        printf("\tBALANCE MODE out of bounds. Falling back to defaults (0 = off)\n");
+    }
+
+    puts("~Verifying SEED is 0 or more...");
+    if (SD < 0) {
+        SD = 0;
+        printf("\tSEED out of bounds. Falling back to defaults (0 = different every run)\n");
     }
 
     /* -----------------------------------------------
-     *        INIT RAND's SEED (CURRENT TIME)
+     *   INIT RAND's SEED (SEED, OR THE CURRENT TIME)
      * -----------------------------------------------
-     * Set to 1 for deterministic behaviour (debugging)
-     * Set to current time for true randomness
+     * The same SEED gives the same cars (plates,
+     * entrances, exits & parking times) every run,
+     * 0 = the current time for true randomness
      */
-    srand(time(NULL));
+    if (SD == 0) SD = (int)(time(NULL) & 0x7fffffff);
+    srand((unsigned)SD);
+    printf("~Car seed %d\n", SD);
 
     /* -----------------------------------------------
      *           CREATE SHARED MEMORY OBJECT
@@ -153,18 +221,43 @@ int main (void) {
     init_shared_memory(shm, ENS, EXS, LVLS);
     puts("~Shared memory created/initialised");
 
+    /* -----------------------------------------------
+     *    START SIMULATED TIME (BEFORE ANY THREAD)
+     * -------------------------------------------- */
+    sim_clock_start(shm, SP);
+    if (SP != 1) printf("~Simulated time runs at %gx real time\n", SP);
+
+    /* -----------------------------------------------
+     *               START SERVING METRICS
+     * -------------------------------------------- */
+    sim_metrics_init();
+    lockprof_init("Simulator");
+    mem_init("Simulator");
+    if (MP != 0 && metrics_serve(MP) == 0) printf("~Metrics on http://127.0.0.1:%d/metrics\n", MP);
+
+    /* -----------------------------------------------
+     *     START TIMING CAR JOURNEYS (BEFORE ANY CAR)
+     * -------------------------------------------- */
+    journey_init();
+    trace_init("simulator");
+    event_init("simulator", ENS, EXS, LVLS);
+    lpr_capture_init(CAPTURE, ENS, EXS, LVLS, SP);
+
     /* -----------------------------------------------
      *      CREATE QUEUES FOR ENTRANCES & EXITS
      * -------------------------------------------- */
+    balance_init((balance_mode_t)BM);
+    if (BM != BALANCE_OFF) printf("~Cars balanced between queues by %s\n", balance_name());
+
     /* Allocate memory for queues */
-    en_queues = malloc(sizeof(queue_t *) * ENS);
-    ex_queues = malloc(sizeof(queue_t *) * EXS);
+    en_queues = mem_malloc(sizeof(queue_t *) * ENS, MEM_QUEUE);
+    ex_queues = mem_malloc(sizeof(queue_t *) * EXS, MEM_QUEUE);
 
     queue_t *new_q;
     /* Create entrance queues */
     pthread_mutex_lock(&en_queues_lock);
     for (int i = 0; i < ENS; i++) {
-        new_q = malloc(sizeof(queue_t) * 1);
+        new_q = mem_malloc(sizeof(queue_t) * 1, MEM_QUEUE);
         init_queue(new_q);
         en_queues[i] = new_q;
     }
@@ -173,24 +266,38 @@ int main (void) {
     /* Create exit queues */
     pthread_mutex_lock(&ex_queues_lock);
     for (int i = 0; i < EXS; i++) {
-        new_q = malloc(sizeof(queue_t) * 1);
+        new_q = mem_malloc(sizeof(queue_t) * 1, MEM_QUEUE);
         init_queue(new_q);
         ex_queues[i] = new_q;
     }
     pthread_mutex_unlock(&ex_queues_lock);
 
+    /* -----------------------------------------------
+     *  START MOVING CARS INSIDE (BEFORE ANY DRIVE IN)
+     * -------------------------------------------- */
+    if (lifecycle_start(WORKERS, EXS) != 0) {
+        perror("Could not start the car lifecycles");
+        exit(1);
+    }
+
+    /* -----------------------------------------------
+     *   CARRY ON FROM A CHECKPOINT (BEFORE ANY THREAD
+     *   TAKES A CAR FROM A QUEUE)
+     * -------------------------------------------- */
+    if (RESTORE[0] != '\0') sim_checkpoint_restore(RESTORE, ENS, EXS, LVLS, CAP);
+
     /* -----------------------------------------------
      *          START ENTRANCE & EXIT THREADS
      * -------------------------------------------- */
     pthread_t en_threads[ENS];
     pthread_t ex_threads[EXS];
 
-    args_t *a; /* will be freed at the end of MAIN */
+    args_t *a; /* each is freed within its thread */
 
     pthread_mutex_lock(&en_queues_lock);
     for (int i = 0; i < ENS; i++) {
         /* set up args - will be freed within their thread */
-        a = malloc(sizeof(args_t) * 1);
+        a = mem_malloc(sizeof(args_t) * 1, MEM_ARGS);
 
         a->id = i;
         a->addr = (int)(sizeof(entrance_t) * i);
@@ -201,8 +308,9 @@ int main (void) {
         a->MIN_T = MIN_T;
         a->MAX_T = MAX_T;
         a->CH = CH;
-        a->car = NULL;
-        a->queue = en_queues[i];
+        a->RATE = RATE;
+        a->GENS = GENS;
+        a->SD = SD;
 
         pthread_create(&en_threads[i], NULL, simulate_entrance, (void *)a);
     }
@@ -211,7 +319,7 @@ int main (void) {
     pthread_mutex_lock(&ex_queues_lock);
     for (int i = 0; i < EXS; i++) {
         /* set up args - will be freed within their thread */
-        a = malloc(sizeof(args_t) * 1);
+        a = mem_malloc(sizeof(args_t) * 1, MEM_ARGS);
         
         a->id = i;
         a->addr = (int)((sizeof(entrance_t) * ENS) + (sizeof(exit_t) * i));
@@ -222,41 +330,47 @@ int main (void) {
         a->MIN_T = MIN_T;
         a->MAX_T = MAX_T;
         a->CH = CH;
-        a->car = NULL;
-        a->queue = ex_queues[i];
+        a->RATE = RATE;
+        a->GENS = GENS;
+        a->SD = SD;
 
         pthread_create(&ex_threads[i], NULL, simulate_exit, (void *)a);
     }
     pthread_mutex_unlock(&ex_queues_lock);
 
     /* -----------------------------------------------
-     *        START LEVEL TEMPERATURE THREADS
-     * -------------------------------------------- */
-    pthread_t temp_threads[LVLS];
+     *        START LEVEL TEMPERATURE THREAD
+     * -----------------------------------------------
+     * 1 thread advances the temperature of all levels
+     */
+    pthread_t temp_thread;
 
-    for (int i = 0; i < LVLS; i++) {
-        // set up args - will be freed within their thread
-        a = malloc(sizeof(args_t) * 1);
-        
-        a->id = i;
-        a->addr = (int)((sizeof(entrance_t) * ENS) + (sizeof(exit_t) * EXS) + (sizeof(level_t) * i));
-        a->ENS = ENS;
-        a->EXS = EXS;
-        a->LVLS = LVLS;
-        a->CAP = CAP;
-        a->MIN_T = MIN_T;
-        a->MAX_T = MAX_T;
-        a->CH = CH;
-        a->car = NULL;
-        a->queue = NULL;
+    /* set up args - will be freed within their thread */
+    a = mem_malloc(sizeof(args_t) * 1, MEM_ARGS);
 
-        pthread_create(&temp_threads[i], NULL, simulate_temp, (void *)a);
+    a->id = 0;
+    a->addr = (int)((sizeof(entrance_t) * ENS) + (sizeof(exit_t) * EXS)); /* where levels begin */
+    a->ENS = ENS;
+    a->EXS = EXS;
+    a->LVLS = LVLS;
+    a->CAP = CAP;
+    a->MIN_T = MIN_T;
+    a->MAX_T = MAX_T;
+    a->CH = CH;
+    a->RATE = RATE;
+    a->GENS = GENS;
+    a->SD = SD;
 
-        /* also set all alarms to '0' by default while we're here */
-        level_t * l = (level_t *)((char *)shm + a->addr);
+    /* also set all alarms to '0' by default while we're here */
+    parking_write_begin(shm);
+    for (int i = 0; i < LVLS; i++) {
+        level_t * l = (level_t *)((char *)shm + a->addr + (sizeof(level_t) * i));
         l->alarm = '0';
+        EVENT_SET(shm, &l->alarm, '0');
     }
-    
+    parking_write_end(shm);
+
+    pthread_create(&temp_thread, NULL, simulate_temp, (void *)a);
 
     /* -----------------------------------------------
      *          START SPAWNING CARS THREAD
@@ -267,7 +381,7 @@ int main (void) {
     pthread_t spawn_cars_thread;
 
     /* set up args - will be freed within their thread */
-    a = malloc(sizeof(args_t) * 1);
+    a = mem_malloc(sizeof(args_t) * 1, MEM_ARGS);
 
     a->id = 0;
     a->addr = 0;
@@ -278,8 +392,9 @@ int main (void) {
     a->MIN_T = MIN_T;
     a->MAX_T = MAX_T;
     a->CH = CH;
-    a->car = NULL;
-    a->queue = NULL;
+    a->RATE = RATE;
+    a->GENS = GENS;
+    a->SD = SD;
 
     pthread_create(&spawn_cars_thread, NULL, spawn_cars, (void *)a);
 
@@ -320,9 +435,23 @@ int main (void) {
     pthread_join(spawn_cars_thread, NULL);
     for (int i = 0; i < ENS; i++) pthread_join(en_threads[i], NULL);
     for (int i = 0; i < EXS; i++) pthread_join(ex_threads[i], NULL);
-    for (int i = 0; i < LVLS; i++) pthread_join(temp_threads[i], NULL);
+    pthread_join(temp_thread, NULL);
+    lifecycle_stop((CK[0] != '\0') ? sim_checkpoint_keep : NULL);
+    metrics_stop();
     puts("~All threads returned");
+    metrics_report("Simulator");
+    journey_report(ENS, EXS);
+    lifecycle_report();
+    if (RESULTS[0] != '\0') write_results(RESULTS, ENS, EXS, RATE);
+    lockprof_report();
+    trace_dump();
+    event_stop();
+    lpr_capture_stop();
 
+    /* -----------------------------------------------
+     *   CHECKPOINT THE CARS STILL QUEUED OR INSIDE
+     * -------------------------------------------- */
+    if (CK[0] != '\0') sim_checkpoint_save(CK, ENS, EXS, LVLS, CAP);
     
     /* -----------------------------------------------
      *             EMPTY QUEUES (FREE ITEMS)
@@ -339,11 +468,12 @@ int main (void) {
      *          FREE QUEUES
      *          UNMAP SHARED MEMORY
      * -------------------------------------------- */
-    free(a);
-    free(new_q);
-    free(en_queues);
-    free(ex_queues);
+    for (int i = 0; i < ENS; i++) mem_free(en_queues[i]);
+    for (int i = 0; i < EXS; i++) mem_free(ex_queues[i]);
+    mem_free(en_queues);
+    mem_free(ex_queues);
     puts("~All queues destroyed");
+    mem_report();
 
     /* commented out because other software may still be running 
     and needs access to the shared memory */
@@ -352,4 +482,27 @@ int main (void) {
     puts("~Goodbye");
     puts("");
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Writes the run's results to simulator.json in a folder,
+ * for ./LOAD-TEST to collect.
+ *
+ * @param dir - folder to write to, must exist
+ * @param ens - no. of entrances
+ * @param exs - no. of exits
+ * @param rate - ARRIVAL_RATE after checking bounds
+ */
+static void write_results(const char *dir, int ens, int exs, int rate) {
+    char path[512];
+
+    snprintf(path, sizeof(path), "%s/simulator.json", dir);
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) {
+        perror("Writing results");
+        return;
+    }
+    journey_json(fp, ens, exs, rate);
+    fclose(fp);
+    printf("~Results written to %s\n", path);
+}
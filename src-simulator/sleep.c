@@ -4,12 +4,9 @@
  * @date    September 2021
  * @brief   Source code for sleep.h
  ***********************************************/
-#include <time.h>    /* for timespec and nanosleep */
-
 #include "sleep.h"   /* corresponding header */
-#include "sim-common.h" /* for slow motion value */
+#include "../src-common/sim-clock.h" /* for simulated time */
 
 void sleep_for_millis(int ms) {
-   struct timespec remaining, requested = {(ms / 1000) * SLOW, ((ms % 1000) * 1000000) * SLOW};
-   nanosleep(&requested, &remaining);
-}
\ No newline at end of file
+    sim_sleep_ms(ms);
+}
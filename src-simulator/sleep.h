@@ -7,8 +7,9 @@
 #pragma once
 
 /**
- * @brief Sleeps for 'ms' milliseconds
+ * @brief Sleeps for 'ms' milliseconds of simulated time (see
+ * sim-clock.h), so SPEED applies
  * 
  * @param ms - milliseconds to sleep
  */
-void sleep_for_millis(int ms);
\ No newline at end of file
+void sleep_for_millis(int ms);
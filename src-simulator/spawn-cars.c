@@ -9,16 +9,43 @@
 #include <pthread.h>    /* for thread operations */
 #include <stdlib.h>     /* for misc like rand */
 #include <ctype.h>      /* for isdigit/isalpha */
+#include <math.h>       /* for log, random gaps between arrivals */
 
 #include "spawn-cars.h" /* corresponding header */
 #include "sim-common.h" /* for flag & rand lock */
+#include "balance.h"    /* for joining the shortest queue */
 #include "queue.h"      /* for queue operations */
 #include "sleep.h"      /* for custom millisecond sleep */
+#include "sim-metrics.h" /* for recording metrics */
+#include "journey.h"    /* for timing car journeys */
+#include "traffic.h"    /* for the traffic profile */
+#include "../config.h"  /* for TRAFFIC_FILE */
+#include "../src-common/lock-prof.h" /* for profiling locks */
+#include "../src-common/mem-account.h" /* for accounting memory */
+#include "../src-common/run-config.h" /* for overriding TRAFFIC_FILE */
+#include "../src-common/sim-clock.h" /* for when cars are due */
+
+#define GENERATOR_BATCH 256 /* cars queued per take of the queues' lock at most */
+
+/* 1 car generator thread, playing the traffic profile's phases */
+typedef struct generator_t {
+    int id;
+    int gens;               /* no. of generators */
+    const traffic_t *traffic;
+    item_t **pool;          /* authorised plates */
+    int total;              /* plates in the pool */
+    float chance;           /* CHANCE after checking bounds */
+    int exits;              /* EXITS after checking bounds */
+    uint64_t rng;           /* the generator's own random state */
+} generator_t;
 
 /* function prototypes */
 void random_plate(car_t *c);
 void random_chance(car_t *c, float chance, item_t **pool, int total);
 bool validate_plate(char *p);
+static void *generate(void *arg);
+static car_t *generate_car(generator_t *g);
+static void queue_cars(generator_t *g, car_t **cars, int *to, double *due, int n);
 
 void *spawn_cars(void *args) {
 
@@ -33,7 +60,7 @@ void *spawn_cars(void *args) {
     size_t pool_size = 100;
     int added = 0; /* also the index */
 
-    item_t **pool = malloc(sizeof(item_t *) * pool_size);
+    item_t **pool = mem_malloc(sizeof(item_t *) * pool_size, MEM_PLATES);
     if (pool == NULL) {
         perror("malloc pool in spawn-cars thread");
         exit(1);
@@ -54,7 +81,11 @@ void *spawn_cars(void *args) {
         line[strcspn(line, "\n")] = 0;
         
         if (validate_plate(line)) {
-            item_t *new_i = malloc(sizeof(item_t));
+            item_t *new_i = mem_malloc(sizeof(item_t), MEM_PLATES);
+            if (new_i == NULL) {
+                perror("malloc plate in spawn-cars thread");
+                exit(1);
+            }
             strncpy(new_i->plate, line, 7);
             pool[added] = new_i;
             //printf("%s, %s, %s\n", line, new_i->plate, pool[added]->plate);
@@ -65,7 +96,7 @@ void *spawn_cars(void *args) {
         if (added >= (int)pool_size) {
             pool_size *= 2;
 
-            pool = realloc(pool, pool_size * sizeof(item_t *));
+            pool = mem_realloc(pool, pool_size * sizeof(item_t *), MEM_PLATES);
             if (pool == NULL) {
                 perror("realloc pool in spawn-cars thread");
                 exit(1);
@@ -77,18 +108,64 @@ void *spawn_cars(void *args) {
     fclose(fp);
 
     /* -----------------------------------------------
-     *        LOOP WHILE SIMULATION HASN'T ENDED
+     *   LOAD THE TRAFFIC PROFILE, IF ANY, AND HAND IT
+     *       TO THE GENERATORS UNTIL THE SIM ENDS
      * -------------------------------------------- */
-    while (!end_simulation) {
-        /* lock rand call for random entrance and milliseconds wait */
-        pthread_mutex_lock(&rand_lock);
+    traffic_t traffic;
+    const char *path = config_str("TRAFFIC_FILE", TRAFFIC_FILE);
+    uint64_t rng = ((uint64_t)a->SD * 2654435761u) | 1; /* entrances, exits & parking times */
+
+    traffic_init(&traffic, a->ENS);
+    int phases = traffic_load(&traffic, path);
+    if (phases > 0) {
+        pthread_t threads[TRAFFIC_MAX_GENERATORS];
+        generator_t gens[TRAFFIC_MAX_GENERATORS];
+
+        printf("~%d arrival phase(s) from %s, played by %d generator(s)\n", phases, path, a->GENS);
+        for (int i = 0; i < a->GENS; i++) {
+            gens[i] = (generator_t){.id = i, .gens = a->GENS, .traffic = &traffic, .pool = pool,
+                .total = added, .chance = a->CH, .exits = a->EXS, .rng = rng ^ ((uint64_t)(i + 1) << 32)};
+            pthread_create(&threads[i], NULL, generate, &gens[i]);
+        }
+        for (int i = 0; i < a->GENS; i++) pthread_join(threads[i], NULL);
+    }
+
+    /* -----------------------------------------------
+     *        LOOP WHILE SIMULATION HASN'T ENDED
+     * -----------------------------------------------
+     * Without arrival phases, 1 car every 1..100ms, or with
+     * an ARRIVAL_RATE cars arrive open loop: each is due an
+     * exponentially distributed gap (a Poisson process)
+     * after the last was DUE, not after it was queued, so a
+     * car park that cannot keep up sees its queues grow
+     * rather than fewer cars arriving
+     */
+    double next_due = sim_now_ms();
+
+    while (!end_simulation && phases <= 0) {
+        /* lock rand call for random milliseconds wait */
+        PROF_METRICS_LOCK(&rand_lock, LK_RAND, MET_LOCK_RAND);
         int pause_spawn = ((rand() % 100) + 1); /* 1..100 */
-        int q_to_goto = rand() % a->ENS;
-        pthread_mutex_unlock(&rand_lock);
+        double u = ((double)rand() + 1) / ((double)RAND_MAX + 2); /* 0..1 exclusive */
+        PROF_UNLOCK(&rand_lock, LK_RAND);
 
-        /* wait 1..100 milliseconds before spawning a new car */
-        sleep_for_millis(pause_spawn);
-        car_t *new_c = malloc(sizeof(car_t) * 1);
+        if (a->RATE > 0) {
+            /* wait until the next car is due */
+            next_due += -log(u) * 1000 / a->RATE;
+            sim_sleep_until_ms(next_due);
+            if (end_simulation) break;
+        } else {
+            /* wait 1..100 milliseconds before spawning a new car */
+            sleep_for_millis(pause_spawn);
+        }
+        car_t *new_c = mem_malloc(sizeof(car_t) * 1, MEM_CAR);
+        if (new_c == NULL) {
+            perror("malloc car");
+            continue;
+        }
+        journey_arrive(new_c);
+        new_c->duration = traffic_park(&traffic, &rng);
+        new_c->exit = (int)(traffic_rand(&rng) % (uint64_t)a->EXS);
         
         /* -----------------------------------------------
          *          TOGGLE FOR DEMO / DEBUGGING
@@ -97,11 +174,17 @@ void *spawn_cars(void *args) {
          * -------------------------------------------- */
         //strcpy(new_c->plate, "206WHS");
         random_chance(new_c, a->CH, pool, added);
+        EVENT(EV_SPAWN, new_c->plate, new_c->seq);
 
-        /* goto random entrance */        
-        pthread_mutex_lock(&en_queues_lock);
-        push_queue(en_queues[q_to_goto], new_c);
-        pthread_mutex_unlock(&en_queues_lock);
+        /* goto random entrance (by the entrances' weights) */
+        int q_to_goto = traffic_entrance(&traffic, &rng);
+        car_stamp(new_c, STAMP_EN_QUEUED);
+        PROF_METRICS_LOCK(&en_queues_lock, LK_EN_QUEUES, MET_LOCK_EN);
+        push_queue(en_queues[balance_join(en_queues, a->ENS, q_to_goto)], new_c);
+        PROF_UNLOCK(&en_queues_lock, LK_EN_QUEUES);
+        metric_inc(MET_SPAWNED);
+        metric_gauge_add(MET_EN_QUEUE, 1);
+        if (a->RATE > 0) journey_lag(0, (uint64_t)((sim_now_ms() - next_due) * 1000000));
         pthread_cond_broadcast(&en_queues_cond); 
         
         /* after placing each car in a queue, broadcast to all entrance
@@ -111,13 +194,133 @@ void *spawn_cars(void *args) {
     }
 
     /* free each individual item before the array itself */
-    for (int i = 0; i < added; i++) free(pool[i]);
-    free(pool);
+    for (int i = 0; i < added; i++) mem_free(pool[i]);
+    mem_free(pool);
+
+    mem_free(a); /* free args */
+    return NULL;
+}
+
+/**
+ * @brief Plays every arrival phase of the traffic profile at 1/gens of
+ * its rate, until the phases are over or the Sim ends. Sleeps until the
+ * next car is due, then queues every car due by then together.
+ *
+ * @param arg - the generator_t
+ * @return void* - NULL
+ */
+static void *generate(void *arg) {
+    generator_t *g = (generator_t *)arg;
+    const traffic_t *t = g->traffic;
+    traffic_stream_t streams[TRAFFIC_MAX_PHASES];
+    car_t *cars[GENERATOR_BATCH];
+    int to[GENERATOR_BATCH];
+    double due[GENERATOR_BATCH];
+
+    for (int p = 0; p < t->n_phases; p++) traffic_start(t, p, g->gens, &streams[p], &g->rng);
+
+    while (!end_simulation) {
+        /* the phase with the earliest car due */
+        int next = -1;
+        for (int p = 0; p < t->n_phases; p++) {
+            if (!streams[p].done && (next < 0 || streams[p].due < streams[next].due)) next = p;
+        }
+        if (next < 0) break; /* every phase is over */
+
+        /* in steps of 100ms (real), so a phase far in the future does not outlast the Sim */
+        double when = streams[next].due;
+        while (!end_simulation && sim_now_ms() < when) sim_sleep_until_ms(fmin(when, sim_now_ms() + (100 * sim_speed())));
+        if (end_simulation) break;
+
+        /* -----------------------------------------------
+         *   EVERY CAR DUE BY NOW, QUEUED IN BATCHES SO A
+         *   HIGH RATE TAKES THE QUEUES' LOCK RARELY
+         * -------------------------------------------- */
+        double now = sim_now_ms();
+        int n = 0;
+        while (next >= 0 && streams[next].due <= now) {
+            double was_due = streams[next].due;
+            int arriving = traffic_advance(t, next, g->gens, &streams[next], &g->rng);
 
-    free(a); /* free args */
+            for (int c = 0; c < arriving; c++) {
+                if (n == GENERATOR_BATCH) {
+                    queue_cars(g, cars, to, due, n);
+                    n = 0;
+                }
+                cars[n] = generate_car(g);
+                if (cars[n] == NULL) continue;
+                to[n] = traffic_entrance(t, &g->rng);
+                due[n] = was_due;
+                n++;
+            }
+
+            next = -1;
+            for (int p = 0; p < t->n_phases; p++) {
+                if (!streams[p].done && (next < 0 || streams[p].due < streams[next].due)) next = p;
+            }
+        }
+        queue_cars(g, cars, to, due, n);
+    }
     return NULL;
 }
 
+/**
+ * @brief Creates a car with a plate, time to park & exit, taking no lock for
+ * random numbers (unlike random_chance) so generators never contend.
+ *
+ * @param g - the generator
+ * @return car_t* - new car, NULL if out of memory
+ */
+static car_t *generate_car(generator_t *g) {
+    car_t *c = mem_malloc(sizeof(car_t) * 1, MEM_CAR);
+    if (c == NULL) {
+        perror("malloc car");
+        return NULL;
+    }
+    journey_arrive(c);
+    c->duration = traffic_park(g->traffic, &g->rng);
+    c->exit = (int)(traffic_rand(&g->rng) % (uint64_t)g->exits);
+
+    /* an authorised plate CHANCE of the time, else a random one */
+    if (traffic_uniform(&g->rng) < g->chance && g->total > 0) {
+        strcpy(c->plate, g->pool[traffic_rand(&g->rng) % (uint64_t)g->total]->plate);
+    } else {
+        for (int i = 0; i < 3; i++) c->plate[i] = "123456789"[traffic_rand(&g->rng) % 9];
+        for (int i = 3; i < 6; i++) c->plate[i] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"[traffic_rand(&g->rng) % 26];
+        c->plate[6] = '\0';
+    }
+    EVENT(EV_SPAWN, c->plate, c->seq);
+    return c;
+}
+
+/**
+ * @brief Queues a batch of cars at their entrances under 1 take of the
+ * queues' lock, then records how late each was queued.
+ *
+ * @param g - the generator
+ * @param cars - cars to queue
+ * @param to - each car's entrance
+ * @param due - when each car was due (sim_now_ms)
+ * @param n - no. of cars
+ */
+static void queue_cars(generator_t *g, car_t **cars, int *to, double *due, int n) {
+    if (n == 0) return;
+
+    for (int i = 0; i < n; i++) car_stamp(cars[i], STAMP_EN_QUEUED);
+    PROF_METRICS_LOCK(&en_queues_lock, LK_EN_QUEUES, MET_LOCK_EN);
+    for (int i = 0; i < n; i++) push_queue(en_queues[balance_join(en_queues, g->traffic->ens, to[i])], cars[i]);
+    PROF_UNLOCK(&en_queues_lock, LK_EN_QUEUES);
+    pthread_cond_broadcast(&en_queues_cond);
+
+    double now = sim_now_ms();
+    metric_add(MET_SPAWNED, (uint64_t)n);
+    metric_gauge_add(MET_EN_QUEUE, n);
+    for (int i = 0; i < n; i++) {
+        journey_lag(g->id, (uint64_t)((now - due[i]) * 1000000));
+        metric_observe_us(MET_GEN_LAG, (uint64_t)((now - due[i]) * 1000));
+    }
+}
+
 bool validate_plate(char *p) {
     /* check if plate is correct length */
     if (strlen(p) != 6) return false;
@@ -147,22 +350,22 @@ void random_plate(car_t *c) {
 
     /* 3 random numbers */
     for (int i = 0; i < 3; i++) {
-        pthread_mutex_lock(&rand_lock);
+        PROF_METRICS_LOCK(&rand_lock, LK_RAND, MET_LOCK_RAND);
         char rand_number = "123456789"[rand() % 9];
-        pthread_mutex_unlock(&rand_lock);
+        PROF_UNLOCK(&rand_lock, LK_RAND);
         rand_plate[i] = rand_number;
     }
 
     /* 3 random letters */
     for (int i = 3; i < 6; i++) {
-        pthread_mutex_lock(&rand_lock);
+        PROF_METRICS_LOCK(&rand_lock, LK_RAND, MET_LOCK_RAND);
         char rand_letter = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"[rand() % 26];
-        pthread_mutex_unlock(&rand_lock);
+        PROF_UNLOCK(&rand_lock, LK_RAND);
         rand_plate[i] = rand_letter;
     }
 
     /* don't forget the null terminator */
-    rand_plate[7] = '\0';
+    rand_plate[6] = '\0';
 
     /* assign to this car */
     strcpy(c->plate, rand_plate);
@@ -173,16 +376,16 @@ void random_chance(car_t *c, float chance, item_t **pool, int total) {
     if (chance > 1 || chance < 0) chance = (float)0.50;
 
     float n = 0;
-    pthread_mutex_lock(&rand_lock);
+    PROF_METRICS_LOCK(&rand_lock, LK_RAND, MET_LOCK_RAND);
     n = (float)((rand() % 100) + 1) / 100; /* 0..99 +1 for 1..100 then /100 for 0.00..1.00 */
-    pthread_mutex_unlock(&rand_lock);
+    PROF_UNLOCK(&rand_lock, LK_RAND);
 
     /* assign to this car */
     if (n < chance) {
         int index = 0;
-        pthread_mutex_lock(&rand_lock);
+        PROF_METRICS_LOCK(&rand_lock, LK_RAND, MET_LOCK_RAND);
         index = rand() % total;
-        pthread_mutex_unlock(&rand_lock);
+        PROF_UNLOCK(&rand_lock, LK_RAND);
         /* since there are a finite no. of authorised cars
          * versus millions non-authorised, we will only assign
          * a non-authorised plate n% of the time */
@@ -15,9 +15,13 @@ typedef struct item_t {
 } item_t;
 
 /**
- * @brief   Spawns a new car every 1..100 milliseconds. 
+ * @brief   Spawns cars as the traffic profile (TRAFFIC_FILE)
+ *          schedules them, on GENERATORS threads, or without
+ *          arrival phases a new car every 1..100 milliseconds,
+ *          or ARRIVAL_RATE cars per second at random gaps.
  *          Cars are given a randomised license plate 
- *          and directed to a random queue.
+ *          and directed to a random queue (by the entrances'
+ *          weights).
  * 
  * @param   args - collection or values
  * @return  void* - mandatory return value (NULL)
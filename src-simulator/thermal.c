@@ -0,0 +1,204 @@
+/************************************************
+ * @file    thermal.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Source code for thermal.h
+ ***********************************************/
+#include <stdio.h>      /* for IO operations */
+#include <stdlib.h>     /* for dynamic memory */
+#include <string.h>     /* for string operations */
+
+#include "thermal.h"    /* corresponding header */
+#include "../src-common/mem-account.h" /* for accounting memory */
+
+/* function prototypes */
+static uint32_t mix(uint32_t x);
+
+thermal_t *thermal_new(int n, int min, int max, uint32_t seed) {
+    thermal_t *t = mem_malloc(sizeof(thermal_t) * 1, MEM_THERMAL);
+    if (t == NULL) return NULL;
+
+    t->n = n;
+    t->ambient = mem_calloc(n, sizeof(float), MEM_THERMAL);
+    t->excess = mem_calloc(n, sizeof(float), MEM_THERMAL);
+    t->next = mem_calloc(n, sizeof(float), MEM_THERMAL);
+    t->forced = mem_calloc(n, sizeof(float), MEM_THERMAL);
+    t->source = mem_calloc(n, sizeof(float), MEM_THERMAL);
+    t->temp = mem_calloc(n, sizeof(float), MEM_THERMAL);
+    t->min = (float)min;
+    t->max = (float)max;
+    t->seed = seed;
+    t->tick = 0;
+    t->events = NULL;
+    t->n_events = 0;
+
+    if (t->ambient == NULL || t->excess == NULL || t->next == NULL ||
+        t->forced == NULL || t->source == NULL || t->temp == NULL) {
+        thermal_free(t);
+        return NULL;
+    }
+
+    /* every sensor starts at the bottom of the window, like the Sim always did */
+    for (int i = 0; i < n; i++) {
+        t->ambient[i] = t->min;
+        t->temp[i] = t->min;
+    }
+    return t;
+}
+
+int thermal_load_scenario(thermal_t *t, const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) return -1;
+
+    char line[1000]; /* buffer to ensure whole line is read */
+    int line_no = 0;
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        char kind[16];
+        int level;
+        fire_event_t e;
+
+        line_no++;
+        line[strcspn(line, "#\n")] = 0; /* strip comments & newline */
+        if (sscanf(line, "%15s", kind) != 1) continue; /* blank line */
+
+        if (sscanf(line, "%15s %d %ld %ld %f", kind, &level, &e.start, &e.duration, &e.degrees) != 5 ||
+            level < 1 || level > t->n || e.start < 0 || e.duration < 0) {
+            printf("\t%s line %d not understood, skipping\n", path, line_no);
+            continue;
+        }
+
+        if (strcmp(kind, "rise") == 0) {
+            e.kind = FIRE_RISE;
+        } else if (strcmp(kind, "spike") == 0) {
+            e.kind = FIRE_SPIKE;
+        } else if (strcmp(kind, "spread") == 0) {
+            e.kind = FIRE_SPREAD;
+        } else {
+            printf("\t%s line %d has unknown fire '%s', skipping\n", path, line_no, kind);
+            continue;
+        }
+        e.sensor = level - 1;
+
+        fire_event_t *grown = mem_realloc(t->events, sizeof(fire_event_t) * (t->n_events + 1), MEM_THERMAL);
+        if (grown == NULL) break;
+        t->events = grown;
+        t->events[t->n_events] = e;
+        t->n_events++;
+    }
+
+    fclose(fp);
+    return t->n_events;
+}
+
+void thermal_step(thermal_t *t) {
+    int n = t->n;
+    float dt = THERMAL_TICK / 1000.0f;
+    float k = THERMAL_TRANSFER * dt;
+    float keep = 1.0f - (THERMAL_COOLING * dt);
+    long now = (long)(t->tick * THERMAL_TICK);
+    uint32_t tick_hash = mix((uint32_t)t->tick ^ t->seed);
+
+    /* restrict so the compiler knows the arrays never overlap */
+    float *restrict ambient = t->ambient;
+    float *restrict excess = t->excess;
+    float *restrict next = t->next;
+    float *restrict forced = t->forced;
+    float *restrict source = t->source;
+    float *restrict temp = t->temp;
+
+    /* -----------------------------------------------
+     *      APPLY SCHEDULED FIRES ACTIVE THIS TICK
+     * -------------------------------------------- */
+    for (int i = 0; i < n; i++) {
+        forced[i] = 0;
+        source[i] = 0;
+    }
+
+    for (int j = 0; j < t->n_events; j++) {
+        fire_event_t *e = &t->events[j];
+        long elapsed = now - e->start;
+        int s = e->sensor;
+
+        if (elapsed < 0) continue; /* not started yet */
+
+        if (e->kind == FIRE_RISE) {
+            /* climb to the target temperature over the duration, then hold */
+            float progress = (e->duration > 0 && elapsed < e->duration) ? (float)elapsed / e->duration : 1.0f;
+            float target = (e->degrees - ambient[s]) * progress;
+            if (target > forced[s]) forced[s] = target;
+
+        } else if (e->kind == FIRE_SPIKE) {
+            if (elapsed < e->duration && e->degrees > forced[s]) forced[s] = e->degrees;
+
+        } else if (e->duration == 0 || elapsed < e->duration) {
+            source[s] += e->degrees * dt;
+        }
+    }
+
+    /* -----------------------------------------------
+     *   AMBIENT RANDOM WALK, UP OR DOWN BY 1 DEGREE
+     *   KEPT WITHIN THE MIN..MAX WINDOW
+     * -------------------------------------------- */
+    for (int i = 0; i < n; i++) {
+        float a = ambient[i] + (float)((int)(mix(tick_hash ^ ((uint32_t)i * 0x9e3779b9u)) % 3) - 1);
+        a = (a < t->min) ? t->min : a;
+        ambient[i] = (a > t->max) ? t->max : a;
+    }
+
+    /* -----------------------------------------------
+     *   HEAT TRANSFER BETWEEN ADJACENT SENSORS
+     *   (ENDS ONLY HAVE 1 NEIGHBOUR)
+     * -------------------------------------------- */
+    if (n == 1) {
+        next[0] = excess[0];
+    } else {
+        next[0] = excess[0] + (k * (excess[1] - excess[0]));
+        for (int i = 1; i < n - 1; i++) {
+            next[i] = excess[i] + (k * (excess[i - 1] - (2 * excess[i]) + excess[i + 1]));
+        }
+        next[n - 1] = excess[n - 1] + (k * (excess[n - 2] - excess[n - 1]));
+    }
+
+    /* -----------------------------------------------
+     *   COOL, HEAT, APPLY FORCED TEMPS, SUM UP
+     * -------------------------------------------- */
+    for (int i = 0; i < n; i++) {
+        float e = (next[i] * keep) + source[i];
+        e = (e < forced[i]) ? forced[i] : e;
+        next[i] = e;
+        temp[i] = ambient[i] + e;
+    }
+
+    /* the next excess becomes the current one */
+    t->next = excess;
+    t->excess = next;
+    t->tick++;
+}
+
+void thermal_free(thermal_t *t) {
+    mem_free(t->ambient);
+    mem_free(t->excess);
+    mem_free(t->next);
+    mem_free(t->forced);
+    mem_free(t->source);
+    mem_free(t->temp);
+    mem_free(t->events);
+    mem_free(t);
+}
+
+/**
+ * @brief Scrambles the bits of a number (lowbias32 hash), used to make
+ * random numbers from (seed, tick, sensor) without any shared state.
+ *
+ * @param x - number to scramble
+ * @return uint32_t - scrambled number
+ */
+static uint32_t mix(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
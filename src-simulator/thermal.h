@@ -0,0 +1,108 @@
+/************************************************
+ * @file    thermal.h
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   API for the thermal scenario engine. Advances
+ *          the temperature of every sensor at once each
+ *          tick, rather than 1 thread per level.
+ *
+ *          Each sensor's temperature is an ambient part
+ *          (the same +-1 random walk within MIN..MAX temp
+ *          the Sim always had) plus an excess part heated
+ *          by scheduled fires. Excess heat flows between
+ *          adjacent sensors and slowly cools, so a fire on
+ *          one level warms the levels above and below.
+ *
+ *          All state is kept as flat arrays of floats, 1
+ *          element per sensor, so each step is a handful of
+ *          simple loops the compiler can vectorise. Random
+ *          numbers are a hash of (seed, tick, sensor) so a
+ *          run is reproducible from its seed alone.
+ *
+ *          Scenario file format, 1 fire per line ('#' = comment),
+ *          levels count from 1 and times are in milliseconds:
+ *
+ *          rise   <level> <start> <duration> <degrees>
+ *              climbs to <degrees> over <duration> then holds
+ *          spike  <level> <start> <duration> <degrees>
+ *              jumps <degrees> above ambient for <duration>
+ *          spread <level> <start> <duration> <degrees>
+ *              heats by <degrees> per second for <duration>
+ *              (0 = until the end), spreading to other levels
+ ***********************************************/
+#pragma once
+
+#include <stdint.h>     /* for int types */
+
+#define THERMAL_TICK 2          /* ms between steps */
+#define THERMAL_TRANSFER 0.5f   /* share of the excess heat difference between neighbours flowing per second */
+#define THERMAL_COOLING 0.05f   /* share of excess heat lost per second */
+
+typedef enum fire_kind_t {
+    FIRE_RISE,
+    FIRE_SPIKE,
+    FIRE_SPREAD
+} fire_kind_t;
+
+/* A scheduled fire from the scenario file */
+typedef struct fire_event_t {
+    fire_kind_t kind;
+    int sensor;         /* index of the sensor (level - 1) */
+    long start;         /* ms after the engine started */
+    long duration;      /* ms, 0 = until the end (spread only) */
+    float degrees;      /* meaning depends on kind, see top of file */
+} fire_event_t;
+
+/* Thermal engine state, arrays hold 1 element per sensor */
+typedef struct thermal_t {
+    int n;              /* no. of sensors */
+    float *ambient;     /* random walk part */
+    float *excess;      /* heat from fires */
+    float *next;        /* scratch for the next excess */
+    float *forced;      /* lowest excess allowed this tick (rise & spike) */
+    float *source;      /* degrees added this tick (spread) */
+    float *temp;        /* ambient + excess */
+    float min;          /* ambient window */
+    float max;
+    uint32_t seed;
+    uint64_t tick;      /* steps taken so far */
+    fire_event_t *events;
+    int n_events;
+} thermal_t;
+
+/**
+ * @brief Creates a thermal engine with every sensor starting at the
+ * bottom of the ambient window and no fires scheduled.
+ *
+ * @param n - no. of sensors
+ * @param min - lowest ambient temperature
+ * @param max - highest ambient temperature
+ * @param seed - seed for the random walk
+ * @return thermal_t* - the engine, NULL if out of memory
+ */
+thermal_t *thermal_new(int n, int min, int max, uint32_t seed);
+
+/**
+ * @brief Loads scheduled fires from a scenario file (see top of file).
+ * Lines that cannot be understood, or name a level that does not exist,
+ * are skipped with a warning.
+ *
+ * @param t - engine to schedule fires in
+ * @param path - scenario file
+ * @return int - no. of fires loaded, -1 if the file could not be opened
+ */
+int thermal_load_scenario(thermal_t *t, const char *path);
+
+/**
+ * @brief Advances every sensor by 1 tick (THERMAL_TICK milliseconds).
+ *
+ * @param t - engine to advance
+ */
+void thermal_step(thermal_t *t);
+
+/**
+ * @brief Frees an engine and everything it owns.
+ *
+ * @param t - engine to free
+ */
+void thermal_free(thermal_t *t);
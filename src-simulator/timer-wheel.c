@@ -0,0 +1,93 @@
+/************************************************
+ * @file    timer-wheel.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Source code for timer-wheel.h
+ ***********************************************/
+#include <stdlib.h>     /* for NULL */
+
+#include "timer-wheel.h" /* corresponding header */
+#include "../src-common/mem-account.h" /* for accounting memory */
+
+/* function prototypes */
+static long slot_of(const wheel_t *w, long ms);
+
+int wheel_init(wheel_t *w, long n_slots, double now) {
+    w->slots = mem_calloc((size_t)n_slots, sizeof(wheel_entry_t *), MEM_LIFECYCLE);
+    if (w->slots == NULL) return -1;
+    w->n_slots = n_slots;
+    w->tick = (long)now;
+    w->count = 0;
+    w->peak = 0;
+    return 0;
+}
+
+void wheel_add(wheel_t *w, wheel_entry_t *e) {
+    long ms = (long)e->due;
+
+    /* already due (or due this ms), so the next advance finds it */
+    if (ms <= w->tick) ms = w->tick + 1;
+
+    long s = slot_of(w, ms);
+    e->next = w->slots[s];
+    w->slots[s] = e;
+    if (++w->count > w->peak) w->peak = w->count;
+}
+
+wheel_entry_t *wheel_advance(wheel_t *w, double now) {
+    long target = (long)now;
+    wheel_entry_t *due = NULL;
+
+    if (target <= w->tick) return NULL;
+
+    /* after a jump of more than 1 turn, every slot is looked at once */
+    long steps = target - w->tick;
+    if (steps > w->n_slots) steps = w->n_slots;
+
+    for (long ms = w->tick + 1; ms <= w->tick + steps; ms++) {
+        wheel_entry_t **link = &w->slots[slot_of(w, ms)];
+
+        /* unlink the entries due by now, pass over those due in a later turn */
+        while (*link != NULL) {
+            wheel_entry_t *e = *link;
+            if ((long)e->due <= target) {
+                *link = e->next;
+                e->next = due;
+                due = e;
+                w->count--;
+            } else {
+                link = &e->next;
+            }
+        }
+    }
+    w->tick = target;
+    return due;
+}
+
+wheel_entry_t *wheel_destroy(wheel_t *w) {
+    wheel_entry_t *all = NULL;
+
+    for (long s = 0; s < w->n_slots; s++) {
+        while (w->slots[s] != NULL) {
+            wheel_entry_t *e = w->slots[s];
+            w->slots[s] = e->next;
+            e->next = all;
+            all = e;
+        }
+    }
+    mem_free(w->slots);
+    w->slots = NULL;
+    w->count = 0;
+    return all;
+}
+
+/**
+ * @brief The slot a millisecond falls in.
+ *
+ * @param w - wheel
+ * @param ms - millisecond, not negative
+ * @return long - slot 0..n_slots-1
+ */
+static long slot_of(const wheel_t *w, long ms) {
+    return ms % w->n_slots;
+}
@@ -0,0 +1,73 @@
+/************************************************
+ * @file    timer-wheel.h
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   API for a hashed timer wheel, holding anything
+ *          that is due at a (simulated) time for as long
+ *          as it waits, without a thread or a sleep each.
+ *
+ *          The wheel has 1 slot per millisecond, wrapping
+ *          around. An entry goes in the slot of the ms it is
+ *          due, so adding is O(1) and advancing to a new ms
+ *          looks at 1 slot. An entry due further away than
+ *          1 turn of the wheel is passed over until the turn
+ *          it is due in.
+ *
+ *          Entries are intrusive (a wheel_entry_t inside the
+ *          caller's own struct), so the wheel allocates only
+ *          its slots. Not thread safe, lock around it.
+ ***********************************************/
+#pragma once
+
+#include <stddef.h>     /* for size_t */
+
+/* Place in the wheel, put first in the struct being timed */
+typedef struct wheel_entry_t {
+    struct wheel_entry_t *next;
+    double due;         /* ms the entry is due */
+} wheel_entry_t;
+
+typedef struct wheel_t {
+    wheel_entry_t **slots;
+    long n_slots;
+    long tick;          /* last ms advanced to, due entries before it are out */
+    size_t count;       /* entries in the wheel */
+    size_t peak;        /* most entries at once */
+} wheel_t;
+
+/**
+ * @brief Creates an empty wheel.
+ *
+ * @param w - wheel to set up
+ * @param n_slots - ms per turn of the wheel, at least 1
+ * @param now - ms to start from
+ * @return int - 0 on success, -1 if out of memory
+ */
+int wheel_init(wheel_t *w, long n_slots, double now);
+
+/**
+ * @brief Adds an entry, its due time set. An entry due already is
+ * returned by the next wheel_advance.
+ *
+ * @param w - wheel
+ * @param e - entry to add
+ */
+void wheel_add(wheel_t *w, wheel_entry_t *e);
+
+/**
+ * @brief Moves the wheel on to 'now', taking out every entry due by
+ * then (in no particular order).
+ *
+ * @param w - wheel
+ * @param now - ms now
+ * @return wheel_entry_t* - due entries linked by 'next', NULL if none
+ */
+wheel_entry_t *wheel_advance(wheel_t *w, double now);
+
+/**
+ * @brief Takes out every entry, due or not, and frees the slots.
+ *
+ * @param w - wheel, unusable after
+ * @return wheel_entry_t* - entries linked by 'next', NULL if none
+ */
+wheel_entry_t *wheel_destroy(wheel_t *w);
@@ -0,0 +1,193 @@
+/************************************************
+ * @file    traffic.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Source code for traffic.h
+ ***********************************************/
+#include <stdio.h>      /* for IO operations */
+#include <string.h>     /* for string operations */
+#include <math.h>       /* for log & sin */
+
+#include "traffic.h"    /* corresponding header */
+
+/* function prototypes */
+static double next_arrival(const traffic_phase_t *p, int gens, double from, uint64_t *rng);
+static double gap_ms(double rate, uint64_t *rng);
+static int past_end(const traffic_phase_t *p, double when);
+
+void traffic_init(traffic_t *t, int ens) {
+    memset(t, 0, sizeof(traffic_t));
+    t->ens = ens;
+    for (int i = 0; i < ens; i++) t->weights[i] = 1;
+    t->weight_total = ens;
+    t->park = PARK_UNIFORM;
+    t->park_a = 100;
+    t->park_b = 10000;
+}
+
+int traffic_load(traffic_t *t, const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) return -1;
+
+    char line[1000]; /* buffer to ensure whole line is read */
+    int line_no = 0;
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        char kind[16];
+        char dist[16];
+        traffic_phase_t p = {0};
+        double x = 0;
+        double y = 0;
+        int n = 0;
+
+        line_no++;
+        line[strcspn(line, "#\n")] = 0; /* strip comments & newline */
+        if (sscanf(line, "%15s", kind) != 1) continue; /* blank line */
+
+        /* -----------------------------------------------
+         *                ARRIVAL PHASES
+         * -------------------------------------------- */
+        if (strcmp(kind, "poisson") == 0 || strcmp(kind, "burst") == 0 || strcmp(kind, "rush") == 0) {
+            int fields = sscanf(line, "%15s %ld %ld %lf %lf", kind, &p.start, &p.duration, &p.rate, &x);
+            p.kind = (kind[0] == 'p') ? ARRIVE_POISSON : (kind[0] == 'b') ? ARRIVE_BURST : ARRIVE_RUSH;
+            p.peak = (p.kind == ARRIVE_RUSH) ? x : p.rate;
+            p.size = (p.kind == ARRIVE_BURST) ? (int)x : 1;
+
+            if (fields != ((p.kind == ARRIVE_POISSON) ? 4 : 5) || p.start < 0 || p.duration < 0 ||
+                p.rate < 0 || p.rate > TRAFFIC_MAX_RATE || p.peak < 0 || p.peak > TRAFFIC_MAX_RATE ||
+                p.size < 1 || (p.kind == ARRIVE_RUSH && p.duration == 0)) {
+                printf("\t%s line %d not understood, skipping\n", path, line_no);
+                continue;
+            }
+            if (t->n_phases == TRAFFIC_MAX_PHASES) {
+                printf("\t%s line %d is past the %d phases allowed, skipping\n", path, line_no, TRAFFIC_MAX_PHASES);
+                continue;
+            }
+            t->phases[t->n_phases++] = p;
+
+        /* -----------------------------------------------
+         *               ENTRANCE WEIGHTS
+         * -------------------------------------------- */
+        } else if (strcmp(kind, "entrance") == 0) {
+            if (sscanf(line, "%15s %d %lf", kind, &n, &x) != 3 || n < 1 || n > t->ens || x < 0) {
+                printf("\t%s line %d not understood (or no such entrance), skipping\n", path, line_no);
+                continue;
+            }
+            t->weights[n - 1] = x;
+
+        /* -----------------------------------------------
+         *                TIME SPENT PARKED
+         * -------------------------------------------- */
+        } else if (strcmp(kind, "park") == 0) {
+            int fields = sscanf(line, "%15s %15s %lf %lf", kind, dist, &x, &y);
+
+            if (fields == 4 && strcmp(dist, "uniform") == 0 && x >= 1 && y >= x) {
+                t->park = PARK_UNIFORM;
+            } else if (fields == 3 && strcmp(dist, "exponential") == 0 && x > 0) {
+                t->park = PARK_EXPONENTIAL;
+            } else if (fields == 3 && strcmp(dist, "fixed") == 0 && x >= 1) {
+                t->park = PARK_FIXED;
+            } else {
+                printf("\t%s line %d not understood, skipping\n", path, line_no);
+                continue;
+            }
+            t->park_a = x;
+            t->park_b = y;
+        } else {
+            printf("\t%s line %d has unknown setting '%s', skipping\n", path, line_no, kind);
+        }
+    }
+    fclose(fp);
+
+    t->weight_total = 0;
+    for (int i = 0; i < t->ens; i++) t->weight_total += t->weights[i];
+    if (t->weight_total <= 0) {
+        printf("\t%s gives every entrance a weight of 0, using 1 each\n", path);
+        for (int i = 0; i < t->ens; i++) t->weights[i] = 1;
+        t->weight_total = t->ens;
+    }
+    return t->n_phases;
+}
+
+void traffic_start(const traffic_t *t, int phase, int gens, traffic_stream_t *s, uint64_t *rng) {
+    const traffic_phase_t *p = &t->phases[phase];
+
+    s->due = next_arrival(p, gens, (double)p->start, rng);
+    s->done = past_end(p, s->due);
+}
+
+int traffic_advance(const traffic_t *t, int phase, int gens, traffic_stream_t *s, uint64_t *rng) {
+    const traffic_phase_t *p = &t->phases[phase];
+
+    s->due = next_arrival(p, gens, s->due, rng);
+    s->done = past_end(p, s->due);
+    return p->size;
+}
+
+int traffic_entrance(const traffic_t *t, uint64_t *rng) {
+    double pick = traffic_uniform(rng) * t->weight_total;
+
+    for (int i = 0; i < t->ens - 1; i++) {
+        pick -= t->weights[i];
+        if (pick < 0) return i;
+    }
+    return t->ens - 1;
+}
+
+long traffic_park(const traffic_t *t, uint64_t *rng) {
+    double ms = t->park_a;
+
+    if (t->park == PARK_UNIFORM) ms = t->park_a + (traffic_uniform(rng) * (t->park_b - t->park_a));
+    if (t->park == PARK_EXPONENTIAL) ms = -log(traffic_uniform(rng)) * t->park_a;
+    return (ms < 1) ? 1 : (long)ms;
+}
+
+/**
+ * @brief When the next arrival of a phase is due after another. Rush
+ * hour's rate changes over time, so its arrivals are drawn at the
+ * peak rate and each kept with a chance of the rate at that moment
+ * over the peak (thinning).
+ *
+ * @param p - phase
+ * @param gens - no. of generators sharing the phase
+ * @param from - ms the last arrival was due (or the phase's start)
+ * @param rng - random state
+ * @return double - ms the next arrival is due, past the end if none
+ */
+static double next_arrival(const traffic_phase_t *p, int gens, double from, uint64_t *rng) {
+    if (p->kind == ARRIVE_POISSON) return from + gap_ms(p->rate / gens, rng);
+    if (p->kind == ARRIVE_BURST) return from + gap_ms(p->rate / p->size / gens, rng);
+
+    double top = (p->peak > p->rate) ? p->peak : p->rate;
+    while (!past_end(p, from)) {
+        from += gap_ms(top / gens, rng);
+        double f = (from - p->start) / p->duration; /* 0..1 through the phase */
+        double rate = p->rate + ((p->peak - p->rate) * sin(M_PI * f));
+        if (traffic_uniform(rng) * top < rate) break;
+    }
+    return from;
+}
+
+/**
+ * @brief A random (exponential) gap between arrivals.
+ *
+ * @param rate - arrivals per second, 0 = never
+ * @param rng - random state
+ * @return double - ms, infinite for a rate of 0
+ */
+static double gap_ms(double rate, uint64_t *rng) {
+    if (rate <= 0) return INFINITY;
+    return -log(traffic_uniform(rng)) * 1000 / rate;
+}
+
+/**
+ * @brief Checks if a moment is past the end of a phase.
+ *
+ * @param p - phase
+ * @param when - ms since the Sim started
+ * @return int - 1 if past, 0 if not
+ */
+static int past_end(const traffic_phase_t *p, double when) {
+    if (isinf(when)) return 1;
+    return p->duration > 0 && when >= (double)(p->start + p->duration);
+}
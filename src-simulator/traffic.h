@@ -0,0 +1,180 @@
+/************************************************
+ * @file    traffic.h
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   API for the traffic profile the Sim's car
+ *          generators play out: when cars arrive, which
+ *          entrance they choose and how long they park,
+ *          loaded from TRAFFIC_FILE (no recompiling).
+ *
+ *          Arrivals are open loop. Each car is due a random
+ *          gap after the last car was DUE, whether or not the
+ *          car park (or the generator) has kept up, and the
+ *          generators report how late each car was queued.
+ *          With GENERATORS threads, each plays every phase
+ *          at 1/GENERATORS of its rate. Poisson streams added
+ *          together are Poisson at the summed rate, so the
+ *          cars arrive the same either way.
+ *
+ *          Traffic file format, 1 line each ('#' = comment),
+ *          times are milliseconds after the Sim starts and
+ *          rates are cars per second, both simulated (see
+ *          SPEED):
+ *
+ *          poisson <start> <duration> <rate>
+ *              random (Poisson) arrivals at a steady rate
+ *          burst <start> <duration> <rate> <size>
+ *              <size> cars arrive together, bursts at random
+ *              gaps averaging <rate> cars per second
+ *          rush <start> <duration> <rate> <peak>
+ *              time of day, the rate climbs from <rate> to
+ *              <peak> halfway through then falls back
+ *          entrance <no.> <weight>
+ *              share of cars choosing entrance <no.> (counted
+ *              from 1, every entrance has a weight of 1 unless
+ *              given one)
+ *          park uniform <min> <max>
+ *          park exponential <mean>
+ *          park fixed <ms>
+ *              milliseconds each car parks (default uniform
+ *              100 10000, as the Sim always did)
+ *
+ *          A <duration> of 0 runs until the end (not rush).
+ *          Without any arrival phase, cars arrive as they
+ *          did before (ARRIVAL_RATE or 1..100ms apart).
+ ***********************************************/
+#pragma once
+
+#include <stdint.h>     /* for int types */
+
+#define TRAFFIC_MAX_PHASES 32   /* arrival phases read from the file */
+#define TRAFFIC_MAX_GENERATORS 8 /* generator threads at most */
+#define TRAFFIC_MAX_RATE 10000000 /* cars per second of any 1 phase */
+
+typedef enum arrival_kind_t {
+    ARRIVE_POISSON,
+    ARRIVE_BURST,
+    ARRIVE_RUSH
+} arrival_kind_t;
+
+typedef enum park_kind_t {
+    PARK_UNIFORM,
+    PARK_EXPONENTIAL,
+    PARK_FIXED
+} park_kind_t;
+
+/* An arrival phase from the traffic file */
+typedef struct traffic_phase_t {
+    arrival_kind_t kind;
+    long start;         /* ms after the Sim started */
+    long duration;      /* ms, 0 = until the end */
+    double rate;        /* cars per second (at the start & end for rush) */
+    double peak;        /* rush only, cars per second halfway through */
+    int size;           /* burst only, cars per burst */
+} traffic_phase_t;
+
+/* The whole profile, read once then shared read only by the generators */
+typedef struct traffic_t {
+    traffic_phase_t phases[TRAFFIC_MAX_PHASES];
+    int n_phases;
+    double weights[5];  /* each entrance's share of the cars */
+    double weight_total;
+    int ens;            /* no. of entrances */
+    park_kind_t park;
+    double park_a;      /* uniform min, exponential mean or fixed ms */
+    double park_b;      /* uniform max */
+} traffic_t;
+
+/* 1 generator's place in 1 phase */
+typedef struct traffic_stream_t {
+    double due;         /* sim_now_ms the next arrival is due */
+    int done;           /* 1 = phase over for this generator */
+} traffic_stream_t;
+
+/**
+ * @brief Sets a profile to the defaults: no arrival phases, every
+ * entrance equally likely and cars parking for 100..10000ms.
+ *
+ * @param t - profile to set
+ * @param ens - ENTRANCES after checking bounds
+ */
+void traffic_init(traffic_t *t, int ens);
+
+/**
+ * @brief Loads a traffic file (see top of file). Lines that cannot be
+ * understood, or name an entrance that does not exist, are skipped
+ * with a warning.
+ *
+ * @param t - profile from traffic_init
+ * @param path - traffic file
+ * @return int - no. of arrival phases loaded, -1 if the file could not be opened
+ */
+int traffic_load(traffic_t *t, const char *path);
+
+/**
+ * @brief Schedules a generator's first arrival in a phase.
+ *
+ * @param t - profile
+ * @param phase - index of the phase
+ * @param gens - no. of generators sharing the phase
+ * @param s - the generator's stream, set
+ * @param rng - the generator's random state
+ */
+void traffic_start(const traffic_t *t, int phase, int gens, traffic_stream_t *s, uint64_t *rng);
+
+/**
+ * @brief Moves a generator's stream on to its next arrival, marking
+ * it done once past the end of the phase.
+ *
+ * @param t - profile
+ * @param phase - index of the phase
+ * @param gens - no. of generators sharing the phase
+ * @param s - the generator's stream, updated
+ * @param rng - the generator's random state
+ * @return int - cars arriving at the arrival just passed (burst size, else 1)
+ */
+int traffic_advance(const traffic_t *t, int phase, int gens, traffic_stream_t *s, uint64_t *rng);
+
+/**
+ * @brief Chooses an entrance by the entrances' weights.
+ *
+ * @param t - profile
+ * @param rng - random state
+ * @return int - entrance 0..ens-1
+ */
+int traffic_entrance(const traffic_t *t, uint64_t *rng);
+
+/**
+ * @brief Chooses how long a car parks.
+ *
+ * @param t - profile
+ * @param rng - random state
+ * @return long - milliseconds, at least 1
+ */
+long traffic_park(const traffic_t *t, uint64_t *rng);
+
+/**
+ * @brief A random no., xorshift64*, so generators never share a lock
+ * for random numbers. Seed with anything but 0.
+ *
+ * @param rng - random state, updated
+ * @return uint64_t - next no.
+ */
+static inline uint64_t traffic_rand(uint64_t *rng) {
+    uint64_t x = *rng;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *rng = x;
+    return x * 2685821657736338717ULL;
+}
+
+/**
+ * @brief A random no. between 0 and 1, both exclusive.
+ *
+ * @param rng - random state, updated
+ * @return double - 0..1
+ */
+static inline double traffic_uniform(uint64_t *rng) {
+    return ((double)(traffic_rand(rng) >> 11) + 0.5) / 9007199254740992.0; /* 2^53 */
+}
@@ -0,0 +1,309 @@
+/************************************************
+ * @file    event-decode.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Prints the event logs written by the Sim, Manager
+ *          and Fire Alarm System (built with EVENT_LOG 1 in
+ *          config.h) as text, merged into 1 timeline.
+ *
+ *          ./EVENT-DECODE [-c] [-p PLATE] [event logs...]
+ *
+ *          -c        counts only (per program & event type)
+ *          -p PLATE  only events of 1 car (its plate)
+ *
+ *          With no event logs given, the 3 programs' default
+ *          logs are read.
+ ***********************************************/
+#include <stdio.h>      /* for IO operations */
+#include <stdlib.h>     /* for dynamic memory & sorting */
+#include <string.h>     /* for string operations */
+#include <stdint.h>     /* for int types */
+#include <stddef.h>     /* for offsetof */
+
+#include "../src-common/parking-types.h" /* for the hardware's layout */
+#include "../src-common/event-log.h"     /* for the log's format */
+
+#define PROGRAMS 8      /* event logs read at most */
+
+/* 1 event read from a log */
+typedef struct read_event_t {
+    event_t e;
+    int program;        /* index into the logs read */
+    uint64_t order;     /* position in the logs, to keep ties in order */
+} read_event_t;
+
+/* 1 log's header & counts */
+typedef struct program_t {
+    event_header_t header;
+    uint64_t counts[EVENT_TYPES];
+    uint64_t first;     /* ns of the earliest event, 0 if none */
+    uint64_t last;      /* ns of the latest event */
+} program_t;
+
+/* Names printed for each event_type_t, in the same order */
+static const char *event_names[EVENT_TYPES] = {"set", "plate", "spawn", "bill"};
+static const char *default_files[] = {"events-simulator.bin", "events-manager.bin", "events-fire-alarm.bin"};
+
+/* function prototypes */
+static int read_log(const char *path, int program, program_t *p, read_event_t **events, size_t *count, size_t *cap, int keep);
+static void describe(const event_t *e, const event_header_t *h, char *out, size_t size);
+static void device(uint16_t offset, const event_header_t *h, char *out, size_t size, int *field);
+static int by_time(const void *a, const void *b);
+
+/**
+ * @brief Entry point for EVENT-DECODE.
+ *
+ * @param argc - argument count
+ * @param argv - "-c", "-p PLATE" then event logs, the 3 defaults if none
+ * @return int - 0 on success, 1 if nothing could be read
+ */
+int main(int argc, char **argv) {
+    const char *files[PROGRAMS];
+    const char *plate = NULL;
+    program_t programs[PROGRAMS];
+    int nfiles = 0;
+    int read = 0;
+    int counts_only = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-c") == 0) {
+            counts_only = 1;
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            plate = argv[++i];
+        } else if (nfiles < PROGRAMS) {
+            files[nfiles++] = argv[i];
+        }
+    }
+    if (nfiles == 0) {
+        for (int i = 0; i < 3; i++) files[nfiles++] = default_files[i];
+    }
+
+    /* -----------------------------------------------
+     *              READ EVERY EVENT LOG
+     * -------------------------------------------- */
+    read_event_t *events = NULL;
+    size_t count = 0;
+    size_t cap = 0;
+
+    memset(programs, 0, sizeof(programs));
+    for (int i = 0; i < nfiles; i++) {
+        if (read_log(files[i], i, &programs[i], &events, &count, &cap, !counts_only) == 0) {
+            read++;
+        } else {
+            snprintf(programs[i].header.program, sizeof(programs[i].header.program), "%s", files[i]);
+            printf("~Skipping %s (could not read it, or not an event log)\n", files[i]);
+        }
+    }
+    if (read == 0 || count == 0) {
+        puts("~No events to decode, build with EVENT_LOG 1 in config.h and run the programs first");
+        free(events);
+        return 1;
+    }
+
+    /* -----------------------------------------------
+     *        MERGE INTO 1 TIMELINE & PRINT IT
+     * -------------------------------------------- */
+    uint64_t origin = UINT64_MAX;
+    uint64_t end = 0;
+
+    for (int i = 0; i < nfiles; i++) {
+        if (programs[i].first != 0 && programs[i].first < origin) origin = programs[i].first;
+        if (programs[i].last > end) end = programs[i].last;
+    }
+
+    if (!counts_only) {
+        qsort(events, count, sizeof(read_event_t), by_time);
+        for (size_t i = 0; i < count; i++) {
+            read_event_t *r = &events[i];
+            char text[96];
+
+            if (plate != NULL && strncmp(r->e.plate, plate, 6) != 0) continue;
+            describe(&r->e, &programs[r->program].header, text, sizeof(text));
+            printf("%12.3fms  %-12s t%-4u %s\n", (double)(r->e.ns - origin) / 1e6,
+                programs[r->program].header.program, r->e.tid, text);
+        }
+    }
+
+    printf("~%lu events from %d event logs over %.3fs", (unsigned long)count, read, (double)(end - origin) / 1e9);
+    if (end > origin) printf(" (%.0f events/s)", (double)count * 1e9 / (double)(end - origin));
+    printf("\n");
+    for (int i = 0; i < nfiles; i++) {
+        if (programs[i].header.version == 0) continue;
+        printf("~%-12s (pid %d):", programs[i].header.program, programs[i].header.pid);
+        for (int t = 0; t < EVENT_TYPES; t++) printf(" %lu %s", (unsigned long)programs[i].counts[t], event_names[t]);
+        printf("\n");
+    }
+
+    free(events);
+    return 0;
+}
+
+/**
+ * @brief Reads every event of 1 log, growing the array as needed.
+ *
+ * @param path - event log
+ * @param program - index of the log
+ * @param p - where to keep the log's header & counts
+ * @param events - array to append to
+ * @param count - events in the array
+ * @param cap - room in the array
+ * @param keep - 1 = append events to the array, 0 = count them only (logs too big to hold)
+ * @return int - 0 if read, -1 if not
+ */
+static int read_log(const char *path, int program, program_t *p, read_event_t **events, size_t *count, size_t *cap, int keep) {
+    FILE *fp = fopen(path, "rb");
+    event_t e;
+
+    if (fp == NULL) return -1;
+    if (fread(&p->header, sizeof(event_header_t), 1, fp) != 1 || memcmp(p->header.magic, EVENT_MAGIC, sizeof(EVENT_MAGIC)) != 0
+        || p->header.version != EVENT_VERSION || p->header.size != sizeof(event_t)) {
+        memset(&p->header, 0, sizeof(event_header_t));
+        fclose(fp);
+        return -1;
+    }
+    p->header.program[sizeof(p->header.program) - 1] = '\0';
+
+    while (fread(&e, sizeof(event_t), 1, fp) == 1) {
+        if (e.type >= EVENT_TYPES) continue;
+        p->counts[e.type]++;
+        if (p->first == 0 || e.ns < p->first) p->first = e.ns;
+        if (e.ns > p->last) p->last = e.ns;
+        if (!keep) {
+            (*count)++;
+            continue;
+        }
+
+        /* if we've run out of memory, realloc the array */
+        if (*count >= *cap) {
+            size_t bigger = (*cap == 0) ? 65536 : *cap * 2;
+            read_event_t *more = realloc(*events, bigger * sizeof(read_event_t));
+            if (more == NULL) {
+                perror("realloc events");
+                fclose(fp);
+                return -1;
+            }
+            *events = more;
+            *cap = bigger;
+        }
+        (*events)[*count].e = e;
+        (*events)[*count].program = program;
+        (*events)[*count].order = *count;
+        (*count)++;
+    }
+    fclose(fp);
+    return 0;
+}
+
+/**
+ * @brief Writes what an event means, such as "entrance 2 gate -> raising".
+ *
+ * @param e - event
+ * @param h - header of the event's log (for the car park's layout)
+ * @param out - where to write
+ * @param size - size of out
+ */
+static void describe(const event_t *e, const event_header_t *h, char *out, size_t size) {
+    char plate[7];
+    char where[32];
+    int field = 0; /* 'P' plate, 'G' gate, 'S' sign, 'A' alarm, 0 unknown */
+
+    memcpy(plate, e->plate, 6);
+    plate[6] = '\0';
+
+    switch (e->type) {
+        case EV_SET:
+            device(e->offset, h, where, sizeof(where), &field);
+            if (field == 'G') {
+                const char *status = (e->value == 'C') ? "closed" : (e->value == 'R') ? "raising"
+                    : (e->value == 'L') ? "lowering" : (e->value == 'O') ? "opened" : "?";
+                snprintf(out, size, "%s -> %s", where, status);
+            } else if (field == 'S') {
+                if (e->value == 0) {
+                    snprintf(out, size, "%s -> blank", where);
+                } else if (e->value >= '0' && e->value <= '9') {
+                    snprintf(out, size, "%s -> level %d", where, e->value - '0' + 1);
+                } else {
+                    snprintf(out, size, "%s -> %c", where, e->value);
+                }
+            } else if (field == 'A') {
+                snprintf(out, size, "%s -> %s", where, (e->value == '1') ? "on" : "off");
+            } else {
+                snprintf(out, size, "%s -> %c", where, e->value);
+            }
+            break;
+        case EV_PLATE:
+            device(e->offset, h, where, sizeof(where), &field);
+            if (plate[0] == '\0') {
+                snprintf(out, size, "%s reset", where);
+            } else {
+                snprintf(out, size, "%s read %s", where, plate);
+            }
+            break;
+        case EV_SPAWN:
+            snprintf(out, size, "car %s spawned (#%u)", plate, e->arg);
+            break;
+        case EV_BILL:
+            snprintf(out, size, "car %s billed $%u.%02u", plate, e->arg / 100, e->arg % 100);
+            break;
+        default:
+            snprintf(out, size, "unknown event %u", e->type);
+            break;
+    }
+}
+
+/**
+ * @brief Names the hardware at a byte of the shared memory, laid out
+ * as entrances, then exits, then levels.
+ *
+ * @param offset - byte within the shared memory
+ * @param h - header of the log (no. of entrances, exits & levels)
+ * @param out - where to write, such as "exit 3 gate"
+ * @param size - size of out
+ * @param field - set to 'P' plate, 'G' gate, 'S' sign, 'A' alarm or 0
+ */
+static void device(uint16_t offset, const event_header_t *h, char *out, size_t size, int *field) {
+    size_t off = offset;
+    size_t exits = sizeof(entrance_t) * h->ens;
+    size_t levels = exits + (sizeof(exit_t) * h->exs);
+
+    *field = 0;
+    if (off < exits) {
+        size_t f = off % sizeof(entrance_t);
+        int n = (int)(off / sizeof(entrance_t)) + 1;
+
+        if (f == offsetof(entrance_t, sensor.plate)) *field = 'P';
+        if (f == offsetof(entrance_t, gate.status)) *field = 'G';
+        if (f == offsetof(entrance_t, sign.display)) *field = 'S';
+        snprintf(out, size, "entrance %d %s", n, (*field == 'P') ? "LPR" : (*field == 'G') ? "gate" : (*field == 'S') ? "sign" : "?");
+    } else if (off < levels) {
+        size_t f = (off - exits) % sizeof(exit_t);
+        int n = (int)((off - exits) / sizeof(exit_t)) + 1;
+
+        if (f == offsetof(exit_t, sensor.plate)) *field = 'P';
+        if (f == offsetof(exit_t, gate.status)) *field = 'G';
+        snprintf(out, size, "exit %d %s", n, (*field == 'P') ? "LPR" : (*field == 'G') ? "gate" : "?");
+    } else if (off < levels + (sizeof(level_t) * h->lvls)) {
+        size_t f = (off - levels) % sizeof(level_t);
+        int n = (int)((off - levels) / sizeof(level_t)) + 1;
+
+        if (f == offsetof(level_t, sensor.plate)) *field = 'P';
+        if (f == offsetof(level_t, alarm)) *field = 'A';
+        snprintf(out, size, "level %d %s", n, (*field == 'P') ? "LPR" : (*field == 'A') ? "alarm" : "?");
+    } else {
+        snprintf(out, size, "byte %u", offset);
+    }
+}
+
+/**
+ * @brief Orders events by time, then by where they were read, for qsort.
+ *
+ * @param a - event
+ * @param b - event
+ * @return int - <0, 0 or >0
+ */
+static int by_time(const void *a, const void *b) {
+    const read_event_t *x = a;
+    const read_event_t *y = b;
+    if (x->e.ns != y->e.ns) return (x->e.ns > y->e.ns) - (x->e.ns < y->e.ns);
+    return (x->order > y->order) - (x->order < y->order);
+}
@@ -0,0 +1,547 @@
+/************************************************
+ * @file    load-test.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Load tests the whole car park end to end. Runs
+ *          the Simulator, Fire Alarm System & Manager
+ *          headless for each car park size asked for, with
+ *          cars arriving at a fixed rate, and writes 1 JSON
+ *          file of every run's results: sustained throughput
+ *          & denial rates (measured after a warm up), queue
+ *          waits and decision latency percentiles. Sizes from
+ *          small to large give scaling curves, and a label
+ *          (such as a commit) tells builds apart.
+ *
+ *          ./LOAD-TEST [-r RATE] [-t SECS] [-w SECS] [-c CAP]
+ *                      [-s SIZES] [-l LABEL] [-o FILE] [-d DIR]
+ *
+ *          -r RATE   cars arriving per second (default 20,
+ *                    0 = a car every 1..100ms at random)
+ *          -t SECS   how long each run lasts (default 20)
+ *          -w SECS   warm up not counted towards sustained
+ *                    throughput (default 5)
+ *          -c CAP    parking spots per level (config.h's)
+ *          -s SIZES  car parks to run, comma separated, each
+ *                    ENSxEXSxLVLS or n for nxnxn, such as
+ *                    "1,2,3,4,5" (default 5x5x5)
+ *          -l LABEL  stored with the results, such as a commit
+ *          -o FILE   results (default load-test.json)
+ *          -d DIR    each run's output & results, in a folder
+ *                    per size (default load-test-runs)
+ *
+ *          Run from the folder holding the executables and
+ *          plates.txt. The programs are given their settings
+ *          as CARPARK_ variables (see src-common/run-config.h),
+ *          so nothing needs re-building between sizes.
+ ***********************************************/
+#include <stdio.h>      /* for IO operations */
+#include <stdlib.h>     /* for atoi & setenv */
+#include <string.h>     /* for string operations */
+#include <errno.h>      /* for telling an existing folder apart */
+#include <fcntl.h>      /* for redirecting output */
+#include <signal.h>     /* for stopping a stuck program */
+#include <time.h>       /* for sleeping & timestamps */
+#include <unistd.h>     /* for fork & exec */
+#include <arpa/inet.h>  /* for the metrics address */
+#include <sys/socket.h> /* for sockets */
+#include <sys/stat.h>   /* for mkdir */
+#include <sys/wait.h>   /* for waiting on the programs */
+
+#include "../config.h"  /* for METRICS_PORT & CAPACITY */
+#include "../src-common/sim-clock.h" /* for the real clock */
+
+#define MAX_RUNS 32
+#define PAGE_SIZE 65536         /* bytes of a metrics page */
+#define START_TIMEOUT 5000      /* ms for the Sim to start serving metrics */
+#define END_GRACE 30            /* s after a run should end before its programs are killed */
+#define TABLE_LINE "-----------------------------------------------------------------------------------------------\n"
+
+/* 1 car park size */
+typedef struct topology_t {
+    int ens;
+    int exs;
+    int lvls;
+} topology_t;
+
+/* Counters read from the Sim's & Manager's metrics at 1 moment */
+typedef struct sample_t {
+    double ms;          /* when, on CLOCK_MONOTONIC */
+    double spawned;
+    double admitted;
+    double turned_away;
+    double exited;
+    double en_queue;    /* cars waiting at all entrances */
+    double decisions;   /* every sign the Manager set */
+    double denied;
+    double full;
+} sample_t;
+
+/* Settings shared by every run */
+typedef struct settings_t {
+    int rate;
+    int secs;
+    int warmup;
+    int cap;
+    int port;
+    const char *label;
+    const char *out;
+    const char *dir;
+} settings_t;
+
+/* function prototypes */
+static int parse_sizes(const char *text, topology_t *sizes);
+static void run(FILE *fp, settings_t *s, topology_t *t, int first);
+static pid_t launch(const char *program, const char *log);
+static int finish(pid_t pid, double deadline_ms);
+static int take_sample(int port, sample_t *sample);
+static int scrape(int port, char *page, size_t size);
+static double metric(const char *page, const char *name);
+static void embed(FILE *fp, const char *path);
+static double json_number(const char *path, const char *member, const char *key);
+static int wait_for_port(int port, int timeout_ms);
+static void sleep_ms(double ms);
+
+/**
+ * @brief Entry point for LOAD-TEST.
+ *
+ * @param argc - argument count
+ * @param argv - see the file's brief
+ * @return int - 0 once every run is written, 1 if the arguments are wrong
+ */
+int main(int argc, char **argv) {
+    settings_t s = {20, 20, 5, CAPACITY, METRICS_PORT, "", "load-test.json", "load-test-runs"};
+    topology_t sizes[MAX_RUNS];
+    const char *size_text = "5x5x5";
+
+    for (int i = 1; i < argc; i++) {
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if (value != NULL && strcmp(argv[i], "-r") == 0) {
+            s.rate = atoi(value);
+        } else if (value != NULL && strcmp(argv[i], "-t") == 0) {
+            s.secs = atoi(value);
+        } else if (value != NULL && strcmp(argv[i], "-w") == 0) {
+            s.warmup = atoi(value);
+        } else if (value != NULL && strcmp(argv[i], "-c") == 0) {
+            s.cap = atoi(value);
+        } else if (value != NULL && strcmp(argv[i], "-s") == 0) {
+            size_text = value;
+        } else if (value != NULL && strcmp(argv[i], "-l") == 0) {
+            s.label = value;
+        } else if (value != NULL && strcmp(argv[i], "-o") == 0) {
+            s.out = value;
+        } else if (value != NULL && strcmp(argv[i], "-d") == 0) {
+            s.dir = value;
+        } else {
+            puts("usage: ./LOAD-TEST [-r RATE] [-t SECS] [-w SECS] [-c CAP] [-s SIZES] [-l LABEL] [-o FILE] [-d DIR]");
+            return 1;
+        }
+        i++;
+    }
+
+    /* the sustained window is from the warm up to 1s before the Sim ends */
+    int count = parse_sizes(size_text, sizes);
+    if (count < 1 || s.rate < 0 || s.rate > 1000 || s.cap < 1 || s.secs < 3 || s.warmup < 0 || s.warmup > s.secs - 2) {
+        puts("~Sizes must be ENSxEXSxLVLS (each 1..5), RATE 0..1000, CAP at least 1 and the warm up at least 2s shorter than the run");
+        return 1;
+    }
+    if (s.port == 0) s.port = 9310; /* metrics are needed, use the default when config.h turns them off */
+
+    if (mkdir(s.dir, 0755) < 0 && errno != EEXIST) {
+        perror(s.dir);
+        return 1;
+    }
+    FILE *fp = fopen(s.out, "w");
+    if (fp == NULL) {
+        perror(s.out);
+        return 1;
+    }
+
+    time_t started = time(NULL);
+    char when[32];
+    strftime(when, sizeof(when), "%Y-%m-%dT%H:%M:%S", localtime(&started));
+
+    fprintf(fp, "{\n\"label\": \"%s\",\n\"started\": \"%s\",\n\"cpus\": %ld,\n", s.label, when, sysconf(_SC_NPROCESSORS_ONLN));
+    fprintf(fp, "\"arrival_rate\": %d,\n\"seconds\": %d,\n\"warmup\": %d,\n\"capacity\": %d,\n\"runs\": [\n", s.rate, s.secs, s.warmup, s.cap);
+
+    printf("~%d runs of %ds at %d cars/s, %d spots per level, sustained rates after %ds\n", count, s.secs, s.rate, s.cap, s.warmup);
+    printf(TABLE_LINE);
+    printf("%-8s %10s %10s %9s %10s %10s %14s %14s %8s\n", "size", "arrived/s", "admitted/s", "denied", "exited/s",
+        "en queue", "queue p99", "decision p99", "rc");
+    printf(TABLE_LINE);
+    for (int i = 0; i < count; i++) run(fp, &s, &sizes[i], i == 0);
+    printf(TABLE_LINE);
+
+    fprintf(fp, "\n]\n}\n");
+    fclose(fp);
+    printf("~Results written to %s\n", s.out);
+    return 0;
+}
+
+/**
+ * @brief Reads the sizes to run.
+ *
+ * @param text - comma separated, each ENSxEXSxLVLS or n for nxnxn
+ * @param sizes - set to each size, MAX_RUNS at most
+ * @return int - no. of sizes, 0 if any is not 1..5
+ */
+static int parse_sizes(const char *text, topology_t *sizes) {
+    int count = 0;
+    const char *at = text;
+
+    while (*at != '\0' && count < MAX_RUNS) {
+        topology_t *t = &sizes[count];
+        int used = 0;
+
+        if (sscanf(at, "%dx%dx%d%n", &t->ens, &t->exs, &t->lvls, &used) != 3) {
+            if (sscanf(at, "%d%n", &t->ens, &used) != 1) return 0;
+            t->exs = t->ens;
+            t->lvls = t->ens;
+        }
+        if (t->ens < 1 || t->ens > 5 || t->exs < 1 || t->exs > 5 || t->lvls < 1 || t->lvls > 5) return 0;
+        count++;
+
+        at += used;
+        if (*at == ',') {
+            at++;
+        } else if (*at != '\0') {
+            return 0;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Runs all 3 programs at 1 size, samples their metrics at the
+ * start & end of the sustained window, then writes the run's results
+ * and its line of the table.
+ *
+ * @param fp - results file, inside the "runs" array
+ * @param s - settings
+ * @param t - size to run
+ * @param first - 1 if no run has been written yet
+ */
+static void run(FILE *fp, settings_t *s, topology_t *t, int first) {
+    char name[32];
+    char path[256];
+    char sim_log[512];
+    char fire_log[512];
+    char man_log[512];
+    char value[16];
+    sample_t begin = {0}, end = {0};
+    int sampled = 0;
+
+    snprintf(name, sizeof(name), "%dx%dx%d", t->ens, t->exs, t->lvls);
+    snprintf(path, sizeof(path), "%s/%s", s->dir, name);
+    mkdir(path, 0755);
+    snprintf(sim_log, sizeof(sim_log), "%s/simulator.out", path);
+    snprintf(fire_log, sizeof(fire_log), "%s/fire-alarm.out", path);
+    snprintf(man_log, sizeof(man_log), "%s/manager.out", path);
+
+    /* results from an earlier run of this size must not be taken for this one's */
+    char old[600];
+    snprintf(old, sizeof(old), "%s/simulator.json", path);
+    unlink(old);
+    snprintf(old, sizeof(old), "%s/manager.json", path);
+    unlink(old);
+
+    /* -----------------------------------------------
+     *      EVERY PROGRAM INHERITS THESE OVERRIDES
+     * -------------------------------------------- */
+    snprintf(value, sizeof(value), "%d", t->ens);
+    setenv("CARPARK_ENTRANCES", value, 1);
+    snprintf(value, sizeof(value), "%d", t->exs);
+    setenv("CARPARK_EXITS", value, 1);
+    snprintf(value, sizeof(value), "%d", t->lvls);
+    setenv("CARPARK_LEVELS", value, 1);
+    snprintf(value, sizeof(value), "%d", s->cap);
+    setenv("CARPARK_CAPACITY", value, 1);
+    snprintf(value, sizeof(value), "%d", s->secs);
+    setenv("CARPARK_DURATION", value, 1);
+    snprintf(value, sizeof(value), "%d", s->rate);
+    setenv("CARPARK_ARRIVAL_RATE", value, 1);
+    setenv("CARPARK_TRAFFIC_FILE", "", 0); /* a fixed rate, unless the caller gave a traffic profile */
+    snprintf(value, sizeof(value), "%d", s->port);
+    setenv("CARPARK_METRICS_PORT", value, 1);
+    setenv("CARPARK_HEADLESS", "1", 1);
+    setenv("CARPARK_RESULTS_DIR", path, 1);
+
+    /* -----------------------------------------------
+     *   START THE SIM, THEN THE OTHERS ONCE IT SERVES
+     *   METRICS (ITS SHARED MEMORY IS READY BY THEN)
+     * -------------------------------------------- */
+    double start = now_ms();
+    pid_t sim = launch("./SIMULATOR", sim_log);
+    pid_t fire = -1, man = -1;
+    if (sim > 0 && wait_for_port(s->port, START_TIMEOUT) == 0) {
+        fire = launch("./FIRE-ALARM-SYSTEM", fire_log);
+        man = launch("./MANAGER", man_log);
+    } else {
+        printf("~%s: the Simulator did not start, see %s\n", name, sim_log);
+    }
+
+    /* -----------------------------------------------
+     *          SAMPLE THE SUSTAINED WINDOW
+     * -------------------------------------------- */
+    if (man > 0) {
+        sleep_ms(start + (s->warmup * 1000.0) - now_ms());
+        sampled = take_sample(s->port, &begin) == 0;
+        sleep_ms(start + ((s->secs - 1) * 1000.0) - now_ms());
+        sampled = sampled && take_sample(s->port, &end) == 0;
+    }
+
+    double deadline = start + ((s->secs + END_GRACE) * 1000.0);
+    int sim_rc = finish(sim, deadline);
+    int fire_rc = finish(fire, deadline);
+    int man_rc = finish(man, deadline);
+
+    /* -----------------------------------------------
+     *               WRITE THE RUN'S RESULTS
+     * -------------------------------------------- */
+    double secs = (end.ms - begin.ms) / 1000;
+    double decisions = end.decisions - begin.decisions;
+    double arrived = 0, admitted = 0, turned_away = 0, exited = 0, denial = 0;
+    if (sampled && secs > 0) {
+        arrived = (end.spawned - begin.spawned) / secs;
+        admitted = (end.admitted - begin.admitted) / secs;
+        turned_away = (end.turned_away - begin.turned_away) / secs;
+        exited = (end.exited - begin.exited) / secs;
+        if (decisions > 0) denial = (end.denied - begin.denied + end.full - begin.full) / decisions;
+    }
+
+    fprintf(fp, "%s{\n\"entrances\": %d, \"exits\": %d, \"levels\": %d,\n", first ? "" : ",\n", t->ens, t->exs, t->lvls);
+    fprintf(fp, "\"exit_codes\": {\"simulator\": %d, \"fire_alarm\": %d, \"manager\": %d},\n", sim_rc, fire_rc, man_rc);
+    if (sampled && secs > 0) {
+        fprintf(fp, "\"sustained\": {\"seconds\": %.3f, \"arrived_per_s\": %.3f, \"admitted_per_s\": %.3f, "
+            "\"turned_away_per_s\": %.3f, \"exited_per_s\": %.3f, \"decisions_per_s\": %.3f, \"denied_per_s\": %.3f, "
+            "\"full_per_s\": %.3f, \"denial_rate\": %.4f, \"entrance_queue_start\": %.0f, \"entrance_queue_end\": %.0f},\n",
+            secs, arrived, admitted, turned_away, exited, decisions / secs, (end.denied - begin.denied) / secs,
+            (end.full - begin.full) / secs, denial, begin.en_queue, end.en_queue);
+    } else {
+        fprintf(fp, "\"sustained\": null,\n");
+    }
+    snprintf(old, sizeof(old), "%s/simulator.json", path);
+    double queue_p99 = json_number(old, "\"entrance_queue_wait\"", "\"p99_ms\"");
+    fprintf(fp, "\"simulator\": ");
+    embed(fp, old);
+    snprintf(old, sizeof(old), "%s/manager.json", path);
+    double decision_p99 = json_number(old, "\"entrance_decisions\"", "\"p99_ms\"");
+    fprintf(fp, ",\n\"manager\": ");
+    embed(fp, old);
+    fprintf(fp, "\n}");
+    fflush(fp);
+
+    printf("%-8s %10.2f %10.2f %8.1f%% %10.2f %4.0f->%-5.0f %12.1fms %12.3fms %2d/%d/%d\n", name, arrived, admitted,
+        denial * 100, exited, begin.en_queue, end.en_queue, queue_p99, decision_p99, sim_rc, fire_rc, man_rc);
+    fflush(stdout);
+}
+
+/**
+ * @brief Starts a program with its output going to a file.
+ *
+ * @param program - path of the executable
+ * @param log - file for its stdout & stderr
+ * @return pid_t - its pid, -1 if it could not be started
+ */
+static pid_t launch(const char *program, const char *log) {
+    pid_t pid = fork();
+
+    if (pid == 0) {
+        int fd = open(log, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd >= 0) {
+            dup2(fd, STDOUT_FILENO);
+            dup2(fd, STDERR_FILENO);
+            close(fd);
+        }
+        execl(program, program, (char *)NULL);
+        perror(program);
+        _exit(127);
+    }
+    return pid;
+}
+
+/**
+ * @brief Waits for a program to end, killing it at the deadline.
+ *
+ * @param pid - the program, nothing is waited for if not above 0
+ * @param deadline_ms - now_ms value to kill it at
+ * @return int - its exit code, -1 if never started, 128 + signal if killed
+ */
+static int finish(pid_t pid, double deadline_ms) {
+    int status = 0;
+
+    if (pid <= 0) return -1;
+    while (waitpid(pid, &status, WNOHANG) == 0) {
+        if (now_ms() > deadline_ms) {
+            kill(pid, SIGKILL);
+            waitpid(pid, &status, 0);
+            break;
+        }
+        sleep_ms(100);
+    }
+    if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+    return WEXITSTATUS(status);
+}
+
+/**
+ * @brief Reads the counters of the Sim (on 'port') & Manager (port + 1).
+ *
+ * @param port - the Sim's metrics port
+ * @param sample - set to the counters & when they were read
+ * @return int - 0 if both were read, -1 if not
+ */
+static int take_sample(int port, sample_t *sample) {
+    static char page[PAGE_SIZE];
+
+    sample->ms = now_ms();
+    if (scrape(port, page, sizeof(page)) < 0) return -1;
+    sample->spawned = metric(page, "simulator_cars_spawned_total");
+    sample->admitted = metric(page, "simulator_cars_total{result=\"admitted\"}");
+    sample->turned_away = metric(page, "simulator_cars_total{result=\"turned_away\"}");
+    sample->exited = metric(page, "simulator_cars_exited_total");
+    sample->en_queue = metric(page, "simulator_queue_depth{queue=\"entrance\"}");
+
+    if (scrape(port + 1, page, sizeof(page)) < 0) return -1;
+    sample->denied = metric(page, "manager_decisions_total{result=\"denied\"}");
+    sample->full = metric(page, "manager_decisions_total{result=\"full\"}");
+    sample->decisions = metric(page, "manager_decisions_total{result=\"admitted\"}") + sample->denied + sample->full
+        + metric(page, "manager_decisions_total{result=\"fire\"}");
+    return 0;
+}
+
+/**
+ * @brief Fetches a program's /metrics page.
+ *
+ * @param port - port it serves metrics on
+ * @param page - set to the response, '\0' terminated
+ * @param size - bytes of 'page'
+ * @return int - 0 if fetched, -1 if not
+ */
+static int scrape(int port, char *page, size_t size) {
+    struct sockaddr_in addr;
+    const char *request = "GET /metrics HTTP/1.0\r\nHost: 127.0.0.1\r\n\r\n";
+    size_t got = 0;
+    ssize_t n;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || write(fd, request, strlen(request)) < 0) {
+        close(fd);
+        return -1;
+    }
+    while (got < size - 1 && (n = read(fd, page + got, size - 1 - got)) > 0) got += (size_t)n;
+    close(fd);
+    page[got] = '\0';
+    return (strstr(page, " 200 ") != NULL) ? 0 : -1;
+}
+
+/**
+ * @brief Finds 1 value on a metrics page.
+ *
+ * @param page - Prometheus text
+ * @param name - the metric & its labels, as on the page
+ * @return double - its value, 0 if not on the page
+ */
+static double metric(const char *page, const char *name) {
+    size_t len = strlen(name);
+    const char *at = page;
+
+    while ((at = strstr(at, name)) != NULL) {
+        if ((at == page || at[-1] == '\n') && at[len] == ' ') return strtod(at + len + 1, NULL);
+        at += len;
+    }
+    return 0;
+}
+
+/**
+ * @brief Copies a program's JSON results into the results file.
+ *
+ * @param fp - results file
+ * @param path - the program's results, null is written if missing
+ */
+static void embed(FILE *fp, const char *path) {
+    FILE *in = fopen(path, "r");
+    char buf[4096];
+    size_t n;
+    int any = 0;
+
+    if (in != NULL) {
+        while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+            /* drop the last newline so the object sits inside the array */
+            if (n < sizeof(buf) && buf[n - 1] == '\n') n--;
+            fwrite(buf, 1, n, fp);
+            any = 1;
+        }
+        fclose(in);
+    }
+    if (!any) fprintf(fp, "null");
+}
+
+/**
+ * @brief Finds a no. inside a member of a program's JSON results, for
+ * the table (the results file has them all).
+ *
+ * @param path - the program's results
+ * @param member - member holding the no., such as "\"entrance_queue_wait\""
+ * @param key - the no.'s key within it, such as "\"p99_ms\""
+ * @return double - the no., 0 if not found
+ */
+static double json_number(const char *path, const char *member, const char *key) {
+    static char text[PAGE_SIZE];
+    FILE *in = fopen(path, "r");
+    double value = 0;
+
+    if (in == NULL) return 0;
+    size_t n = fread(text, 1, sizeof(text) - 1, in);
+    fclose(in);
+    text[n] = '\0';
+
+    const char *at = strstr(text, member);
+    if (at != NULL) at = strstr(at, key);
+    if (at != NULL) at = strchr(at, ':');
+    if (at != NULL) value = strtod(at + 1, NULL);
+    return value;
+}
+
+/**
+ * @brief Waits for a program to accept connections on a port.
+ *
+ * @param port - port to try
+ * @param timeout_ms - how long to keep trying
+ * @return int - 0 once it accepts, -1 if it never did
+ */
+static int wait_for_port(int port, int timeout_ms) {
+    struct sockaddr_in addr;
+    double give_up = now_ms() + timeout_ms;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    while (now_ms() < give_up) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        int ok = (fd >= 0 && connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+
+        if (fd >= 0) close(fd);
+        if (ok) return 0;
+        sleep_ms(50);
+    }
+    return -1;
+}
+
+/**
+ * @brief Sleeps, returning at once if 'ms' is not above 0.
+ *
+ * @param ms - milliseconds to sleep
+ */
+static void sleep_ms(double ms) {
+    if (ms <= 0) return;
+    struct timespec nap = {(time_t)(ms / 1000), (long)((ms - ((double)(long)(ms / 1000) * 1000)) * 1000000)};
+    nanosleep(&nap, NULL);
+}
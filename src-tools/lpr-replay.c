@@ -0,0 +1,614 @@
+/************************************************
+ * @file    lpr-replay.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Replays LPR readings the Simulator captured (see
+ *          src-common/lpr-trace.h) to the Manager, in place of
+ *          the Simulator. Creates the PARKING shared memory,
+ *          writes each plate into its entrance, exit or level
+ *          LPR and plays the Simulator's side of the handshake
+ *          (waiting for the sign, opening raised gates, closing
+ *          lowered ones), so the Manager's decision path can be
+ *          benchmarked the same way every time.
+ *
+ *          ./LPR-REPLAY [-f] [-w SECS] [-t SECS] [-o FILE] CAPTURE
+ *
+ *          -f        as fast as the Manager absorbs the readings
+ *                    (default at the pace they were captured)
+ *          -w SECS   time to start the Manager in before the
+ *                    first reading (default 2)
+ *          -t SECS   stop waiting on the Manager after (default 120)
+ *          -o FILE   results (default lpr-replay.json)
+ *
+ *          Readings are written in the order captured. A reading
+ *          also waits until the Manager has answered the previous
+ *          reading of the same plate, so a car never reaches an
+ *          exit before the Manager let it in, even at full speed.
+ *
+ *          Start the Manager (and Fire Alarm System, if wanted)
+ *          with the captured no. of ENTRANCES, EXITS & LEVELS,
+ *          such as CARPARK_ENTRANCES=2 ./MANAGER, and with
+ *          CARPARK_RESULTS_DIR for its own decision latency.
+ ***********************************************/
+#include <stdio.h>      /* for IO operations */
+#include <stdlib.h>     /* for dynamic memory */
+#include <string.h>     /* for string operations */
+#include <errno.h>      /* for telling an interrupted sleep apart */
+#include <stdatomic.h>  /* for flags shared by the threads */
+#include <pthread.h>    /* for threads */
+#include <time.h>       /* for sleeping & timestamps */
+
+#include "../src-simulator/parking.h"       /* for creating the shared memory */
+#include "../src-common/parking-status.h"   /* for changing the hardware */
+#include "../src-common/lpr-trace.h"        /* for the capture */
+#include "../src-common/hdr-histogram.h"    /* for answer times */
+#include "../src-common/event-log.h"        /* for logging the hardware changes */
+#include "../src-common/sim-clock.h"        /* for the Manager's time */
+
+#define SHARED_MEM_NAME "PARKING"
+#define MAX_SIDE 5              /* entrances, exits & levels at most */
+#define CONSUMED_POLL_US 50     /* between looks at an exit LPR the Manager has not reset */
+
+/* 1 replaying thread, 1 per entrance & exit and 1 for every level */
+typedef struct player_t {
+    lpr_where_t where;
+    int id;
+    int *records;       /* its readings, indices into 'records' in order */
+    int count;
+    hdr_t answered;     /* ns from writing a plate to the Manager answering */
+    unsigned long signs[4]; /* entrances: level, X, F, anything else (a fire) */
+} player_t;
+
+/* Settings & state shared by every thread */
+typedef struct replay_t {
+    lpr_header_t header;
+    lpr_record_t *records;  /* every reading, in the order to write them */
+    int *after;             /* previous reading of the same plate, -1 if none */
+    _Atomic char *done;     /* 1 = reading answered */
+    int count;
+    int fast;
+    double started_ms;      /* when the first reading was due */
+    pthread_mutex_t order_lock;
+    pthread_cond_t order_cond;
+    int next;               /* next reading to write, under order_lock */
+    volatile _Atomic int ending;
+} replay_t;
+
+static replay_t rp;
+static volatile void *shm;
+
+/* function prototypes */
+static int load(const char *path);
+static int compare(const void *a, const void *b);
+static void link_plates(void);
+static void *play(void *arg);
+static void take_turn(int r);
+static void written(int r);
+static void answered(int r);
+static void play_entrance(player_t *p, entrance_t *en, int r);
+static void play_exit(player_t *p, exit_t *ex, int r);
+static void play_level(level_t *lvl, int r);
+static void tidy_gate(boom_t *gate);
+static void write_plate(LPR_t *sensor, const lpr_record_t *rec);
+static void write_json(const char *path, const char *capture, player_t *players, int n, double secs);
+static void sleep_until(double ms);
+
+/**
+ * @brief Entry point for LPR-REPLAY.
+ *
+ * @param argc - argument count
+ * @param argv - see the file's brief
+ * @return int - 0 once every reading is replayed, 1 if the arguments or capture are wrong
+ */
+int main(int argc, char **argv) {
+    const char *capture = NULL;
+    const char *out = "lpr-replay.json";
+    int wait = 2;
+    int limit = 120;
+
+    for (int i = 1; i < argc; i++) {
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if (strcmp(argv[i], "-f") == 0) {
+            rp.fast = 1;
+        } else if (value != NULL && strcmp(argv[i], "-w") == 0) {
+            wait = atoi(argv[++i]);
+        } else if (value != NULL && strcmp(argv[i], "-t") == 0) {
+            limit = atoi(argv[++i]);
+        } else if (value != NULL && strcmp(argv[i], "-o") == 0) {
+            out = argv[++i];
+        } else if (argv[i][0] != '-' && capture == NULL) {
+            capture = argv[i];
+        } else {
+            capture = NULL;
+            break;
+        }
+    }
+    if (capture == NULL) {
+        puts("usage: ./LPR-REPLAY [-f] [-w SECS] [-t SECS] [-o FILE] CAPTURE");
+        return 1;
+    }
+    if (load(capture) != 0) return 1;
+    link_plates();
+
+    int ens = rp.header.ens;
+    int exs = rp.header.exs;
+    int lvls = rp.header.lvls;
+    double speed = rp.header.speed;
+    if (!(speed >= SIM_SPEED_MIN && speed <= SIM_SPEED_MAX)) speed = 1;
+    printf("~%d readings from %d entrances, %d exits & %d levels (captured at SPEED %g)\n",
+        rp.count, ens, exs, lvls, speed);
+
+    /* -----------------------------------------------
+     *     CREATE THE CAR PARK AS THE SIM WOULD: GATES
+     *     CLOSED, LPRs EMPTY, SIGNS BLANK, NO ALARMS
+     * -------------------------------------------- */
+    shm = create_shared_memory(SHARED_MEM_NAME, PARKING_SIZE);
+    init_shared_memory(shm, ens, exs, lvls);
+    sim_clock_start(shm, speed); /* the Manager runs at the captured SPEED, as it did then */
+    event_init("lpr-replay", ens, exs, lvls);
+    entrance_t *en = (entrance_t *)shm;
+    exit_t *ex = (exit_t *)((char *)shm + (sizeof(entrance_t) * ens));
+    level_t *lvl = (level_t *)((char *)shm + (sizeof(entrance_t) * ens) + (sizeof(exit_t) * exs));
+    /* the LPRs are not zeroed by init_shared_memory, and the Manager would
+    answer whatever is in them, leaving a sign set before the first reading */
+    for (int i = 0; i < ens; i++) {
+        parking_set(shm, &en[i].gate.status, 'C');
+        parking_set(shm, &en[i].sign.display, 0);
+        parking_set_plate(shm, en[i].sensor.plate, "");
+    }
+    for (int i = 0; i < exs; i++) {
+        parking_set(shm, &ex[i].gate.status, 'C');
+        parking_set_plate(shm, ex[i].sensor.plate, "");
+    }
+    for (int i = 0; i < lvls; i++) parking_set_plate(shm, lvl[i].sensor.plate, "");
+    parking_write_begin(shm);
+    for (int i = 0; i < lvls; i++) {
+        lvl[i].alarm = '0';
+        EVENT_SET(shm, &lvl[i].alarm, '0');
+    }
+    parking_write_end(shm);
+    /* the Manager fails safe if no Fire Alarm thread ever starts, so mark
+    a slot as started & stopped on purpose (a Fire Alarm System started
+    too is still watched) */
+    parking_status(shm)->fire[HB_NO_FIRE].state = HB_STOPPED;
+
+    /* -----------------------------------------------
+     *         HAND EACH THREAD ITS OWN READINGS
+     * -------------------------------------------- */
+    player_t players[MAX_SIDE * 2 + 1];
+    int n = 0;
+    for (int i = 0; i < ens; i++) players[n++] = (player_t){.where = LPR_ENTRANCE, .id = i};
+    for (int i = 0; i < exs; i++) players[n++] = (player_t){.where = LPR_EXIT, .id = i};
+    players[n++] = (player_t){.where = LPR_LEVEL, .id = 0};
+
+    for (int i = 0; i < n; i++) {
+        hdr_reset(&players[i].answered);
+        players[i].records = malloc(sizeof(int) * (size_t)(rp.count + 1));
+        if (players[i].records == NULL) {
+            perror("malloc readings");
+            return 1;
+        }
+        for (int r = 0; r < rp.count; r++) {
+            lpr_record_t *rec = &rp.records[r];
+            if (rec->where == players[i].where && (rec->where == LPR_LEVEL || rec->id == players[i].id)) {
+                players[i].records[players[i].count++] = r;
+            }
+        }
+    }
+
+    printf("~You may now start the Manager, replaying %s in %ds...\n", rp.fast ? "as fast as it answers" : "at the pace captured", wait);
+    fflush(stdout);
+    sleep_until(now_ms() + (wait * 1000.0));
+
+    /* -----------------------------------------------
+     *     REPLAY UNTIL EVERY READING IS ANSWERED OR
+     *     THE MANAGER HAS TAKEN TOO LONG
+     * -------------------------------------------- */
+    pthread_t threads[MAX_SIDE * 2 + 1];
+    pthread_mutex_init(&rp.order_lock, NULL);
+    pthread_cond_init(&rp.order_cond, NULL);
+    rp.started_ms = now_ms();
+    for (int i = 0; i < n; i++) pthread_create(&threads[i], NULL, play, &players[i]);
+
+    int answered_all = 0;
+    while (!answered_all && now_ms() - rp.started_ms < limit * 1000.0) {
+        sleep_until(now_ms() + 100);
+        answered_all = 1;
+        for (int r = 0; r < rp.count; r++) {
+            if (!rp.done[r]) answered_all = 0;
+        }
+    }
+    double secs = (now_ms() - rp.started_ms) / 1000;
+
+    /* wake every thread still waiting on the Manager so they return */
+    rp.ending = 1;
+    pthread_mutex_lock(&rp.order_lock);
+    pthread_cond_broadcast(&rp.order_cond);
+    pthread_mutex_unlock(&rp.order_lock);
+    for (int i = 0; i < ens; i++) {
+        pthread_cond_broadcast(&en[i].sign.condition);
+        pthread_cond_broadcast(&en[i].gate.condition);
+    }
+    for (int i = 0; i < exs; i++) pthread_cond_broadcast(&ex[i].gate.condition);
+    for (int i = 0; i < n; i++) pthread_join(threads[i], NULL);
+    event_stop();
+
+    /* -----------------------------------------------
+     *                    REPORT
+     * -------------------------------------------- */
+    int replayed = 0;
+    hdr_t en_all;
+    hdr_t ex_all;
+    unsigned long signs[4] = {0, 0, 0, 0};
+    hdr_reset(&en_all);
+    hdr_reset(&ex_all);
+    for (int r = 0; r < rp.count; r++) replayed += rp.done[r];
+    for (int i = 0; i < n; i++) {
+        if (players[i].where == LPR_ENTRANCE) hdr_merge(&en_all, &players[i].answered);
+        if (players[i].where == LPR_EXIT) hdr_merge(&ex_all, &players[i].answered);
+        for (int s = 0; s < 4; s++) signs[s] += players[i].signs[s];
+    }
+
+    printf("~%d of %d readings answered in %.1fs, %.1f per second%s\n", replayed, rp.count, secs,
+        (secs > 0) ? replayed / secs : 0, answered_all ? "" : " (gave up waiting on the Manager)");
+    printf("~Entrance signs: %lu assigned a level, %lu not authorised, %lu full, %lu fire\n",
+        signs[0], signs[1], signs[2], signs[3]);
+    hdr_print(stdout, "entrance LPR -> sign", &en_all);
+    hdr_print(stdout, "exit LPR -> answered", &ex_all);
+    write_json(out, capture, players, n, secs);
+
+    for (int i = 0; i < n; i++) free(players[i].records);
+    free(rp.records);
+    free(rp.after);
+    free((void *)rp.done);
+    return answered_all ? 0 : 1;
+}
+
+/**
+ * @brief Reads a capture into memory, ordered by when each reading was made.
+ *
+ * @param path - capture file
+ * @return int - 0 if read, 1 if it is not a complete capture
+ */
+static int load(const char *path) {
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        perror(path);
+        return 1;
+    }
+
+    if (fread(&rp.header, sizeof(rp.header), 1, fp) != 1 || memcmp(rp.header.magic, LPR_MAGIC, sizeof(rp.header.magic)) != 0
+        || rp.header.version != LPR_VERSION || rp.header.size != sizeof(lpr_record_t)) {
+        printf("%s is not an LPR capture (version %d)\n", path, LPR_VERSION);
+        fclose(fp);
+        return 1;
+    }
+    if (rp.header.ens < 1 || rp.header.ens > MAX_SIDE || rp.header.exs < 1 || rp.header.exs > MAX_SIDE
+        || rp.header.lvls < 1 || rp.header.lvls > MAX_SIDE) {
+        printf("%s has %d entrances, %d exits & %d levels, each must be 1..%d\n", path,
+            rp.header.ens, rp.header.exs, rp.header.lvls, MAX_SIDE);
+        fclose(fp);
+        return 1;
+    }
+    if (rp.header.records == 0) printf("\t%s was not finished by the Sim, replaying what was written\n", path);
+
+    /* read every record there is, the header's count may be 0 */
+    int room = 1024;
+    rp.records = malloc(sizeof(lpr_record_t) * (size_t)room);
+    while (rp.records != NULL && fread(&rp.records[rp.count], sizeof(lpr_record_t), 1, fp) == 1) {
+        lpr_record_t *rec = &rp.records[rp.count];
+        int sides[LPR_WHERES] = {rp.header.ens, rp.header.exs, rp.header.lvls};
+
+        if (rec->where < LPR_WHERES && rec->id < sides[rec->where]) rp.count++; /* else skip a corrupt record */
+        if (rp.count == room) {
+            room *= 2;
+            rp.records = realloc(rp.records, sizeof(lpr_record_t) * (size_t)room);
+        }
+    }
+    fclose(fp);
+
+    rp.after = malloc(sizeof(int) * (size_t)(rp.count + 1));
+    rp.done = calloc((size_t)(rp.count + 1), sizeof(char));
+    if (rp.records == NULL || rp.after == NULL || rp.done == NULL) {
+        perror("malloc capture");
+        return 1;
+    }
+
+    /* threads write under locks so may have captured slightly out of order */
+    qsort(rp.records, (size_t)rp.count, sizeof(lpr_record_t), compare);
+    return 0;
+}
+
+/**
+ * @brief Orders readings by when they were made, for qsort.
+ *
+ * @param a - 1st lpr_record_t
+ * @param b - 2nd lpr_record_t
+ * @return int - below, at or above 0 as a was made before, with or after b
+ */
+static int compare(const void *a, const void *b) {
+    uint64_t x = ((const lpr_record_t *)a)->ns;
+    uint64_t y = ((const lpr_record_t *)b)->ns;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Finds each reading's previous reading of the same plate, by
+ * # table (open addressing, plates hashed like the Manager's).
+ */
+static void link_plates(void) {
+    int size = 1;
+    while (size < rp.count * 2) size *= 2;
+    int *last = malloc(sizeof(int) * (size_t)size);
+
+    for (int r = 0; r < rp.count; r++) rp.after[r] = -1;
+    if (last == NULL) return; /* readings only wait for their turn */
+
+    for (int i = 0; i < size; i++) last[i] = -1;
+    for (int r = 0; r < rp.count; r++) {
+        uint32_t h = 5381;
+        for (int c = 0; c < 6; c++) h = (h * 33) + (uint8_t)rp.records[r].plate[c];
+
+        int slot = (int)(h & (uint32_t)(size - 1));
+        while (last[slot] >= 0 && memcmp(rp.records[last[slot]].plate, rp.records[r].plate, 6) != 0) {
+            slot = (slot + 1) & (size - 1);
+        }
+        rp.after[r] = last[slot];
+        last[slot] = r;
+    }
+    free(last);
+}
+
+/**
+ * @brief Replays 1 entrance's, 1 exit's or every level's readings.
+ *
+ * @param arg - the thread's player_t
+ * @return void* - NULL
+ */
+static void *play(void *arg) {
+    player_t *p = (player_t *)arg;
+    int ens = rp.header.ens;
+    int exs = rp.header.exs;
+
+    for (int i = 0; i < p->count && !rp.ending; i++) {
+        int r = p->records[i];
+
+        if (!rp.fast) sleep_until(rp.started_ms + (double)rp.records[r].ns / 1000000);
+        if (p->where == LPR_ENTRANCE) {
+            play_entrance(p, (entrance_t *)((char *)shm + (sizeof(entrance_t) * p->id)), r);
+        } else if (p->where == LPR_EXIT) {
+            play_exit(p, (exit_t *)((char *)shm + (sizeof(entrance_t) * ens) + (sizeof(exit_t) * p->id)), r);
+        } else {
+            int lvl = rp.records[r].id;
+            play_level((level_t *)((char *)shm + (sizeof(entrance_t) * ens) + (sizeof(exit_t) * exs) + (sizeof(level_t) * lvl)), r);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Waits until every earlier reading is written and the Manager
+ * has answered the previous reading of the same plate.
+ *
+ * @param r - reading about to be written
+ */
+static void take_turn(int r) {
+    int before = rp.after[r];
+
+    pthread_mutex_lock(&rp.order_lock);
+    while ((rp.next != r || (before >= 0 && !rp.done[before])) && !rp.ending) {
+        pthread_cond_wait(&rp.order_cond, &rp.order_lock);
+    }
+    pthread_mutex_unlock(&rp.order_lock);
+}
+
+/**
+ * @brief Lets the next reading be written, once this one is.
+ *
+ * @param r - reading just written
+ */
+static void written(int r) {
+    pthread_mutex_lock(&rp.order_lock);
+    rp.next = r + 1;
+    pthread_cond_broadcast(&rp.order_cond);
+    pthread_mutex_unlock(&rp.order_lock);
+}
+
+/**
+ * @brief Marks a reading answered, releasing later readings of its plate.
+ *
+ * @param r - reading the Manager answered
+ */
+static void answered(int r) {
+    pthread_mutex_lock(&rp.order_lock);
+    rp.done[r] = 1;
+    pthread_cond_broadcast(&rp.order_cond);
+    pthread_mutex_unlock(&rp.order_lock);
+}
+
+/**
+ * @brief Plays a car arriving at an entrance, as simulate-entrance.c
+ * does: LPR, wait for the sign, drive in through the gate if assigned.
+ *
+ * @param p - the entrance's player
+ * @param en - the entrance
+ * @param r - reading to replay
+ */
+static void play_entrance(player_t *p, entrance_t *en, int r) {
+    tidy_gate(&en->gate);
+    take_turn(r);
+    if (rp.ending) return;
+    double wrote = now_ms();
+    write_plate(&en->sensor, &rp.records[r]);
+    written(r);
+
+    /* the Manager holds the sign's lock while it decides, so once the sign
+    is set the gate is raised and the LPR reset too */
+    pthread_mutex_lock(&en->sign.lock);
+    while (en->sign.display == 0 && !rp.ending) pthread_cond_wait(&en->sign.condition, &en->sign.lock);
+    if (!rp.ending) {
+        char sign = en->sign.display;
+        hdr_record(&p->answered, (uint64_t)((now_ms() - wrote) * 1000000));
+        p->signs[(sign >= '0' && sign <= '9') ? 0 : (sign == 'X') ? 1 : (sign == 'F') ? 2 : 3]++;
+
+        if (sign >= '0' && sign <= '9') {
+            pthread_mutex_lock(&en->gate.lock);
+            while (en->gate.status == 'C' && !rp.ending) pthread_cond_wait(&en->gate.condition, &en->gate.lock);
+            if (en->gate.status == 'R') parking_set(shm, &en->gate.status, 'O');
+            pthread_mutex_unlock(&en->gate.lock);
+            pthread_cond_broadcast(&en->gate.condition);
+        }
+        answered(r);
+    }
+    parking_set(shm, &en->sign.display, 0);
+    pthread_mutex_unlock(&en->sign.lock);
+}
+
+/**
+ * @brief Plays a car arriving at an exit, as simulate-exit.c does: LPR,
+ * then out through the gate once the Manager has billed it.
+ *
+ * @param p - the exit's player
+ * @param ex - the exit
+ * @param r - reading to replay
+ */
+static void play_exit(player_t *p, exit_t *ex, int r) {
+    tidy_gate(&ex->gate);
+    take_turn(r);
+    if (rp.ending) return;
+    double wrote = now_ms();
+    write_plate(&ex->sensor, &rp.records[r]);
+    written(r);
+
+    pthread_mutex_lock(&ex->gate.lock);
+    while (ex->gate.status == 'C' && !rp.ending) pthread_cond_wait(&ex->gate.condition, &ex->gate.lock);
+    if (ex->gate.status == 'R') parking_set(shm, &ex->gate.status, 'O');
+    pthread_mutex_unlock(&ex->gate.lock);
+    pthread_cond_broadcast(&ex->gate.condition);
+
+    /* a gate still open for the last car lets this one through before the
+    Manager bills it, so wait for the Manager to reset the LPR (it holds
+    the LPR's lock until then, and says nothing when it is done) */
+    struct timespec poll = {0, CONSUMED_POLL_US * 1000};
+    pthread_mutex_lock(&ex->sensor.lock);
+    while (ex->sensor.plate[0] != '\0' && !rp.ending) {
+        pthread_mutex_unlock(&ex->sensor.lock);
+        nanosleep(&poll, NULL);
+        pthread_mutex_lock(&ex->sensor.lock);
+    }
+    pthread_mutex_unlock(&ex->sensor.lock);
+    if (!rp.ending) {
+        hdr_record(&p->answered, (uint64_t)((now_ms() - wrote) * 1000000));
+        answered(r);
+    }
+}
+
+/**
+ * @brief Plays a car passing a level's LPR, which the Manager does not answer.
+ *
+ * @param lvl - the level
+ * @param r - reading to replay
+ */
+static void play_level(level_t *lvl, int r) {
+    take_turn(r);
+    if (rp.ending) return;
+    write_plate(&lvl->sensor, &rp.records[r]);
+    written(r);
+    answered(r);
+}
+
+/**
+ * @brief Closes a gate the Manager lowered and opens one it raised, as
+ * the Sim does before each car (without the 10ms it takes).
+ *
+ * @param gate - entrance or exit gate
+ */
+static void tidy_gate(boom_t *gate) {
+    pthread_mutex_lock(&gate->lock);
+    if (gate->status == 'L') parking_set(shm, &gate->status, 'C');
+    if (gate->status == 'R') parking_set(shm, &gate->status, 'O');
+    pthread_mutex_unlock(&gate->lock);
+    pthread_cond_broadcast(&gate->condition);
+}
+
+/**
+ * @brief Writes a reading's plate into an LPR and tells the Manager.
+ *
+ * @param sensor - LPR
+ * @param rec - reading
+ */
+static void write_plate(LPR_t *sensor, const lpr_record_t *rec) {
+    char plate[7];
+
+    memcpy(plate, rec->plate, 6);
+    plate[6] = '\0';
+    pthread_mutex_lock(&sensor->lock);
+    parking_set_plate(shm, sensor->plate, plate);
+    pthread_mutex_unlock(&sensor->lock);
+    pthread_cond_broadcast(&sensor->condition);
+}
+
+/**
+ * @brief Writes the replay's results as JSON.
+ *
+ * @param path - file to write
+ * @param capture - capture replayed
+ * @param players - every thread's results
+ * @param n - no. of threads
+ * @param secs - how long the replay took
+ */
+static void write_json(const char *path, const char *capture, player_t *players, int n, double secs) {
+    FILE *fp = fopen(path, "w");
+    int counts[LPR_WHERES] = {0, 0, 0};
+    int replayed = 0;
+
+    if (fp == NULL) {
+        perror(path);
+        return;
+    }
+    for (int r = 0; r < rp.count; r++) {
+        if (rp.done[r]) {
+            counts[rp.records[r].where]++;
+            replayed++;
+        }
+    }
+
+    fprintf(fp, "{\n\"capture\": \"%s\",\n\"fast\": %s,\n\"seconds\": %.3f,\n", capture, rp.fast ? "true" : "false", secs);
+    fprintf(fp, "\"readings\": {\"captured\": %d, \"answered\": %d, \"entrance\": %d, \"exit\": %d, \"level\": %d},\n",
+        rp.count, replayed, counts[LPR_ENTRANCE], counts[LPR_EXIT], counts[LPR_LEVEL]);
+    fprintf(fp, "\"per_second\": %.3f,\n", (secs > 0) ? replayed / secs : 0);
+    for (int w = LPR_ENTRANCE; w <= LPR_EXIT; w++) {
+        fprintf(fp, "\"%s\": [", (w == LPR_ENTRANCE) ? "entrances" : "exits");
+        int first = 1;
+        for (int i = 0; i < n; i++) {
+            if ((int)players[i].where != w) continue;
+            fprintf(fp, "%s\n{\"id\": %d, \"answered\": ", first ? "" : ",", players[i].id);
+            hdr_json(fp, &players[i].answered);
+            if (w == LPR_ENTRANCE) {
+                fprintf(fp, ", \"signs\": {\"level\": %lu, \"not_authorised\": %lu, \"full\": %lu, \"fire\": %lu}",
+                    players[i].signs[0], players[i].signs[1], players[i].signs[2], players[i].signs[3]);
+            }
+            fprintf(fp, "}");
+            first = 0;
+        }
+        fprintf(fp, "\n]%s\n", (w == LPR_ENTRANCE) ? "," : "");
+    }
+    fprintf(fp, "}\n");
+    fclose(fp);
+    printf("~Results written to %s\n", path);
+}
+
+/**
+ * @brief Sleeps until a moment, straight away if it has passed.
+ *
+ * @param ms - CLOCK_MONOTONIC in ms
+ */
+static void sleep_until(double ms) {
+    struct timespec when;
+
+    when.tv_sec = (time_t)(ms / 1000);
+    when.tv_nsec = (long)((ms - ((double)when.tv_sec * 1000)) * 1000000);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &when, NULL) == EINTR && !rp.ending);
+}
@@ -0,0 +1,223 @@
+/************************************************
+ * @file    status-viewer.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Watches the car park from any terminal by reading
+ *          the Manager's status feed (STATUS_SOCKET in
+ *          config.h). Any no. of viewers may attach and
+ *          detach while the Manager runs.
+ *
+ *          ./STATUS-VIEWER [-r] [-n FRAMES] [-s MS] [socket]
+ *
+ *          -r         print each frame's changes as a line
+ *                     rather than redrawing the car park
+ *          -n FRAMES  stop after FRAMES frames
+ *          -s MS      wait MS ms after each frame (a slow
+ *                     viewer, to see frames conflate)
+ ***********************************************/
+#include <stdio.h>      /* for IO operations */
+#include <stdlib.h>     /* for atoi */
+#include <string.h>     /* for string operations */
+#include <stdint.h>     /* for int types */
+#include <time.h>       /* for lag & sleeping */
+#include <unistd.h>     /* for close */
+#include <sys/socket.h> /* for sockets */
+#include <sys/un.h>     /* for Unix socket addresses */
+
+#include "../config.h"  /* for STATUS_SOCKET */
+#include "../src-common/status-feed.h" /* for the frames */
+#include "../src-common/sim-clock.h" /* for the real clock */
+
+/* Names printed for each field_t, in the same order */
+static const char *field_names[FEED_FIELDS] = {"layout", "en-lpr", "en-gate", "en-sign", "ex-lpr", "ex-gate",
+    "lvl-lpr", "lvl-temp", "lvl-alarm", "lvl-cap", "revenue", "cars", "failsafe"};
+
+/* function prototypes */
+static void draw(const feed_state_t *s, const feed_header_t *h, double lag_ms);
+static void print_changes(const uint8_t *buf, size_t len, const feed_header_t *h, double lag_ms);
+static void plate_text(char *out, const char *plate);
+
+/**
+ * @brief Entry point for STATUS-VIEWER.
+ *
+ * @param argc - argument count
+ * @param argv - "-r", "-n FRAMES", "-s MS" then the socket, STATUS_SOCKET if none
+ * @return int - 0 once the feed ends, 1 if it could not attach
+ */
+int main(int argc, char **argv) {
+    const char *path = STATUS_SOCKET;
+    int raw = 0;
+    long limit = -1;
+    int pause_ms = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-r") == 0) {
+            raw = 1;
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            limit = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            pause_ms = atoi(argv[++i]);
+        } else {
+            path = argv[i];
+        }
+    }
+
+    /* -----------------------------------------------
+     *             ATTACH TO THE MANAGER
+     * -------------------------------------------- */
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        printf("~Could not attach to %s, is the Manager running with STATUS_SOCKET set in config.h?\n", path);
+        if (fd >= 0) close(fd);
+        return 1;
+    }
+
+    /* -----------------------------------------------
+     *        APPLY & SHOW EVERY FRAME UNTIL THE END
+     * -------------------------------------------- */
+    feed_state_t state;
+    feed_header_t h;
+    uint8_t frame[FEED_FRAME];
+    unsigned long frames = 0;
+    unsigned long snapshots = 0;
+    unsigned long long bytes = 0;
+    unsigned long records = 0;
+    double lag_sum = 0;
+    double lag_max = 0;
+    ssize_t got;
+
+    memset(&state, 0, sizeof(state));
+    while ((limit < 0 || (long)frames < limit) && (got = recv(fd, frame, sizeof(frame), 0)) > 0) {
+        int applied = feed_apply(&state, frame, (size_t)got, &h);
+        if (applied < 0) {
+            puts("~Not a status feed of this version, stopping");
+            break;
+        }
+        double lag_ms = (double)(mono_ns() - h.ns) / 1e6;
+
+        frames++;
+        bytes += (unsigned long long)got;
+        records += (unsigned long)applied;
+        if (h.kind == FEED_SNAPSHOT) snapshots++;
+        lag_sum += lag_ms;
+        if (lag_ms > lag_max) lag_max = lag_ms;
+
+        if (raw) {
+            print_changes(frame, (size_t)got, &h, lag_ms);
+        } else {
+            draw(&state, &h, lag_ms);
+        }
+
+        if (pause_ms > 0) {
+            struct timespec nap = {pause_ms / 1000, (pause_ms % 1000) * 1000000L};
+            nanosleep(&nap, NULL);
+        }
+    }
+    close(fd);
+
+    if (frames == 0) puts("~Feed ended before any frame, the Manager ended or has too many viewers");
+    printf("~%lu frames (%lu snapshots), %lu changes, %.1f bytes per frame", frames, snapshots, records,
+        (frames > 0) ? (double)bytes / (double)frames : 0.0);
+    if (frames > 0) printf(", lag %.2fms avg %.2fms max", lag_sum / (double)frames, lag_max);
+    printf("\n");
+    return 0;
+}
+
+/**
+ * @brief Redraws the whole car park, like the Manager's display.
+ *
+ * @param s - state to draw
+ * @param h - header of the latest frame
+ * @param lag_ms - ms from the state being taken to it being drawn
+ */
+static void draw(const feed_state_t *s, const feed_header_t *h, double lag_ms) {
+    char plate[7];
+    int total = 0;
+
+    printf("\033[H\033[2J");
+    printf("CAR PARK STATUS (frame %u, %s, %.2fms behind)\n\n", h->seq, (h->kind == FEED_SNAPSHOT) ? "snapshot" : "delta", lag_ms);
+    for (int i = 0; i < s->ens; i++) {
+        plate_text(plate, s->en[i].plate);
+        printf("ENTRANCE #%d:\tLPR(%s) Gate(%c) Sign(%c)\n", i + 1, plate, s->en[i].gate, s->en[i].sign ? s->en[i].sign : '-');
+    }
+    printf("\n");
+    for (int i = 0; i < s->exs; i++) {
+        plate_text(plate, s->ex[i].plate);
+        printf("EXIT #%d:\tLPR(%s) Gate(%c)\n", i + 1, plate, s->ex[i].gate);
+    }
+    printf("\n");
+    for (int i = 0; i < s->lvls; i++) {
+        plate_text(plate, s->lvl[i].plate);
+        printf("LEVEL #%d:\tLPR(%s) Temp(%d°) Alarm(%c) Capacity(%d/%d)parked\n", i + 1, plate, s->lvl[i].temp,
+            s->lvl[i].alarm, s->lvl[i].capacity, s->cap);
+        total += s->lvl[i].capacity;
+    }
+    printf("\n\t TOTAL CAPACITY: %d/%d parked", total, s->cap * s->lvls);
+    printf("\n\tTOTAL CUSTOMERS: %d cars", s->cars);
+    printf("\n\t  TOTAL REVENUE: $%.2f\n\n", (double)s->revenue / 100);
+    if (s->failsafe) printf("\tFIRE ALARM SYSTEM NOT RESPONDING - GATES RAISED\n");
+    fflush(stdout);
+}
+
+/**
+ * @brief Prints a frame's records on 1 line, such as "en-gate[2]=O".
+ *
+ * @param buf - the frame
+ * @param len - bytes in the frame
+ * @param h - the frame's header
+ * @param lag_ms - ms from the state being taken to it being printed
+ */
+static void print_changes(const uint8_t *buf, size_t len, const feed_header_t *h, double lag_ms) {
+    size_t at = sizeof(feed_header_t);
+
+    printf("#%u %c %3ub %.2fms:", h->seq, h->kind, (unsigned)len, lag_ms);
+    for (int r = 0; r < h->records && at + 2 <= len; r++) {
+        int field = buf[at];
+        int size = feed_value_size(field);
+        const uint8_t *v = buf + at + 2;
+
+        if (size < 0 || field >= FEED_FIELDS || at + 2 + (size_t)size > len) break;
+        printf(" %s[%d]=", field_names[field], buf[at + 1]);
+        if (field == FD_LAYOUT) {
+            uint16_t cap;
+            memcpy(&cap, v + 4, 2);
+            printf("%u/%u/%u/%u", v[0], v[1], v[2], cap);
+        } else if (size == 6) {
+            char plate[7];
+            plate_text(plate, (const char *)v);
+            printf("%s", plate);
+        } else if (size == 4) {
+            int32_t n;
+            memcpy(&n, v, 4);
+            printf("%d", n);
+        } else if (size == 2) {
+            int16_t n;
+            memcpy(&n, v, 2);
+            printf("%d", n);
+        } else if (field == FD_FAILSAFE) {
+            printf("%d", v[0]);
+        } else {
+            printf("%c", v[0] ? v[0] : '-');
+        }
+        at += 2 + (size_t)size;
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+/**
+ * @brief Writes a plate as text, "------" if the LPR is empty.
+ *
+ * @param out - 7 chars
+ * @param plate - 6 chars, '\0' padded
+ */
+static void plate_text(char *out, const char *plate) {
+    memcpy(out, plate, 6);
+    out[6] = '\0';
+    if (strlen(out) < 6) strcpy(out, "------");
+}
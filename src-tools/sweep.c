@@ -0,0 +1,605 @@
+/************************************************
+ * @file    sweep.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Sweeps a design space for capacity planning.
+ *          Runs the whole car park once for every mix of
+ *          the entrances, exits, levels, capacities, arrival
+ *          rates & chances asked for, several runs at once
+ *          (1 per CPU by default), and prints a table of
+ *          each configuration's throughput, the share of cars
+ *          turned away as the car park was full ('F') or not
+ *          authorised ('X'), and queue waits, so a whole
+ *          design space is evaluated in minutes.
+ *
+ *          ./SWEEP [-e ENS] [-x EXS] [-l LVLS] [-c CAPS]
+ *                  [-r RATES] [-p CHANCES] [-t SECS] [-s SPEED]
+ *                  [-S SEED] [-j JOBS] [-o FILE] [-d DIR]
+ *
+ *          -e ENS      entrances (default 5)
+ *          -x EXS      exits (default 5)
+ *          -l LVLS     levels (default 5)
+ *          -c CAPS     parking spots per level (config.h's)
+ *          -r RATES    cars arriving per second (default 20,
+ *                      0 = a car every 1..100ms at random)
+ *          -p CHANCES  chance of an authorised plate (config.h's)
+ *          -t SECS     how long each run lasts (default 10)
+ *          -s SPEED    simulated time per real second, so each
+ *                      run covers SECS x SPEED seconds of
+ *                      traffic (default 10)
+ *          -S SEED     cars' seed, the same for every run so
+ *                      configurations see the same cars
+ *                      (default 1, 0 = different every run)
+ *          -j JOBS     runs at once (default the no. of CPUs)
+ *          -o FILE     results (default sweep.json)
+ *          -d DIR      each run's output & results, in a folder
+ *                      per configuration (default sweep-runs)
+ *
+ *          Each range is comma separated values, FROM-TO or
+ *          FROM-TO:STEP, such as "-e 1-5 -c 10,20,40
+ *          -p 0.2-1:0.2". Every mix of them is run.
+ *
+ *          Run from the folder holding ./INTEGRATED and
+ *          plates.txt. Each run is its own ./INTEGRATED process
+ *          (its PARKING region is private, see
+ *          src-integrated/parking-region.h) working in its own
+ *          folder, with metrics & the status feed off, so runs
+ *          never share anything. Settings are given as
+ *          CARPARK_ variables (see src-common/run-config.h).
+ ***********************************************/
+#include <stdio.h>      /* for IO operations */
+#include <stdlib.h>     /* for strtod & setenv */
+#include <string.h>     /* for string operations */
+#include <errno.h>      /* for telling an existing folder apart */
+#include <fcntl.h>      /* for redirecting output */
+#include <limits.h>     /* for PATH_MAX */
+#include <signal.h>     /* for stopping a stuck run */
+#include <time.h>       /* for sleeping & timestamps */
+#include <unistd.h>     /* for fork & exec */
+#include <sys/stat.h>   /* for mkdir */
+#include <sys/wait.h>   /* for waiting on the runs */
+
+#include "../config.h"  /* for CAPACITY & CHANCE */
+#include "../src-common/sim-clock.h" /* for the real clock */
+
+#define MAX_VALUES 64           /* per range */
+#define MAX_CONFIGS 10000       /* mixes of every range */
+#define MAX_JOBS 256            /* runs at once */
+#define END_GRACE 30            /* s after a run should end before it is killed */
+#define POLL_MS 50              /* between checks for finished runs */
+#define JSON_SIZE 65536         /* bytes of a run's results read for the table */
+#define TABLE_LINE "--------------------------------------------------------------------------------------------------------\n"
+
+/* Values of 1 setting to sweep */
+typedef struct range_t {
+    double values[MAX_VALUES];
+    int count;
+} range_t;
+
+/* 1 configuration & its run */
+typedef struct config_t {
+    int ens;
+    int exs;
+    int lvls;
+    int cap;
+    int rate;
+    double chance;
+    char name[64];      /* also its folder */
+    pid_t pid;          /* 0 = not started, -1 = done */
+    double deadline;    /* now_ms to kill it at */
+    int rc;             /* ./INTEGRATED's exit code, 128 + signal if killed */
+} config_t;
+
+/* Settings shared by every run */
+typedef struct settings_t {
+    int secs;
+    double speed;
+    int seed;
+    int jobs;
+    const char *out;
+    const char *dir;
+    char program[PATH_MAX];     /* ./INTEGRATED, absolute as runs work in their own folder */
+    char plates[PATH_MAX];
+    char scenario[PATH_MAX];
+} settings_t;
+
+/* function prototypes */
+static int parse_range(const char *text, range_t *r, double lo, double hi, int whole);
+static int expand(range_t *r, config_t *configs);
+static pid_t start(settings_t *s, config_t *c);
+static void link_input(const char *from, const char *folder, const char *name);
+static void set_int(const char *name, int value);
+static int reap(config_t *configs, int count, int *running);
+static void write_run(FILE *fp, settings_t *s, config_t *c, int first);
+static void print_run(settings_t *s, config_t *c);
+static void embed(FILE *fp, const char *path);
+static double json_number(const char *path, const char *member, const char *key);
+static void sleep_ms(double ms);
+
+/**
+ * @brief Entry point for SWEEP.
+ *
+ * @param argc - argument count
+ * @param argv - see the file's brief
+ * @return int - 0 once every run is written, 1 if the arguments are wrong
+ */
+int main(int argc, char **argv) {
+    static config_t configs[MAX_CONFIGS]; /* ~1MB, kept off the stack */
+    static settings_t s = {10, 10, 1, 0, "sweep.json", "sweep-runs", "", "", ""};
+    const char *texts[6] = {"5", "5", "5", NULL, "20", NULL};
+    const char *flags[6] = {"-e", "-x", "-l", "-c", "-r", "-p"};
+    char cap[16], chance[16];
+
+    snprintf(cap, sizeof(cap), "%d", CAPACITY);
+    snprintf(chance, sizeof(chance), "%g", CHANCE);
+    texts[3] = cap;
+    texts[5] = chance;
+    s.jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    for (int i = 1; i < argc; i++) {
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        int range = -1;
+
+        for (int k = 0; k < 6; k++) {
+            if (strcmp(argv[i], flags[k]) == 0) range = k;
+        }
+        if (value != NULL && range >= 0) {
+            texts[range] = value;
+        } else if (value != NULL && strcmp(argv[i], "-t") == 0) {
+            s.secs = atoi(value);
+        } else if (value != NULL && strcmp(argv[i], "-s") == 0) {
+            s.speed = strtod(value, NULL);
+        } else if (value != NULL && strcmp(argv[i], "-S") == 0) {
+            s.seed = atoi(value);
+        } else if (value != NULL && strcmp(argv[i], "-j") == 0) {
+            s.jobs = atoi(value);
+        } else if (value != NULL && strcmp(argv[i], "-o") == 0) {
+            s.out = value;
+        } else if (value != NULL && strcmp(argv[i], "-d") == 0) {
+            s.dir = value;
+        } else {
+            puts("usage: ./SWEEP [-e ENS] [-x EXS] [-l LVLS] [-c CAPS] [-r RATES] [-p CHANCES] [-t SECS] [-s SPEED] [-S SEED] [-j JOBS] [-o FILE] [-d DIR]");
+            return 1;
+        }
+        i++;
+    }
+
+    /* -----------------------------------------------
+     *     READ THE RANGES, THEN EVERY MIX OF THEM
+     * -------------------------------------------- */
+    static range_t ranges[6];
+    double lows[6] = {1, 1, 1, 1, 0, 0};
+    double highs[6] = {5, 5, 5, 1000000, 1000, 1};
+    for (int k = 0; k < 6; k++) {
+        if (parse_range(texts[k], &ranges[k], lows[k], highs[k], k < 5) < 1) {
+            printf("~%s %s: ranges are values, FROM-TO or FROM-TO:STEP, comma separated (up to %d values)\n",
+                flags[k], texts[k], MAX_VALUES);
+            puts("~ENS, EXS & LVLS must be 1..5, CAPS at least 1, RATES 0..1000 & CHANCES 0..1");
+            return 1;
+        }
+    }
+    int count = expand(ranges, configs);
+    if (count < 1) {
+        printf("~More than %d configurations, narrow the ranges\n", MAX_CONFIGS);
+        return 1;
+    }
+    if (s.secs < 1 || s.speed < 0.001 || s.speed > 1000 || s.seed < 0 || s.jobs < 1 || s.jobs > MAX_JOBS) {
+        printf("~SECS must be at least 1, SPEED 0.001..1000, SEED 0 or more & JOBS 1..%d\n", MAX_JOBS);
+        return 1;
+    }
+
+    /* runs work in their own folders, so find the inputs from here */
+    char here[PATH_MAX - 64]; /* room for the names added to it */
+    if (getcwd(here, sizeof(here)) == NULL) {
+        perror("getcwd");
+        return 1;
+    }
+    snprintf(s.program, sizeof(s.program), "%s/INTEGRATED", here);
+    snprintf(s.plates, sizeof(s.plates), "%s/plates.txt", here);
+    snprintf(s.scenario, sizeof(s.scenario), "%s/%s", here, SCENARIO_FILE);
+    if (access(s.program, X_OK) < 0) {
+        puts("~No ./INTEGRATED here, build it with make first");
+        return 1;
+    }
+
+    if (mkdir(s.dir, 0755) < 0 && errno != EEXIST) {
+        perror(s.dir);
+        return 1;
+    }
+    FILE *fp = fopen(s.out, "w");
+    if (fp == NULL) {
+        perror(s.out);
+        return 1;
+    }
+
+    time_t started = time(NULL);
+    char when[32];
+    strftime(when, sizeof(when), "%Y-%m-%dT%H:%M:%S", localtime(&started));
+
+    fprintf(fp, "{\n\"started\": \"%s\",\n\"cpus\": %ld,\n\"jobs\": %d,\n", when, sysconf(_SC_NPROCESSORS_ONLN), s.jobs);
+    fprintf(fp, "\"seconds\": %d,\n\"speed\": %g,\n\"seed\": %d,\n\"runs\": [\n", s.secs, s.speed, s.seed);
+
+    if (s.jobs > sysconf(_SC_NPROCESSORS_ONLN)) {
+        puts("~More runs at once than CPUs, overloaded runs may be slower & raise false fire alarms");
+    }
+    int rounds = (count + s.jobs - 1) / s.jobs;
+    printf("~%d configurations of %ds (%gs of traffic each), %d at a time, about %.1f minutes\n",
+        count, s.secs, s.secs * s.speed, s.jobs, rounds * (s.secs + 1) / 60.0);
+
+    /* -----------------------------------------------
+     *   KEEP JOBS RUNS GOING UNTIL EVERY ONE IS DONE
+     * -------------------------------------------- */
+    int next = 0, running = 0, done = 0;
+    while (done < count) {
+        while (running < s.jobs && next < count) {
+            configs[next].pid = start(&s, &configs[next]);
+            if (configs[next].pid > 0) {
+                running++;
+            } else {
+                configs[next].pid = -1;
+                configs[next].rc = -1;
+                done++;
+            }
+            next++;
+        }
+
+        int reaped = reap(configs, next, &running);
+        if (reaped > 0) {
+            done += reaped;
+            printf("\r~%d/%d runs done", done, count);
+            fflush(stdout);
+        } else {
+            sleep_ms(POLL_MS);
+        }
+    }
+    printf("\n");
+
+    /* -----------------------------------------------
+     *     EVERY RUN'S RESULTS, IN THE ORDER ASKED FOR
+     * -------------------------------------------- */
+    printf(TABLE_LINE);
+    printf("%-8s %6s %5s %6s %10s %10s %7s %7s %18s %10s %4s\n", "size", "cap", "rate", "chance",
+        "arrived/s", "admitted/s", "full F", "auth X", "en wait p50/p99", "ex p99", "rc");
+    printf(TABLE_LINE);
+    for (int i = 0; i < count; i++) {
+        write_run(fp, &s, &configs[i], i == 0);
+        print_run(&s, &configs[i]);
+    }
+    printf(TABLE_LINE);
+
+    fprintf(fp, "\n]\n}\n");
+    fclose(fp);
+    printf("~Results written to %s, each run's output in %s\n", s.out, s.dir);
+    return 0;
+}
+
+/**
+ * @brief Reads the values of 1 setting to sweep.
+ *
+ * @param text - comma separated, each a value, FROM-TO or FROM-TO:STEP
+ * @param r - set to the values, MAX_VALUES at most
+ * @param lo - lowest value allowed
+ * @param hi - highest value allowed
+ * @param whole - 1 if the values must be whole numbers
+ * @return int - no. of values, 0 if any is wrong or there are too many
+ */
+static int parse_range(const char *text, range_t *r, double lo, double hi, int whole) {
+    const char *at = text;
+
+    r->count = 0;
+    while (*at != '\0') {
+        char *end;
+        double from = strtod(at, &end);
+        double to = from;
+        double step = 1;
+
+        if (end == at) return 0;
+        at = end;
+        if (*at == '-') {
+            to = strtod(at + 1, &end);
+            if (end == at + 1) return 0;
+            at = end;
+        }
+        if (*at == ':') {
+            step = strtod(at + 1, &end);
+            if (end == at + 1 || step <= 0) return 0;
+            at = end;
+        }
+        if (from < lo || to > hi || to < from) return 0;
+
+        /* counted rather than added up, so 0.1 steps do not drift */
+        int steps = (int)(((to - from) / step) + 1e-9);
+        for (int k = 0; k <= steps; k++) {
+            double value = from + (k * step);
+
+            if (r->count == MAX_VALUES || (whole && value != (double)(long)value)) return 0;
+            r->values[r->count++] = value;
+        }
+
+        if (*at == ',') {
+            at++;
+        } else if (*at != '\0') {
+            return 0;
+        }
+    }
+    return r->count;
+}
+
+/**
+ * @brief Lists every mix of the ranges, the last range changing
+ * fastest.
+ *
+ * @param r - entrances, exits, levels, capacities, rates & chances
+ * @param configs - set to each mix, MAX_CONFIGS at most
+ * @return int - no. of configurations, 0 if there are too many
+ */
+static int expand(range_t *r, config_t *configs) {
+    long total = 1;
+
+    for (int k = 0; k < 6; k++) total *= r[k].count;
+    if (total > MAX_CONFIGS) return 0;
+
+    for (int i = 0; i < (int)total; i++) {
+        config_t *c = &configs[i];
+        int index[6];
+        int rest = i;
+
+        for (int k = 5; k >= 0; k--) {
+            index[k] = rest % r[k].count;
+            rest /= r[k].count;
+        }
+        memset(c, 0, sizeof(*c));
+        c->ens = (int)r[0].values[index[0]];
+        c->exs = (int)r[1].values[index[1]];
+        c->lvls = (int)r[2].values[index[2]];
+        c->cap = (int)r[3].values[index[3]];
+        c->rate = (int)r[4].values[index[4]];
+        c->chance = r[5].values[index[5]];
+        snprintf(c->name, sizeof(c->name), "%dx%dx%d-c%d-r%d-p%g", c->ens, c->exs, c->lvls, c->cap, c->rate, c->chance);
+    }
+    return (int)total;
+}
+
+/**
+ * @brief Starts 1 configuration's run in its own folder, with its
+ * output going to a file there.
+ *
+ * @param s - settings
+ * @param c - configuration to run, its deadline is set
+ * @return pid_t - the run's pid, -1 if it could not be started
+ */
+static pid_t start(settings_t *s, config_t *c) {
+    char folder[PATH_MAX];
+
+    snprintf(folder, sizeof(folder), "%s/%s", s->dir, c->name);
+    if (mkdir(folder, 0755) < 0 && errno != EEXIST) {
+        perror(folder);
+        return -1;
+    }
+    link_input(s->plates, folder, "plates.txt");
+    link_input(s->scenario, folder, SCENARIO_FILE);
+
+    /* results from an earlier sweep must not be taken for this one's */
+    char old[PATH_MAX + 32];
+    snprintf(old, sizeof(old), "%s/simulator.json", folder);
+    unlink(old);
+    snprintf(old, sizeof(old), "%s/manager.json", folder);
+    unlink(old);
+    snprintf(old, sizeof(old), "%s/billing.txt", folder);
+    unlink(old);
+
+    c->deadline = now_ms() + ((s->secs + END_GRACE) * 1000.0);
+    pid_t pid = fork();
+    if (pid != 0) return pid;
+
+    /* -----------------------------------------------
+     *  THE RUN'S OWN OVERRIDES, NOTHING SHARED WITH THE
+     *  OTHER RUNS (PORTS, SOCKETS, FILES)
+     * -------------------------------------------- */
+    if (chdir(folder) < 0) _exit(127);
+    int fd = open("integrated.out", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+        dup2(fd, STDOUT_FILENO);
+        dup2(fd, STDERR_FILENO);
+        close(fd);
+    }
+
+    char value[32];
+    set_int("ENTRANCES", c->ens);
+    set_int("EXITS", c->exs);
+    set_int("LEVELS", c->lvls);
+    set_int("CAPACITY", c->cap);
+    set_int("ARRIVAL_RATE", c->rate);
+    snprintf(value, sizeof(value), "%g", c->chance);
+    setenv("CARPARK_CHANCE", value, 1);
+    set_int("SEED", s->seed);
+    set_int("DURATION", s->secs);
+    snprintf(value, sizeof(value), "%g", s->speed);
+    setenv("CARPARK_SPEED", value, 1);
+    setenv("CARPARK_TRAFFIC_FILE", "", 0); /* a fixed rate, unless the caller gave a traffic profile */
+    setenv("CARPARK_METRICS_PORT", "0", 1);
+    setenv("CARPARK_STATUS_SOCKET", "", 1);
+    setenv("CARPARK_LPR_CAPTURE", "", 1);
+    setenv("CARPARK_HEADLESS", "1", 1);
+    setenv("CARPARK_RESULTS_DIR", ".", 1);
+
+    execl(s->program, s->program, (char *)NULL);
+    perror(s->program);
+    _exit(127);
+}
+
+/**
+ * @brief Links an input the programs read from their working folder
+ * into a run's folder.
+ *
+ * @param from - the input, absolute, nothing is linked if missing
+ * @param folder - the run's folder
+ * @param name - the name the programs open it by
+ */
+static void link_input(const char *from, const char *folder, const char *name) {
+    char to[PATH_MAX + 64];
+
+    if (access(from, R_OK) < 0) return;
+    snprintf(to, sizeof(to), "%s/%s", folder, name);
+    unlink(to);
+    if (symlink(from, to) < 0) perror(to);
+}
+
+/**
+ * @brief Sets 1 CARPARK_ override to a no.
+ *
+ * @param name - the setting, such as "ENTRANCES"
+ * @param value - its value
+ */
+static void set_int(const char *name, int value) {
+    char var[64], text[16];
+
+    snprintf(var, sizeof(var), "CARPARK_%s", name);
+    snprintf(text, sizeof(text), "%d", value);
+    setenv(var, text, 1);
+}
+
+/**
+ * @brief Collects every run that has ended, killing any past its
+ * deadline.
+ *
+ * @param configs - configurations started so far
+ * @param count - no. started so far
+ * @param running - runs going, less those collected
+ * @return int - no. of runs collected
+ */
+static int reap(config_t *configs, int count, int *running) {
+    int reaped = 0;
+
+    for (int i = 0; i < count; i++) {
+        config_t *c = &configs[i];
+        int status = 0;
+
+        if (c->pid <= 0) continue;
+        pid_t got = waitpid(c->pid, &status, WNOHANG);
+        if (got == 0 && now_ms() > c->deadline) {
+            kill(c->pid, SIGKILL);
+            got = waitpid(c->pid, &status, 0);
+        }
+        if (got != c->pid) continue;
+
+        c->rc = WIFSIGNALED(status) ? 128 + WTERMSIG(status) : WEXITSTATUS(status);
+        c->pid = -1;
+        (*running)--;
+        reaped++;
+    }
+    return reaped;
+}
+
+/**
+ * @brief Writes 1 run's configuration & the Sim's & Manager's results.
+ *
+ * @param fp - results file, inside the "runs" array
+ * @param s - settings
+ * @param c - configuration, once its run is done
+ * @param first - 1 if no run has been written yet
+ */
+static void write_run(FILE *fp, settings_t *s, config_t *c, int first) {
+    char path[PATH_MAX + 64];
+
+    fprintf(fp, "%s{\n\"entrances\": %d, \"exits\": %d, \"levels\": %d, \"capacity\": %d, \"arrival_rate\": %d, \"chance\": %g,\n",
+        first ? "" : ",\n", c->ens, c->exs, c->lvls, c->cap, c->rate, c->chance);
+    fprintf(fp, "\"exit_code\": %d,\n\"simulator\": ", c->rc);
+    snprintf(path, sizeof(path), "%s/%s/simulator.json", s->dir, c->name);
+    embed(fp, path);
+    fprintf(fp, ",\n\"manager\": ");
+    snprintf(path, sizeof(path), "%s/%s/manager.json", s->dir, c->name);
+    embed(fp, path);
+    fprintf(fp, "\n}");
+}
+
+/**
+ * @brief Prints 1 run's line of the table from the Sim's results.
+ * Shares turned away are of the cars that arrived.
+ *
+ * @param s - settings
+ * @param c - configuration, once its run is done
+ */
+static void print_run(settings_t *s, config_t *c) {
+    char path[PATH_MAX + 64];
+    char size[16];
+    char waits[32];
+
+    snprintf(path, sizeof(path), "%s/%s/simulator.json", s->dir, c->name);
+    double arrived = json_number(path, "\"cars\"", "\"arrived\"");
+    double full = json_number(path, "\"cars\"", "\"full\"");
+    double denied = json_number(path, "\"cars\"", "\"denied\"");
+    double evacuated = json_number(path, "\"cars\"", "\"evacuated\"");
+    if (arrived < 1) arrived = 1;
+
+    snprintf(size, sizeof(size), "%dx%dx%d", c->ens, c->exs, c->lvls);
+    snprintf(waits, sizeof(waits), "%.1f/%.1fms", json_number(path, "\"entrance_queue_wait\"", "\"p50_ms\""),
+        json_number(path, "\"entrance_queue_wait\"", "\"p99_ms\""));
+    printf("%-8s %6d %5d %6g %10.2f %10.2f %6.1f%% %6.1f%% %18s %8.1fms %4d\n", size, c->cap, c->rate, c->chance,
+        json_number(path, "\"per_second\"", "\"arrived\""), json_number(path, "\"per_second\"", "\"admitted\""),
+        (full / arrived) * 100, (denied / arrived) * 100, waits, json_number(path, "\"exit_queue_wait\"", "\"p99_ms\""), c->rc);
+
+    /* a fire alarm (such as a false one when the CPUs are overloaded) skews the run */
+    if (evacuated > 0) printf("%-8s %.0f cars turned away by a fire alarm, see %s/%s\n", "", evacuated, s->dir, c->name);
+}
+
+/**
+ * @brief Copies a program's JSON results into the results file.
+ *
+ * @param fp - results file
+ * @param path - the program's results, null is written if missing
+ */
+static void embed(FILE *fp, const char *path) {
+    FILE *in = fopen(path, "r");
+    char buf[4096];
+    size_t n;
+    int any = 0;
+
+    if (in != NULL) {
+        while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+            /* drop the last newline so the object sits inside the array */
+            if (n < sizeof(buf) && buf[n - 1] == '\n') n--;
+            fwrite(buf, 1, n, fp);
+            any = 1;
+        }
+        fclose(in);
+    }
+    if (!any) fprintf(fp, "null");
+}
+
+/**
+ * @brief Finds a no. inside a member of a program's JSON results, for
+ * the table (the results file has them all).
+ *
+ * @param path - the program's results
+ * @param member - member holding the no., such as "\"entrance_queue_wait\""
+ * @param key - the no.'s key within it, such as "\"p99_ms\""
+ * @return double - the no., 0 if not found
+ */
+static double json_number(const char *path, const char *member, const char *key) {
+    static char text[JSON_SIZE];
+    FILE *in = fopen(path, "r");
+    double value = 0;
+
+    if (in == NULL) return 0;
+    size_t n = fread(text, 1, sizeof(text) - 1, in);
+    fclose(in);
+    text[n] = '\0';
+
+    const char *at = strstr(text, member);
+    if (at != NULL) at = strstr(at, key);
+    if (at != NULL) at = strchr(at, ':');
+    if (at != NULL) value = strtod(at + 1, NULL);
+    return value;
+}
+
+/**
+ * @brief Sleeps, returning at once if 'ms' is not above 0.
+ *
+ * @param ms - milliseconds to sleep
+ */
+static void sleep_ms(double ms) {
+    if (ms <= 0) return;
+    struct timespec nap = {(time_t)(ms / 1000), (long)((ms - ((double)(long)(ms / 1000) * 1000)) * 1000000)};
+    nanosleep(&nap, NULL);
+}
@@ -0,0 +1,328 @@
+/************************************************
+ * @file    trace-merge.c
+ * @author  Johnny Madigan
+ * @date    October 2021
+ * @brief   Joins the trace files written by the Sim, Manager
+ *          and Fire Alarm System (built with TRACE 1 in
+ *          config.h) into 1 Chrome trace_event JSON file.
+ *
+ *          Spans are shown per program & thread, and spans of
+ *          each car are also shown on the car's own row (under
+ *          "cars"), so 1 car's journey through all 3 programs
+ *          reads left to right in 1 timeline.
+ *
+ *          The Sim numbers every car it spawns, the Manager
+ *          only sees plates. A Manager span is joined to the
+ *          Sim's car with the same plate whose journey (first
+ *          to last span) it falls within.
+ *
+ *          ./TRACE-MERGE [-o trace.json] [trace files...]
+ *
+ *          Open trace.json in chrome://tracing or
+ *          https://ui.perfetto.dev
+ ***********************************************/
+#include <stdio.h>      /* for IO operations */
+#include <stdlib.h>     /* for dynamic memory & sorting */
+#include <string.h>     /* for string operations */
+#include <stdint.h>     /* for int types */
+
+#define DEFAULT_OUT "trace.json"
+#define PROGRAMS 8      /* trace files merged at most */
+
+/* 1 span read from a trace file */
+typedef struct span_t {
+    uint64_t start;     /* ns */
+    uint64_t dur;       /* ns */
+    unsigned tid;
+    unsigned seq;       /* car's sequence no., 0 = unknown */
+    int program;        /* index into programs */
+    char name[32];
+    char plate[8];      /* "-" = not a car's span */
+} span_t;
+
+/* 1 car's visit, as numbered by the Sim */
+typedef struct journey_t {
+    char plate[8];
+    unsigned seq;
+    uint64_t first;     /* start of its first span */
+    uint64_t last;      /* end of its last span */
+} journey_t;
+
+static const char *default_files[] = {"trace-simulator.txt", "trace-manager.txt", "trace-fire-alarm.txt"};
+
+/* function prototypes */
+static int read_file(const char *path, int program, char *name, span_t **spans, size_t *count, size_t *cap);
+static size_t find_journeys(span_t *spans, size_t count, journey_t **journeys);
+static journey_t *join(journey_t *journeys, size_t count, span_t *s);
+static int by_journey(const void *a, const void *b);
+static int by_plate(const void *a, const void *b);
+
+/**
+ * @brief Entry point for TRACE-MERGE.
+ *
+ * @param argc - argument count
+ * @param argv - "-o out.json" then trace files, the 3 defaults if none
+ * @return int - 0 on success, 1 if nothing could be read or written
+ */
+int main(int argc, char **argv) {
+    const char *out = DEFAULT_OUT;
+    const char *files[PROGRAMS];
+    char names[PROGRAMS][64];
+    int nfiles = 0;
+    int read = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            out = argv[++i];
+        } else if (nfiles < PROGRAMS) {
+            files[nfiles++] = argv[i];
+        }
+    }
+    if (nfiles == 0) {
+        for (int i = 0; i < 3; i++) files[nfiles++] = default_files[i];
+    }
+
+    /* -----------------------------------------------
+     *              READ EVERY TRACE FILE
+     * -------------------------------------------- */
+    span_t *spans = NULL;
+    size_t count = 0;
+    size_t cap = 0;
+
+    for (int i = 0; i < nfiles; i++) {
+        if (read_file(files[i], i, names[i], &spans, &count, &cap) == 0) {
+            read++;
+        } else {
+            snprintf(names[i], sizeof(names[i]), "%s", files[i]);
+            printf("~Skipping %s (could not read it)\n", files[i]);
+        }
+    }
+    if (read == 0 || count == 0) {
+        puts("~No spans to merge, build with TRACE 1 in config.h and run the programs first");
+        free(spans);
+        return 1;
+    }
+
+    /* -----------------------------------------------
+     *     JOIN MANAGER (& OTHER UNNUMBERED) SPANS
+     *     TO THE SIM'S CARS BY PLATE & TIME
+     * -------------------------------------------- */
+    journey_t *journeys = NULL;
+    size_t cars = find_journeys(spans, count, &journeys);
+    size_t joined = 0;
+    size_t unjoined = 0;
+    uint64_t origin = spans[0].start;
+
+    for (size_t i = 0; i < count; i++) {
+        span_t *s = &spans[i];
+        if (s->start < origin) origin = s->start;
+        if (s->seq == 0 && strcmp(s->plate, "-") != 0) {
+            journey_t *j = join(journeys, cars, s);
+            if (j != NULL) {
+                s->seq = j->seq;
+                joined++;
+            } else {
+                unjoined++;
+            }
+        }
+    }
+
+    /* -----------------------------------------------
+     *              WRITE CHROME JSON
+     * -----------------------------------------------
+     * pid 0 is "cars" with 1 row (tid) per car, each
+     * program after that has 1 row per thread
+     */
+    FILE *fp = fopen(out, "w");
+    if (fp == NULL) {
+        perror("fopen trace json");
+        free(spans);
+        free(journeys);
+        return 1;
+    }
+
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"cars\"}}");
+    for (int i = 0; i < nfiles; i++) {
+        fprintf(fp, ",\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"%s\"}}", i + 1, names[i]);
+    }
+    for (size_t i = 0; i < cars; i++) {
+        fprintf(fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"%s #%u\"}}",
+            journeys[i].seq, journeys[i].plate, journeys[i].seq);
+    }
+    for (size_t i = 0; i < count; i++) {
+        span_t *s = &spans[i];
+        double ts = (double)(s->start - origin) / 1000;
+        double dur = (double)s->dur / 1000;
+
+        fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%u",
+            s->name, names[s->program], ts, dur, s->program + 1, s->tid);
+        if (strcmp(s->plate, "-") != 0) {
+            fprintf(fp, ",\"args\":{\"car\":\"%s #%u\"}}", s->plate, s->seq);
+        } else {
+            fprintf(fp, "}");
+        }
+
+        /* also on the car's own row */
+        if (s->seq != 0) {
+            fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":%u}",
+                s->name, names[s->program], ts, dur, s->seq);
+        }
+    }
+    fprintf(fp, "\n]}\n");
+    fclose(fp);
+
+    printf("~Merged %lu spans from %d trace files, %lu cars\n", (unsigned long)count, read, (unsigned long)cars);
+    printf("~%lu spans joined to a car by plate, %lu not (no Sim car with that plate at the time)\n",
+        (unsigned long)joined, (unsigned long)unjoined);
+    printf("~Written to %s, open it in chrome://tracing or https://ui.perfetto.dev\n", out);
+
+    free(spans);
+    free(journeys);
+    return 0;
+}
+
+/**
+ * @brief Reads every span of 1 trace file, growing the array as needed.
+ *
+ * @param path - trace file
+ * @param program - index of the file
+ * @param name - where to write the program's name & pid (64 bytes)
+ * @param spans - array to append to
+ * @param count - spans in the array
+ * @param cap - room in the array
+ * @return int - 0 if read, -1 if not
+ */
+static int read_file(const char *path, int program, char *name, span_t **spans, size_t *count, size_t *cap) {
+    FILE *fp = fopen(path, "r");
+    char line[256];
+    char program_name[32] = "program";
+    int pid = 0;
+
+    if (fp == NULL) return -1;
+
+    if (fgets(line, sizeof(line), fp) != NULL) sscanf(line, "# %31s %d", program_name, &pid);
+    snprintf(name, 64, "%s (pid %d)", program_name, pid);
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        span_t s;
+        unsigned long start, dur;
+
+        if (sscanf(line, "%lu %lu %u %31s %7s %u", &start, &dur, &s.tid, s.name, s.plate, &s.seq) != 6) continue;
+        s.start = start;
+        s.dur = dur;
+        s.program = program;
+
+        /* if we've run out of memory, realloc the array */
+        if (*count >= *cap) {
+            size_t bigger = (*cap == 0) ? 4096 : *cap * 2;
+            span_t *more = realloc(*spans, bigger * sizeof(span_t));
+            if (more == NULL) {
+                perror("realloc spans");
+                fclose(fp);
+                return -1;
+            }
+            *spans = more;
+            *cap = bigger;
+        }
+        (*spans)[(*count)++] = s;
+    }
+    fclose(fp);
+    return 0;
+}
+
+/**
+ * @brief Finds every numbered car's first & last span.
+ *
+ * @param spans - every span
+ * @param count - no. of spans
+ * @param journeys - set to a new array, sorted by plate then time (freed by the caller)
+ * @return size_t - no. of journeys
+ */
+static size_t find_journeys(span_t *spans, size_t count, journey_t **journeys) {
+    journey_t *j = malloc(sizeof(journey_t) * (count + 1));
+    size_t n = 0;
+
+    if (j == NULL) {
+        perror("malloc journeys");
+        exit(1);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (spans[i].seq == 0) continue;
+        strcpy(j[n].plate, spans[i].plate);
+        j[n].seq = spans[i].seq;
+        j[n].first = spans[i].start;
+        j[n].last = spans[i].start + spans[i].dur;
+        n++;
+    }
+
+    /* fold each car's spans into 1 journey */
+    qsort(j, n, sizeof(journey_t), by_journey);
+    size_t cars = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (cars > 0 && j[cars - 1].seq == j[i].seq) {
+            if (j[i].first < j[cars - 1].first) j[cars - 1].first = j[i].first;
+            if (j[i].last > j[cars - 1].last) j[cars - 1].last = j[i].last;
+        } else {
+            j[cars++] = j[i];
+        }
+    }
+    qsort(j, cars, sizeof(journey_t), by_plate);
+    *journeys = j;
+    return cars;
+}
+
+/**
+ * @brief Finds the car a span belongs to: the journey with the same plate
+ * that the span starts within, or else the latest to start before it.
+ *
+ * @param journeys - sorted by plate then time
+ * @param count - no. of journeys
+ * @param s - span with a plate
+ * @return journey_t* - the car's journey, NULL if none
+ */
+static journey_t *join(journey_t *journeys, size_t count, span_t *s) {
+    size_t lo = 0;
+    size_t hi = count;
+    journey_t *best = NULL;
+
+    /* first journey with this plate */
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (strcmp(journeys[mid].plate, s->plate) < 0) lo = mid + 1; else hi = mid;
+    }
+    for (size_t i = lo; i < count && strcmp(journeys[i].plate, s->plate) == 0; i++) {
+        if (journeys[i].first > s->start) break;
+        best = &journeys[i];
+        if (s->start <= journeys[i].last) break;
+    }
+    return best;
+}
+
+/**
+ * @brief Orders journeys by sequence no., for qsort.
+ *
+ * @param a - journey
+ * @param b - journey
+ * @return int - <0, 0 or >0
+ */
+static int by_journey(const void *a, const void *b) {
+    const journey_t *x = a;
+    const journey_t *y = b;
+    return (x->seq > y->seq) - (x->seq < y->seq);
+}
+
+/**
+ * @brief Orders journeys by plate then when they started, for qsort.
+ *
+ * @param a - journey
+ * @param b - journey
+ * @return int - <0, 0 or >0
+ */
+static int by_plate(const void *a, const void *b) {
+    const journey_t *x = a;
+    const journey_t *y = b;
+    int c = strcmp(x->plate, y->plate);
+    return (c != 0) ? c : (x->first > y->first) - (x->first < y->first);
+}